@@ -27,6 +27,7 @@
 #include <vector>
 #include <string>
 #include <functional>
+#include <unordered_set>
 
 #include "base_object.hpp"
 #include "operator.hpp"
@@ -72,6 +73,7 @@ public:
     }
     void AddOutputNode(Node* node)
     {
+        MarkGraphOutput(node, true);
         output_nodes.push_back(node);
     }
 
@@ -84,6 +86,9 @@ public:
     }
     void ResetOutputNode(void)
     {
+        for (auto node : output_nodes)
+            MarkGraphOutput(node, false);
+
         output_nodes.clear();
     }
 
@@ -105,13 +110,20 @@ public:
     bool AddNode(Node* node, bool set_owner = true);
     bool AddTensor(Tensor* tensor, bool set_owner = true);
     bool RemoveTensor(Tensor* tensor);
-    bool RemoveNode(Node* node);
+    /* keep_order == false moves the last node into the hole: for batched edits followed by SanitizeGraph() */
+    bool RemoveNode(Node* node, bool keep_order = true);
 
-    bool CreateNodeFromStatic(Node*, const StaticGraph*, const StaticNode*);
-    bool SetupConnection(Tensor*, const StaticGraph*, const StaticTensor*);
+    bool CreateNodeFromStatic(Node*, const StaticGraph*, StaticNode*, bool take_over);
+    bool SetupConnection(Tensor*, const StaticGraph*, const StaticTensor*, bool take_over);
 
-    bool RealCreateFromStatic(const StaticGraphPtr&);
-    static Graph* CreateFromStatic(const std::string& graph_name, const StaticGraphPtr& static_graph);
+    bool RealCreateFromStatic(const StaticGraphPtr&, bool take_over);
+    /*
+     * take_over: the static graph is not used by anyone else. names, shapes and attrs are
+     * moved out of it instead of copied, and all but its const tensor buffers are released
+     * once the graph is built
+     */
+    static Graph* CreateFromStatic(const std::string& graph_name, const StaticGraphPtr& static_graph,
+                                   bool take_over = false);
 
     StaticGraphPtr& GetOrigGraph(void);
 
@@ -119,6 +131,12 @@ public:
     std::vector<Node*> output_nodes;
     std::vector<Node*> seq_nodes;
 
+    /* after adding or removing seq_nodes directly: the next FindNode() rebuilds the name index */
+    void InvalidateNodeMap(void)
+    {
+        node_map_dirty_ = true;
+    }
+
     static void BFSVisit(Graph* graph, std::vector<Node*>& starts, graph_visit_t func, bool backward = true,
                          bool input_ready = true);
     static void BackwardBFS(Graph* graph, std::vector<Node*>& starts, graph_visit_t func, bool input_ready);
@@ -138,7 +156,8 @@ public:
     Tensor* GetInputTensor(const std::string& name);
     Tensor* GetOutputTensor(const std::string& name);
 
-    bool Replace(Subgraph* orig_sub, Subgraph* new_sb);
+    /* with sanitize == false, seq_nodes is left unsorted until the caller runs SanitizeGraph() */
+    bool Replace(Subgraph* orig_sub, Subgraph* new_sb, bool sanitize = true);
 
     void AddTensorMap(const std::string& tensor_name, Tensor* tensor);
     Graph* GetViewCopy(void);
@@ -196,7 +215,7 @@ protected:
     std::string name_;
     std::string type_;
 
-    std::vector<Node*> owned_nodes_;
+    std::unordered_set<Node*> owned_nodes_;
     std::unordered_map<std::string, Tensor*> owned_tensors_;
 
     int model_format_;
@@ -207,6 +226,29 @@ protected:
     Attribute attrs_;
 
     std::unordered_map<std::string, Tensor*> tensor_map_;
+
+    /*
+       name --> node in seq_nodes, kept up to date by AddNode/RemoveNode/Replace. seq_nodes
+       is public and may be filled directly: a new graph starts dirty, and whoever changes
+       seq_nodes of a graph already looked up in calls InvalidateNodeMap()
+    */
+    void IndexNode(Node* node);
+    void RebuildNodeMap(void);
+
+    /* output_nodes also collects nodes with unused outputs: the model outputs are tagged on their tensors */
+    static void MarkGraphOutput(Node* node, bool graph_output)
+    {
+        for (unsigned int i = 0; i < node->GetOutputNum(); i++)
+            node->GetOutputTensor(i)->SetGraphOutput(graph_output);
+    }
+
+    /* release a node which is no longer in seq_nodes/input_nodes/output_nodes */
+    void DetachNode(Node* node);
+    void RemoveUnvisitedNodes(const std::vector<int>& access_flag);
+
+    std::unordered_map<std::string, Node*> node_map_;
+    bool node_map_dirty_ = true;
+
     StaticGraphPtr orig_graph_;
     std::mutex graph_lock_;
 };
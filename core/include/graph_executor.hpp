@@ -47,6 +47,8 @@ public:
         exec_handle_ = nullptr;
         prerun_done_ = false;
         optimize_only = 0;
+        static_shape = 0;
+        infer_shape = 0;
 
         InitAttrIO();
     }
@@ -59,7 +61,8 @@ public:
             ReleaseExecHandle();
     }
 
-    bool CreateGraph(void* context, const char* graph_name, const char* model_name);
+    /* take_over: the graph owns the model, see Graph::CreateFromStatic() */
+    bool CreateGraph(void* context, const char* graph_name, const char* model_name, bool take_over = false);
 
     bool AttachGraph(void* context, Graph* graph_);
 
@@ -107,6 +110,7 @@ public:
     bool SetEventHook(int event, event_handler_t cb_func, void* cb_arg);
 
     bool InferShape(void);
+    void MarkStaticShape(Graph* graph);
 
     bool Prerun(void);
 
@@ -141,6 +145,15 @@ public:
     bool GetOptimizeOnly(const char* name, void* val, int size);
     bool SetOptimizeOnly(const char* name, const void* val, int size);
 
+    bool GetStaticShape(const char* name, void* val, int size);
+    bool SetStaticShape(const char* name, const void* val, int size);
+
+    bool GetInferShape(const char* name, void* val, int size);
+    bool SetInferShape(const char* name, const void* val, int size);
+
+    bool GetFuseAttr(const char* name, void* val, int size);
+    bool SetFuseAttr(const char* name, const void* val, int size);
+
     bool BailoutSetAttr(const char* name, const void* val, int size);
     bool BailoutGetAttr(const char* name, void* val, int size);
 
@@ -172,6 +185,8 @@ private:
     AttrIO attr_io_;
     bool prerun_done_;
     int optimize_only;
+    int static_shape;
+    int infer_shape;
 };
 
 }    // namespace TEngine
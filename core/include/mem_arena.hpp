@@ -0,0 +1,101 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2020, Open AI Lab
+ */
+
+#ifndef __MEM_ARENA_HPP__
+#define __MEM_ARENA_HPP__
+
+#include <cstdlib>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "utilities/non_copyable.hpp"
+
+namespace TEngine {
+
+/*
+ * bump allocator: memory is carved out of big blocks and only released,
+ * all together, when the arena goes away.
+ * objects created by New() must be destructed by the owner of the arena.
+ */
+class MemArena : public NonCopyable
+{
+public:
+    MemArena(size_t block_size = 64 * 1024)
+    {
+        block_size_ = block_size;
+        cur_ = nullptr;
+        left_ = 0;
+    }
+
+    ~MemArena()
+    {
+        for (auto block : blocks_)
+            std::free(block);
+    }
+
+    void* Alloc(size_t size, size_t align = alignof(std::max_align_t))
+    {
+        size_t pad = (align - (( size_t )cur_ & (align - 1))) & (align - 1);
+
+        if (cur_ == nullptr || pad + size > left_)
+        {
+            /* big objects get their own block */
+            size_t alloc_size = size + align > block_size_ ? size + align : block_size_;
+
+            char* block = static_cast<char*>(std::malloc(alloc_size));
+
+            if (block == nullptr)
+                throw std::bad_alloc();
+
+            blocks_.push_back(block);
+
+            cur_ = block;
+            left_ = alloc_size;
+            pad = (align - (( size_t )cur_ & (align - 1))) & (align - 1);
+        }
+
+        void* ptr = cur_ + pad;
+
+        cur_ += pad + size;
+        left_ -= pad + size;
+
+        return ptr;
+    }
+
+    template <typename T, typename... Args> T* New(Args&&... args)
+    {
+        return new (Alloc(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+private:
+    std::vector<char*> blocks_;
+    char* cur_;
+    size_t left_;
+    size_t block_size_;
+};
+
+}    // namespace TEngine
+
+#endif
@@ -34,6 +34,7 @@
 namespace TEngine {
 
 class Node;
+struct NodeOps;
 
 struct NodePort
 {
@@ -49,11 +50,13 @@ class Node : public BaseObject
 public:
     ~Node() {}
 
-    Node(const std::string& name)
+    Node(std::string name)
     {
-        name_ = name;
+        name_ = std::move(name);
         op_ = nullptr;
         dynamic_shape_ = false;
+        static_shape_ = false;
+        node_ops_ = nullptr;
     }
 
     Operator* GetOp(void) const
@@ -296,6 +299,12 @@ public:
         return op_.reset(op);
     }
 
+    /* Operator::Clone() resets the param to the defaults, this keeps it */
+    void ShareOp(const Node* node)
+    {
+        op_ = node->op_;
+    }
+
     void SetNodeIndex(int idx)
     {
         index_ = idx;
@@ -319,6 +328,27 @@ public:
         return true;
     }
 
+    /* the output dims were resolved at convert time for the saved input shapes */
+    bool IsStaticShape(void)
+    {
+        return static_shape_;
+    }
+    void SetStaticShape(bool val)
+    {
+        static_shape_ = val;
+    }
+
+    /* the ops bound by the device driver, looked up for every node on each run */
+    NodeOps* GetNodeOps(void) const
+    {
+        return node_ops_;
+    }
+
+    void SetNodeOps(NodeOps* node_ops)
+    {
+        node_ops_ = node_ops;
+    }
+
     bool InputReshaped(void)
     {
         Tensor* input = GetInputTensor(0);
@@ -341,6 +371,8 @@ protected:
     std::string name_;
     int index_;    // index in seq node list of graph
     bool dynamic_shape_;
+    bool static_shape_;
+    NodeOps* node_ops_;
 };
 
 #define ATTR_CUSTOM_ATTR "CUSTOM_ATTR"
@@ -84,6 +84,12 @@ public:
         return 0.0f;
     }
 
+    /* true if op is the same operator with the same param, an unknown op never is */
+    virtual bool IsSameParam(Operator* op)
+    {
+        return false;
+    }
+
     void SetOpVer(int op_ver)
     {
         op_ver_ = op_ver;
@@ -228,6 +234,11 @@ public:
         T* new_obj = new T(*dynamic_cast<T*>(this));
         return new_obj;
     }
+
+    bool IsSameParam(Operator* op) override
+    {
+        return dynamic_cast<T*>(op) != nullptr;
+    }
 };
 
 template <typename T, typename P> class OperatorWithParam : public Operator
@@ -249,6 +260,14 @@ public:
         return &param_;
     }
 
+    /* the param items declared by DECLARE_PARSER_ENTRY are compared */
+    bool IsSameParam(Operator* op) override
+    {
+        T* other = dynamic_cast<T*>(op);
+
+        return other != nullptr && param_.IsSameItems(*other->GetParam());
+    }
+
     void ParseDefParam(void)
     {
         ParseParam(param_, this);
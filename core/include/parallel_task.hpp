@@ -0,0 +1,94 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2020, Open AI Lab
+ */
+
+#ifndef __PARALLEL_TASK_HPP__
+#define __PARALLEL_TASK_HPP__
+
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace TEngine {
+
+/*
+ * run func(0) ... func(task_num - 1) on a bounded set of short-lived threads.
+ * tasks are handed out one index at a time, so uneven task costs balance out.
+ * max_thread <= 0 means one thread per hardware thread, which suits compute
+ * bound work; I/O bound callers may ask for more threads than cores.
+ */
+static inline int GetParallelThreadNum(int task_num, int max_thread = 0)
+{
+    int thread_num = max_thread;
+
+    if (thread_num <= 0)
+        thread_num = std::thread::hardware_concurrency();
+
+    if (thread_num <= 0)
+        thread_num = 1;
+
+    if (thread_num > task_num)
+        thread_num = task_num;
+
+    return thread_num;
+}
+
+static inline void ParallelRun(int task_num, const std::function<void(int)>& func, int max_thread = 0)
+{
+    if (task_num <= 0)
+        return;
+
+    int thread_num = GetParallelThreadNum(task_num, max_thread);
+
+    if (thread_num <= 1)
+    {
+        for (int i = 0; i < task_num; i++)
+            func(i);
+
+        return;
+    }
+
+    std::atomic<int> next_task(0);
+
+    auto worker = [&]() {
+        int idx;
+
+        while ((idx = next_task.fetch_add(1)) < task_num)
+            func(idx);
+    };
+
+    std::vector<std::thread> threads;
+
+    /* the caller thread works as well */
+    for (int i = 1; i < thread_num; i++)
+        threads.emplace_back(worker);
+
+    worker();
+
+    for (auto& t : threads)
+        t.join();
+}
+
+}    // namespace TEngine
+
+#endif
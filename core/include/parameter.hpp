@@ -35,11 +35,13 @@ struct NamedParam
 {
     using item_cpy_t = void (*)(void*, const void*);
     using item_set_any = void (*)(void*, const any&);
+    using item_cmp_t = bool (*)(const void*, const void*);
 
     struct ItemInfo
     {
         item_cpy_t cpy_func;
         item_set_any cpy_any;
+        item_cmp_t cmp_func;
         const char* type_name;
         int data;
     };
@@ -135,21 +137,36 @@ struct NamedParam
         return item_map_;
     }
 
+    /* other must be of the same param type: only the declared items are compared */
+    bool IsSameItems(const NamedParam& other) const
+    {
+        for (auto& e : item_map_)
+        {
+            const ItemInfo& entry = e.second;
+
+            if (!entry.cmp_func(( const char* )this + entry.data, ( const char* )&other + entry.data))
+                return false;
+        }
+
+        return true;
+    }
+
 protected:
     std::unordered_map<std::string, ItemInfo> item_map_;
 };
 
 #define DECLARE_PARSER_STRUCTURE(s) s(void)
 
-#define DECLARE_PARSER_ENTRY(e)                                                          \
-    {                                                                                    \
-        typedef decltype(e) T;                                                           \
-        ItemInfo info;                                                                   \
-        info.type_name = typeid(T).name();                                               \
-        info.data = ( char* )&e - ( char* )this;                                         \
-        info.cpy_func = [](void* data, const void* v) { *( T* )data = *( const T* )v; }; \
-        info.cpy_any = [](void* data, const any& n) { *( T* )data = any_cast<T>(n); };   \
-        item_map_[#e] = info;                                                            \
+#define DECLARE_PARSER_ENTRY(e)                                                                        \
+    {                                                                                                  \
+        typedef decltype(e) T;                                                                         \
+        ItemInfo info;                                                                                 \
+        info.type_name = typeid(T).name();                                                             \
+        info.data = ( char* )&e - ( char* )this;                                                       \
+        info.cpy_func = [](void* data, const void* v) { *( T* )data = *( const T* )v; };               \
+        info.cpy_any = [](void* data, const any& n) { *( T* )data = any_cast<T>(n); };                 \
+        info.cmp_func = [](const void* a, const void* b) { return *( const T* )a == *( const T* )b; }; \
+        item_map_[#e] = info;                                                                          \
     }
 
 }    // namespace TEngine
@@ -27,10 +27,12 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <unordered_map>
 
 #include "attribute.hpp"
 #include "safe_object_manager.hpp"
 #include "tensor_shape.hpp"
+#include "mem_arena.hpp"
 
 namespace TEngine {
 
@@ -40,9 +42,11 @@ struct StaticTensor;
 struct StaticOp;
 
 using StaticGraphPtr = std::shared_ptr<StaticGraph>;
-using StaticNodePtr = std::shared_ptr<StaticNode>;
-using StaticTensorPtr = std::shared_ptr<StaticTensor>;
-using StaticOpPtr = std::shared_ptr<StaticOp>;
+
+/* nodes, tensors and ops live in the arena of the graph and are released with it */
+using StaticNodePtr = StaticNode*;
+using StaticTensorPtr = StaticTensor*;
+using StaticOpPtr = StaticOp*;
 
 struct StaticGraph
 {
@@ -58,7 +62,10 @@ struct StaticGraph
     std::vector<int> output_node_list;
     std::vector<StaticNodePtr> node_list;
     std::vector<StaticTensorPtr> tensor_list;
+    std::vector<StaticOpPtr> op_list;
     std::unordered_map<std::string, StaticTensorPtr> const_tensor_map;
+    std::unordered_map<std::string, int> node_map;    // name --> index in node_list, first one wins
+    std::unordered_map<std::string, int> tensor_map;    // name --> index in tensor_list, first one wins
     std::vector<void*> mem_src;
     int graph_layout;
     int model_layout;
@@ -81,13 +88,15 @@ struct StaticGraph
     void* dev_handle;
     void (*release_func)(void*);
     const void* exec_context;
+
+    MemArena arena;
 };
 
 struct StaticNode
 {
     std::string name;
     int index;
-    StaticOpPtr op;
+    StaticOpPtr op = nullptr;
     Attribute attrs;
 
     std::vector<int> input_tensor_list;
@@ -140,11 +149,13 @@ struct StaticOp
 {
     std::string name;
     bool dynamic_shape;
+    bool static_shape;
     any param;
     Attribute attrs;
     StaticOp()
     {
         dynamic_shape = false;
+        static_shape = false;
     }
 };
 
@@ -69,6 +69,10 @@ void AddGraphInputNode(StaticGraph* graph, StaticNode* node);
 void AddGraphOutputNode(StaticGraph* graph, StaticNode* node);
 bool CheckGraphIntegraity(StaticGraph* graph);
 
+/* for a graph taken over by a runtime Graph: the name indices, then all but the const tensor buffers */
+void ReleaseStaticIndex(StaticGraph* graph);
+void ReleaseStaticTopology(StaticGraph* graph);
+
 // StaticNode
 StaticNode* CreateStaticNode(StaticGraph* graph, const std::string& node_name);
 int AddNodeInputTensor(StaticNode* node, StaticTensor* tensor);
@@ -83,6 +87,7 @@ StaticTensor* GetNodeInputTensor(StaticGraph* graph, StaticNode* node, int idx);
 StaticOp* CreateStaticOp(StaticGraph* graph, const std::string& op_name);
 void SetOperatorParam(StaticOp*, any&& param);
 void SetOperatorDynamicShape(StaticOp*);
+void SetOperatorStaticShape(StaticOp*);
 void AddOperatorAttr(StaticOp*, const std::string& attr_name, any&& val);
 any& GetOperatorParam(StaticOp*);
 
@@ -346,6 +346,23 @@ int request_tengine_version(const char* version);
 
 graph_t create_graph(context_t context, const char* model_format, const char* file_name, ...);
 
+/*!
+ * @brief Create the graph like create_graph(), for a one-shot use such as model conversion:
+ *        the graph takes the loaded model over instead of copying it, and the model is
+ *        released once the graph is built, but for the constant tensor data.
+ *        when the model is already used by another graph, it is copied as create_graph() does
+ *
+ * @param [in] context: The context the graph will run inside;
+ *                   could be NULL and the graph is created in a private context.
+ *
+ * @param [in] model_format: The model format type,such as "caffe","tengine"
+ * @param [in] file_name:  The name of model file.
+ *
+ * @return  The graph handler or NULL if failed.
+ */
+
+graph_t create_graph_exclusive(context_t context, const char* model_format, const char* file_name, ...);
+
 /*!
  * @brief save the graph into file using the model format
  *
@@ -361,6 +378,8 @@ int save_graph(graph_t graph, const char* model_format, const char* file_name, .
 /*!
  * @brief Set the layout type of the graph
  *        the default layout of graph is NCHW
+ *        a NHWC graph set to NCHW is converted: tensors, weights and axes,
+ *        with transposes at the graph inputs and outputs only
  * @param [in] graph, the graph handle
  * @param [in] layout_type, the layout type NCHW or NHWC
  *
@@ -369,6 +388,52 @@ int save_graph(graph_t graph, const char* model_format, const char* file_name, .
 
 int set_graph_layout(graph_t graph, int layout_type);
 
+/*!
+ * @brief Pack the convolution and fully connected weights for the kernels ahead of time
+ *        the packed weights are kept as node attributes "prepack.<scheme>" next to
+ *        the original ones and saved with the graph. run it after prerun_graph()
+ *        with the "optimize_only" attr, so that the weights are the final ones
+ * @param [in] graph, the graph handle
+ * @param [in] schemes, comma separated: gemm4x16, gemm8x12, wino23, wino63
+ *
+ * @return 0 success, or -1 fail
+ */
+
+int prepack_graph_weights(graph_t graph, const char* schemes);
+
+/*!
+ * @brief Print the flops, the parameter bytes and the activation bytes read and written
+ *        of the nodes, the heaviest first. the shapes must be known: run it after
+ *        prerun_graph(), with the "infer_shape" attr in "optimize_only" mode
+ * @param [in] graph, the graph handle
+ * @param [in] top_num, how many nodes to print
+ * @param [in] json_file, if not NULL, all the nodes are saved there as json too
+ *
+ * @return 0 success, or -1 fail
+ */
+
+int report_graph_cost(graph_t graph, int top_num, const char* json_file);
+
+/*!
+ * @brief Calibrate the graph for int8: run the fp32 graph over the samples on a reference
+ *        cpu path and set a symmetric int8 scale on the input and activation tensors,
+ *        and one per output channel on the convolution and fully connected weights.
+ *        the data stays fp32: save the graph to get the int8 annotated model.
+ *        run it after prerun_graph(), with the "infer_shape" attr in "optimize_only" mode
+ * @param [in] graph, the graph handle
+ * @param [in] sample_number, how many samples
+ * @param [in] get_sample, fills data, size floats in the NCHW layout of the input, with
+ *             sample idx, returning 0 on success. it is called from several threads at once
+ * @param [in] arg, passed to get_sample
+ * @param [in] method, "minmax", "kl" or "percentile", the latter with an optional
+ *             ":<percent>", 99.99 by default
+ *
+ * @return 0 success, or -1 fail
+ */
+
+int calibrate_graph(graph_t graph, int sample_number, int (*get_sample)(int idx, float* data, int size, void* arg),
+                    void* arg, const char* method);
+
 /*!
  * @brief designate the input nodes of the graph
  *
@@ -873,6 +938,13 @@ int set_tensor_data_type(tensor_t tensor, int data_type);
 /*!
  * @brief The interface to set some proprietary attribute items for graph.
  *        The backend device to run the graph may use the attribute item.
+ *        "static_shape" (int), with "optimize_only": prerun_graph() infers the
+ *        shapes from the input shapes set, and marks the nodes whose output
+ *        dims are known, so that loading the saved graph skips their inference.
+ *        their outputs get offsets in one activation arena as well, used by
+ *        the cpu runner as long as the shapes fit.
+ *        "infer_shape" (int), with "optimize_only": the shapes are inferred the
+ *        same way, but neither marked nor planned in the saved graph
  *
  * @param [in] graph: The graph handle.
  * @param [in] attr_name: The attribute name.
@@ -42,7 +42,8 @@ int vload_file_model(context_t exec_context, const char* model_name, const char*
 int vload_mem_model(context_t exec_context, const char* model_name, const char* model_format, const void* addr,
                     int mem_size, va_list argp);
 
-graph_t create_graph_in_context(context_t exec_context, const char* graph_name, const char* model_name);
+graph_t create_graph_in_context(context_t exec_context, const char* graph_name, const char* model_name,
+                                bool take_over = false);
 
 int save_graph_internal(graph_t graph, const char* file_format, const char* fname, va_list argp);
 
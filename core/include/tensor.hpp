@@ -27,6 +27,9 @@
 #include <iostream>
 #include <string>
 #include <atomic>
+#include <memory>
+#include <cstdlib>
+#include <cstring>
 
 #include "base_object.hpp"
 #include "tensor_shape.hpp"
@@ -38,6 +41,50 @@ class Node;
 struct NodePort;
 struct StaticConstTensor;
 
+/*
+ * data of a const tensor. copies of a tensor share the same buffer,
+ * and the buffer is released, if owned, when the last user drops it.
+ */
+class ConstBuffer
+{
+public:
+    ConstBuffer(void* addr, bool owned = false)
+    {
+        mem_addr_ = addr;
+        owned_ = owned;
+    }
+
+    ~ConstBuffer()
+    {
+        if (owned_)
+            std::free(mem_addr_);
+    }
+
+    ConstBuffer(const ConstBuffer&) = delete;
+    ConstBuffer& operator=(const ConstBuffer&) = delete;
+
+    void* GetMem(void) const
+    {
+        return mem_addr_;
+    }
+
+    bool IsOwned(void) const
+    {
+        return owned_;
+    }
+
+    void SetOwned(bool owned)
+    {
+        owned_ = owned;
+    }
+
+private:
+    void* mem_addr_;
+    bool owned_;
+};
+
+using ConstBufferPtr = std::shared_ptr<ConstBuffer>;
+
 struct QuantParam
 {
     int zero_point;
@@ -59,13 +106,14 @@ struct QuantParam
 class Tensor : public BaseObject
 {
 public:
-    Tensor(const std::string& name)
+    Tensor(std::string name)
     {
-        name_ = name;
+        name_ = std::move(name);
         data_type_ = TENGINE_DT_FP32;
         static_tensor_ = nullptr;
         reshaped_count_ = 0;
         producer = nullptr;
+        graph_output_ = false;
     }
     virtual ~Tensor()
     {
@@ -74,19 +122,14 @@ public:
 
     void FreeTensor(void)
     {
-        if (type_ == kConstTensor && ExistAttr("free_mem") && ExistAttr("mem_addr"))
-        {
-            void* mem = any_cast<void*>(GetAttr("mem_addr"));
-            std::free(mem);
-
-            RemoveAttr("free_mem");
-            RemoveAttr("mem_addr");
-        }
+        if (type_ == kConstTensor)
+            const_buf_.reset();
     }
 
     Tensor(const Tensor& o)
         : BaseObject(o), producer(o.producer), consumer(o.consumer), quant_param_(o.quant_param_), type_(o.type_),
-          name_(o.name_), data_type_(o.data_type_), shape_(o.shape_), static_tensor_(o.static_tensor_){};
+          name_(o.name_), data_type_(o.data_type_), shape_(o.shape_), static_tensor_(o.static_tensor_),
+          const_buf_(o.const_buf_), graph_output_(o.graph_output_){};
 
     Tensor& operator=(const Tensor& rhs) = delete;
 
@@ -212,22 +255,76 @@ public:
 
      */
 
+    /* the buffer is touched by every pass over the tensors,
+       so it is a plain member instead of an entry in the attribute map */
     void* GetMemAddr(void) const
     {
-        if (!ExistAttr("mem_addr"))
-            return nullptr;
-
-        return any_cast<void*>(GetAttr("mem_addr"));
+        return const_buf_ ? const_buf_->GetMem() : nullptr;
     }
 
+    /* addr is borrowed until SetFreeMem(true) hands it over */
     void SetMemAddr(void* addr)
     {
-        (*this)["mem_addr"] = addr;
+        if (addr)
+            const_buf_.reset(new ConstBuffer(addr));
+        else
+            const_buf_.reset();
+    }
+
+    bool GetFreeMem(void) const
+    {
+        return const_buf_ && const_buf_->IsOwned();
+    }
+
+    void SetFreeMem(bool free_mem)
+    {
+        if (const_buf_)
+            const_buf_->SetOwned(free_mem);
+    }
+
+    /*
+     * copy on write: the buffer is updated in place only when this tensor
+     * is its single user and owns it, otherwise the data is copied first.
+     * a caller which rewrites every element from GetMemAddr() may skip the
+     * copy with keep_data == false: the old buffer stays valid, it is still
+     * owned by its other users
+     */
+    void* GetWritableMemAddr(bool keep_data = true)
+    {
+        if (!const_buf_)
+            return nullptr;
+
+        if (const_buf_.use_count() == 1 && const_buf_->IsOwned())
+            return const_buf_->GetMem();
+
+        int mem_size = GetTotalSize();
+        void* new_mem = std::malloc(mem_size + 128);
+
+        if (new_mem == nullptr)
+            return nullptr;
+
+        if (keep_data)
+            std::memcpy(new_mem, const_buf_->GetMem(), mem_size);
+
+        const_buf_.reset(new ConstBuffer(new_mem, true));
+
+        return new_mem;
     }
 
     void FreeMem(void);
     void BindStaticTensor(StaticConstTensor*);
 
+    /* an output of the model: kept even when nothing inside the graph consumes it */
+    bool IsGraphOutput(void) const
+    {
+        return graph_output_;
+    }
+
+    void SetGraphOutput(bool graph_output)
+    {
+        graph_output_ = graph_output;
+    }
+
     std::vector<QuantParam>* GetQuantParam(void)
     {
         return &quant_param_;
@@ -243,6 +340,10 @@ protected:
     StaticConstTensor* static_tensor_;
 
     std::atomic<int> reshaped_count_;
+
+    ConstBufferPtr const_buf_;
+
+    bool graph_output_;
 };
 
 }    // namespace TEngine
@@ -0,0 +1,46 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2020, Open AI Lab
+ */
+#ifndef __TENSOR_PERMUTE_HPP__
+#define __TENSOR_PERMUTE_HPP__
+
+#include <vector>
+
+namespace TEngine {
+
+/*
+ * dst gets the elements of src with the dims reordered: output dim i is input
+ * dim perm[i]. the copy goes tile by tile on all cores. elem_size is 1, 2, 4 or 8,
+ * src and dst must not overlap. max_thread <= 0 means one thread per core
+ */
+bool PermuteData(const void* src, void* dst, const std::vector<int>& dims, const std::vector<int>& perm,
+                 int elem_size, int max_thread = 0);
+
+/* [batch][rows][cols] --> [batch][cols][rows] */
+bool TransposeData(const void* src, void* dst, int batch, int rows, int cols, int elem_size, int max_thread = 0);
+
+/* the same, the result goes back to data: swapped in place when rows == cols, through a scratch buffer otherwise */
+bool TransposeDataInPlace(void* data, int batch, int rows, int cols, int elem_size, int max_thread = 0);
+
+}    // namespace TEngine
+
+#endif
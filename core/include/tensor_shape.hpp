@@ -96,6 +96,7 @@ public:
     }
 
     void SetDim(const std::vector<int>& args);
+    void SetDim(std::vector<int>&& args);
 
     void DumpShape(std::ostream& os) const;
 
@@ -25,9 +25,11 @@
 #include <vector>
 #include <string>
 #include <queue>
-#include <set>
+#include <algorithm>
+#include <unordered_set>
 
 #include "static_graph.hpp"
+#include "static_graph_interface.hpp"
 #include "graph.hpp"
 #include "exec_attr.hpp"
 #include "logger.hpp"
@@ -59,23 +61,34 @@ void Graph::DumpGraph(void)
 
 Node* Graph::FindNode(const std::string& node_name)
 {
-    int len = node_name.size();
+    if (node_map_dirty_)
+        RebuildNodeMap();
 
-    for (unsigned int i = 0; i < seq_nodes.size(); i++)
-    {
-        Node* node = seq_nodes[i];
-        const std::string& target_name = node->GetName();
+    auto ir = node_map_.find(node_name);
 
-        int start = target_name.size() - len;
+    if (ir == node_map_.end())
+        return nullptr;
 
-        if (start)
-            continue;
+    return ir->second;
+}
 
-        if (target_name == node_name)
-            return node;
-    }
+void Graph::IndexNode(Node* node)
+{
+    /* a dirty index is rebuilt as a whole anyway. a duplicated name keeps the first node */
+    if (!node_map_dirty_)
+        node_map_.emplace(node->GetName(), node);
+}
 
-    return nullptr;
+void Graph::RebuildNodeMap(void)
+{
+    node_map_.clear();
+    node_map_.reserve(seq_nodes.size());
+
+    /* keep the first one for duplicated names, as the linear search did */
+    for (unsigned int i = 0; i < seq_nodes.size(); i++)
+        node_map_.emplace(seq_nodes[i]->GetName(), seq_nodes[i]);
+
+    node_map_dirty_ = false;
 }
 
 bool Graph::AddInputNode(const std::string& node_name)
@@ -113,6 +126,7 @@ bool Graph::AddOutputNode(const std::string& node_name)
             return true;
     }
 
+    MarkGraphOutput(node, true);
     output_nodes.push_back(node);
 
     return true;
@@ -120,15 +134,17 @@ bool Graph::AddOutputNode(const std::string& node_name)
 
 Tensor* Graph::FindTensor(const std::string& tensor_name)
 {
-    if (tensor_map_.count(tensor_name))
-        return tensor_map_[tensor_name];
+    auto ir = tensor_map_.find(tensor_name);
 
-    return nullptr;
+    if (ir == tensor_map_.end())
+        return nullptr;
+
+    return ir->second;
 }
 
-bool Graph::CreateNodeFromStatic(Node* node, const StaticGraph* static_graph, const StaticNode* static_node)
+bool Graph::CreateNodeFromStatic(Node* node, const StaticGraph* static_graph, StaticNode* static_node, bool take_over)
 {
-    StaticOp* static_op = static_node->op.get();
+    StaticOp* static_op = static_node->op;
 
     Operator* op = OpManager::CreateOp(static_op->name);
     if (op == nullptr)
@@ -140,13 +156,17 @@ bool Graph::CreateNodeFromStatic(Node* node, const StaticGraph* static_graph, co
     op->ParamFromStaticOp(static_op);
     op->SetDynamicShape(static_op->dynamic_shape);
     node->SetDynamicShape(static_op->dynamic_shape);
+    node->SetStaticShape(static_op->static_shape);
 
     /* copy attrs in static_node */
     std::vector<std::string> node_attr_name = static_node->attrs.ListAttr();
 
     for (unsigned int i = 0; i < node_attr_name.size(); i++)
     {
-        node->SetAttr(node_attr_name[i], static_node->attrs.GetAttr(node_attr_name[i]));
+        if (take_over)
+            node->SetAttr(node_attr_name[i], std::move(static_node->attrs.GetAttr(node_attr_name[i])));
+        else
+            node->SetAttr(node_attr_name[i], static_node->attrs.GetAttr(node_attr_name[i]));
     }
 
     /* copy attrs in static_op  */
@@ -154,7 +174,10 @@ bool Graph::CreateNodeFromStatic(Node* node, const StaticGraph* static_graph, co
 
     for (unsigned int i = 0; i < attr_name.size(); i++)
     {
-        op->SetAttr(attr_name[i], static_op->attrs[attr_name[i]]);
+        if (take_over)
+            op->SetAttr(attr_name[i], std::move(static_op->attrs[attr_name[i]]));
+        else
+            op->SetAttr(attr_name[i], static_op->attrs[attr_name[i]]);
     }
 
     node->SetOp(op);
@@ -164,9 +187,9 @@ bool Graph::CreateNodeFromStatic(Node* node, const StaticGraph* static_graph, co
     for (unsigned int i = 0; i < static_node->output_tensor_list.size(); i++)
     {
         int idx = static_node->output_tensor_list[i];
-        StaticTensor* static_tensor = static_graph->tensor_list[idx].get();
+        StaticTensor* static_tensor = static_graph->tensor_list[idx];
 
-        Tensor* tensor = new Tensor(static_tensor->name);
+        Tensor* tensor = take_over ? new Tensor(std::move(static_tensor->name)) : new Tensor(static_tensor->name);
 
         tensor->SetDataType(static_tensor->data_type);
         tensor->SetType(( TensorType )static_tensor->type);
@@ -174,7 +197,10 @@ bool Graph::CreateNodeFromStatic(Node* node, const StaticGraph* static_graph, co
         TShape& shape = tensor->GetShape();
 
         shape.SetDataLayout(static_graph->graph_layout);
-        shape.SetDim(static_tensor->dims);
+        if (take_over)
+            shape.SetDim(std::move(static_tensor->dims));
+        else
+            shape.SetDim(static_tensor->dims);
 
         std::vector<QuantParam>* quant_param = tensor->GetQuantParam();
         quant_param->resize(1);
@@ -194,7 +220,7 @@ bool Graph::CreateNodeFromStatic(Node* node, const StaticGraph* static_graph, co
         {
             StaticConstTensor* const_tensor = dynamic_cast<StaticConstTensor*>(static_tensor);
 
-            (*tensor)["mem_addr"] = const_tensor->mem_addr;
+            tensor->SetMemAddr(const_tensor->mem_addr);
             (*tensor)["file_offset"] = const_tensor->file_offset;
             (*tensor)["file_size"] = const_tensor->file_size;
             tensor->BindStaticTensor(const_tensor);
@@ -214,6 +240,7 @@ bool Graph::CreateNodeFromStatic(Node* node, const StaticGraph* static_graph, co
     /* add node into list */
     node->SetNodeIndex(seq_nodes.size());
     seq_nodes.push_back(node);
+    IndexNode(node);
 
     /* my node!*/
     SetNodeOwner(node);
@@ -221,15 +248,26 @@ bool Graph::CreateNodeFromStatic(Node* node, const StaticGraph* static_graph, co
     return true;
 }
 
-bool Graph::SetupConnection(Tensor* tensor, const StaticGraph* static_graph, const StaticTensor* static_tensor)
+bool Graph::SetupConnection(Tensor* tensor, const StaticGraph* static_graph, const StaticTensor* static_tensor,
+                            bool take_over)
 {
     /*will setup the tensor consumer and node inputs*/
     for (unsigned int i = 0; i < static_tensor->consumer.size(); i++)
     {
         const NodeSynapse* p_synapse = &static_tensor->consumer[i];
-        const StaticNode* static_node = static_graph->node_list[p_synapse->node_index].get();
+        const StaticNode* static_node = static_graph->node_list[p_synapse->node_index];
 
-        Node* node = FindNode(static_node->name);
+        /* while building from static, seq_nodes follows node_list */
+        Node* node = nullptr;
+
+        /* a taken over static graph has no names left: the indices are all there is */
+        if (take_over)
+            node = seq_nodes[p_synapse->node_index];
+        else if (( size_t )p_synapse->node_index < seq_nodes.size() &&
+                 seq_nodes[p_synapse->node_index]->GetName() == static_node->name)
+            node = seq_nodes[p_synapse->node_index];
+        else
+            node = FindNode(static_node->name);
 
         /* create input port*/
         node->SetInputPort(p_synapse->entry_index, tensor);
@@ -279,31 +317,62 @@ static int model_format_mapping(const std::string& fmt)
 }
 #endif
 
-bool Graph::RealCreateFromStatic(const StaticGraphPtr& static_graph)
+bool Graph::RealCreateFromStatic(const StaticGraphPtr& static_graph, bool take_over)
 {
     orig_graph_ = static_graph;
     attrs_ = static_graph->attrs;
 
     int node_number = static_graph->node_list.size();
+    int tensor_number = static_graph->tensor_list.size();
+
+    seq_nodes.reserve(node_number);
+    owned_nodes_.reserve(node_number);
+    node_map_.reserve(node_number);
+
+    /* from an empty graph, the nodes are indexed as they are added */
+    node_map_dirty_ = !seq_nodes.empty();
+    owned_tensors_.reserve(tensor_number);
+    tensor_map_.reserve(tensor_number);
+
+    /* nothing looks names up in it any more: the memory is reused right below */
+    if (take_over)
+        ReleaseStaticIndex(static_graph.get());
 
     /* create node and its output tensor */
     for (int i = 0; i < node_number; i++)
     {
-        const StaticNode* node_ptr = static_graph->node_list[i].get();
+        StaticNode* node_ptr = static_graph->node_list[i];
 
-        Node* node = new Node(node_ptr->name);
+        Node* node = take_over ? new Node(std::move(node_ptr->name)) : new Node(node_ptr->name);
 
-        if (!CreateNodeFromStatic(node, static_graph.get(), node_ptr))
+        if (!CreateNodeFromStatic(node, static_graph.get(), node_ptr, take_over))
             return false;
+
+        if (take_over)
+            std::vector<int>().swap(node_ptr->input_tensor_list);
     }
 
     /* Setup the connections */
-    int tensor_number = static_graph->tensor_list.size();
-
     for (int i = 0; i < tensor_number; i++)
     {
-        const StaticTensor* static_tensor = static_graph->tensor_list[i].get();
-        Tensor* tensor = FindTensor(static_tensor->name);
+        const StaticTensor* static_tensor = static_graph->tensor_list[i];
+        const NodeSynapse& producer = static_tensor->producer;
+        Tensor* tensor = nullptr;
+
+        /* reach the tensor through its producer, fall back to the name */
+        if (producer.node_index >= 0 && producer.node_index < node_number)
+        {
+            Node* node = seq_nodes[producer.node_index];
+
+            if (( unsigned int )producer.entry_index < node->GetOutputNum())
+                tensor = node->GetOutputTensor(producer.entry_index);
+
+            if (tensor && !take_over && tensor->GetName() != static_tensor->name)
+                tensor = nullptr;
+        }
+
+        if (tensor == nullptr && !take_over)
+            tensor = FindTensor(static_tensor->name);
 
         if (tensor == nullptr)
         {
@@ -311,8 +380,11 @@ bool Graph::RealCreateFromStatic(const StaticGraphPtr& static_graph)
             return false;
         }
 
-        if (!SetupConnection(tensor, static_graph.get(), static_tensor))
+        if (!SetupConnection(tensor, static_graph.get(), static_tensor, take_over))
             return false;
+
+        if (take_over)
+            std::vector<NodeSynapse>().swap(static_graph->tensor_list[i]->consumer);
     }
 
     /* set the input and output */
@@ -320,7 +392,7 @@ bool Graph::RealCreateFromStatic(const StaticGraphPtr& static_graph)
     for (unsigned int i = 0; i < static_graph->input_node_list.size(); i++)
     {
         int node_idx = static_graph->input_node_list[i];
-        Node* node = FindNode(static_graph->node_list[node_idx].get()->name);
+        Node* node = seq_nodes[node_idx];
         input_nodes.push_back(node);
 
         /* update the input node's tensor type */
@@ -331,7 +403,8 @@ bool Graph::RealCreateFromStatic(const StaticGraphPtr& static_graph)
     for (unsigned int i = 0; i < static_graph->output_node_list.size(); i++)
     {
         int node_idx = static_graph->output_node_list[i];
-        Node* node = FindNode(static_graph->node_list[node_idx].get()->name);
+        Node* node = seq_nodes[node_idx];
+        MarkGraphOutput(node, true);
         output_nodes.push_back(node);
     }
 
@@ -350,14 +423,18 @@ bool Graph::RealCreateFromStatic(const StaticGraphPtr& static_graph)
     model_layout_ = static_graph->model_layout;
     layout_ = static_graph->graph_layout;
 
+    /* the const tensor buffers are still borrowed from it */
+    if (take_over)
+        ReleaseStaticTopology(static_graph.get());
+
     return true;
 }
 
-Graph* Graph::CreateFromStatic(const std::string& graph_name, const StaticGraphPtr& static_graph)
+Graph* Graph::CreateFromStatic(const std::string& graph_name, const StaticGraphPtr& static_graph, bool take_over)
 {
     Graph* new_graph = new Graph(graph_name);
 
-    if (new_graph->RealCreateFromStatic(static_graph))
+    if (new_graph->RealCreateFromStatic(static_graph, take_over))
         return new_graph;
 
     delete new_graph;
@@ -404,7 +481,70 @@ bool Graph::RemoveTensor(Tensor* tensor)
     return true;
 }
 
-bool Graph::RemoveNode(Node* node)
+bool Graph::RemoveNode(Node* node, bool keep_order)
+{
+    /* remove from seq_nodes */
+    int seq_idx = node->GetNodeIndex();
+    bool indexed = (seq_idx >= 0 && seq_idx < ( int )seq_nodes.size() && seq_nodes[seq_idx] == node);
+
+    if (!indexed)
+    {
+        auto ir = std::find(seq_nodes.begin(), seq_nodes.end(), node);
+        seq_idx = (ir == seq_nodes.end()) ? -1 : ir - seq_nodes.begin();
+    }
+
+    if (seq_idx >= 0)
+    {
+        if (!keep_order)
+        {
+            seq_nodes[seq_idx] = seq_nodes.back();
+            seq_nodes.pop_back();
+
+            if (indexed && seq_idx < ( int )seq_nodes.size())
+                seq_nodes[seq_idx]->SetNodeIndex(seq_idx);
+        }
+        else
+        {
+            seq_nodes.erase(seq_nodes.begin() + seq_idx);
+
+            /* the node index was right, keep it right for the nodes behind */
+            if (indexed)
+            {
+                for (unsigned int i = seq_idx; i < seq_nodes.size(); i++)
+                    seq_nodes[i]->SetNodeIndex(i);
+            }
+        }
+
+        if (!node_map_dirty_)
+        {
+            auto map_ir = node_map_.find(node->GetName());
+
+            if (map_ir != node_map_.end() && map_ir->second == node)
+                node_map_.erase(map_ir);
+
+            /* fewer names than nodes: another node of the same name may take it over */
+            if (node_map_.size() != seq_nodes.size())
+                node_map_dirty_ = true;
+        }
+    }
+
+    /* remove from inputs/outputs */
+    auto ir = std::find(input_nodes.begin(), input_nodes.end(), node);
+
+    if (ir != input_nodes.end())
+        input_nodes.erase(ir);
+
+    ir = std::find(output_nodes.begin(), output_nodes.end(), node);
+
+    if (ir != output_nodes.end())
+        output_nodes.erase(ir);
+
+    DetachNode(node);
+
+    return true;
+}
+
+void Graph::DetachNode(Node* node)
 {
     std::vector<Tensor*> tensor_list;
 
@@ -442,59 +582,42 @@ bool Graph::RemoveNode(Node* node)
         tensor->RemoveConsumer(port);
     }
 
-    /* remove from seq_nodes_ */
-    auto ir = seq_nodes.begin();
-
-    while (ir != seq_nodes.end())
-    {
-        if ((*ir) == node)
-            break;
-        ir++;
-    }
-
-    if (ir != seq_nodes.end())
-        seq_nodes.erase(ir);
+    /* if it is my node, free it */
 
-    /* remove from inputs/outputs */
+    if (RemoveNodeOwner(node))
+        delete node;
+}
 
-    ir = input_nodes.begin();
+void Graph::RemoveUnvisitedNodes(const std::vector<int>& access_flag)
+{
+    std::vector<Node*> dead_nodes;
 
-    while (ir != input_nodes.end())
+    for (unsigned int i = 0; i < access_flag.size(); i++)
     {
-        if ((*ir) == node)
-        {
-            input_nodes.erase(ir);
-            break;
-        }
-
-        ir++;
+        if (!access_flag[i])
+            dead_nodes.push_back(seq_nodes[i]);
     }
 
-    ir = output_nodes.begin();
-
-    while (ir != output_nodes.end())
-    {
-        if ((*ir) == node)
-        {
-            output_nodes.erase(ir);
-            break;
-        }
+    if (dead_nodes.empty())
+        return;
 
-        ir++;
-    }
+    std::unordered_set<Node*> dead_set(dead_nodes.begin(), dead_nodes.end());
 
-    /* if it is my node, free it */
+    auto is_dead = [&](Node* node) { return dead_set.count(node) > 0; };
 
-    if (RemoveNodeOwner(node))
-        delete node;
+    input_nodes.erase(std::remove_if(input_nodes.begin(), input_nodes.end(), is_dead), input_nodes.end());
+    output_nodes.erase(std::remove_if(output_nodes.begin(), output_nodes.end(), is_dead), output_nodes.end());
 
-    return true;
+    /* in seq order, so that a node is released after the nodes feeding it */
+    for (unsigned int i = 0; i < dead_nodes.size(); i++)
+        DetachNode(dead_nodes[i]);
 }
 
 bool Graph::AddNode(Node* node, bool set_owner)
 {
     node->SetNodeIndex(seq_nodes.size());
     seq_nodes.push_back(node);
+    IndexNode(node);
 
     if (set_owner)
         SetNodeOwner(node);
@@ -547,6 +670,7 @@ void Graph::StripGraph(void)
     int node_number = seq_nodes.size();
 
     std::vector<Node*> new_seq;
+    std::vector<Node*> extra_inputs;
     std::vector<int> access_flag(node_number, 0);
 
     /* make sure the node index is correct first */
@@ -559,12 +683,12 @@ void Graph::StripGraph(void)
     /* assume all the nodes in seq_nodes are in order,
        so that we just simply collect them one by one  */
 
+    std::vector<Node*> visited_seq;
+
     for (int i = 0; i < node_number; i++)
     {
         if (access_flag[i])
-        {
-            new_seq.push_back(seq_nodes[i]);
-        }
+            visited_seq.push_back(seq_nodes[i]);
     }
 
     for (unsigned int i = 0; i < input_nodes.size(); i++)
@@ -574,29 +698,19 @@ void Graph::StripGraph(void)
         if (!access_flag[input_index])
         {
             access_flag[input_index] = 1;
-            new_seq.insert(new_seq.begin(), input_nodes[i]);
+            extra_inputs.push_back(input_nodes[i]);
         }
     }
 
-    auto ir = seq_nodes.begin();
+    /* un-visited input nodes go first, the last one found in front */
+    new_seq.reserve(extra_inputs.size() + visited_seq.size());
+    new_seq.insert(new_seq.end(), extra_inputs.rbegin(), extra_inputs.rend());
+    new_seq.insert(new_seq.end(), visited_seq.begin(), visited_seq.end());
 
     // removing node that can not be visited
-    for (int i = 0; i < node_number; i++)
-    {
-        if (access_flag[i])
-        {
-            ir++;
-            continue;
-        }
-
-        Node* node = (*ir);
-        ir = seq_nodes.erase(ir);
-
-        if (!RemoveNode(node))
-            break;
-    }
+    RemoveUnvisitedNodes(access_flag);
 
-    seq_nodes = new_seq;
+    seq_nodes.swap(new_seq);
 
     for (unsigned int i = 0; i < seq_nodes.size(); i++)
     {
@@ -605,6 +719,8 @@ void Graph::StripGraph(void)
         node->SetNodeIndex(i);
     }
 
+    RebuildNodeMap();
+
     HandleNoChildTensor();
 }
 
@@ -615,12 +731,16 @@ void Graph::SanitizeGraph(void)
     std::vector<Node*> new_seq;
     std::vector<int> access_flag(node_number, 0);
 
+    new_seq.reserve(node_number);
+
     /* make sure the node index is correct first */
     for (int i = 0; i < node_number; i++)
         seq_nodes[i]->SetNodeIndex(i);
 
+    /* the backward BFS visits a node after all its consumers:
+       collect them in visit order and reverse the list at the end */
     BFSVisit(this, output_nodes, graph_visit_t([&](Graph* graph, Node* node) {
-                 new_seq.insert(new_seq.begin(), node);
+                 new_seq.push_back(node);
                  access_flag[node->GetNodeIndex()] = 1;
              }));
 
@@ -631,30 +751,16 @@ void Graph::SanitizeGraph(void)
         if (!access_flag[input_index])
         {
             access_flag[input_index] = 1;
-            new_seq.insert(new_seq.begin(), input_nodes[i]);
+            new_seq.push_back(input_nodes[i]);
         }
     }
 
-    auto ir = seq_nodes.begin();
+    std::reverse(new_seq.begin(), new_seq.end());
 
     // removing node that can not be visited
-    for (int i = 0; i < node_number; i++)
-    {
-        if (access_flag[i])
-        {
-            ir++;
-            continue;
-        }
-
-        Node* node = (*ir);
+    RemoveUnvisitedNodes(access_flag);
 
-        ir = seq_nodes.erase(ir);
-
-        if (!RemoveNode(node))
-            break;
-    }
-
-    seq_nodes = new_seq;
+    seq_nodes.swap(new_seq);
 
     for (unsigned int i = 0; i < seq_nodes.size(); i++)
     {
@@ -663,6 +769,8 @@ void Graph::SanitizeGraph(void)
         node->SetNodeIndex(i);
     }
 
+    RebuildNodeMap();
+
     RemoveNoChildTensor();
 }
 
@@ -690,6 +798,8 @@ bool Graph::IsInputNode(Node* node)
 
 void Graph::HandleNoChildTensor(void)
 {
+    std::unordered_set<Node*> output_set(output_nodes.begin(), output_nodes.end());
+
     auto tensor_ir = tensor_map_.begin();
 
     while (tensor_ir != tensor_map_.end())
@@ -700,9 +810,10 @@ void Graph::HandleNoChildTensor(void)
         {
             Node* node = tensor->producer->owner;
 
-            if (!IsOutputNode(node))
+            if (!output_set.count(node))
             {
                 output_nodes.push_back(node);
+                output_set.insert(node);
             }
         }
 
@@ -727,16 +838,18 @@ void Graph::RemoveNoChildTensor(void)
         }
     }
 
+    std::unordered_set<Node*> output_set(output_nodes.begin(), output_nodes.end());
+
     for (unsigned int i = 0; i < tensor_list.size(); i++)
     {
         Tensor* tensor = tensor_list[i];
 
-        if (!IsOutputNode(tensor->producer->owner))
+        if (!output_set.count(tensor->producer->owner))
             RemoveTensor(tensor);
     }
 }
 
-static bool AllChildVisited(Graph* graph, Node* node, std::vector<int>& visited, const std::set<Node*>& in_graph)
+static bool AllChildVisited(Graph* graph, Node* node, std::vector<int>& visited, const std::unordered_set<Node*>& in_graph)
 {
     for (unsigned int i = 0; i < node->GetOutputNum(); i++)
     {
@@ -754,7 +867,7 @@ static bool AllChildVisited(Graph* graph, Node* node, std::vector<int>& visited,
     return true;
 }
 
-static bool AllInputVisited(Graph* graph, Node* node, std::vector<int>& visited, const std::set<Node*>& in_graph)
+static bool AllInputVisited(Graph* graph, Node* node, std::vector<int>& visited, const std::unordered_set<Node*>& in_graph)
 {
     for (unsigned int i = 0; i < node->GetInputNum(); i++)
     {
@@ -782,10 +895,7 @@ void Graph::ForwardBFS(Graph* graph, std::vector<Node*>& starts, graph_visit_t f
 {
     int node_number = graph->seq_nodes.size();
     std::vector<int> visited(node_number, 0);
-    std::set<Node*> in_graph;
-
-    for (int i = 0; i < node_number; i++)
-        in_graph.insert(graph->seq_nodes[i]);
+    std::unordered_set<Node*> in_graph(graph->seq_nodes.begin(), graph->seq_nodes.end());
 
     std::queue<Node*> visit_queue;
 
@@ -850,10 +960,7 @@ void Graph::BackwardBFS(Graph* graph, std::vector<Node*>& starts, graph_visit_t
     std::vector<int> visited(node_number, 0);
     std::queue<Node*> visit_queue;
 
-    std::set<Node*> in_graph;
-
-    for (int i = 0; i < node_number; i++)
-        in_graph.insert(graph->seq_nodes[i]);
+    std::unordered_set<Node*> in_graph(graph->seq_nodes.begin(), graph->seq_nodes.end());
 
     /* inital the visit list */
     for (unsigned int i = 0; i < starts.size(); i++)
@@ -910,7 +1017,7 @@ void Graph::BackwardBFS(Graph* graph, std::vector<Node*>& starts, graph_visit_t
 
 void Graph::SetNodeOwner(Node* node)
 {
-    owned_nodes_.push_back(node);
+    owned_nodes_.insert(node);
 }
 
 void Graph::SetTensorOwner(Tensor* tensor)
@@ -920,20 +1027,7 @@ void Graph::SetTensorOwner(Tensor* tensor)
 
 bool Graph::RemoveNodeOwner(Node* node)
 {
-    auto ir = owned_nodes_.begin();
-
-    while (ir != owned_nodes_.end())
-    {
-        if ((*ir) == node)
-        {
-            owned_nodes_.erase(ir);
-            return true;
-        }
-
-        ir++;
-    }
-
-    return false;
+    return owned_nodes_.erase(node) > 0;
 }
 
 bool Graph::RemoveTensorOwner(Tensor* tensor)
@@ -985,7 +1079,7 @@ Tensor* Graph::GetOutputTensor(const std::string& name)
     return nullptr;
 }
 
-bool Graph::Replace(Subgraph* orig_sub, Subgraph* new_sub)
+bool Graph::Replace(Subgraph* orig_sub, Subgraph* new_sub, bool sanitize)
 {
     // check if all input tensors are consumed
     std::vector<Node*>& orig_input = orig_sub->input_nodes;
@@ -1065,22 +1159,23 @@ bool Graph::Replace(Subgraph* orig_sub, Subgraph* new_sub)
     for (unsigned int i = 0; i < orig_sub->seq_nodes.size(); i++)
     {
         Node* node = orig_sub->seq_nodes[i];
-        RemoveNode(node);
+        RemoveNode(node, sanitize);
     }
 
     // add nodes/tensors in new to whole graph
+    std::vector<Node*> added_nodes;
+
     for (unsigned int i = 0; i < new_sub->seq_nodes.size(); i++)
     {
-        bool graph_output_node = false;
-        bool graph_input_node = false;
-
         Node* node = new_sub->seq_nodes[i];
 
         if (new_sub->RemoveNodeOwner(node))
         {
             /* it is a new created  node */
             SetNodeOwner(node);
+            node->SetNodeIndex(seq_nodes.size());
             seq_nodes.push_back(node);
+            IndexNode(node);
 
             /* check if tensor produced are new or not */
             for (unsigned int j = 0; j < node->GetOutputNum(); j++)
@@ -1092,71 +1187,91 @@ bool Graph::Replace(Subgraph* orig_sub, Subgraph* new_sub)
                     SetTensorOwner(tensor);
                     tensor_map_[tensor->GetName()] = tensor;
                 }
+            }
 
-                if (tensor->consumer.size() == 0)
-                    graph_output_node = true;
-                else
-                {
-                    for (unsigned int i = 0; i < tensor->consumer.size(); i++)
-                    {
-                        NodePort* np = tensor->consumer[i];
+            added_nodes.push_back(node);
+        }
+        else
+        {
+            XLOG_ERROR() << "WHY GOES HERE!!!\n";
+        }
+    }
 
-                        if (!NodeInGraph(np->owner))
-                        {
-                            graph_output_node = true;
-                            break;
-                        }
-                    }
-                }
-            }
+    /* only now the links between the new nodes are all inside the graph */
+    for (auto node : added_nodes)
+    {
+        bool graph_output_node = false;
+        bool graph_input_node = false;
 
-            if (node->GetInputNum() == 0)
-            {
-                Operator* op = node->GetOp();
+        for (unsigned int j = 0; j < node->GetOutputNum(); j++)
+        {
+            Tensor* tensor = node->GetOutputTensor(j);
 
-                if (op->GetName() != "Const")
-                    graph_input_node = true;
-            }
+            if (tensor->consumer.size() == 0)
+                graph_output_node = true;
             else
             {
-                for (unsigned int i = 0; i < node->GetInputNum(); i++)
+                for (unsigned int i = 0; i < tensor->consumer.size(); i++)
                 {
-                    Tensor* input_tensor = node->GetInputTensor(i);
-
-                    if (input_tensor->GetType() != kVarTensor)
-                        continue;
-
-                    NodePort* np = input_tensor->producer;
+                    NodePort* np = tensor->consumer[i];
 
                     if (!NodeInGraph(np->owner))
                     {
-                        graph_input_node = true;
+                        graph_output_node = true;
                         break;
                     }
                 }
             }
+        }
 
-            if (graph_input_node)
-                input_nodes.push_back(node);
+        if (node->GetInputNum() == 0)
+        {
+            Operator* op = node->GetOp();
 
-            if (graph_output_node)
-                output_nodes.push_back(node);
+            if (op->GetName() != "Const")
+                graph_input_node = true;
         }
         else
         {
-            XLOG_ERROR() << "WHY GOES HERE!!!\n";
+            for (unsigned int i = 0; i < node->GetInputNum(); i++)
+            {
+                Tensor* input_tensor = node->GetInputTensor(i);
+
+                if (input_tensor->GetType() != kVarTensor)
+                    continue;
+
+                NodePort* np = input_tensor->producer;
+
+                if (!NodeInGraph(np->owner))
+                {
+                    graph_input_node = true;
+                    break;
+                }
+            }
         }
+
+        if (graph_input_node)
+            input_nodes.push_back(node);
+
+        if (graph_output_node)
+            output_nodes.push_back(node);
     }
 
     // re-sort the graph
-
-    SanitizeGraph();
+    if (sanitize)
+        SanitizeGraph();
 
     return true;
 }
 
 bool Graph::NodeInGraph(Node* node)
 {
+    /* the node index is right for nodes owned by this graph */
+    unsigned int idx = node->GetNodeIndex();
+
+    if (idx < seq_nodes.size() && seq_nodes[idx] == node)
+        return true;
+
     for (unsigned int i = 0; i < seq_nodes.size(); i++)
     {
         if (node == seq_nodes[i])
@@ -25,16 +25,18 @@
 #include <cstdio>
 #include <cstring>
 #include <functional>
+#include <unordered_set>
 
 #include "tengine_c_api.h"
 #include "exec_context.hpp"
 #include "graph_executor.hpp"
+#include "graph_optimizer.hpp"
 #include "tengine_config.hpp"
 #include "tengine_errno.hpp"
 
 namespace TEngine {
 
-bool GraphExecutor::CreateGraph(void* exec_context, const char* graph_name, const char* model_name)
+bool GraphExecutor::CreateGraph(void* exec_context, const char* graph_name, const char* model_name, bool take_over)
 {
     StaticGraphPtr static_graph;
     Graph* graph = nullptr;
@@ -49,18 +51,37 @@ bool GraphExecutor::CreateGraph(void* exec_context, const char* graph_name, cons
     }
     else
     {
-        if (!StaticGraphManager::SafeGet(model_name, static_graph))
+        StaticGraphManager::Get();
+
+        bool found = StaticGraphManager::Find(model_name);
+
+        if (found)
+            static_graph = StaticGraphManager::GetInstance()->at(model_name);
+
+        /* only a model nobody else uses can be taken over: drop it from the manager too */
+        if (found && take_over)
+        {
+            if (static_graph.use_count() == 2)
+                StaticGraphManager::Remove(model_name);
+            else
+                take_over = false;
+        }
+
+        StaticGraphManager::Put();
+
+        if (!found)
         {
             set_tengine_errno(ENOENT);
             return false;
         }
 
-        graph = Graph::CreateFromStatic(graph_name, static_graph);
+        graph = Graph::CreateFromStatic(graph_name, static_graph, take_over);
 
         if (graph == nullptr)
             return false;
 
-        model_name_ = model_name;
+        if (!take_over)
+            model_name_ = model_name;
     }
 
     graph_ = graph;
@@ -326,10 +347,54 @@ Tensor* GraphExecutor::FindTensor(const std::string& name)
         return graph_->FindTensor(name);
 }
 
+/* the nodes whose outputs all have known dims, a dynamic shape node and whatever follows it aside */
+void GraphExecutor::MarkStaticShape(Graph* graph)
+{
+    int static_number = 0;
+
+    /* the outputs of the nodes not marked: the shapes saved for them may not hold at run time */
+    std::unordered_set<Tensor*> dynamic_tensors;
+
+    for (auto node : graph->seq_nodes)
+    {
+        bool known = !node->IsDynamicShape();
+
+        for (unsigned int i = 0; known && i < node->GetInputNum(); i++)
+        {
+            if (dynamic_tensors.count(node->GetInputTensor(i)))
+                known = false;
+        }
+
+        for (unsigned int i = 0; known && i < node->GetOutputNum(); i++)
+        {
+            if (node->GetOutputTensor(i)->GetShape().GetSize() <= 0)
+                known = false;
+        }
+
+        node->SetStaticShape(known);
+
+        if (known)
+        {
+            static_number++;
+            continue;
+        }
+
+        for (unsigned int i = 0; i < node->GetOutputNum(); i++)
+            dynamic_tensors.insert(node->GetOutputTensor(i));
+    }
+
+    LOG_INFO() << "static shape nodes: " << static_number << "/" << graph->seq_nodes.size() << "\n";
+}
+
+/*
+ * a static shape node is skipped, unless one of its inputs was reshaped:
+ * by the user, or by a node inferred earlier in this pass
+ */
 bool GraphExecutor::InferShape(void)
 {
     int node_number = graph_->seq_nodes.size();
     Node* node;
+    std::unordered_set<Tensor*> changed;
 
     for (int i = 0; i < node_number; i++)
     {
@@ -346,6 +411,7 @@ bool GraphExecutor::InferShape(void)
             continue;
 
         bool skip = false;
+        bool reshaped = false;
         unsigned int j;
 
         for (j = 0; j < node->GetInputNum(); j++)
@@ -365,7 +431,13 @@ bool GraphExecutor::InferShape(void)
             }
 
             if (input->Reshaped())
+            {
                 input->UpdateReshapeCount();
+                reshaped = true;
+            }
+
+            if (changed.count(input))
+                reshaped = true;
         }
 
         if (skip == true)
@@ -375,6 +447,9 @@ bool GraphExecutor::InferShape(void)
             return false;
         }
 
+        if (node->IsStaticShape() && !reshaped)
+            continue;
+
         std::vector<TShape> inputs;
 
         for (unsigned int i = 0; i < node->GetInputNum(); i++)
@@ -400,8 +475,11 @@ bool GraphExecutor::InferShape(void)
             TShape& shape = tensor->GetShape();
             TShape& new_shape = outputs[i];
 
-            if (new_shape.GetSize())
+            if (new_shape.GetSize() && !(shape == new_shape))
+            {
                 shape = new_shape;
+                changed.insert(tensor);
+            }
         }
     }
 
@@ -534,10 +612,24 @@ bool GraphExecutor::Prerun(void)
 
     if (optimize_only)
     {
-        if (exec_engine_->Prerun(exec_handle_))
-            return true;
-        else
+        /*
+         * the shapes are resolved from the input shapes set. static_shape also saves them as
+         * final with the graph, infer_shape is for the tools reading them off this graph
+         */
+        if ((static_shape || infer_shape) && !InferShape())
             return false;
+
+        if (!exec_engine_->Prerun(exec_handle_))
+            return false;
+
+        /* the activation arena is planned for the shapes, and saved with the graph too */
+        if (static_shape)
+        {
+            MarkStaticShape(GetOptimizedGraph());
+            GraphOptimizerManager::RunOpt("MemPlan", GetOptimizedGraph());
+        }
+
+        return true;
     }
 
     if (InferShape() && exec_engine_->Prerun(exec_handle_))
@@ -600,6 +692,67 @@ bool GraphExecutor::SetOptimizeOnly(const char* name, const void* val, int size)
     return true;
 }
 
+bool GraphExecutor::GetStaticShape(const char* name, void* val, int size)
+{
+    if (size != sizeof(int))
+        return false;
+
+    *( int* )val = static_shape;
+
+    return true;
+}
+
+bool GraphExecutor::SetStaticShape(const char* name, const void* val, int size)
+{
+    if (size != sizeof(int))
+        return false;
+
+    static_shape = *( const int* )val;
+
+    return true;
+}
+
+bool GraphExecutor::GetInferShape(const char* name, void* val, int size)
+{
+    if (size != sizeof(int))
+        return false;
+
+    *( int* )val = infer_shape;
+
+    return true;
+}
+
+bool GraphExecutor::SetInferShape(const char* name, const void* val, int size)
+{
+    if (size != sizeof(int))
+        return false;
+
+    infer_shape = *( const int* )val;
+
+    return true;
+}
+
+/* the fusion switches are kept on the graph, for the device executors to pass on */
+bool GraphExecutor::GetFuseAttr(const char* name, void* val, int size)
+{
+    if (size != sizeof(int) || graph_ == nullptr)
+        return false;
+
+    *( int* )val = graph_->ExistAttr(name) ? any_cast<int>(graph_->GetAttr(name)) : 0;
+
+    return true;
+}
+
+bool GraphExecutor::SetFuseAttr(const char* name, const void* val, int size)
+{
+    if (size != sizeof(int) || graph_ == nullptr)
+        return false;
+
+    graph_->SetAttr(name, *( const int* )val);
+
+    return true;
+}
+
 bool GraphExecutor::BailoutSetAttr(const char* name, const void* val, int size)
 {
     return exec_engine_->SetGraphAttr(exec_handle_, name, val, size);
@@ -621,6 +774,36 @@ void GraphExecutor::InitAttrIO(void)
     attr_io_.RegSetFunc("optimize_only", set_opt_only_func);
     attr_io_.RegGetFunc("optimize_only", get_opt_only_func);
 
+    auto set_static_func = std::bind(&GraphExecutor::SetStaticShape, this, std::placeholders::_1,
+                                     std::placeholders::_2, std::placeholders::_3);
+
+    auto get_static_func = std::bind(&GraphExecutor::GetStaticShape, this, std::placeholders::_1,
+                                     std::placeholders::_2, std::placeholders::_3);
+
+    attr_io_.RegSetFunc("static_shape", set_static_func);
+    attr_io_.RegGetFunc("static_shape", get_static_func);
+
+    auto set_infer_func = std::bind(&GraphExecutor::SetInferShape, this, std::placeholders::_1, std::placeholders::_2,
+                                    std::placeholders::_3);
+
+    auto get_infer_func = std::bind(&GraphExecutor::GetInferShape, this, std::placeholders::_1, std::placeholders::_2,
+                                    std::placeholders::_3);
+
+    attr_io_.RegSetFunc("infer_shape", set_infer_func);
+    attr_io_.RegGetFunc("infer_shape", get_infer_func);
+
+    auto set_fuse_func = std::bind(&GraphExecutor::SetFuseAttr, this, std::placeholders::_1, std::placeholders::_2,
+                                   std::placeholders::_3);
+
+    auto get_fuse_func = std::bind(&GraphExecutor::GetFuseAttr, this, std::placeholders::_1, std::placeholders::_2,
+                                   std::placeholders::_3);
+
+    for (auto& name : GetFuseGraphAttrs())
+    {
+        attr_io_.RegSetFunc(name.c_str(), set_fuse_func);
+        attr_io_.RegGetFunc(name.c_str(), get_fuse_func);
+    }
+
     // bailout
     auto set_func2 = std::bind(&GraphExecutor::BailoutSetAttr, this, std::placeholders::_1, std::placeholders::_2,
                                std::placeholders::_3);
@@ -42,6 +42,9 @@ void Node::DumpNode(void)
     if (dynamic_shape_)
         LOG_INFO() << " Dynamic";
 
+    if (static_shape_)
+        LOG_INFO() << " Static";
+
     LOG_INFO() << "\n";
 
     LOG_INFO() << "\tInput: " << inputs_.size() << " Output: " << outputs_.size() << std::endl;
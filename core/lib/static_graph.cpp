@@ -33,6 +33,16 @@ namespace TEngine {
 
 StaticGraph::~StaticGraph(void)
 {
+    /* the memory goes away with the arena, only run the destructors here */
+    for (auto node : node_list)
+        node->~StaticNode();
+
+    for (auto tensor : tensor_list)
+        tensor->~StaticTensor();
+
+    for (auto op : op_list)
+        op->~StaticOp();
+
     for (auto p : mem_src)
         free(p);
 
@@ -130,50 +140,32 @@ bool AddGraphAttr(StaticGraph* graph, const std::string& attr_name, any&& value)
 
 StaticNode* FindNode(StaticGraph* graph, const std::string& node_name)
 {
-    int node_number = graph->node_list.size();
-
-    for (int i = 0; i < node_number; i++)
-    {
-        StaticNode* node = graph->node_list[i].get();
+    auto ir = graph->node_map.find(node_name);
 
-        if (node->name == node_name)
-            return node;
-    }
+    if (ir == graph->node_map.end())
+        return nullptr;
 
-    return nullptr;
+    return graph->node_list[ir->second];
 }
 
 StaticTensor* FindTensor(StaticGraph* graph, const std::string& tensor_name)
 {
-    int tensor_number = graph->tensor_list.size();
+    auto ir = graph->tensor_map.find(tensor_name);
 
-    for (int i = 0; i < tensor_number; i++)
-    {
-        StaticTensor* tensor = graph->tensor_list[i].get();
-
-        if (tensor->name == tensor_name)
-            return tensor;
-    }
+    if (ir == graph->tensor_map.end())
+        return nullptr;
 
-    return nullptr;
+    return graph->tensor_list[ir->second];
 }
 
 StaticTensor* FindConstTensor(StaticGraph* graph, const std::string& tensor_name)
 {
-    auto ir = graph->const_tensor_map.begin();
-    auto end = graph->const_tensor_map.end();
-
-    while (ir != end)
-    {
-        StaticTensor* tensor = ir->second.get();
+    auto ir = graph->const_tensor_map.find(tensor_name);
 
-        if (tensor->name == tensor_name)
-            return tensor;
-
-        ir++;
-    }
+    if (ir == graph->const_tensor_map.end())
+        return nullptr;
 
-    return nullptr;
+    return ir->second;
 }
 
 void AddGraphInputNode(StaticGraph* graph, StaticNode* node)
@@ -193,7 +185,7 @@ bool CheckGraphIntegraityByEdge(StaticGraph* graph)
 
     for (unsigned int i = 0; i < graph->tensor_list.size(); i++)
     {
-        tensor = graph->tensor_list[i].get();
+        tensor = graph->tensor_list[i];
 
         /* check index */
         if (tensor->index != ( int )i)
@@ -207,7 +199,7 @@ bool CheckGraphIntegraityByEdge(StaticGraph* graph)
 
         NodeSynapse node_entry = tensor->producer;
 
-        StaticNode* node = graph->node_list[node_entry.node_index].get();
+        StaticNode* node = graph->node_list[node_entry.node_index];
 
         if (node->index != node_entry.node_index)
         {
@@ -228,7 +220,7 @@ bool CheckGraphIntegraityByEdge(StaticGraph* graph)
         /* if the node has no input tensor, the op must be const or input */
         if (node->input_tensor_list.size() == 0)
         {
-            StaticOp* op = node->op.get();
+            StaticOp* op = node->op;
 
             if (op->name != "Const" && op->name != "InputOp")
             {
@@ -267,7 +259,7 @@ bool CheckGraphIntegraityByEdge(StaticGraph* graph)
         {
             node_entry = tensor->consumer[k];
 
-            node = graph->node_list[node_entry.node_index].get();
+            node = graph->node_list[node_entry.node_index];
 
             if (node->index != node_entry.node_index)
             {
@@ -303,19 +295,68 @@ bool CheckGraphIntegraity(StaticGraph* graph)
     return CheckGraphIntegraityByEdge(graph) && CheckGraphIntegraityByNode(graph);
 }
 
+void ReleaseStaticIndex(StaticGraph* graph)
+{
+    std::unordered_map<std::string, StaticTensorPtr>().swap(graph->const_tensor_map);
+    std::unordered_map<std::string, int>().swap(graph->node_map);
+    std::unordered_map<std::string, int>().swap(graph->tensor_map);
+}
+
+void ReleaseStaticTopology(StaticGraph* graph)
+{
+    /* the objects stay in the arena until the graph goes, their own buffers are released here */
+    for (auto node : graph->node_list)
+        node->~StaticNode();
+
+    for (auto op : graph->op_list)
+        op->~StaticOp();
+
+    std::vector<StaticTensorPtr> const_list;
+
+    for (auto tensor : graph->tensor_list)
+    {
+        StaticConstTensor* const_tensor = dynamic_cast<StaticConstTensor*>(tensor);
+
+        if (const_tensor == nullptr)
+        {
+            tensor->~StaticTensor();
+            continue;
+        }
+
+        /* mem_addr may still be borrowed by a runtime tensor */
+        std::string().swap(const_tensor->name);
+        std::vector<int>().swap(const_tensor->dims);
+        std::vector<float>().swap(const_tensor->scale);
+        std::vector<float>().swap(const_tensor->zero_point);
+        std::vector<NodeSynapse>().swap(const_tensor->consumer);
+
+        const_list.push_back(const_tensor);
+    }
+
+    std::vector<StaticNodePtr>().swap(graph->node_list);
+    std::vector<StaticOpPtr>().swap(graph->op_list);
+    graph->tensor_list.swap(const_list);
+
+    graph->input_node_list.clear();
+    graph->output_node_list.clear();
+
+    ReleaseStaticIndex(graph);
+}
+
 StaticNode* CreateStaticNode(StaticGraph* graph, const std::string& node_name)
 {
     /* the most important thing is to set the node idx */
 
     int node_idx = graph->node_list.size();
-    StaticNodePtr node_ptr(new StaticNode());
+    StaticNodePtr node_ptr = graph->arena.New<StaticNode>();
 
     node_ptr->name = node_name;
     node_ptr->index = node_idx;
 
     graph->node_list.emplace_back(node_ptr);
+    graph->node_map.emplace(node_name, node_idx);
 
-    return node_ptr.get();
+    return node_ptr;
 }
 
 const std::string& GetNodeName(StaticNode* node)
@@ -346,32 +387,33 @@ int AddNodeOutputTensor(StaticNode* node, StaticTensor* tensor)
 
 void SetNodeOp(StaticNode* node, StaticOp* op)
 {
-    node->op.reset(op);
+    node->op = op;
 }
 
 StaticOp* GetNodeOp(StaticNode* node)
 {
-    return node->op.get();
+    return node->op;
 }
 
 StaticTensor* GetNodeOutputTensor(StaticGraph* graph, StaticNode* node, int idx)
 {
     int tensor_idx = node->output_tensor_list[idx];
 
-    return graph->tensor_list[tensor_idx].get();
+    return graph->tensor_list[tensor_idx];
 }
 
 StaticTensor* GetNodeInputTensor(StaticGraph* graph, StaticNode* node, int idx)
 {
     int tensor_idx = node->input_tensor_list[idx];
 
-    return graph->tensor_list[tensor_idx].get();
+    return graph->tensor_list[tensor_idx];
 }
 
 StaticOp* CreateStaticOp(StaticGraph* graph, const std::string& op_name)
 {
-    StaticOp* op = new StaticOp();
+    StaticOp* op = graph->arena.New<StaticOp>();
     op->name = op_name;
+    graph->op_list.push_back(op);
     return op;
 }
 
@@ -380,6 +422,11 @@ void SetOperatorDynamicShape(StaticOp* op)
     op->dynamic_shape = true;
 }
 
+void SetOperatorStaticShape(StaticOp* op)
+{
+    op->static_shape = true;
+}
+
 void SetOperatorParam(StaticOp* op, any&& param)
 {
     op->param = std::move(param);
@@ -399,14 +446,15 @@ StaticTensor* CreateStaticTensor(StaticGraph* graph, const std::string& name)
 {
     int tensor_idx = graph->tensor_list.size();
 
-    StaticTensorPtr tensor_ptr(new StaticTensor());
+    StaticTensorPtr tensor_ptr = graph->arena.New<StaticTensor>();
 
     tensor_ptr->index = tensor_idx;
     tensor_ptr->name = name;
     tensor_ptr->type = kVarTensor;
     graph->tensor_list.push_back(tensor_ptr);
+    graph->tensor_map.emplace(name, tensor_idx);
 
-    return tensor_ptr.get();
+    return tensor_ptr;
 }
 
 void SetTensorDim(StaticTensor* tensor, const std::vector<int>& dims)
@@ -456,24 +504,25 @@ StaticNode* GetTensorProducer(StaticGraph* graph, StaticTensor* tensor)
     if (node_idx >= graph->node_list.size())
         return nullptr;
 
-    return graph->node_list[node_idx].get();
+    return graph->node_list[node_idx];
 }
 
 StaticTensor* CreateStaticConstTensor(StaticGraph* graph, const std::string& name)
 {
     int tensor_idx = graph->tensor_list.size();
 
-    StaticTensorPtr tensor_ptr(new StaticConstTensor());
+    StaticTensorPtr tensor_ptr = graph->arena.New<StaticConstTensor>();
 
     tensor_ptr->index = tensor_idx;
     tensor_ptr->name = name;
     tensor_ptr->type = kConstTensor;
 
     graph->tensor_list.push_back(tensor_ptr);
+    graph->tensor_map.emplace(name, tensor_idx);
 
     graph->const_tensor_map[name] = tensor_ptr;
 
-    return dynamic_cast<StaticTensor*>(tensor_ptr.get());
+    return tensor_ptr;
 }
 
 void* GetConstTensorBuffer(StaticTensor* tensor)
@@ -587,7 +636,7 @@ void DumpStaticGraph(StaticGraph* graph)
 
         StaticNodePtr node_ptr = graph->node_list[i];
 
-        DumpStaticNode(graph, node_ptr.get(), os);
+        DumpStaticNode(graph, node_ptr, os);
 
         os << "\n";
     }
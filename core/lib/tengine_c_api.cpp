@@ -39,6 +39,9 @@
 #include "graph_perf.hpp"
 #include "static_graph.hpp"
 #include "graph_executor.hpp"
+#include "graph_optimizer.hpp"
+#include "graph_cost.hpp"
+#include "graph_calibration.hpp"
 
 #include "serializer.hpp"
 
@@ -245,11 +248,9 @@ void release_tengine(void)
    model_format == "xxx:m", it is to load model from memory instead of file
 */
 
-graph_t create_graph(context_t context, const char* model_format, const char* fname, ...)
+static graph_t vcreate_graph(context_t context, const char* model_format, const char* fname, bool take_over,
+                             va_list argp)
 {
-    va_list argp;
-    va_start(argp, fname);
-
     bool new_context_created = false;
 
     ExecContext* exec_context = reinterpret_cast<ExecContext*>(context);
@@ -323,7 +324,7 @@ graph_t create_graph(context_t context, const char* model_format, const char* fn
         }
 
         if (model_loaded)
-            graph = create_graph_in_context(exec_context, graph_name, model_name.c_str());
+            graph = create_graph_in_context(exec_context, graph_name, model_name.c_str(), take_over);
     }
 
     if (graph == nullptr)
@@ -342,6 +343,30 @@ graph_t create_graph(context_t context, const char* model_format, const char* fn
     return graph;
 }
 
+graph_t create_graph(context_t context, const char* model_format, const char* fname, ...)
+{
+    va_list argp;
+    va_start(argp, fname);
+
+    graph_t graph = vcreate_graph(context, model_format, fname, false, argp);
+
+    va_end(argp);
+
+    return graph;
+}
+
+graph_t create_graph_exclusive(context_t context, const char* model_format, const char* fname, ...)
+{
+    va_list argp;
+    va_start(argp, fname);
+
+    graph_t graph = vcreate_graph(context, model_format, fname, true, argp);
+
+    va_end(argp);
+
+    return graph;
+}
+
 int save_graph(graph_t graph, const char* model_format, const char* fname, ...)
 {
     va_list argp;
@@ -369,11 +394,101 @@ int set_graph_layout(graph_t graph, int layout_type)
 
     Graph* real_graph = executor->GetGraph();
 
+    /* a NHWC graph is rewritten, instead of just read in another layout */
+    if (layout_type == TENGINE_LAYOUT_NCHW && real_graph->GetLayout() == TENGINE_LAYOUT_NHWC)
+    {
+        if (!GraphOptimizerManager::RunOpt("LayoutNCHW", real_graph))
+        {
+            set_tengine_errno(ENOSYS);
+            return -1;
+        }
+    }
+
     real_graph->SetLayout(layout_type);
 
     return 0;
 }
 
+int prepack_graph_weights(graph_t graph, const char* schemes)
+{
+    GraphExecutor* executor = reinterpret_cast<GraphExecutor*>(graph);
+    GraphOptimizer opt;
+
+    opt.name = "WeightPrepack";
+    opt.optimizer = graph_opt_t(GraphPrepackWeights);
+    opt.args = std::string(schemes);
+
+    if (!opt.optimizer(executor->GetOptimizedGraph(), &opt))
+    {
+        set_tengine_errno(EINVAL);
+        return -1;
+    }
+
+    return 0;
+}
+
+int report_graph_cost(graph_t graph, int top_num, const char* json_file)
+{
+    GraphExecutor* executor = reinterpret_cast<GraphExecutor*>(graph);
+    Graph* real_graph = executor->GetOptimizedGraph();
+
+    if (real_graph == nullptr)
+        real_graph = executor->GetGraph();
+
+    if (!ReportGraphCost(real_graph, top_num, json_file))
+    {
+        set_tengine_errno(EIO);
+        return -1;
+    }
+
+    return 0;
+}
+
+int calibrate_graph(graph_t graph, int sample_number, int (*get_sample)(int idx, float* data, int size, void* arg),
+                    void* arg, const char* method)
+{
+    GraphExecutor* executor = reinterpret_cast<GraphExecutor*>(graph);
+    Graph* real_graph = executor->GetOptimizedGraph();
+    std::string method_name(method ? method : "kl");
+    std::string::size_type sep = method_name.find(':');
+    float percentile = 99.99f;
+    int calib_method;
+
+    if (sep != std::string::npos)
+    {
+        percentile = strtof(method_name.c_str() + sep + 1, nullptr);
+        method_name.resize(sep);
+    }
+
+    if (method_name == "minmax")
+        calib_method = kCalibMinMax;
+    else if (method_name == "kl")
+        calib_method = kCalibKL;
+    else if (method_name == "percentile")
+        calib_method = kCalibPercentile;
+    else
+    {
+        set_tengine_errno(EINVAL);
+        return -1;
+    }
+
+    if (real_graph == nullptr || get_sample == nullptr)
+    {
+        set_tengine_errno(EINVAL);
+        return -1;
+    }
+
+    auto sample_func = [=](int idx, float* data, int size) { return get_sample(idx, data, size, arg) == 0; };
+
+    if (!CalibrateGraph(real_graph, sample_number, sample_func, calib_method, percentile))
+    {
+        set_tengine_errno(EINVAL);
+        return -1;
+    }
+
+    return 0;
+}
+
 int set_graph_input_node(graph_t graph, const char* input_nodes[], int input_number)
 {
     if (input_number <= 0)
@@ -274,11 +274,11 @@ int save_graph_internal(graph_t graph, const char* model_format, const char* fna
     return 0;
 }
 
-graph_t create_graph_in_context(context_t exec_context, const char* graph_name, const char* model_name)
+graph_t create_graph_in_context(context_t exec_context, const char* graph_name, const char* model_name, bool take_over)
 {
     GraphExecutor* executor = new GraphExecutor();
 
-    if (!executor->CreateGraph(exec_context, graph_name, model_name))
+    if (!executor->CreateGraph(exec_context, graph_name, model_name, take_over))
     {
         delete executor;
         return nullptr;
@@ -0,0 +1,354 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2020, Open AI Lab
+ */
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include "parallel_task.hpp"
+#include "tensor_permute.hpp"
+
+/* a tile of 16x16 elements keeps both the rows read and the rows written in L1 */
+#define PERMUTE_TILE 16
+
+/* elements per task: the thread start-up cost is paid back well before that */
+#define PERMUTE_TASK_SIZE (1 << 16)
+
+namespace TEngine {
+
+/*
+ * the permutation with the size-1 dims dropped and the dims which stay
+ * neighbours merged: a batched 2-d transpose becomes a 3-d one, whatever
+ * dims it came with
+ */
+struct PermutePlan
+{
+    std::vector<int> out_dims;
+    std::vector<size_t> in_stride;
+    std::vector<size_t> out_stride;
+    size_t elem_num;
+};
+
+static bool MakePermutePlan(const std::vector<int>& dims, const std::vector<int>& perm, PermutePlan& plan)
+{
+    int rank = dims.size();
+
+    if (( int )perm.size() != rank)
+        return false;
+
+    std::vector<bool> seen(rank, false);
+
+    for (auto p : perm)
+    {
+        if (p < 0 || p >= rank || seen[p])
+            return false;
+
+        seen[p] = true;
+    }
+
+    std::vector<size_t> stride(rank);
+    size_t elem_num = 1;
+
+    for (int i = rank - 1; i >= 0; i--)
+    {
+        if (dims[i] < 0)
+            return false;
+
+        stride[i] = elem_num;
+        elem_num *= dims[i];
+    }
+
+    plan.out_dims.clear();
+    plan.in_stride.clear();
+    plan.elem_num = elem_num;
+
+    for (int i = 0; i < rank; i++)
+    {
+        int d = dims[perm[i]];
+
+        if (d == 1)
+            continue;
+
+        /* the previous output dim is the input dim just in front of this one */
+        if (!plan.out_dims.empty() && plan.in_stride.back() == stride[perm[i]] * d)
+        {
+            plan.out_dims.back() *= d;
+            plan.in_stride.back() = stride[perm[i]];
+            continue;
+        }
+
+        plan.out_dims.push_back(d);
+        plan.in_stride.push_back(stride[perm[i]]);
+    }
+
+    int out_rank = plan.out_dims.size();
+    size_t out_size = 1;
+
+    plan.out_stride.resize(out_rank);
+
+    for (int i = out_rank - 1; i >= 0; i--)
+    {
+        plan.out_stride[i] = out_size;
+        out_size *= plan.out_dims[i];
+    }
+
+    return true;
+}
+
+/* the offsets of the idx-th element of the sub-space spanned by axes */
+static void GetOffsets(const PermutePlan& plan, const std::vector<int>& axes, size_t idx, size_t& in_offset,
+                       size_t& out_offset)
+{
+    in_offset = 0;
+    out_offset = 0;
+
+    for (int i = axes.size() - 1; i >= 0; i--)
+    {
+        int a = axes[i];
+        size_t pos = idx % plan.out_dims[a];
+
+        idx /= plan.out_dims[a];
+        in_offset += pos * plan.in_stride[a];
+        out_offset += pos * plan.out_stride[a];
+    }
+}
+
+/* the innermost dim stays in place: whole rows are copied */
+template <typename T> static void CopyRows(const T* src, T* dst, const PermutePlan& plan, int max_thread)
+{
+    int rank = plan.out_dims.size();
+    size_t row_size = plan.out_dims[rank - 1];
+    size_t row_num = plan.elem_num / row_size;
+    size_t task_rows = std::max(( size_t )1, PERMUTE_TASK_SIZE / row_size);
+    int task_num = (row_num + task_rows - 1) / task_rows;
+
+    std::vector<int> axes;
+
+    for (int i = 0; i < rank - 1; i++)
+        axes.push_back(i);
+
+    ParallelRun(
+        task_num,
+        [&](int task) {
+            size_t end = std::min(row_num, (task + 1) * task_rows);
+
+            for (size_t r = task * task_rows; r < end; r++)
+            {
+                size_t in_offset;
+                size_t out_offset;
+
+                GetOffsets(plan, axes, r, in_offset, out_offset);
+                std::memcpy(dst + out_offset, src + in_offset, row_size * sizeof(T));
+            }
+        },
+        max_thread);
+}
+
+/*
+ * the innermost input dim moves to output dim y, the innermost output dim
+ * comes from input dim x: each (x, y) plane is a 2-d transpose, done tile by
+ * tile. a task takes a band of y rows, or several planes when they are small
+ */
+template <typename T> static void CopyTiles(const T* src, T* dst, const PermutePlan& plan, int max_thread)
+{
+    int rank = plan.out_dims.size();
+    int x_axis = rank - 1;
+    int y_axis = 0;
+
+    while (plan.in_stride[y_axis] != 1)
+        y_axis++;
+
+    std::vector<int> axes;
+
+    for (int i = 0; i < rank; i++)
+    {
+        if (i != x_axis && i != y_axis)
+            axes.push_back(i);
+    }
+
+    int dx = plan.out_dims[x_axis];
+    int dy = plan.out_dims[y_axis];
+    size_t x_stride = plan.in_stride[x_axis];
+    size_t y_stride = plan.out_stride[y_axis];
+
+    int band = std::max(PERMUTE_TILE, PERMUTE_TASK_SIZE / dx / PERMUTE_TILE * PERMUTE_TILE);
+    int band_num = (dy + band - 1) / band;
+    size_t unit_num = plan.elem_num / (( size_t )dx * dy) * band_num;
+    size_t task_units = std::max(( size_t )1, PERMUTE_TASK_SIZE / (( size_t )std::min(band, dy) * dx));
+    int task_num = (unit_num + task_units - 1) / task_units;
+
+    ParallelRun(
+        task_num,
+        [&](int task) {
+            size_t end = std::min(unit_num, (task + 1) * task_units);
+
+            for (size_t u = task * task_units; u < end; u++)
+            {
+                size_t in_base;
+                size_t out_base;
+
+                GetOffsets(plan, axes, u / band_num, in_base, out_base);
+
+                int y0 = (u % band_num) * band;
+                int y1 = std::min(dy, y0 + band);
+
+                for (int yt = y0; yt < y1; yt += PERMUTE_TILE)
+                {
+                    int yt_end = std::min(y1, yt + PERMUTE_TILE);
+
+                    for (int xt = 0; xt < dx; xt += PERMUTE_TILE)
+                    {
+                        int xt_end = std::min(dx, xt + PERMUTE_TILE);
+
+                        for (int y = yt; y < yt_end; y++)
+                        {
+                            const T* s = src + in_base + y;
+                            T* d = dst + out_base + y * y_stride;
+
+                            for (int x = xt; x < xt_end; x++)
+                                d[x] = s[x * x_stride];
+                        }
+                    }
+                }
+            }
+        },
+        max_thread);
+}
+
+template <typename T> static void RunPermute(const T* src, T* dst, const PermutePlan& plan, int max_thread)
+{
+    if (plan.out_dims.empty())
+        *dst = *src;
+    else if (plan.in_stride.back() == 1)
+        CopyRows(src, dst, plan, max_thread);
+    else
+        CopyTiles(src, dst, plan, max_thread);
+}
+
+bool PermuteData(const void* src, void* dst, const std::vector<int>& dims, const std::vector<int>& perm,
+                 int elem_size, int max_thread)
+{
+    PermutePlan plan;
+
+    if (!MakePermutePlan(dims, perm, plan))
+        return false;
+
+    if (plan.elem_num == 0)
+        return true;
+
+    switch (elem_size)
+    {
+        case 1:
+            RunPermute(( const uint8_t* )src, ( uint8_t* )dst, plan, max_thread);
+            return true;
+        case 2:
+            RunPermute(( const uint16_t* )src, ( uint16_t* )dst, plan, max_thread);
+            return true;
+        case 4:
+            RunPermute(( const uint32_t* )src, ( uint32_t* )dst, plan, max_thread);
+            return true;
+        case 8:
+            RunPermute(( const uint64_t* )src, ( uint64_t* )dst, plan, max_thread);
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool TransposeData(const void* src, void* dst, int batch, int rows, int cols, int elem_size, int max_thread)
+{
+    return PermuteData(src, dst, {batch, rows, cols}, {0, 2, 1}, elem_size, max_thread);
+}
+
+/* a task takes a band of rows and swaps what is right of the diagonal with its mirror */
+template <typename T> static void SwapSquare(T* data, int batch, int n, int max_thread)
+{
+    int band_num = (n + PERMUTE_TILE - 1) / PERMUTE_TILE;
+
+    ParallelRun(
+        batch * band_num,
+        [&](int task) {
+            T* d = data + ( size_t )(task / band_num) * n * n;
+            int i0 = (task % band_num) * PERMUTE_TILE;
+            int i1 = std::min(n, i0 + PERMUTE_TILE);
+
+            for (int j0 = i0; j0 < n; j0 += PERMUTE_TILE)
+            {
+                int j1 = std::min(n, j0 + PERMUTE_TILE);
+
+                for (int i = i0; i < i1; i++)
+                {
+                    for (int j = std::max(j0, i + 1); j < j1; j++)
+                        std::swap(d[( size_t )i * n + j], d[( size_t )j * n + i]);
+                }
+            }
+        },
+        max_thread);
+}
+
+bool TransposeDataInPlace(void* data, int batch, int rows, int cols, int elem_size, int max_thread)
+{
+    if (batch < 0 || rows < 0 || cols < 0)
+        return false;
+
+    if (rows <= 1 || cols <= 1)
+        return true;
+
+    if (rows == cols)
+    {
+        switch (elem_size)
+        {
+            case 1:
+                SwapSquare(( uint8_t* )data, batch, rows, max_thread);
+                return true;
+            case 2:
+                SwapSquare(( uint16_t* )data, batch, rows, max_thread);
+                return true;
+            case 4:
+                SwapSquare(( uint32_t* )data, batch, rows, max_thread);
+                return true;
+            case 8:
+                SwapSquare(( uint64_t* )data, batch, rows, max_thread);
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    size_t size = ( size_t )batch * rows * cols * elem_size;
+    void* tmp = std::malloc(size);
+
+    if (tmp == nullptr)
+        return false;
+
+    bool ret = TransposeData(data, tmp, batch, rows, cols, elem_size, max_thread);
+
+    if (ret)
+        std::memcpy(data, tmp, size);
+
+    std::free(tmp);
+
+    return ret;
+}
+
+}    // namespace TEngine
@@ -22,6 +22,7 @@
  * Author: haitao@openailab.com
  */
 #include <unordered_map>
+#include <utility>
 
 #include "tensor_shape.hpp"
 #include "logger.hpp"
@@ -34,6 +35,11 @@ void TShape::SetDim(const std::vector<int>& args)
     dim_ = args;
 }
 
+void TShape::SetDim(std::vector<int>&& args)
+{
+    dim_ = std::move(args);
+}
+
 void TShape::DumpShape(std::ostream& os) const
 {
     std::string result = "[";
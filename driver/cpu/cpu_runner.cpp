@@ -28,10 +28,12 @@
 #include "cpu_runner.hpp"
 #include "tensor_mem.hpp"
 #include "graph_optimizer.hpp"
+#include "mem_plan.hpp"
 #include "cpu_driver.hpp"
 #include "operator/convolution.hpp"
 #include "operator/pooling.hpp"
 #include "operator/relu.hpp"
+#include "operator/fused_operator.hpp"
 #include "tengine_errno.hpp"
 
 namespace TEngine {
@@ -239,10 +241,10 @@ bool CPURunner::Prerun(Subgraph* sub_graph)
     for (unsigned int i = 0; i < sub_graph->seq_nodes.size(); i++)
     {
         Node* node = sub_graph->seq_nodes[i];
-        if (!node->ExistAttr(ATTR_NODE_OPS))
+        if (node->GetNodeOps() == nullptr)
             continue;
 
-        NodeOps* node_ops = any_cast<NodeOps*>(node->GetAttr(ATTR_NODE_OPS));
+        NodeOps* node_ops = node->GetNodeOps();
 
         if (!node_ops->Prerun(node))
         {
@@ -263,10 +265,10 @@ bool CPURunner::Postrun(Subgraph* sub_graph)
     {
         Node* node = seq_nodes[i];
 
-        if (!node->ExistAttr(ATTR_NODE_OPS))
+        if (node->GetNodeOps() == nullptr)
             continue;
 
-        NodeOps* node_ops = any_cast<NodeOps*>(node->GetAttr(ATTR_NODE_OPS));
+        NodeOps* node_ops = node->GetNodeOps();
 
         if (!node_ops->Postrun(node))
         {
@@ -304,6 +306,15 @@ bool CPURunner::FreeMem(Subgraph* sub_graph)
         sub_graph->RemoveAttr("shared_temp_memory");
     }
 
+    if (sub_graph->ExistAttr("mem_arena"))
+    {
+        void* mem_addr = any_cast<void*>(sub_graph->GetAttr("mem_arena"));
+
+        mem_free(mem_addr);
+
+        sub_graph->RemoveAttr("mem_arena");
+    }
+
     if (sub_graph->ExistAttr("MemPool"))
     {
         MemPool* mem_pool = any_cast<MemPool*>(sub_graph->GetAttr("MemPool"));
@@ -323,31 +334,74 @@ bool CPURunner::UnbindNodeOps(Subgraph* sub_graph)
     {
         Node* node = seq_nodes[i];
 
-        if (!node->ExistAttr(ATTR_NODE_OPS))
+        if (node->GetNodeOps() == nullptr)
             continue;
 
-        NodeOps* node_ops = any_cast<NodeOps*>(node->GetAttr(ATTR_NODE_OPS));
+        NodeOps* node_ops = node->GetNodeOps();
 
         node_ops->OnUnbind(node);
 
         node_ops->Release();
 
-        node->RemoveAttr(ATTR_NODE_OPS);
+        node->SetNodeOps(nullptr);
     }
 
     return true;
 }
 
+/* a GRAPH_ATTR_FUSE_ switch, passed on by the device executor */
+static bool GetFuseAttr(Subgraph* graph, const char* name)
+{
+    return graph->ExistAttr(name) && any_cast<int>(graph->GetAttr(name)) != 0;
+}
+
 bool CPURunner::OptimizeGraph(Subgraph* optimized_graph)
 {
     #if 1
 
-    GraphOptimizerManager::RunOpt("BNScale", optimized_graph);
-    GraphOptimizerManager::RunOpt("FcBn", optimized_graph);
-    GraphOptimizerManager::RunOpt("UnsEltConv", optimized_graph);
-    GraphOptimizerManager::RunOpt("ConvBN", optimized_graph);
-    GraphOptimizerManager::RunOpt("ConvReLu", optimized_graph);
-    GraphOptimizerManager::RunOpt("ConvReLu6", optimized_graph);
+    for (auto name : {"ConstFold", "Transpose", "ReshapeFold", "CSE", "DCE"})
+    {
+        if (!GraphOptimizerManager::RunOpt(name, optimized_graph))
+        {
+            XLOG_ERROR() << "graph: " << optimized_graph->GetName() << " optimizer " << name << " failed\n";
+            return false;
+        }
+    }
+
+    /* the fused ops need kernels: convert_tool may ask for them in the tmfile anyway */
+    bool fuse_transformer = GetFuseAttr(optimized_graph, GRAPH_ATTR_FUSE_TRANSFORMER);
+    std::vector<std::string> fusions;
+
+    if (fuse_transformer || NodeOpsRegistryManager::HasOpImplementor("LayerNorm"))
+        fusions.push_back("LayerNormFuse");
+
+    if (fuse_transformer || NodeOpsRegistryManager::HasOpImplementor("Gelu"))
+        fusions.push_back("GeluFuse");
+
+    if (fuse_transformer || NodeOpsRegistryManager::HasOpImplementor("Attention"))
+        fusions.push_back("AttentionFuse");
+
+    for (auto name : {"PadFuse", "BNScale", "FcBn", "UnsEltConv", "ConvBN", "DeconvBN", "BNConv"})
+        fusions.push_back(name);
+
+    /* only worth it when a kernel runs the fused op, or asked for a tmfile */
+    if (GetFuseAttr(optimized_graph, GRAPH_ATTR_FUSE_CONV_ELTWISE) ||
+        NodeOpsRegistryManager::HasOpImplementor(FusedConvEltwise::class_name))
+        fusions.push_back("ConvEltwise");
+
+    fusions.push_back("ConvReLu");
+    fusions.push_back("ConvReLu6");
+
+    /* the other activations need kernels which know the extended encoding */
+    if (GetFuseAttr(optimized_graph, GRAPH_ATTR_FUSE_ACTIVATION))
+        fusions.push_back("ConvActivation");
+
+    /* one rewrite to a fixed point: a fusion also sees the nodes the others made, in any order */
+    if (GraphFuse(optimized_graph, fusions) < 0)
+    {
+        XLOG_ERROR() << "graph: " << optimized_graph->GetName() << " fusion failed\n";
+        return false;
+    }
 
     // GraphOptimizerManager::RunOpt("SigMul", optimized_graph);
     #endif
@@ -370,7 +424,7 @@ static void CalculateMemBlocks(std::vector<int>& mem_block, Subgraph* sub_graph)
         Node* node = seq_nodes[i];
 
         // first, add output tensor into map
-        if (!node->IsDynamicShape() && node->ExistAttr(ATTR_NODE_OPS))
+        if (!node->IsDynamicShape() && node->GetNodeOps() != nullptr)
         {
             for (unsigned int j = 0; j < node->GetOutputNum(); j++)
             {
@@ -447,6 +501,174 @@ static void CalculateMemBlocks(std::vector<int>& mem_block, Subgraph* sub_graph)
     }
 }
 
+/* the bytes the pool of CalculateMemBlocks takes: as many blocks of the smallest size, and the rest */
+static uint64_t GetPoolSize(const std::vector<int>& mem_blocks)
+{
+    if (mem_blocks.empty())
+        return 0;
+
+    uint64_t pool_size = ( uint64_t )mem_blocks[0] * mem_blocks.size();
+
+    for (unsigned int i = 1; i < mem_blocks.size(); i++)
+        pool_size += mem_blocks[i];
+
+    return pool_size;
+}
+
+struct PlannedTensor
+{
+    Tensor* tensor;
+    uint32_t offset;
+    int first;
+    int last;
+};
+
+/*
+ * the plan was made for the graph saved: a pass rewriting it since may have moved a
+ * tensor to a place still in use by another. check the places of the tensors alive
+ * at the same time in this subgraph do not overlap
+ */
+static bool CheckPlannedMem(Subgraph* sub_graph, std::vector<PlannedTensor>& places)
+{
+    const std::vector<Node*>& seq_nodes = sub_graph->seq_nodes;
+    int node_number = seq_nodes.size();
+    std::unordered_map<Node*, int> node_idx;
+
+    for (int i = 0; i < node_number; i++)
+        node_idx[seq_nodes[i]] = i;
+
+    for (auto& place : places)
+    {
+        Tensor* tensor = place.tensor;
+
+        place.first = node_idx.at(tensor->producer->owner);
+        place.last = place.first;
+
+        /* the outputs of the subgraph stay till the end */
+        if (tensor->consumer.empty() || tensor->IsGraphOutput())
+            place.last = node_number;
+
+        for (auto port : tensor->consumer)
+        {
+            auto ir = node_idx.find(port->owner);
+
+            place.last = std::max(place.last, ir == node_idx.end() ? node_number : ir->second);
+        }
+    }
+
+    std::sort(places.begin(), places.end(),
+              [](const PlannedTensor& a, const PlannedTensor& b) { return a.first < b.first; });
+
+    std::vector<const PlannedTensor*> live;
+
+    for (auto& place : places)
+    {
+        uint32_t end = place.offset + place.tensor->GetTotalSize();
+        unsigned int live_num = 0;
+
+        for (auto p : live)
+        {
+            if (p->last < place.first)
+                continue;
+
+            live[live_num++] = p;
+
+            if (place.offset < p->offset + p->tensor->GetTotalSize() && p->offset < end)
+            {
+                LOG_WARN() << "mem plan: " << place.tensor->GetName() << " overlaps " << p->tensor->GetName()
+                           << ", the graph was changed since\n";
+                return false;
+            }
+        }
+
+        live.resize(live_num);
+        live.push_back(&place);
+    }
+
+    return true;
+}
+
+/*
+ * the tensors go where the convert time plan (see mem_plan.hpp) put them, if every
+ * tensor to allocate has a place, still fits in it and no place is shared by two
+ * tensors alive at once. otherwise, or if the pool of CalculateMemBlocks would be
+ * smaller than the arena, the pool does it.
+ * the plan gives every output its own place, so a kernel which wants an output on
+ * its input (ATTR_INPLACE) leaves the graph to the pool as well
+ */
+static bool AllocatePlannedMem(Subgraph* sub_graph, uint64_t pool_size, mem_alloc_t alloc_func,
+                               mem_free_t free_func)
+{
+    const std::vector<Node*>& seq_nodes = sub_graph->seq_nodes;
+    std::vector<PlannedTensor> places;
+    uint32_t arena_size = 0;
+
+    for (unsigned int i = 0; i < seq_nodes.size(); i++)
+    {
+        Node* node = seq_nodes[i];
+
+        if (node->IsDynamicShape() || node->GetNodeOps() == nullptr)
+            continue;
+
+        if (node->ExistAttr(ATTR_INPLACE) && !any_cast<inplace_t>(node->GetAttr(ATTR_INPLACE)).empty())
+            return false;
+
+        const MemPlanHeader* header = GetMemPlan(node);
+        const MemPlanEntry* entry = header ? ( const MemPlanEntry* )(header + 1) : nullptr;
+
+        for (unsigned int j = 0; j < node->GetOutputNum(); j++)
+        {
+            Tensor* tensor = node->GetOutputTensor(j);
+
+            if (get_tensor_mem(tensor))
+                continue;
+
+            if (header == nullptr || entry[j].offset == MEM_PLAN_NONE ||
+                tensor->GetTotalSize() > entry[j].size || (arena_size && header->arena_size != arena_size))
+                return false;
+
+            arena_size = header->arena_size;
+            places.push_back(PlannedTensor{tensor, entry[j].offset, 0, 0});
+        }
+    }
+
+    if (places.empty())
+        return false;
+
+    LOG_INFO() << "graph: " << sub_graph->GetName() << " planned arena: " << arena_size
+               << " bytes, memory pool: " << pool_size << " bytes\n";
+
+    if (arena_size > pool_size || !CheckPlannedMem(sub_graph, places))
+        return false;
+
+    void* arena_mem = alloc_func(arena_size + 128 + MEM_ALIGN_SIZE);
+
+    if (arena_mem == nullptr)
+        return false;
+
+    void* arena = ( void* )((( long )(arena_mem) + MEM_ALIGN_SIZE - 1) & (MEM_ALIGN_MASK));
+
+    for (unsigned int i = 0; i < places.size(); i++)
+    {
+        Tensor* tensor = places[i].tensor;
+
+        if (!set_tensor_mem(tensor, ( char* )arena + places[i].offset, tensor->GetTotalSize(), nullptr))
+        {
+            /* the pool starts from scratch */
+            for (unsigned int k = 0; k < i; k++)
+                free_tensor_mem(places[k].tensor);
+
+            free_func(arena_mem);
+
+            return false;
+        }
+    }
+
+    sub_graph->SetAttr("mem_arena", arena_mem);
+
+    return true;
+}
+
 bool CPURunner::AllocateMem(Subgraph* sub_graph)
 {
     const std::vector<Node*>& seq_nodes = sub_graph->seq_nodes;
@@ -463,10 +685,10 @@ bool CPURunner::AllocateMem(Subgraph* sub_graph)
     {
         Node* node = seq_nodes[i];
 
-        if (!node->ExistAttr(ATTR_NODE_OPS))
+        if (node->GetNodeOps() == nullptr)
             continue;
 
-        NodeOps* node_ops = any_cast<NodeOps*>(node->GetAttr(ATTR_NODE_OPS));
+        NodeOps* node_ops = node->GetNodeOps();
         unsigned int mem_size = 0;
 
         if (node_ops->GetSharedMemorySize(node, mem_size) && mem_size > max_shared_mem_size)
@@ -486,10 +708,10 @@ bool CPURunner::AllocateMem(Subgraph* sub_graph)
         {
             Node* node = seq_nodes[i];
 
-            if (!node->ExistAttr(ATTR_NODE_OPS))
+            if (node->GetNodeOps() == nullptr)
                 continue;
 
-            NodeOps* node_ops = any_cast<NodeOps*>(node->GetAttr(ATTR_NODE_OPS));
+            NodeOps* node_ops = node->GetNodeOps();
 
             unsigned int mem_size = 0;
 
@@ -508,6 +730,9 @@ bool CPURunner::AllocateMem(Subgraph* sub_graph)
 
     CalculateMemBlocks(mem_blocks, sub_graph);
 
+    if (AllocatePlannedMem(sub_graph, GetPoolSize(mem_blocks), mem_alloc, mem_free))
+        return true;
+
     MemPool* mem_pool = new MemPool(mem_blocks, mem_alloc, mem_free);
 
     sub_graph->SetAttr("MemPool", mem_pool);
@@ -521,7 +746,7 @@ bool CPURunner::AllocateMem(Subgraph* sub_graph)
     {
         Node* node = seq_nodes[i];
 
-        if (node->IsDynamicShape() || !node->ExistAttr(ATTR_NODE_OPS))
+        if (node->IsDynamicShape() || node->GetNodeOps() == nullptr)
             continue;
 
         for (unsigned int i = 0; i < node->GetOutputNum(); i++)
@@ -639,7 +864,7 @@ bool CPURunner::BindNodeOps(Subgraph* sub_graph)
 
         node_ops->SetHelper(mem_alloc, mem_free, dispatch, wait);
 
-        node->SetAttr(ATTR_NODE_OPS, node_ops);
+        node->SetNodeOps(node_ops);
 
         node_ops->exec_attr = exec_attr;
 
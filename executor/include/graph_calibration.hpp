@@ -0,0 +1,62 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+/*
+ * Copyright (c) 2020, Open AI Lab
+ */
+#ifndef __GRAPH_CALIBRATION_HPP__
+#define __GRAPH_CALIBRATION_HPP__
+
+#include <functional>
+
+namespace TEngine {
+
+class Graph;
+
+enum CalibMethod
+{
+    kCalibMinMax,
+    kCalibKL,
+    kCalibPercentile
+};
+
+/* the |x| histogram of a tensor over all the samples */
+#define CALIB_HIST_BINS 2048
+
+/* the int8 levels the KL threshold search quantizes the histogram to */
+#define CALIB_KL_LEVELS 128
+
+/* fills data, size floats, with the preprocessed sample idx: false stops the calibration */
+using calib_sample_t = std::function<bool(int idx, float* data, int size)>;
+
+/*
+ * runs the fp32 graph over sample_num samples with the reference forward (see
+ * ref_forward.hpp), the samples in parallel, and sets the int8 quant params of the
+ * input and activation tensors: a symmetric scale per tensor from the threshold of
+ * the method, percentile in (0, 100] for kCalibPercentile. the Convolution,
+ * Deconvolution and FullyConnected weights get a scale per output channel.
+ * the graph must be NCHW, with one input. a node with no reference forward or
+ * no static shape, and whatever it feeds, keeps no quant params and stays fp32
+ */
+bool CalibrateGraph(Graph* graph, int sample_num, const calib_sample_t& get_sample, int method, float percentile);
+
+}    // namespace TEngine
+
+#endif
@@ -0,0 +1,59 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2020, Open AI Lab
+ */
+#ifndef __GRAPH_COST_HPP__
+#define __GRAPH_COST_HPP__
+
+namespace TEngine {
+
+class Node;
+class Graph;
+
+/* the work of a node for its current shapes: the bytes of all its inputs and outputs */
+struct NodeCost
+{
+    double fops;
+    double param_bytes;    /* the const inputs: weights, biases */
+    double read_bytes;    /* the other inputs */
+    double write_bytes;
+
+    /* flops per byte moved */
+    double Intensity(void) const
+    {
+        double bytes = param_bytes + read_bytes + write_bytes;
+
+        return bytes > 0 ? fops / bytes : 0;
+    }
+};
+
+/* false if a shape is unknown: the cost is left at zero */
+bool GetNodeCost(Node* node, NodeCost& cost);
+
+/*
+ * prints the nodes ranked by flops, the heaviest top_num ones, then the totals.
+ * json_file, if not nullptr, gets all the nodes in graph order
+ */
+bool ReportGraphCost(Graph* graph, int top_num, const char* json_file);
+
+}    // namespace TEngine
+
+#endif
@@ -25,6 +25,7 @@
 #define __GRAPH_OPTIMIZER_HPP__
 
 #include <string>
+#include <vector>
 #include <functional>
 
 #include "any.hpp"
@@ -33,8 +34,17 @@
 namespace TEngine {
 
 class Graph;
+class Node;
 struct GraphOptimizer;
 
+/*
+ * graph attrs, int: also fuse into the ops only some kernels run, as convert_tool
+ * does for a tmfile. the device optimizers find them on their subgraph
+ */
+#define GRAPH_ATTR_FUSE_CONV_ELTWISE "fuse_conv_eltwise"
+#define GRAPH_ATTR_FUSE_ACTIVATION "fuse_activation"
+#define GRAPH_ATTR_FUSE_TRANSFORMER "fuse_transformer"
+
 using graph_opt_t = std::function<bool(Graph*, GraphOptimizer*)>;
 
 struct GraphOptimizer
@@ -52,6 +62,44 @@ public:
     static void Init(void);
 };
 
+/* evaluates the nodes whose inputs are all constant, see graph_const_fold.cpp */
+bool GraphConstFold(Graph* graph, GraphOptimizer* opt);
+
+/* merges, sinks and absorbs Transpose/Permute ops, see graph_transpose_opt.cpp */
+bool GraphOptimizeTranspose(Graph* graph, GraphOptimizer* opt);
+
+/* merges the nodes computing the same value and drops the ones nothing reads, see graph_cse.cpp */
+bool GraphEliminateCommonSubexpr(Graph* graph, GraphOptimizer* opt);
+bool GraphEliminateDeadCode(Graph* graph, GraphOptimizer* opt);
+
+/* collapses the shape-only chains and drops the no-op nodes, see graph_reshape_fold.cpp */
+bool GraphFoldReshape(Graph* graph, GraphOptimizer* opt);
+
+/* rewrites a NHWC graph into a NCHW one, weights included, see graph_layout_convert.cpp */
+bool GraphConvertToNCHW(Graph* graph, GraphOptimizer* opt);
+
+/* adds the conv/fc weights packed for the kernels as node attrs, see graph_weight_prepack.cpp */
+bool GraphPrepackWeights(Graph* graph, GraphOptimizer* opt);
+
+/* places the activation tensors of the static shape nodes in one arena, see graph_mem_plan.cpp */
+bool GraphPlanMemory(Graph* graph, GraphOptimizer* opt);
+
+/*
+ * runs the rules of the named fusions (ConvBN, ConvReLu, ...) in one graph rewrite, until none of
+ * them matches any more. on the same node the rules of the earlier names are tried first.
+ * returns the number of rewrites applied, or -1 if a rewrite failed and the graph should not be run
+ */
+int GraphFuse(Graph* graph, const std::vector<std::string>& fusions);
+
+/* the names of the GRAPH_ATTR_FUSE_ attrs */
+const std::vector<std::string>& GetFuseGraphAttrs(void);
+
+/* element-wise ops: each output element only depends on the input elements at the same place */
+const std::vector<std::string>& GetElementwiseOps(void);
+
+/* y[c] = x[c] * scale[c] + shift[c] of a BatchNormalization or a channel Scale node, false if not const */
+bool GetChannelAffine(Node* node, int channel_num, std::vector<float>& scale, std::vector<float>& shift);
+
 }    // namespace TEngine
 
 #endif
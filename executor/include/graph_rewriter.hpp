@@ -0,0 +1,109 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2020, Open AI Lab
+ */
+
+#ifndef __GRAPH_REWRITER_HPP__
+#define __GRAPH_REWRITER_HPP__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+
+
+namespace TEngine {
+
+class Graph;
+class Node;
+
+using Subgraph = Graph;
+
+/*
+ * a pattern is a small tree hanging off the inputs of its root, items[0],
+ * which is the last node of the matched chain.
+ */
+struct PatternItem
+{
+    std::vector<std::string> ops;    // any of these op types, empty means any op
+    std::function<bool(Node*)> check;    // extra condition, optional
+    std::vector<std::pair<int, int>> inputs;    // input port --> index of the item producing it
+    bool single_consumer = false;    // the only output feeds the matched node only
+};
+
+struct GraphPattern
+{
+    std::vector<PatternItem> items;
+
+    /* ops[0] --> ops[1] --> ... --> ops[n-1], connected through input 0 */
+    static GraphPattern Chain(const std::vector<std::string>& ops);
+};
+
+/*
+ * match holds the node bound to each pattern item.
+ * fill orig with the nodes to drop and fused with the new ones,
+ * return false to leave the match alone.
+ */
+using rewrite_func_t =
+    std::function<bool(Graph* graph, const std::vector<Node*>& match, Subgraph* orig, Subgraph* fused)>;
+
+struct RewriteRule
+{
+    std::string name;
+    GraphPattern pattern;
+    rewrite_func_t rewrite;
+};
+
+/*
+ * applies rules until none of them matches any more. nodes are visited
+ * from a worklist seeded with the whole graph; after a rewrite only the
+ * new nodes and their neighbours are queued again. the graph is sorted
+ * once at the end, not after every replacement.
+ */
+class GraphRewriter
+{
+public:
+    void AddRule(const RewriteRule& rule);
+
+    /* returns the number of rewrites applied, or -1 if one could not be applied */
+    int Run(Graph* graph);
+
+private:
+    bool MatchItem(const RewriteRule& rule, int rule_idx, int item_idx, Node* node, std::vector<Node*>& match);
+    uint32_t GetOpType(Node* node);
+
+    std::vector<RewriteRule> rules_;
+
+    /* op type ids of every item of every rule */
+    std::vector<std::vector<std::vector<uint32_t>>> rule_ops_;
+
+    /* root op type --> rules, rules with any-op roots are always tried */
+    std::unordered_map<uint32_t, std::vector<int>> root_rules_;
+    std::vector<int> any_root_rules_;
+
+    /* op type name --> id */
+    std::unordered_map<std::string, uint32_t> op_types_;
+};
+
+}    // namespace TEngine
+
+#endif
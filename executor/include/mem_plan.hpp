@@ -0,0 +1,68 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2020, Open AI Lab
+ */
+#ifndef __MEM_PLAN_HPP__
+#define __MEM_PLAN_HPP__
+
+#include <cstdint>
+
+namespace TEngine {
+
+class Node;
+
+/*
+ * the places of the activation tensors in one arena, planned ahead of time for the
+ * static shapes. each node with planned outputs has a custom node attr "mem_plan",
+ * saved in the tmfile with the node: a MemPlanHeader and a MemPlanEntry per output
+ */
+#define MEM_PLAN_ATTR "mem_plan"
+#define MEM_PLAN_VERSION 1
+
+/* the offsets are aligned to it */
+#define MEM_PLAN_ALIGN 64
+
+/* the output is left to the runtime */
+#define MEM_PLAN_NONE 0xffffffff
+
+struct MemPlanHeader
+{
+    int32_t version;
+    int32_t output_num;
+    uint32_t arena_size;    /* bytes of the whole arena, the same for all nodes of the graph */
+    int32_t reserved;
+};
+
+struct MemPlanEntry
+{
+    uint32_t offset;
+    uint32_t size;    /* bytes reserved: the tensor may not grow past it */
+};
+
+/* the plan of node, nullptr if none. the entries start at header + 1 */
+const MemPlanHeader* GetMemPlan(Node* node);
+
+/* removes the plan of node: a node made by a rewrite may not keep the place of the one it replaced */
+void DropMemPlan(Node* node);
+
+}    // namespace TEngine
+
+#endif
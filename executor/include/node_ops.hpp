@@ -280,6 +280,9 @@ public:
     static void AddRegistry(const std::string& name, NodeOpsRegistry* reg);
     static NodeOpsRegistry* FindRegistry(const std::string& name);
 
+    /* any registry has a kernel for op_name */
+    static bool HasOpImplementor(const std::string& op_name);
+
     template <typename T> static NodeOps* simple_select_function(T* ops, const CPUInfo* info, Node* node)
     {
         NodeOps* new_ops = new T(*ops);
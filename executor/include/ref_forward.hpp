@@ -0,0 +1,44 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+/*
+ * Copyright (c) 2020, Open AI Lab
+ */
+#ifndef __REF_FORWARD_HPP__
+#define __REF_FORWARD_HPP__
+
+#include <vector>
+
+namespace TEngine {
+
+class Node;
+
+/*
+ * a plain fp32 NCHW forward of one node for the offline tools, such as the int8
+ * calibration: single threaded and slow, but it needs no device. the shapes of
+ * the node tensors must be known. inputs[i] is the data of input port i, const
+ * ones included, outputs[i] a buffer of the size of output port i
+ */
+bool RefForwardSupported(Node* node);
+bool RefForward(Node* node, const std::vector<const float*>& inputs, const std::vector<float*>& outputs);
+
+}    // namespace TEngine
+
+#endif
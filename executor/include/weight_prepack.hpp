@@ -0,0 +1,77 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2020, Open AI Lab
+ */
+#ifndef __WEIGHT_PREPACK_HPP__
+#define __WEIGHT_PREPACK_HPP__
+
+#include <cstdint>
+
+namespace TEngine {
+
+class Node;
+
+/*
+ * the weights of a Convolution or FullyConnected node packed for a kernel ahead
+ * of time. each packing is a custom node attr "prepack.<scheme name>", saved in
+ * the tmfile with the node: a PrepackHeader and the packed fp32 data after it.
+ * the original weight tensor is left as it is
+ */
+#define PREPACK_ATTR_PREFIX "prepack."
+#define PREPACK_VERSION 1
+
+enum PrepackScheme
+{
+    /*
+     * [group][M / tile_m][K][tile_m]: panels of tile_m weight rows, K interleaved,
+     * the last panel zero padded. M is output channels per group, K is
+     * input channels per group * kernel_h * kernel_w. tile_n is the width of the
+     * im2col panel the kernel multiplies them with
+     */
+    PREPACK_GEMM = 1,
+
+    /* [output channel][input channel][tile_n][tile_n]: G g G^T of F(tile_m, 3), tile_n = tile_m + 2 */
+    PREPACK_WINOGRAD = 2,
+};
+
+/* the layouts are plain fp32, valid for any ISA with kernels of the same tiles */
+#define PREPACK_ISA_ANY 0
+
+struct PrepackHeader
+{
+    int32_t version;
+    int32_t scheme;
+    int32_t tile_m;
+    int32_t tile_n;
+    int32_t isa;
+    int32_t group;
+    int32_t out_dim;    /* M: output channels, or FC outputs */
+    int32_t in_dim;    /* K of one group, before packing */
+    uint32_t data_size;    /* bytes of packed data after the header */
+    int32_t reserved[3];
+};
+
+/* the packed weights of node named scheme_name (e.g. "gemm4x16"), nullptr if none. data starts at header + 1 */
+const PrepackHeader* GetPrepackedWeight(Node* node, const char* scheme_name);
+
+}    // namespace TEngine
+
+#endif
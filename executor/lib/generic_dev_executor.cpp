@@ -23,6 +23,7 @@
  */
 
 #include "graph_task.hpp"
+#include "graph_optimizer.hpp"
 #include "generic_dev_executor.hpp"
 
 namespace TEngine {
@@ -209,6 +210,15 @@ bool GenericDevExecutor::OptimizeGraph(SubgraphTask* task)
     if (task->graph_handle == nullptr)
         return false;
 
+    /* the fusion switches are set on the whole graph, the device optimizes its subgraph */
+    Graph* graph = task->graph_task->GetGraphExecutor()->GetGraph();
+
+    for (auto& name : GetFuseGraphAttrs())
+    {
+        if (graph != task->sub_graph && graph->ExistAttr(name))
+            task->sub_graph->SetAttr(name, graph->GetAttr(name));
+    }
+
     task->graph_optimized = DevOptimizeGraph(task->graph_handle);
 
     return task->graph_optimized;
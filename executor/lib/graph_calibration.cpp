@@ -0,0 +1,556 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+/*
+ * Copyright (c) 2020, Open AI Lab
+ */
+#include <cmath>
+#include <cfloat>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <unordered_map>
+
+#include "logger.hpp"
+#include "node.hpp"
+#include "graph.hpp"
+#include "graph_calibration.hpp"
+#include "ref_forward.hpp"
+#include "parallel_task.hpp"
+#include "operator/deconvolution.hpp"
+
+namespace TEngine {
+
+/* the nodes to run and the var tensors they pass along: the graph input is tensor 0 */
+struct CalibContext
+{
+    std::vector<Node*> nodes;
+    std::vector<Tensor*> tensors;
+    std::vector<int> consumer_num;
+    std::unordered_map<Tensor*, int> tensor_idx;
+    const calib_sample_t* get_sample;
+};
+
+using calib_visit_t = std::function<void(int tensor, const float* data, int size)>;
+
+static int AddCalibTensor(CalibContext& ctx, Tensor* tensor)
+{
+    int idx = ctx.tensors.size();
+
+    ctx.tensors.push_back(tensor);
+    ctx.consumer_num.push_back(0);
+    ctx.tensor_idx[tensor] = idx;
+
+    return idx;
+}
+
+static bool InitCalibContext(Graph* graph, CalibContext& ctx)
+{
+    if (graph->GetLayout() != TENGINE_LAYOUT_NCHW || graph->input_nodes.size() != 1 ||
+        graph->input_nodes[0]->GetOutputNum() != 1)
+    {
+        LOG_ERROR() << "graph: " << graph->GetName() << " calibration needs a NCHW graph with one input\n";
+        return false;
+    }
+
+    Tensor* input = graph->input_nodes[0]->GetOutputTensor(0);
+
+    if (input->GetDataType() != TENGINE_DT_FP32 || input->GetShape().GetSize() <= 0)
+    {
+        LOG_ERROR() << "graph: " << graph->GetName() << " needs a fp32 input of known shape\n";
+        return false;
+    }
+
+    AddCalibTensor(ctx, input);
+
+    /* a node the reference forward can not run stays fp32, and so do the nodes fed by it */
+    int skip_num = 0;
+
+    for (auto node : graph->seq_nodes)
+    {
+        const std::string& op_name = node->GetOp()->GetName();
+
+        if (op_name == "Const" || op_name == "Input")
+            continue;
+
+        bool ready = true;
+
+        for (unsigned int i = 0; i < node->GetInputNum(); i++)
+        {
+            Tensor* tensor = node->GetInputTensor(i);
+
+            if (tensor->GetType() != kConstTensor && !ctx.tensor_idx.count(tensor))
+                ready = false;
+        }
+
+        if (!ready)
+        {
+            skip_num++;
+            continue;
+        }
+
+        Tensor* output = node->GetOutputTensor(0);
+
+        if (!RefForwardSupported(node) || output->GetShape().GetSize() <= 0)
+        {
+            LOG_WARN() << "node: " << node->GetName() << " op: " << op_name
+                       << " can not be calibrated, left fp32\n";
+            continue;
+        }
+
+        /* a buffer goes once the last node run reads it: the nodes left out do not count */
+        for (unsigned int i = 0; i < node->GetInputNum(); i++)
+        {
+            auto ir = ctx.tensor_idx.find(node->GetInputTensor(i));
+
+            if (ir != ctx.tensor_idx.end())
+                ctx.consumer_num[ir->second]++;
+        }
+
+        AddCalibTensor(ctx, output);
+        ctx.nodes.push_back(node);
+    }
+
+    if (skip_num > 0)
+        LOG_WARN() << "graph: " << graph->GetName() << " " << skip_num << " nodes fed by them are left fp32 too\n";
+
+    if (ctx.nodes.empty())
+    {
+        LOG_ERROR() << "graph: " << graph->GetName() << " has no node to calibrate\n";
+        return false;
+    }
+
+    return true;
+}
+
+/* the buffers of a tensor go once its last consumer has run */
+static bool RunSample(const CalibContext& ctx, int idx, const calib_visit_t& visit)
+{
+    std::vector<std::vector<float>> buffers(ctx.tensors.size());
+    std::vector<int> ref_num(ctx.consumer_num);
+
+    buffers[0].resize(ctx.tensors[0]->GetShape().GetSize());
+
+    if (!(*ctx.get_sample)(idx, buffers[0].data(), buffers[0].size()))
+    {
+        LOG_ERROR() << "no calibration sample: " << idx << "\n";
+        return false;
+    }
+
+    visit(0, buffers[0].data(), buffers[0].size());
+
+    for (auto node : ctx.nodes)
+    {
+        std::vector<const float*> inputs;
+        std::vector<float*> outputs;
+
+        for (unsigned int i = 0; i < node->GetInputNum(); i++)
+        {
+            Tensor* tensor = node->GetInputTensor(i);
+
+            if (tensor->GetType() == kConstTensor)
+                inputs.push_back(( const float* )tensor->GetMemAddr());
+            else
+                inputs.push_back(buffers[ctx.tensor_idx.at(tensor)].data());
+        }
+
+        int out_idx = ctx.tensor_idx.at(node->GetOutputTensor(0));
+
+        buffers[out_idx].resize(ctx.tensors[out_idx]->GetShape().GetSize());
+        outputs.push_back(buffers[out_idx].data());
+
+        if (!RefForward(node, inputs, outputs))
+            return false;
+
+        visit(out_idx, buffers[out_idx].data(), buffers[out_idx].size());
+
+        for (unsigned int i = 0; i < node->GetInputNum(); i++)
+        {
+            auto ir = ctx.tensor_idx.find(node->GetInputTensor(i));
+
+            if (ir != ctx.tensor_idx.end() && --ref_num[ir->second] == 0)
+                std::vector<float>().swap(buffers[ir->second]);
+        }
+    }
+
+    return true;
+}
+
+/* the samples run in parallel, each one into its own copy of init merged into result under the lock */
+template <typename T>
+static bool RunSamples(const CalibContext& ctx, int sample_num, const T& init, T& result,
+                       const std::function<void(T&, int, const float*, int)>& visit,
+                       const std::function<void(T&, const T&)>& merge)
+{
+    std::mutex merge_lock;
+    std::atomic<bool> failed(false);
+
+    ParallelRun(sample_num, [&](int idx) {
+        if (failed)
+            return;
+
+        T local = init;
+
+        bool ok = RunSample(ctx, idx, [&](int tensor, const float* data, int size) {
+            visit(local, tensor, data, size);
+        });
+
+        if (!ok)
+        {
+            failed = true;
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(merge_lock);
+
+        merge(result, local);
+    });
+
+    return !failed;
+}
+
+static float GetPercentileThreshold(const std::vector<uint64_t>& hist, float bin_width, float percentile)
+{
+    uint64_t total = 0;
+
+    for (auto count : hist)
+        total += count;
+
+    if (total == 0)
+        return 0.f;
+
+    uint64_t target = std::ceil(total * ( double )percentile / 100);
+    uint64_t sum = 0;
+
+    for (int i = 0; i < CALIB_HIST_BINS; i++)
+    {
+        sum += hist[i];
+
+        if (sum >= target)
+            return (i + 1) * bin_width;
+    }
+
+    return CALIB_HIST_BINS * bin_width;
+}
+
+static float GetKLDivergence(const std::vector<float>& p, const std::vector<float>& q)
+{
+    double p_sum = 0;
+    double q_sum = 0;
+
+    for (unsigned int i = 0; i < p.size(); i++)
+    {
+        p_sum += p[i];
+        q_sum += q[i];
+    }
+
+    double kl = 0;
+
+    for (unsigned int i = 0; i < p.size(); i++)
+    {
+        double p_i = p[i] / p_sum;
+        double q_i = q[i] / q_sum;
+
+        if (p_i > 0)
+            kl += p_i * std::log(p_i / q_i);
+    }
+
+    return kl;
+}
+
+/*
+ * the threshold whose clipped distribution P (the tail summed into the last bin)
+ * loses the least information, KL(P || Q), when quantized to CALIB_KL_LEVELS
+ * levels and expanded back to Q over the non empty bins
+ */
+static float GetKLThreshold(const std::vector<uint64_t>& hist, float bin_width)
+{
+    const float eps = 1e-8f;
+
+    double tail_sum = 0;
+
+    for (int i = CALIB_KL_LEVELS; i < CALIB_HIST_BINS; i++)
+        tail_sum += hist[i];
+
+    int best_threshold = CALIB_HIST_BINS;
+    float min_kl = FLT_MAX;
+
+    for (int threshold = CALIB_KL_LEVELS; threshold < CALIB_HIST_BINS; threshold++)
+    {
+        std::vector<float> clip(threshold, eps);
+
+        for (int i = 0; i < threshold; i++)
+            clip[i] += hist[i];
+
+        clip[threshold - 1] += tail_sum;
+        tail_sum -= hist[threshold];
+
+        float bin_num = ( float )threshold / CALIB_KL_LEVELS;
+        std::vector<float> expand(threshold, eps);
+
+        for (int i = 0; i < CALIB_KL_LEVELS; i++)
+        {
+            float start = i * bin_num;
+            float end = start + bin_num;
+            int left_upper = std::ceil(start);
+            int right_lower = std::floor(end);
+            float left_scale = left_upper > start ? left_upper - start : 0.f;
+            float right_scale = right_lower < end && right_lower < threshold ? end - right_lower : 0.f;
+
+            float level = 0;
+            float count = 0;
+
+            if (left_scale > 0)
+            {
+                level += left_scale * hist[left_upper - 1];
+                count += hist[left_upper - 1] ? left_scale : 0.f;
+            }
+
+            if (right_scale > 0)
+            {
+                level += right_scale * hist[right_lower];
+                count += hist[right_lower] ? right_scale : 0.f;
+            }
+
+            for (int j = left_upper; j < right_lower; j++)
+            {
+                level += hist[j];
+                count += hist[j] ? 1.f : 0.f;
+            }
+
+            if (count == 0)
+                continue;
+
+            float value = level / count;
+
+            if (left_scale > 0 && hist[left_upper - 1])
+                expand[left_upper - 1] += value * left_scale;
+
+            if (right_scale > 0 && hist[right_lower])
+                expand[right_lower] += value * right_scale;
+
+            for (int j = left_upper; j < right_lower; j++)
+            {
+                if (hist[j])
+                    expand[j] += value;
+            }
+        }
+
+        float kl = GetKLDivergence(clip, expand);
+
+        if (kl < min_kl)
+        {
+            min_kl = kl;
+            best_threshold = threshold;
+        }
+    }
+
+    return (best_threshold + 0.5f) * bin_width;
+}
+
+static void SetInt8Param(QuantParam& param, float threshold)
+{
+    /* an all zero tensor: any scale does */
+    if (threshold <= 0)
+        threshold = 1.f;
+
+    param.zero_point = 0;
+    param.scale = threshold / 127;
+    param.width = 8;
+    param.max = threshold;
+    param.min = -threshold;
+}
+
+/* symmetric, per output channel: channel_of maps an element to its channel */
+static void SetWeightParam(Tensor* weight, int channel_num, const std::function<int(int)>& channel_of)
+{
+    if (weight->GetType() != kConstTensor || weight->GetDataType() != TENGINE_DT_FP32 || channel_num <= 0)
+        return;
+
+    const float* data = ( const float* )weight->GetMemAddr();
+    int elem_num = weight->GetShape().GetSize();
+    std::vector<float> max_abs(channel_num, 0.f);
+
+    for (int i = 0; i < elem_num; i++)
+    {
+        int c = channel_of(i);
+
+        max_abs[c] = std::max(max_abs[c], std::fabs(data[i]));
+    }
+
+    std::vector<QuantParam>* params = weight->GetQuantParam();
+
+    params->resize(channel_num);
+
+    for (int c = 0; c < channel_num; c++)
+        SetInt8Param((*params)[c], max_abs[c]);
+}
+
+static void CalibrateWeights(const CalibContext& ctx)
+{
+    for (auto node : ctx.nodes)
+    {
+        const std::string& op_name = node->GetOp()->GetName();
+
+        if (node->GetInputNum() < 2)
+            continue;
+
+        Tensor* weight = node->GetInputTensor(1);
+        const std::vector<int>& dims = weight->GetShape().GetDim();
+
+        if (dims.empty())
+            continue;
+
+        /* [output_channel][...] */
+        if (op_name == "Convolution" || op_name == "Fused.ConvEltwise" || op_name == "FullyConnected")
+        {
+            int row_size = weight->GetShape().GetSize() / dims[0];
+
+            SetWeightParam(weight, dims[0], [row_size](int i) { return i / row_size; });
+        }
+        /* [input_channel][output_channel / group][kernel_h][kernel_w] */
+        else if (op_name == "Deconvolution" && dims.size() == 4)
+        {
+            DeconvParam* param = dynamic_cast<Deconvolution*>(node->GetOp())->GetParam();
+            int group = std::max(param->group, 1);
+            int in_c_g = dims[0] / group;
+            int out_c_g = dims[1];
+            int kernel_size = dims[2] * dims[3];
+
+            SetWeightParam(weight, out_c_g * group, [=](int i) {
+                int ic = i / (out_c_g * kernel_size);
+                int oc = (i / kernel_size) % out_c_g;
+
+                return (ic / in_c_g) * out_c_g + oc;
+            });
+        }
+    }
+}
+
+bool CalibrateGraph(Graph* graph, int sample_num, const calib_sample_t& get_sample, int method, float percentile)
+{
+    static const char* method_name[] = {"minmax", "kl", "percentile"};
+
+    CalibContext ctx;
+
+    ctx.get_sample = &get_sample;
+
+    if (sample_num <= 0 || method < kCalibMinMax || method > kCalibPercentile ||
+        (method == kCalibPercentile && (percentile <= 0 || percentile > 100)))
+    {
+        LOG_ERROR() << "bad calibration args: " << sample_num << " samples, method " << method << "\n";
+        return false;
+    }
+
+    if (!InitCalibContext(graph, ctx))
+        return false;
+
+    int tensor_num = ctx.tensors.size();
+
+    /* pass 1: the range of each tensor */
+    std::vector<float> max_abs(tensor_num, 0.f);
+
+    bool ok = RunSamples<std::vector<float>>(
+        ctx, sample_num, std::vector<float>(tensor_num, 0.f), max_abs,
+        [](std::vector<float>& local, int tensor, const float* data, int size) {
+            float val = local[tensor];
+
+            for (int i = 0; i < size; i++)
+                val = std::max(val, std::fabs(data[i]));
+
+            local[tensor] = val;
+        },
+        [](std::vector<float>& result, const std::vector<float>& local) {
+            for (unsigned int i = 0; i < result.size(); i++)
+                result[i] = std::max(result[i], local[i]);
+        });
+
+    if (!ok)
+        return false;
+
+    std::vector<float> threshold(max_abs);
+
+    /* pass 2: the |x| histograms over [0, max_abs], zeros left out */
+    if (method != kCalibMinMax)
+    {
+        using hist_t = std::vector<std::vector<uint64_t>>;
+
+        hist_t hist(tensor_num, std::vector<uint64_t>(CALIB_HIST_BINS, 0));
+
+        ok = RunSamples<hist_t>(
+            ctx, sample_num, hist, hist,
+            [&max_abs](hist_t& local, int tensor, const float* data, int size) {
+                if (max_abs[tensor] <= 0)
+                    return;
+
+                float bin_scale = CALIB_HIST_BINS / max_abs[tensor];
+                uint64_t* bins = local[tensor].data();
+
+                for (int i = 0; i < size; i++)
+                {
+                    float val = std::fabs(data[i]);
+
+                    if (val == 0)
+                        continue;
+
+                    bins[std::min(( int )(val * bin_scale), CALIB_HIST_BINS - 1)]++;
+                }
+            },
+            [](hist_t& result, const hist_t& local) {
+                for (unsigned int i = 0; i < result.size(); i++)
+                {
+                    for (int j = 0; j < CALIB_HIST_BINS; j++)
+                        result[i][j] += local[i][j];
+                }
+            });
+
+        if (!ok)
+            return false;
+
+        ParallelRun(tensor_num, [&](int i) {
+            float bin_width = max_abs[i] / CALIB_HIST_BINS;
+
+            if (max_abs[i] <= 0)
+                return;
+
+            if (method == kCalibKL)
+                threshold[i] = GetKLThreshold(hist[i], bin_width);
+            else
+                threshold[i] = GetPercentileThreshold(hist[i], bin_width, percentile);
+        });
+    }
+
+    for (int i = 0; i < tensor_num; i++)
+    {
+        std::vector<QuantParam>* params = ctx.tensors[i]->GetQuantParam();
+
+        params->resize(1);
+        SetInt8Param((*params)[0], threshold[i]);
+    }
+
+    CalibrateWeights(ctx);
+
+    LOG_INFO() << "graph: " << graph->GetName() << " calibrated " << tensor_num << " tensors over " << sample_num
+               << " samples with " << method_name[method] << "\n";
+
+    return true;
+}
+
+}    // namespace TEngine
@@ -0,0 +1,809 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+/*
+ * Copyright (c) 2020, Open AI Lab
+ */
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+
+#include "node.hpp"
+#include "graph.hpp"
+#include "data_type.hpp"
+#include "exec_attr.hpp"
+#include "graph_optimizer.hpp"
+#include "graph_rewriter.hpp"
+#include "operator/cast.hpp"
+#include "operator/concat.hpp"
+#include "operator/eltwise.hpp"
+#include "operator/gather.hpp"
+
+namespace TEngine {
+
+/*
+ * tengine tensors have no rank 0: a folded scalar is stored as [1] and
+ * remembers its rank in this attribute, so that Unsqueeze/Concat chains
+ * on top of it get the same shape as in the original model
+ */
+#define ATTR_CONST_SCALAR "const_scalar"
+
+struct FoldResult
+{
+    std::vector<int> dims;
+    int data_type = TENGINE_DT_FP32;
+    void* data = nullptr;
+};
+
+using const_fold_t = bool (*)(Graph* graph, Node* node, FoldResult& result);
+
+static int GetElemNum(const std::vector<int>& dims)
+{
+    int elem_num = 1;
+
+    for (auto d : dims)
+        elem_num *= d;
+
+    return elem_num;
+}
+
+static std::vector<int> GetFoldDims(const Tensor* tensor)
+{
+    if (tensor->ExistAttr(ATTR_CONST_SCALAR))
+        return std::vector<int>();
+
+    return tensor->GetShape().GetDim();
+}
+
+static bool IsFoldDataType(int data_type)
+{
+    return data_type == TENGINE_DT_FP32 || data_type == TENGINE_DT_INT32 || data_type == TENGINE_DT_INT16 ||
+           data_type == TENGINE_DT_INT8 || data_type == TENGINE_DT_UINT8;
+}
+
+static double LoadElement(const void* buf, int data_type, int idx)
+{
+    switch (data_type)
+    {
+        case TENGINE_DT_FP32:
+            return (( const float* )buf)[idx];
+        case TENGINE_DT_INT32:
+            return (( const int32_t* )buf)[idx];
+        case TENGINE_DT_INT16:
+            return (( const int16_t* )buf)[idx];
+        case TENGINE_DT_INT8:
+            return (( const int8_t* )buf)[idx];
+        case TENGINE_DT_UINT8:
+            return (( const uint8_t* )buf)[idx];
+        default:
+            return 0;
+    }
+}
+
+/* converting an out of range double to an integer is undefined: saturate, NaN gives 0 */
+template <typename T> static T SaturateCast(double val)
+{
+    if (std::isnan(val))
+        return 0;
+
+    if (val <= std::numeric_limits<T>::lowest())
+        return std::numeric_limits<T>::lowest();
+
+    if (val >= std::numeric_limits<T>::max())
+        return std::numeric_limits<T>::max();
+
+    return ( T )val;
+}
+
+static void StoreElement(void* buf, int data_type, int idx, double val)
+{
+    switch (data_type)
+    {
+        case TENGINE_DT_FP32:
+            (( float* )buf)[idx] = val;
+            break;
+        case TENGINE_DT_INT32:
+            (( int32_t* )buf)[idx] = SaturateCast<int32_t>(val);
+            break;
+        case TENGINE_DT_INT16:
+            (( int16_t* )buf)[idx] = SaturateCast<int16_t>(val);
+            break;
+        case TENGINE_DT_INT8:
+            (( int8_t* )buf)[idx] = SaturateCast<int8_t>(val);
+            break;
+        case TENGINE_DT_UINT8:
+            (( uint8_t* )buf)[idx] = SaturateCast<uint8_t>(val);
+            break;
+        default:
+            break;
+    }
+}
+
+static bool AllocResult(FoldResult& result)
+{
+    for (auto d : result.dims)
+    {
+        if (d <= 0)
+            return false;
+    }
+
+    int mem_size = GetElemNum(result.dims) * DataType::GetTypeSize(result.data_type);
+
+    result.data = std::malloc(mem_size);
+
+    return result.data != nullptr;
+}
+
+/* a tensor with known content: the output of a Const node */
+static bool IsConstInput(const Tensor* tensor)
+{
+    if (tensor->GetType() != kConstTensor || tensor->GetMemAddr() == nullptr || tensor->producer == nullptr)
+        return false;
+
+    if (tensor->producer->owner->GetOp()->GetName() != "Const")
+        return false;
+
+    if (!IsFoldDataType(tensor->GetDataType()))
+        return false;
+
+    for (auto d : tensor->GetShape().GetDim())
+    {
+        if (d <= 0)
+            return false;
+    }
+
+    return tensor->GetShape().GetSize() > 0;
+}
+
+static bool FoldShape(Graph* graph, Node* node, FoldResult& result)
+{
+    std::vector<int> in_dims = GetFoldDims(node->GetInputTensor(0));
+
+    if (in_dims.empty())
+        return false;
+
+    result.dims = {( int )in_dims.size()};
+    result.data_type = TENGINE_DT_INT32;
+
+    if (!AllocResult(result))
+        return false;
+
+    for (unsigned int i = 0; i < in_dims.size(); i++)
+        StoreElement(result.data, result.data_type, i, in_dims[i]);
+
+    return true;
+}
+
+/* Reshape, Flatten, Squeeze, Unsqueeze and ExpandDims: the data is kept, only the shape changes */
+static bool FoldReshape(Graph* graph, Node* node, FoldResult& result)
+{
+    Operator* op = node->GetOp();
+    Tensor* input = node->GetInputTensor(0);
+    std::vector<int> in_dims = GetFoldDims(input);
+
+    if (in_dims.empty() && op->GetName() != "Unsqueeze")
+        in_dims = {1};
+
+    /* the shape inference of Squeeze only knows about 4 dims */
+    if (op->GetName() == "Squeeze" && in_dims.size() != 4)
+        return false;
+
+    std::vector<TShape> ishape;
+    std::vector<TShape> oshape(node->GetOutputNum());
+
+    for (unsigned int i = 0; i < node->GetInputNum(); i++)
+        ishape.push_back(node->GetInputTensor(i)->GetShape());
+
+    ishape[0].SetDim(in_dims);
+
+    if (!op->InferShape(ishape, oshape, graph->GetLayout()))
+        return false;
+
+    result.dims = oshape[0].GetDim();
+    result.data_type = input->GetDataType();
+
+    if (result.dims.empty() || GetElemNum(result.dims) != GetElemNum(in_dims))
+        return false;
+
+    if (!AllocResult(result))
+        return false;
+
+    std::memcpy(result.data, input->GetMemAddr(), GetElemNum(in_dims) * DataType::GetTypeSize(result.data_type));
+
+    return true;
+}
+
+static bool FoldConcat(Graph* graph, Node* node, FoldResult& result)
+{
+    Concat* concat_op = dynamic_cast<Concat*>(node->GetOp());
+    ConcatParam* param = concat_op->GetParam();
+
+    Tensor* input = node->GetInputTensor(0);
+    std::vector<int> out_dims = GetFoldDims(input);
+
+    if (out_dims.empty())
+        out_dims = {1};
+
+    int rank = out_dims.size();
+    int axis = param->axis;
+
+    if (axis < 0)
+        axis += rank;
+
+    if (axis < 0 || axis >= rank)
+        return false;
+
+    out_dims[axis] = 0;
+
+    for (unsigned int i = 0; i < node->GetInputNum(); i++)
+    {
+        Tensor* tensor = node->GetInputTensor(i);
+        std::vector<int> dims = GetFoldDims(tensor);
+
+        if (dims.empty())
+            dims = {1};
+
+        if (( int )dims.size() != rank || tensor->GetDataType() != input->GetDataType())
+            return false;
+
+        for (int j = 0; j < rank; j++)
+        {
+            if (j != axis && dims[j] != out_dims[j])
+                return false;
+        }
+
+        out_dims[axis] += dims[axis];
+    }
+
+    result.dims = out_dims;
+    result.data_type = input->GetDataType();
+
+    if (!AllocResult(result))
+        return false;
+
+    int elem_size = DataType::GetTypeSize(result.data_type);
+    int outer_size = 1;
+    int inner_size = elem_size;
+
+    for (int j = 0; j < axis; j++)
+        outer_size *= out_dims[j];
+
+    for (int j = axis + 1; j < rank; j++)
+        inner_size *= out_dims[j];
+
+    uint8_t* out_ptr = ( uint8_t* )result.data;
+
+    for (int o = 0; o < outer_size; o++)
+    {
+        for (unsigned int i = 0; i < node->GetInputNum(); i++)
+        {
+            Tensor* tensor = node->GetInputTensor(i);
+            const std::vector<int>& dims = tensor->GetShape().GetDim();
+            int copy_size = dims[axis] * inner_size;
+            const uint8_t* in_ptr = ( const uint8_t* )tensor->GetMemAddr() + o * copy_size;
+
+            std::memcpy(out_ptr, in_ptr, copy_size);
+            out_ptr += copy_size;
+        }
+    }
+
+    return true;
+}
+
+static bool FoldGather(Graph* graph, Node* node, FoldResult& result)
+{
+    Gather* gather_op = dynamic_cast<Gather*>(node->GetOp());
+    GatherParam* param = gather_op->GetParam();
+
+    Tensor* input = node->GetInputTensor(0);
+    std::vector<int> in_dims = GetFoldDims(input);
+    int rank = in_dims.size();
+    int axis = param->axis;
+
+    if (axis < 0)
+        axis += rank;
+
+    if (axis < 0 || axis >= rank)
+        return false;
+
+    std::vector<int> indices;
+
+    if (param->is_onnx)
+    {
+        /* the onnx loader keeps a single scalar index in indices_num, which drops the axis */
+        if (axis != 0)
+            return false;
+
+        indices.push_back(param->indices_num);
+        result.dims.assign(in_dims.begin() + 1, in_dims.end());
+    }
+    else
+    {
+        if (node->GetInputNum() < 2)
+            return false;
+
+        Tensor* indices_tensor = node->GetInputTensor(1);
+        int indices_num = indices_tensor->GetShape().GetSize();
+
+        if (indices_num != param->indices_num)
+            return false;
+
+        for (int i = 0; i < indices_num; i++)
+            indices.push_back(LoadElement(indices_tensor->GetMemAddr(), indices_tensor->GetDataType(), i));
+
+        result.dims = in_dims;
+        result.dims[axis] = indices_num;
+    }
+
+    for (auto& idx : indices)
+    {
+        if (idx < 0)
+            idx += in_dims[axis];
+
+        if (idx < 0 || idx >= in_dims[axis])
+            return false;
+    }
+
+    result.data_type = input->GetDataType();
+
+    if (!AllocResult(result))
+        return false;
+
+    int outer_size = 1;
+    int inner_size = DataType::GetTypeSize(result.data_type);
+
+    for (int j = 0; j < axis; j++)
+        outer_size *= in_dims[j];
+
+    for (int j = axis + 1; j < rank; j++)
+        inner_size *= in_dims[j];
+
+    const uint8_t* in_ptr = ( const uint8_t* )input->GetMemAddr();
+    uint8_t* out_ptr = ( uint8_t* )result.data;
+
+    for (int o = 0; o < outer_size; o++)
+    {
+        for (auto idx : indices)
+        {
+            std::memcpy(out_ptr, in_ptr + (o * in_dims[axis] + idx) * inner_size, inner_size);
+            out_ptr += inner_size;
+        }
+    }
+
+    return true;
+}
+
+static bool BroadcastDims(const std::vector<int>& dims0, const std::vector<int>& dims1, std::vector<int>& out_dims)
+{
+    int rank = std::max(dims0.size(), dims1.size());
+
+    out_dims.resize(rank);
+
+    for (int i = 0; i < rank; i++)
+    {
+        int idx0 = i - rank + ( int )dims0.size();
+        int idx1 = i - rank + ( int )dims1.size();
+        int d0 = idx0 >= 0 ? dims0[idx0] : 1;
+        int d1 = idx1 >= 0 ? dims1[idx1] : 1;
+
+        if (d0 != d1 && d0 != 1 && d1 != 1)
+            return false;
+
+        out_dims[i] = std::max(d0, d1);
+    }
+
+    return true;
+}
+
+/* strides of dims laid over out_dims, 0 along the broadcast axes */
+static std::vector<int> GetBroadcastStrides(const std::vector<int>& dims, const std::vector<int>& out_dims)
+{
+    int rank = out_dims.size();
+    int offset = rank - dims.size();
+    int stride = 1;
+
+    std::vector<int> strides(rank, 0);
+
+    for (int i = rank - 1; i >= offset; i--)
+    {
+        if (dims[i - offset] != 1)
+            strides[i] = stride;
+
+        stride *= dims[i - offset];
+    }
+
+    return strides;
+}
+
+static bool EvalUnary(int type, const EltwiseParam* param, double x, double& y)
+{
+    switch (type)
+    {
+        case ELT_RSQRT:
+            y = 1.0 / std::sqrt(x);
+            break;
+        case ELT_LOG:
+            y = std::log(x);
+            break;
+        case ELT_EXP:
+            y = std::exp(x);
+            break;
+        case ELT_SQRT:
+            y = std::sqrt(x);
+            break;
+        case ELT_FLOOR:
+            y = std::floor(x);
+            break;
+        case ELT_SQUARE:
+            y = x * x;
+            break;
+        case ELT_POWER:
+            y = std::pow(param->shift + param->scale * x, param->power);
+            break;
+        default:
+            return false;
+    }
+
+    return true;
+}
+
+static bool EvalBinary(int type, double x0, double x1, double& y)
+{
+    switch (type)
+    {
+        case ELT_SUM:
+            y = x0 + x1;
+            break;
+        case ELT_SUB:
+            y = x0 - x1;
+            break;
+        case ELT_PROD:
+            y = x0 * x1;
+            break;
+        case ELT_DIV:
+            y = x0 / x1;
+            break;
+        case ELT_MAX:
+            y = std::max(x0, x1);
+            break;
+        case ELT_POW:
+            y = std::pow(x0, x1);
+            break;
+        default:
+            return false;
+    }
+
+    return true;
+}
+
+static bool FoldEltwise(Graph* graph, Node* node, FoldResult& result)
+{
+    Eltwise* eltwise_op = dynamic_cast<Eltwise*>(node->GetOp());
+    EltwiseParam* param = eltwise_op->GetParam();
+
+    Tensor* input0 = node->GetInputTensor(0);
+    int data_type = input0->GetDataType();
+    double y;
+
+    result.data_type = data_type;
+
+    if (node->GetInputNum() == 1)
+    {
+        /* the unary math is for float only */
+        if (data_type != TENGINE_DT_FP32 || !EvalUnary(param->type, param, 1, y))
+            return false;
+
+        result.dims = GetFoldDims(input0);
+
+        if (!AllocResult(result))
+            return false;
+
+        int elem_num = GetElemNum(result.dims);
+
+        for (int i = 0; i < elem_num; i++)
+        {
+            EvalUnary(param->type, param, LoadElement(input0->GetMemAddr(), data_type, i), y);
+            StoreElement(result.data, data_type, i, y);
+        }
+
+        return true;
+    }
+
+    if (node->GetInputNum() != 2 || !EvalBinary(param->type, 1, 1, y))
+        return false;
+
+    Tensor* input1 = node->GetInputTensor(1);
+
+    if (input1->GetDataType() != data_type)
+        return false;
+
+    std::vector<int> dims0 = GetFoldDims(input0);
+    std::vector<int> dims1 = GetFoldDims(input1);
+
+    if (!BroadcastDims(dims0, dims1, result.dims))
+        return false;
+
+    if (!AllocResult(result))
+        return false;
+
+    std::vector<int> strides0 = GetBroadcastStrides(dims0, result.dims);
+    std::vector<int> strides1 = GetBroadcastStrides(dims1, result.dims);
+
+    int rank = result.dims.size();
+    int elem_num = GetElemNum(result.dims);
+    bool is_float = (data_type == TENGINE_DT_FP32);
+
+    for (int i = 0; i < elem_num; i++)
+    {
+        int idx0 = 0;
+        int idx1 = 0;
+        int remain = i;
+
+        for (int j = rank - 1; j >= 0; j--)
+        {
+            int pos = remain % result.dims[j];
+
+            remain /= result.dims[j];
+            idx0 += pos * strides0[j];
+            idx1 += pos * strides1[j];
+        }
+
+        double x0 = LoadElement(input0->GetMemAddr(), data_type, idx0);
+        double x1 = LoadElement(input1->GetMemAddr(), data_type, idx1);
+
+        /* leave integer division by zero to the runtime */
+        if (!is_float && param->type == ELT_DIV && x1 == 0)
+            return false;
+
+        EvalBinary(param->type, x0, x1, y);
+
+        /* integer division truncates */
+        StoreElement(result.data, data_type, i, is_float ? y : std::trunc(y));
+    }
+
+    return true;
+}
+
+static bool FoldCast(Graph* graph, Node* node, FoldResult& result)
+{
+    Cast* cast_op = dynamic_cast<Cast*>(node->GetOp());
+    CastParam* param = cast_op->GetParam();
+
+    Tensor* input = node->GetInputTensor(0);
+
+    /* 1 is float for both onnx and tensorflow, the other codes are the onnx ones */
+    result.data_type = -1;
+
+    if (param->type_to == 1)
+        result.data_type = TENGINE_DT_FP32;
+    else if (graph->GetModelFormat() == MODEL_FORMAT_ONNX)
+    {
+        switch (param->type_to)
+        {
+            case 2:
+                result.data_type = TENGINE_DT_UINT8;
+                break;
+            case 3:
+                result.data_type = TENGINE_DT_INT8;
+                break;
+            case 5:
+                result.data_type = TENGINE_DT_INT16;
+                break;
+            case 6:
+            case 7:
+                /* there is no int64 tensor */
+                result.data_type = TENGINE_DT_INT32;
+                break;
+            default:
+                break;
+        }
+    }
+
+    if (result.data_type < 0)
+        return false;
+
+    result.dims = GetFoldDims(input);
+
+    if (!AllocResult(result))
+        return false;
+
+    int elem_num = GetElemNum(result.dims);
+    bool is_float = (result.data_type == TENGINE_DT_FP32);
+
+    for (int i = 0; i < elem_num; i++)
+    {
+        double x = LoadElement(input->GetMemAddr(), input->GetDataType(), i);
+
+        StoreElement(result.data, result.data_type, i, is_float ? x : std::trunc(x));
+    }
+
+    return true;
+}
+
+static const struct
+{
+    const char* op_name;
+    const_fold_t fold;
+} fold_table[] = {
+    {"Shape", FoldShape},
+    {"Reshape", FoldReshape},
+    {"Flatten", FoldReshape},
+    {"Squeeze", FoldReshape},
+    {"Unsqueeze", FoldReshape},
+    {"ExpandDims", FoldReshape},
+    {"Concat", FoldConcat},
+    {"Gather", FoldGather},
+    {"Eltwise", FoldEltwise},
+    {"Cast", FoldCast},
+};
+
+static const_fold_t GetFoldFunc(const std::string& op_name)
+{
+    for (auto& entry : fold_table)
+    {
+        if (op_name == entry.op_name)
+            return entry.fold;
+    }
+
+    return nullptr;
+}
+
+/*
+ * the integers of a quantized tensor stand for (x - zero_point) * scale: the
+ * fold functions work on the raw values, so such a tensor is left alone
+ */
+static bool HasQuantParam(Tensor* tensor)
+{
+    for (auto& param : *tensor->GetQuantParam())
+    {
+        if (param.scale != 1.f || param.zero_point != 0)
+            return true;
+    }
+
+    return false;
+}
+
+static bool CanFold(Node* node)
+{
+    if (node->GetOutputNum() != 1 || node->GetInputNum() == 0 || node->IsDynamicShape())
+        return false;
+
+    if (HasQuantParam(node->GetOutputTensor(0)))
+        return false;
+
+    /* Shape only needs the shape of its input */
+    if (node->GetOp()->GetName() == "Shape")
+    {
+        const std::vector<int>& dims = node->GetInputTensor(0)->GetShape().GetDim();
+
+        for (auto d : dims)
+        {
+            if (d <= 0)
+                return false;
+        }
+
+        return !dims.empty();
+    }
+
+    for (unsigned int i = 0; i < node->GetInputNum(); i++)
+    {
+        Tensor* tensor = node->GetInputTensor(i);
+
+        if (!IsConstInput(tensor) || HasQuantParam(tensor))
+            return false;
+    }
+
+    return true;
+}
+
+/* a const input goes away with the folded node, unless someone else reads it */
+static void AddUnsharedConstProducers(Graph* graph, Subgraph* orig, Node* node)
+{
+    for (unsigned int i = 0; i < node->GetInputNum(); i++)
+    {
+        Tensor* tensor = node->GetInputTensor(i);
+
+        if (!IsConstInput(tensor))
+            continue;
+
+        Node* const_node = tensor->producer->owner;
+        bool shared = graph->IsOutputNode(const_node);
+
+        for (auto port : tensor->consumer)
+        {
+            if (port->owner != node)
+                shared = true;
+        }
+
+        if (shared || std::find(orig->seq_nodes.begin(), orig->seq_nodes.end(), const_node) != orig->seq_nodes.end())
+            continue;
+
+        orig->seq_nodes.push_back(const_node);
+    }
+}
+
+static bool FoldConstNode(Graph* graph, const std::vector<Node*>& match, Subgraph* orig, Subgraph* fused)
+{
+    Node* node = match[0];
+    const_fold_t fold = GetFoldFunc(node->GetOp()->GetName());
+    FoldResult result;
+
+    if (fold == nullptr || !fold(graph, node, result))
+    {
+        std::free(result.data);
+        return false;
+    }
+
+    orig->seq_nodes.push_back(node);
+    orig->output_nodes.push_back(node);
+
+    AddUnsharedConstProducers(graph, orig, node);
+
+    /* the output tensor stays, with a Const node as its new producer */
+    Tensor* output = node->GetOutputTensor(0);
+
+    output->SetType(kConstTensor);
+    output->SetDataType(result.data_type);
+    output->SetMemAddr(result.data);
+    output->SetFreeMem(true);
+
+    if (result.dims.empty())
+    {
+        result.dims = {1};
+        output->SetAttr(ATTR_CONST_SCALAR, true);
+    }
+
+    output->GetShape().SetDim(result.dims);
+
+    Node* const_node = new Node(output->GetName());
+
+    const_node->SetOp(OpManager::CreateOp("Const"));
+    const_node->AddOutputTensor(output);
+
+    fused->seq_nodes.push_back(const_node);
+    fused->output_nodes.push_back(const_node);
+    fused->SetNodeOwner(const_node);
+
+    return true;
+}
+
+bool GraphConstFold(Graph* graph, GraphOptimizer* opt)
+{
+    RewriteRule rule;
+
+    rule.name = "const_fold";
+    rule.pattern.items.resize(1);
+
+    for (auto& entry : fold_table)
+        rule.pattern.items[0].ops.push_back(entry.op_name);
+
+    rule.pattern.items[0].check = CanFold;
+    rule.rewrite = FoldConstNode;
+
+    GraphRewriter rewriter;
+
+    rewriter.AddRule(rule);
+
+    return rewriter.Run(graph) >= 0;
+}
+
+}    // namespace TEngine
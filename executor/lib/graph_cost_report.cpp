@@ -0,0 +1,220 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2020, Open AI Lab
+ */
+#include <cstdio>
+#include <algorithm>
+
+#include "logger.hpp"
+#include "node.hpp"
+#include "graph.hpp"
+#include "graph_cost.hpp"
+
+namespace TEngine {
+
+bool GetNodeCost(Node* node, NodeCost& cost)
+{
+    cost.fops = 0;
+    cost.param_bytes = 0;
+    cost.read_bytes = 0;
+    cost.write_bytes = 0;
+
+    for (unsigned int i = 0; i < node->GetInputNum(); i++)
+    {
+        Tensor* tensor = node->GetInputTensor(i);
+
+        if (tensor->GetShape().GetSize() <= 0)
+            return false;
+
+        if (tensor->GetType() == kConstTensor)
+            cost.param_bytes += tensor->GetTotalSize();
+        else
+            cost.read_bytes += tensor->GetTotalSize();
+    }
+
+    for (unsigned int i = 0; i < node->GetOutputNum(); i++)
+    {
+        Tensor* tensor = node->GetOutputTensor(i);
+
+        if (tensor->GetShape().GetSize() <= 0)
+            return false;
+
+        cost.write_bytes += tensor->GetTotalSize();
+    }
+
+    cost.fops = node->GetFops();
+
+    return true;
+}
+
+static void WriteJsonString(FILE* fp, const std::string& str)
+{
+    fputc('"', fp);
+
+    for (char c : str)
+    {
+        if (c == '"' || c == '\\')
+            fprintf(fp, "\\%c", c);
+        else if (( unsigned char )c < 0x20)
+            fprintf(fp, "\\u%04x", c);
+        else
+            fputc(c, fp);
+    }
+
+    fputc('"', fp);
+}
+
+struct RankedCost
+{
+    Node* node;
+    NodeCost cost;
+    bool known;
+    int rank;
+};
+
+static bool WriteJsonReport(Graph* graph, const std::vector<RankedCost>& costs, const NodeCost& total,
+                            const char* json_file)
+{
+    FILE* fp = fopen(json_file, "w");
+
+    if (fp == nullptr)
+    {
+        LOG_ERROR() << "cannot write the cost report: " << json_file << "\n";
+        return false;
+    }
+
+    fprintf(fp, "{\n  \"graph\": ");
+    WriteJsonString(fp, graph->GetName());
+    fprintf(fp, ",\n  \"total\": {\"flops\": %.0f, \"param_bytes\": %.0f, \"read_bytes\": %.0f, \"write_bytes\": %.0f, "
+                "\"intensity\": %.4f},\n  \"nodes\": [",
+            total.fops, total.param_bytes, total.read_bytes, total.write_bytes, total.Intensity());
+
+    for (unsigned int i = 0; i < costs.size(); i++)
+    {
+        const RankedCost& item = costs[i];
+        const NodeCost& cost = item.cost;
+
+        fprintf(fp, "%s\n    {\"name\": ", i ? "," : "");
+        WriteJsonString(fp, item.node->GetName());
+        fprintf(fp, ", \"op\": ");
+        WriteJsonString(fp, item.node->GetOp()->GetName());
+
+        if (!item.known)
+        {
+            fprintf(fp, ", \"shape_known\": false}");
+            continue;
+        }
+
+        fprintf(fp, ", \"rank\": %d, \"flops\": %.0f, \"param_bytes\": %.0f, \"read_bytes\": %.0f, \"write_bytes\": %.0f, "
+                    "\"intensity\": %.4f}",
+                item.rank, cost.fops, cost.param_bytes, cost.read_bytes, cost.write_bytes, cost.Intensity());
+    }
+
+    fprintf(fp, "\n  ]\n}\n");
+    fclose(fp);
+
+    return true;
+}
+
+bool ReportGraphCost(Graph* graph, int top_num, const char* json_file)
+{
+    std::vector<RankedCost> costs;
+    NodeCost total = {0, 0, 0, 0};
+    int unknown_num = 0;
+
+    for (auto node : graph->seq_nodes)
+    {
+        const std::string& op_name = node->GetOp()->GetName();
+
+        if (op_name == "Const" || op_name == "Input")
+            continue;
+
+        RankedCost item;
+
+        item.node = node;
+        item.known = GetNodeCost(node, item.cost);
+        item.rank = 0;
+
+        if (item.known)
+        {
+            total.fops += item.cost.fops;
+            total.param_bytes += item.cost.param_bytes;
+            total.read_bytes += item.cost.read_bytes;
+            total.write_bytes += item.cost.write_bytes;
+        }
+        else
+            unknown_num++;
+
+        costs.push_back(item);
+    }
+
+    /* rank by flops, the bytes moved break the ties */
+    std::vector<RankedCost*> ranked;
+
+    for (auto& item : costs)
+    {
+        if (item.known)
+            ranked.push_back(&item);
+    }
+
+    std::stable_sort(ranked.begin(), ranked.end(), [](const RankedCost* a, const RankedCost* b) {
+        if (a->cost.fops != b->cost.fops)
+            return a->cost.fops > b->cost.fops;
+
+        return a->cost.param_bytes + a->cost.read_bytes + a->cost.write_bytes >
+               b->cost.param_bytes + b->cost.read_bytes + b->cost.write_bytes;
+    });
+
+    for (unsigned int i = 0; i < ranked.size(); i++)
+        ranked[i]->rank = i + 1;
+
+    int show_num = std::min(( int )ranked.size(), top_num);
+
+    printf("%4s  %-32s %-20s %12s %6s %12s %12s %12s %8s\n", "rank", "node", "op", "MFLOPs", "%", "param KB",
+           "read KB", "write KB", "FLOP/B");
+
+    for (int i = 0; i < show_num; i++)
+    {
+        const RankedCost* item = ranked[i];
+        const NodeCost& cost = item->cost;
+
+        printf("%4d  %-32s %-20s %12.3f %6.2f %12.1f %12.1f %12.1f %8.2f\n", item->rank,
+               item->node->GetName().substr(0, 32).c_str(), item->node->GetOp()->GetName().substr(0, 20).c_str(),
+               cost.fops / 1e6, total.fops > 0 ? cost.fops * 100 / total.fops : 0.0, cost.param_bytes / 1024,
+               cost.read_bytes / 1024, cost.write_bytes / 1024, cost.Intensity());
+    }
+
+    printf("total: %.3f MFLOPs, %.1f KB params, %.1f KB read, %.1f KB written, %.2f FLOP/B, %d nodes",
+           total.fops / 1e6, total.param_bytes / 1024, total.read_bytes / 1024, total.write_bytes / 1024,
+           total.Intensity(), ( int )ranked.size());
+
+    if (unknown_num)
+        printf(", %d with unknown shapes", unknown_num);
+
+    printf("\n");
+
+    if (json_file == nullptr)
+        return true;
+
+    return WriteJsonReport(graph, costs, total, json_file);
+}
+
+}    // namespace TEngine
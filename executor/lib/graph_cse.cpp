@@ -0,0 +1,312 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2020, Open AI Lab
+ */
+#include <cstring>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "node.hpp"
+#include "graph.hpp"
+#include "graph_optimizer.hpp"
+
+namespace TEngine {
+
+static inline void HashCombine(size_t& seed, size_t val)
+{
+    seed ^= val + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+/* FNV-1a */
+static size_t HashBytes(const void* data, unsigned int size)
+{
+    const uint8_t* ptr = ( const uint8_t* )data;
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (unsigned int i = 0; i < size; i++)
+    {
+        hash ^= ptr[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+static bool IsConstNode(Node* node)
+{
+    return node->GetOp()->GetName() == "Const";
+}
+
+/* op type and input tensors, or the content for a Const node. the param is only compared on collision */
+static size_t HashNode(Node* node)
+{
+    size_t seed = std::hash<std::string>()(node->GetOp()->GetName());
+
+    if (IsConstNode(node))
+    {
+        Tensor* tensor = node->GetOutputTensor(0);
+
+        HashCombine(seed, tensor->GetDataType());
+
+        for (auto d : tensor->GetShape().GetDim())
+            HashCombine(seed, d);
+
+        HashCombine(seed, HashBytes(tensor->GetMemAddr(), tensor->GetTotalSize()));
+
+        return seed;
+    }
+
+    for (unsigned int i = 0; i < node->GetInputNum(); i++)
+        HashCombine(seed, std::hash<Tensor*>()(node->GetInputTensor(i)));
+
+    return seed;
+}
+
+static bool IsSameQuantParam(Tensor* a, Tensor* b)
+{
+    std::vector<QuantParam>* quant_a = a->GetQuantParam();
+    std::vector<QuantParam>* quant_b = b->GetQuantParam();
+
+    if (quant_a->size() != quant_b->size())
+        return false;
+
+    for (unsigned int i = 0; i < quant_a->size(); i++)
+    {
+        if ((*quant_a)[i].scale != (*quant_b)[i].scale || (*quant_a)[i].zero_point != (*quant_b)[i].zero_point)
+            return false;
+    }
+
+    return true;
+}
+
+static bool IsSameNode(Node* a, Node* b)
+{
+    if (a->GetOp()->GetName() != b->GetOp()->GetName() || a->IsDynamicShape() != b->IsDynamicShape())
+        return false;
+
+    if (a->GetInputNum() != b->GetInputNum() || a->GetOutputNum() != b->GetOutputNum())
+        return false;
+
+    for (unsigned int i = 0; i < a->GetOutputNum(); i++)
+    {
+        Tensor* tensor_a = a->GetOutputTensor(i);
+        Tensor* tensor_b = b->GetOutputTensor(i);
+
+        if (tensor_a->GetType() != tensor_b->GetType() || tensor_a->GetDataType() != tensor_b->GetDataType() ||
+            !IsSameQuantParam(tensor_a, tensor_b))
+            return false;
+    }
+
+    if (IsConstNode(a))
+    {
+        Tensor* tensor_a = a->GetOutputTensor(0);
+        Tensor* tensor_b = b->GetOutputTensor(0);
+
+        return tensor_a->GetShape().GetDim() == tensor_b->GetShape().GetDim() &&
+               !memcmp(tensor_a->GetMemAddr(), tensor_b->GetMemAddr(), tensor_a->GetTotalSize());
+    }
+
+    for (unsigned int i = 0; i < a->GetInputNum(); i++)
+    {
+        if (a->GetInputTensor(i) != b->GetInputTensor(i))
+            return false;
+    }
+
+    return a->GetOp()->IsSameParam(b->GetOp());
+}
+
+/* a node another one may be merged into */
+static bool CanKeepNode(Node* node)
+{
+    if (node->GetOutputNum() == 0)
+        return false;
+
+    if (IsConstNode(node))
+    {
+        Tensor* tensor = node->GetOutputTensor(0);
+
+        return node->GetOutputNum() == 1 && tensor->GetType() == kConstTensor && tensor->GetMemAddr() != nullptr;
+    }
+
+    /* input nodes are never the same */
+    return node->GetInputNum() > 0;
+}
+
+/* a node which may go away: nobody outside sees its tensors */
+static bool CanMergeNode(Node* node, const std::unordered_set<Node*>& boundary)
+{
+    if (boundary.count(node))
+        return false;
+
+    for (unsigned int i = 0; i < node->GetOutputNum(); i++)
+    {
+        if (node->GetOutputTensor(i)->IsGraphOutput())
+            return false;
+    }
+
+    return true;
+}
+
+/* hand the consumers of node over to rep */
+static void MergeNode(Node* node, Node* rep)
+{
+    for (unsigned int i = 0; i < node->GetOutputNum(); i++)
+    {
+        Tensor* tensor = node->GetOutputTensor(i);
+        Tensor* rep_tensor = rep->GetOutputTensor(i);
+
+        for (auto port : tensor->consumer)
+        {
+            port->tensor = rep_tensor;
+            rep_tensor->AddConsumer(port);
+        }
+
+        tensor->consumer.clear();
+    }
+}
+
+bool GraphEliminateCommonSubexpr(Graph* graph, GraphOptimizer* opt)
+{
+    std::unordered_set<Node*> boundary(graph->input_nodes.begin(), graph->input_nodes.end());
+    boundary.insert(graph->output_nodes.begin(), graph->output_nodes.end());
+
+    std::unordered_map<size_t, std::vector<Node*>> node_table;
+
+    /*
+     * seq_nodes is in topological order: producers are merged before their
+     * consumers are hashed, so duplicated chains collapse in one sweep
+     */
+    std::vector<Node*> node_list = graph->seq_nodes;
+    int merge_number = 0;
+
+    for (auto node : node_list)
+    {
+        if (!CanKeepNode(node))
+            continue;
+
+        std::vector<Node*>& candidates = node_table[HashNode(node)];
+        Node* rep = nullptr;
+
+        for (auto n : candidates)
+        {
+            if (IsSameNode(n, node))
+            {
+                rep = n;
+                break;
+            }
+        }
+
+        if (rep == nullptr || !CanMergeNode(node, boundary))
+        {
+            candidates.push_back(node);
+            continue;
+        }
+
+        MergeNode(node, rep);
+        graph->RemoveNode(node, false);
+
+        merge_number++;
+    }
+
+    if (merge_number > 0)
+        graph->SanitizeGraph();
+
+    return true;
+}
+
+static bool IsDeadNode(Node* node, const std::unordered_set<Node*>& input_set)
+{
+    if (node->GetOutputNum() == 0 || input_set.count(node))
+        return false;
+
+    for (unsigned int i = 0; i < node->GetOutputNum(); i++)
+    {
+        Tensor* tensor = node->GetOutputTensor(i);
+
+        if (!tensor->consumer.empty() || tensor->IsGraphOutput())
+            return false;
+    }
+
+    return true;
+}
+
+/*
+ * SanitizeGraph() already drops what the output nodes do not reach. but any node
+ * with an unused output is listed as an output node too, so a dead branch keeps
+ * itself alive. here only the tagged model outputs count.
+ */
+bool GraphEliminateDeadCode(Graph* graph, GraphOptimizer* opt)
+{
+    bool has_graph_output = false;
+
+    for (auto node : graph->output_nodes)
+    {
+        for (unsigned int i = 0; i < node->GetOutputNum(); i++)
+        {
+            if (node->GetOutputTensor(i)->IsGraphOutput())
+                has_graph_output = true;
+        }
+    }
+
+    /* nothing tells the wanted outputs from the unused ones */
+    if (!has_graph_output)
+        return true;
+
+    std::unordered_set<Node*> input_set(graph->input_nodes.begin(), graph->input_nodes.end());
+    std::unordered_set<Node*> removed;
+
+    /* consumers first */
+    std::vector<Node*> work_list = graph->seq_nodes;
+
+    while (!work_list.empty())
+    {
+        Node* node = work_list.back();
+
+        work_list.pop_back();
+
+        if (removed.count(node) || !IsDeadNode(node, input_set))
+            continue;
+
+        std::vector<Node*> producers;
+
+        for (unsigned int i = 0; i < node->GetInputNum(); i++)
+        {
+            Tensor* tensor = node->GetInputTensor(i);
+
+            if (tensor->producer)
+                producers.push_back(tensor->producer->owner);
+        }
+
+        graph->RemoveNode(node, false);
+        removed.insert(node);
+
+        /* they may have lost their last consumer */
+        work_list.insert(work_list.end(), producers.begin(), producers.end());
+    }
+
+    if (!removed.empty())
+        graph->SanitizeGraph();
+
+    return true;
+}
+
+}    // namespace TEngine
@@ -0,0 +1,804 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2020, Open AI Lab
+ */
+#include <cstdlib>
+#include <algorithm>
+#include <unordered_map>
+
+#include "node.hpp"
+#include "graph.hpp"
+#include "data_type.hpp"
+#include "tensor_permute.hpp"
+#include "graph_optimizer.hpp"
+#include "operator/transpose.hpp"
+#include "operator/concat.hpp"
+#include "operator/softmax.hpp"
+#include "operator/split.hpp"
+#include "operator/gather.hpp"
+#include "operator/slice.hpp"
+#include "operator/reduction.hpp"
+#include "operator/stridedslice.hpp"
+#include "operator/pad.hpp"
+#include "operator/flatten.hpp"
+
+/*
+ * rewrites a NHWC graph into a NCHW one, ahead of time:
+ *
+ *  - every 4-d tensor is permuted to NCHW, the const ones together with their data,
+ *    so that the OHWI conv weights become OIHW
+ *  - the axes in the params of Concat, Softmax, Split, Gather, Slice, Reduction,
+ *    StridedSlice and Pad are remapped
+ *  - the weights of a FullyConnected reading a flattened 4-d tensor get their columns
+ *    reordered from HWC to CHW
+ *  - ops which work on the raw data, like Reshape, keep seeing NHWC tensors through
+ *    Transpose ops around them, and so do the graph inputs and outputs
+ *
+ * back to back transposes are left to the Transpose optimizer
+ */
+
+namespace TEngine {
+
+/* the op reads and writes NCHW tensors */
+#define LAYOUT_CONVERT 0
+/* the op keeps seeing NHWC tensors */
+#define LAYOUT_KEEP 1
+/* the op flattens a NCHW tensor for the FullyConnected ops after it */
+#define LAYOUT_FLATTEN 2
+
+/* the shape inference follows the graph layout, and the params do not depend on it */
+static const std::vector<std::string> layout_aware_ops = {"Convolution", "Pooling", "BatchNormalization", "Resize",
+                                                          "Interp"};
+
+/* the params carry axes */
+static const std::vector<std::string> layout_axis_ops = {"Concat", "Softmax", "Split", "Gather",
+                                                         "Slice", "Reduction", "StridedSlice", "Pad"};
+
+/* the result depends on the order of the data, whatever the layout of the graph */
+static const std::vector<std::string> layout_raw_ops = {"Reshape", "Flatten", "Squeeze",  "Unsqueeze",
+                                                        "ExpandDims", "Transpose", "Shape", "Reverse"};
+
+/* out dim i is in dim perm[i] */
+static const std::vector<int> nhwc_to_nchw = {0, 3, 1, 2};
+static const std::vector<int> nchw_to_nhwc = {0, 2, 3, 1};
+
+using LayoutPlan = std::unordered_map<Node*, int>;
+
+struct FcWeight
+{
+    Tensor* weight;
+    int hw;
+    int c;
+};
+
+static bool IsInList(const std::vector<std::string>& list, const std::string& name)
+{
+    return std::find(list.begin(), list.end(), name) != list.end();
+}
+
+static bool Is4D(Tensor* tensor)
+{
+    return tensor->GetShape().GetDim().size() == 4;
+}
+
+static bool Has4DTensor(Node* node)
+{
+    for (unsigned int i = 0; i < node->GetInputNum(); i++)
+    {
+        if (Is4D(node->GetInputTensor(i)))
+            return true;
+    }
+
+    for (unsigned int i = 0; i < node->GetOutputNum(); i++)
+    {
+        if (Is4D(node->GetOutputTensor(i)))
+            return true;
+    }
+
+    return false;
+}
+
+static bool AllOutputs4D(Node* node)
+{
+    for (unsigned int i = 0; i < node->GetOutputNum(); i++)
+    {
+        if (!Is4D(node->GetOutputTensor(i)))
+            return false;
+    }
+
+    return true;
+}
+
+/* NHWC axis --> NCHW axis, -1 if out of range */
+static int MapAxis(int axis)
+{
+    if (axis < 0)
+        axis += 4;
+
+    if (axis < 0 || axis >= 4)
+        return -1;
+
+    return nchw_to_nhwc[axis];
+}
+
+/* per axis values: new[i] = old[nhwc_to_nchw[i]] */
+template <typename T> static void PermuteAxes(T* values)
+{
+    T old[4];
+
+    for (int i = 0; i < 4; i++)
+        old[i] = values[i];
+
+    for (int i = 0; i < 4; i++)
+        values[i] = old[nhwc_to_nchw[i]];
+}
+
+static int PermuteMask(int mask)
+{
+    int new_mask = mask & ~0xf;
+
+    for (int i = 0; i < 4; i++)
+    {
+        if (mask & (1 << nhwc_to_nchw[i]))
+            new_mask |= 1 << i;
+    }
+
+    return new_mask;
+}
+
+static bool RemapAxis(int& axis, bool apply)
+{
+    int new_axis = MapAxis(axis);
+
+    if (new_axis < 0)
+        return false;
+
+    if (apply)
+        axis = new_axis;
+
+    return true;
+}
+
+static bool RemapReduction(Node* node, bool apply)
+{
+    ReductionParam* param = dynamic_cast<Reduction*>(node->GetOp())->GetParam();
+    int* dims[4] = {&param->dim_0, &param->dim_1, &param->dim_2, &param->dim_3};
+    bool reduced[4] = {false, false, false, false};
+    int new_dims[4];
+
+    for (int i = 0; i < 4; i++)
+    {
+        new_dims[i] = *dims[i];
+
+        /* -2 marks an unused entry */
+        if (*dims[i] == -2)
+            continue;
+
+        new_dims[i] = MapAxis(*dims[i]);
+
+        if (new_dims[i] < 0)
+            return false;
+
+        reduced[*dims[i] < 0 ? *dims[i] + 4 : *dims[i]] = true;
+    }
+
+    /* the axes left without keepdim must come out in the same order */
+    if (!param->keepdim && !Is4D(node->GetOutputTensor(0)))
+    {
+        int last = -1;
+
+        for (int i = 0; i < 4; i++)
+        {
+            if (reduced[i])
+                continue;
+
+            if (MapAxis(i) < last)
+                return false;
+
+            last = MapAxis(i);
+        }
+    }
+
+    if (apply)
+    {
+        for (int i = 0; i < 4; i++)
+            *dims[i] = new_dims[i];
+    }
+
+    return true;
+}
+
+static bool RemapStridedSlice(Node* node, bool apply)
+{
+    StridedSliceParam* param = dynamic_cast<StridedSlice*>(node->GetOp())->GetParam();
+
+    /* the masks changing the rank are not mapped */
+    if (param->shrink_axis_mask || param->new_axis_mask || param->ellipsis_mask || !AllOutputs4D(node))
+        return false;
+
+    if (apply)
+    {
+        PermuteAxes(param->begin);
+        PermuteAxes(param->end);
+        PermuteAxes(param->stride);
+
+        param->begin_mask = PermuteMask(param->begin_mask);
+        param->end_mask = PermuteMask(param->end_mask);
+    }
+
+    return true;
+}
+
+static bool RemapPad(Node* node, bool apply)
+{
+    PadParam* param = dynamic_cast<Pad*>(node->GetOp())->GetParam();
+
+    if (apply)
+    {
+        int* before[4] = {&param->pad_0_h, &param->pad_1_h, &param->pad_2_h, &param->pad_3_h};
+        int* after[4] = {&param->pad_0_w, &param->pad_1_w, &param->pad_2_w, &param->pad_3_w};
+        int old_before[4];
+        int old_after[4];
+
+        for (int i = 0; i < 4; i++)
+        {
+            old_before[i] = *before[i];
+            old_after[i] = *after[i];
+        }
+
+        for (int i = 0; i < 4; i++)
+        {
+            *before[i] = old_before[nhwc_to_nchw[i]];
+            *after[i] = old_after[nhwc_to_nchw[i]];
+        }
+    }
+
+    return true;
+}
+
+static bool RemapSlice(Node* node, bool apply)
+{
+    SliceParam* param = dynamic_cast<Slice*>(node->GetOp())->GetParam();
+
+    if (!AllOutputs4D(node))
+        return false;
+
+    /* the tflite style slice has a begin and a size per axis */
+    if (!param->iscaffe && !param->ismxnet && !param->isonnx && !param->isncnn)
+    {
+        if (param->begin_.size() != 4 || param->size_.size() != 4)
+            return false;
+
+        if (apply)
+        {
+            PermuteAxes(param->begin_.data());
+            PermuteAxes(param->size_.data());
+        }
+
+        return true;
+    }
+
+    return RemapAxis(param->axis, apply);
+}
+
+/* with apply == false, only tells if the axes can be remapped */
+static bool RemapAxisParam(Node* node, bool apply)
+{
+    Operator* op = node->GetOp();
+    const std::string& op_name = op->GetName();
+
+    if (!Is4D(node->GetInputTensor(0)))
+        return false;
+
+    if (op_name == "Reduction")
+        return RemapReduction(node, apply);
+
+    if (op_name == "StridedSlice")
+        return RemapStridedSlice(node, apply);
+
+    if (op_name == "Slice")
+        return RemapSlice(node, apply);
+
+    if (!AllOutputs4D(node))
+        return false;
+
+    if (op_name == "Pad")
+        return RemapPad(node, apply);
+
+    if (op_name == "Concat")
+        return RemapAxis(dynamic_cast<Concat*>(op)->GetParam()->axis, apply);
+
+    if (op_name == "Softmax")
+        return RemapAxis(dynamic_cast<Softmax*>(op)->GetParam()->axis, apply);
+
+    if (op_name == "Split")
+        return RemapAxis(dynamic_cast<Split*>(op)->GetParam()->axis, apply);
+
+    if (op_name == "Gather")
+        return RemapAxis(dynamic_cast<Gather*>(op)->GetParam()->axis, apply);
+
+    return false;
+}
+
+/* [batch][rows][cols] --> [batch][cols][rows] in a new buffer owned by the tensor */
+static bool TransposeConstData(Tensor* tensor, int batch, int rows, int cols)
+{
+    int elem_size = DataType::GetTypeSize(tensor->GetDataType());
+    void* data = std::malloc(tensor->GetTotalSize());
+
+    if (data == nullptr)
+        return false;
+
+    if (!TransposeData(tensor->GetMemAddr(), data, batch, rows, cols, elem_size))
+    {
+        std::free(data);
+        return false;
+    }
+
+    tensor->SetMemAddr(data);
+    tensor->SetFreeMem(true);
+
+    return true;
+}
+
+static bool IsExclusiveConst(Tensor* tensor)
+{
+    return tensor->GetType() == kConstTensor && tensor->GetMemAddr() != nullptr && tensor->consumer.size() == 1 &&
+           !tensor->IsGraphOutput();
+}
+
+/* the weight columns of a FullyConnected reading a flattened [n, h, w, c] tensor */
+static bool GetFcWeight(Node* node, const std::vector<int>& in_dims, FcWeight& fc_weight)
+{
+    if (node->GetOp()->GetName() != "FullyConnected" || node->GetInputNum() < 2)
+        return false;
+
+    Tensor* weight = node->GetInputTensor(1);
+    const std::vector<int>& dims = weight->GetShape().GetDim();
+
+    if (!IsExclusiveConst(weight) || dims.size() != 2 || dims[1] != in_dims[1] * in_dims[2] * in_dims[3])
+        return false;
+
+    fc_weight.weight = weight;
+    fc_weight.hw = in_dims[1] * in_dims[2];
+    fc_weight.c = in_dims[3];
+
+    return true;
+}
+
+/* Reshape to [n, k] or Flatten to [n, k, 1, 1], read only by FullyConnected ops */
+static bool IsFlattenToFc(Node* node, std::vector<FcWeight>& fc_weights)
+{
+    const std::string& op_name = node->GetOp()->GetName();
+    Tensor* input = node->GetInputTensor(0);
+    Tensor* output = node->GetOutputTensor(0);
+
+    if (node->GetOutputNum() != 1 || !Is4D(input) || output->IsGraphOutput() || output->consumer.empty())
+        return false;
+
+    const std::vector<int>& in_dims = input->GetShape().GetDim();
+    const std::vector<int>& out_dims = output->GetShape().GetDim();
+    int k = in_dims[1] * in_dims[2] * in_dims[3];
+
+    if (op_name == "Reshape")
+    {
+        if (out_dims.size() != 2 || out_dims[0] != in_dims[0] || out_dims[1] != k)
+            return false;
+    }
+    else if (op_name == "Flatten")
+    {
+        FlattenParam* param = dynamic_cast<Flatten*>(node->GetOp())->GetParam();
+
+        if (param->axis != 1 || (param->end_axis != 3 && param->end_axis != -1))
+            return false;
+    }
+    else
+    {
+        return false;
+    }
+
+    std::vector<FcWeight> weights;
+
+    for (auto port : output->consumer)
+    {
+        FcWeight fc_weight;
+
+        if (port->port_index != 0 || !GetFcWeight(port->owner, in_dims, fc_weight))
+            return false;
+
+        weights.push_back(fc_weight);
+    }
+
+    fc_weights.insert(fc_weights.end(), weights.begin(), weights.end());
+
+    return true;
+}
+
+/* the shapes are needed up front: fill the missing ones, in the original layout */
+static void InferMissingShapes(Graph* graph)
+{
+    for (auto node : graph->seq_nodes)
+    {
+        Operator* op = node->GetOp();
+        bool missing = false;
+
+        if (op->GetName() == "Const" || op->GetName() == "Input" || node->IsDynamicShape())
+            continue;
+
+        for (unsigned int i = 0; i < node->GetOutputNum(); i++)
+        {
+            if (node->GetOutputTensor(i)->GetShape().GetSize() <= 0)
+                missing = true;
+        }
+
+        if (!missing)
+            continue;
+
+        std::vector<TShape> ishape;
+        std::vector<TShape> oshape(node->GetOutputNum());
+
+        for (unsigned int i = 0; i < node->GetInputNum(); i++)
+        {
+            TShape& shape = node->GetInputTensor(i)->GetShape();
+
+            if (shape.GetSize() <= 0)
+                return;
+
+            ishape.push_back(shape);
+        }
+
+        if (!op->InferShape(ishape, oshape, graph->GetLayout()))
+            return;
+
+        for (unsigned int i = 0; i < node->GetOutputNum(); i++)
+        {
+            if (oshape[i].GetSize() > 0)
+                node->GetOutputTensor(i)->GetShape() = oshape[i];
+        }
+    }
+}
+
+static bool PlanNode(Graph* graph, Node* node, LayoutPlan& plan, std::vector<FcWeight>& fc_weights)
+{
+    const std::string& op_name = node->GetOp()->GetName();
+
+    for (unsigned int i = 0; i < node->GetOutputNum(); i++)
+    {
+        if (node->GetOutputTensor(i)->GetShape().GetSize() <= 0)
+        {
+            LOG_ERROR() << "layout conversion: the shape of tensor " << node->GetOutputTensor(i)->GetName()
+                        << " is unknown\n";
+            return false;
+        }
+    }
+
+    if (graph->IsInputNode(node))
+    {
+        plan[node] = LAYOUT_KEEP;
+        return true;
+    }
+
+    /* decided after the consumers */
+    if (op_name == "Const")
+        return true;
+
+    plan[node] = LAYOUT_CONVERT;
+
+    if (op_name == "FullyConnected")
+    {
+        Tensor* input = node->GetInputTensor(0);
+        FcWeight fc_weight;
+
+        /* a flattening op before has taken care of the weights */
+        if (!Is4D(input) || (input->producer && plan[input->producer->owner] == LAYOUT_FLATTEN))
+            return true;
+
+        if (!GetFcWeight(node, input->GetShape().GetDim(), fc_weight))
+        {
+            LOG_ERROR() << "layout conversion: the weight of node " << node->GetName() << " can not be reordered\n";
+            return false;
+        }
+
+        fc_weights.push_back(fc_weight);
+
+        return true;
+    }
+
+    if (!Has4DTensor(node) || IsInList(layout_aware_ops, op_name))
+        return true;
+
+    /* element-wise: any layout does, as long as all the inputs share it */
+    if (IsInList(GetElementwiseOps(), op_name))
+    {
+        /* a lower rank input broadcasts along the last axes */
+        for (unsigned int i = 0; i < node->GetInputNum(); i++)
+        {
+            Tensor* tensor = node->GetInputTensor(i);
+
+            if (!Is4D(tensor) && tensor->GetShape().GetSize() != 1)
+                plan[node] = LAYOUT_KEEP;
+        }
+
+        if (!AllOutputs4D(node))
+            plan[node] = LAYOUT_KEEP;
+
+        return true;
+    }
+
+    if (IsInList(layout_axis_ops, op_name))
+    {
+        if (!RemapAxisParam(node, false))
+            plan[node] = LAYOUT_KEEP;
+
+        return true;
+    }
+
+    if (IsInList(layout_raw_ops, op_name))
+    {
+        plan[node] = IsFlattenToFc(node, fc_weights) ? LAYOUT_FLATTEN : LAYOUT_KEEP;
+        return true;
+    }
+
+    LOG_ERROR() << "layout conversion: op " << op_name << " of node " << node->GetName() << " is not supported\n";
+
+    return false;
+}
+
+/* a const is kept in NHWC only when no consumer wants it in NCHW */
+static void PlanConst(Node* node, LayoutPlan& plan)
+{
+    Tensor* tensor = node->GetOutputTensor(0);
+
+    plan[node] = LAYOUT_KEEP;
+
+    for (auto port : tensor->consumer)
+    {
+        if (plan[port->owner] != LAYOUT_KEEP)
+            plan[node] = LAYOUT_CONVERT;
+    }
+}
+
+static void SetNCHWShape(Tensor* tensor, const std::vector<int>& nhwc_dims)
+{
+    std::vector<int> dims(4);
+
+    for (int i = 0; i < 4; i++)
+        dims[i] = nhwc_dims[nhwc_to_nchw[i]];
+
+    tensor->GetShape().SetDim(dims);
+    tensor->GetShape().SetDataLayout(TENGINE_LAYOUT_NCHW);
+}
+
+static void SetNHWCShape(Tensor* tensor, const std::vector<int>& nchw_dims)
+{
+    std::vector<int> dims(4);
+
+    for (int i = 0; i < 4; i++)
+        dims[i] = nchw_dims[nchw_to_nhwc[i]];
+
+    tensor->GetShape().SetDim(dims);
+    tensor->GetShape().SetDataLayout(TENGINE_LAYOUT_NHWC);
+}
+
+static Tensor* AddVarTensor(Graph* graph, const std::string& name, Tensor* orig)
+{
+    Tensor* tensor = new Tensor(name);
+
+    tensor->SetType(kVarTensor);
+    tensor->SetDataType(orig->GetDataType());
+    *tensor->GetQuantParam() = *orig->GetQuantParam();
+
+    graph->AddTensor(tensor);
+
+    return tensor;
+}
+
+static Node* AddTransposeNode(Graph* graph, const std::string& name, Tensor* input, Tensor* output,
+                              const std::vector<int>& perm)
+{
+    Node* node = new Node(name);
+    Transpose* op = dynamic_cast<Transpose*>(OpManager::CreateOp("Transpose"));
+
+    op->GetParam()->tr_shape = perm;
+    node->SetOp(op);
+
+    node->AddInputTensor(input);
+    input->AddConsumer(node->GetInputPort(0));
+
+    node->AddOutputTensor(output);
+    output->producer = node->GetOutputPort(0);
+
+    graph->AddNode(node);
+
+    return node;
+}
+
+static void MoveConsumers(Tensor* from, Tensor* to, const std::vector<NodePort*>& ports)
+{
+    for (auto port : ports)
+    {
+        from->RemoveConsumer(port);
+        port->tensor = to;
+        to->AddConsumer(port);
+    }
+}
+
+/* a graph output keeps its tensor in NHWC: the producer writes a new one and a Transpose restores it */
+static void ConvertGraphOutput(Graph* graph, Tensor* tensor, const std::vector<NodePort*>& nchw_ports)
+{
+    NodePort* producer = tensor->producer;
+    Node* node = producer->owner;
+    int port_index = producer->port_index;
+    Tensor* inner = AddVarTensor(graph, tensor->GetName() + ".nchw", tensor);
+
+    SetNCHWShape(inner, tensor->GetShape().GetDim());
+
+    node->SetOutputPort(port_index, inner);
+    inner->producer = node->GetOutputPort(port_index);
+
+    MoveConsumers(tensor, inner, nchw_ports);
+
+    Node* transpose = AddTransposeNode(graph, tensor->GetName() + ".nhwc", inner, tensor, nchw_to_nhwc);
+
+    /* the Transpose takes the place of the producer in the output list */
+    auto it = std::find(graph->output_nodes.begin(), graph->output_nodes.end(), node);
+
+    if (it == graph->output_nodes.end())
+    {
+        graph->output_nodes.push_back(transpose);
+        return;
+    }
+
+    graph->output_nodes.insert(it + 1, transpose);
+
+    for (unsigned int i = 0; i < node->GetOutputNum(); i++)
+    {
+        if (node->GetOutputTensor(i)->IsGraphOutput())
+            return;
+    }
+
+    graph->output_nodes.erase(std::find(graph->output_nodes.begin(), graph->output_nodes.end(), node));
+}
+
+/* the tensor and its consumers, in the layout of each side */
+static bool ConvertTensor(Graph* graph, Tensor* tensor, LayoutPlan& plan)
+{
+    int producer_action = plan[tensor->producer->owner];
+
+    /* the flattened data is read as is */
+    if (producer_action == LAYOUT_FLATTEN)
+        return true;
+
+    std::vector<NodePort*> nchw_ports;
+    std::vector<NodePort*> nhwc_ports;
+
+    for (auto port : tensor->consumer)
+    {
+        if (plan[port->owner] == LAYOUT_KEEP)
+            nhwc_ports.push_back(port);
+        else
+            nchw_ports.push_back(port);
+    }
+
+    const std::vector<int> dims = tensor->GetShape().GetDim();
+
+    if (producer_action == LAYOUT_KEEP)
+    {
+        if (nchw_ports.empty())
+            return true;
+
+        Tensor* output = AddVarTensor(graph, tensor->GetName() + ".nchw", tensor);
+
+        SetNCHWShape(output, dims);
+        AddTransposeNode(graph, output->GetName(), tensor, output, nhwc_to_nchw);
+        MoveConsumers(tensor, output, nchw_ports);
+
+        return true;
+    }
+
+    if (tensor->IsGraphOutput())
+    {
+        ConvertGraphOutput(graph, tensor, nchw_ports);
+        return true;
+    }
+
+    if (tensor->GetType() == kConstTensor && !TransposeConstData(tensor, dims[0], dims[1] * dims[2], dims[3]))
+        return false;
+
+    SetNCHWShape(tensor, dims);
+
+    if (!nhwc_ports.empty())
+    {
+        Tensor* output = AddVarTensor(graph, tensor->GetName() + ".nhwc", tensor);
+
+        SetNHWCShape(output, dims);
+        AddTransposeNode(graph, output->GetName(), tensor, output, nchw_to_nhwc);
+        MoveConsumers(tensor, output, nhwc_ports);
+    }
+
+    return true;
+}
+
+bool GraphConvertToNCHW(Graph* graph, GraphOptimizer* opt)
+{
+    if (graph->GetLayout() != TENGINE_LAYOUT_NHWC)
+        return true;
+
+    InferMissingShapes(graph);
+
+    /* decide everything first: the graph is left untouched if some op can not be converted */
+    LayoutPlan plan;
+    std::vector<FcWeight> fc_weights;
+
+    for (auto node : graph->seq_nodes)
+    {
+        if (!PlanNode(graph, node, plan, fc_weights))
+            return false;
+    }
+
+    for (auto node : graph->seq_nodes)
+    {
+        if (node->GetOp()->GetName() == "Const" && !graph->IsInputNode(node))
+            PlanConst(node, plan);
+    }
+
+    for (auto& fc_weight : fc_weights)
+    {
+        Tensor* weight = fc_weight.weight;
+
+        if (!TransposeConstData(weight, weight->GetShape().Shape(0), fc_weight.hw, fc_weight.c))
+            return false;
+    }
+
+    std::vector<Tensor*> tensors;
+
+    for (auto node : graph->seq_nodes)
+    {
+        if (plan[node] == LAYOUT_CONVERT && IsInList(layout_axis_ops, node->GetOp()->GetName()))
+            RemapAxisParam(node, true);
+
+        for (unsigned int i = 0; i < node->GetOutputNum(); i++)
+        {
+            Tensor* tensor = node->GetOutputTensor(i);
+
+            if (Is4D(tensor) && tensor->producer != nullptr)
+                tensors.push_back(tensor);
+        }
+    }
+
+    for (auto tensor : tensors)
+    {
+        if (!ConvertTensor(graph, tensor, plan))
+        {
+            LOG_ERROR() << "layout conversion: failed on tensor " << tensor->GetName() << "\n";
+            return false;
+        }
+    }
+
+    graph->SetLayout(TENGINE_LAYOUT_NCHW);
+    graph->SetModelLayout(TENGINE_LAYOUT_NCHW);
+
+    graph->SanitizeGraph();
+
+    return true;
+}
+
+}    // namespace TEngine
@@ -0,0 +1,297 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2020, Open AI Lab
+ */
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <unordered_map>
+
+#include "logger.hpp"
+#include "node.hpp"
+#include "graph.hpp"
+#include "graph_optimizer.hpp"
+#include "mem_plan.hpp"
+
+namespace TEngine {
+
+/* a tensor lives from its producer to its last consumer, both included */
+struct PlanTensor
+{
+    Node* node;
+    int port;
+    int first;
+    int last;
+    uint32_t size;
+    uint32_t offset;
+};
+
+static bool Overlap(const PlanTensor* a, const PlanTensor* b)
+{
+    return a->first <= b->last && b->first <= a->last;
+}
+
+/*
+ * the tensors which the cpu runner would allocate: the outputs of the nodes with
+ * static shapes, but the const and the input ones
+ */
+static bool CollectPlanTensors(Graph* graph, std::vector<PlanTensor>& tensors)
+{
+    std::unordered_map<Node*, int> node_idx;
+    int node_number = graph->seq_nodes.size();
+
+    for (int i = 0; i < node_number; i++)
+        node_idx[graph->seq_nodes[i]] = i;
+
+    for (int i = 0; i < node_number; i++)
+    {
+        Node* node = graph->seq_nodes[i];
+        const std::string& op_name = node->GetOp()->GetName();
+
+        if (op_name == "Const" || op_name == "Input" || node->IsDynamicShape() || !node->IsStaticShape())
+            continue;
+
+        bool graph_output = std::find(graph->output_nodes.begin(), graph->output_nodes.end(), node) !=
+                            graph->output_nodes.end();
+
+        for (unsigned int j = 0; j < node->GetOutputNum(); j++)
+        {
+            Tensor* tensor = node->GetOutputTensor(j);
+            uint64_t size = tensor->GetTotalSize();
+
+            size = (size + MEM_PLAN_ALIGN - 1) / MEM_PLAN_ALIGN * MEM_PLAN_ALIGN;
+
+            if (size == 0 || size > INT32_MAX)
+                return false;
+
+            PlanTensor t;
+
+            t.node = node;
+            t.port = j;
+            t.first = i;
+            t.last = i;
+            t.size = size;
+            t.offset = 0;
+
+            /* the outputs of the graph stay till the end */
+            if (graph_output || tensor->consumer.empty())
+                t.last = node_number;
+
+            for (auto port : tensor->consumer)
+            {
+                auto ir = node_idx.find(port->owner);
+
+                if (ir == node_idx.end())
+                    t.last = node_number;
+                else
+                    t.last = std::max(t.last, ir->second);
+            }
+
+            tensors.push_back(t);
+        }
+    }
+
+    return true;
+}
+
+/*
+ * greedy by size: the biggest tensor is placed first, each into the smallest gap
+ * left by the placed tensors living at the same time, or after them all
+ */
+static uint64_t PlaceTensors(std::vector<PlanTensor>& tensors)
+{
+    std::vector<PlanTensor*> order;
+
+    for (auto& t : tensors)
+        order.push_back(&t);
+
+    std::stable_sort(order.begin(), order.end(),
+                     [](const PlanTensor* a, const PlanTensor* b) { return a->size > b->size; });
+
+    std::vector<PlanTensor*> placed;
+    uint64_t arena_size = 0;
+
+    for (auto t : order)
+    {
+        std::vector<PlanTensor*> live;
+
+        for (auto p : placed)
+        {
+            if (Overlap(t, p))
+                live.push_back(p);
+        }
+
+        std::sort(live.begin(), live.end(),
+                  [](const PlanTensor* a, const PlanTensor* b) { return a->offset < b->offset; });
+
+        uint64_t best_offset = 0;
+        uint64_t best_gap = UINT64_MAX;
+        uint64_t free_start = 0;
+
+        for (auto p : live)
+        {
+            if (p->offset >= free_start + t->size && p->offset - free_start < best_gap)
+            {
+                best_gap = p->offset - free_start;
+                best_offset = free_start;
+            }
+
+            free_start = std::max(free_start, ( uint64_t )p->offset + p->size);
+        }
+
+        if (best_gap == UINT64_MAX)
+            best_offset = free_start;
+
+        t->offset = best_offset;
+        arena_size = std::max(arena_size, best_offset + t->size);
+
+        placed.push_back(t);
+    }
+
+    return arena_size;
+}
+
+static void SetMemPlanAttr(Node* node, const std::vector<PlanTensor*>& outputs, uint32_t arena_size)
+{
+    int output_num = node->GetOutputNum();
+    MemPlanHeader header = {};
+    std::vector<MemPlanEntry> entry(output_num);
+
+    header.version = MEM_PLAN_VERSION;
+    header.output_num = output_num;
+    header.arena_size = arena_size;
+
+    for (int i = 0; i < output_num; i++)
+    {
+        entry[i].offset = MEM_PLAN_NONE;
+        entry[i].size = 0;
+    }
+
+    for (auto t : outputs)
+    {
+        entry[t->port].offset = t->offset;
+        entry[t->port].size = t->size;
+    }
+
+    std::vector<uint8_t> mem(sizeof(MemPlanHeader) + output_num * sizeof(MemPlanEntry));
+
+    memcpy(mem.data(), &header, sizeof(MemPlanHeader));
+    memcpy(mem.data() + sizeof(MemPlanHeader), entry.data(), output_num * sizeof(MemPlanEntry));
+
+    if (!node->ExistAttr(ATTR_CUSTOM_ATTR))
+        node->SetAttr(ATTR_CUSTOM_ATTR, node_custom_attr_map_t());
+
+    node_custom_attr_map_t* attr_map = any_cast<node_custom_attr_map_t>(&node->GetAttr(ATTR_CUSTOM_ATTR));
+    CustomNodeAttr& attr = (*attr_map)[MEM_PLAN_ATTR];
+
+    attr.type_name = nullptr;
+    attr.attr_size = mem.size();
+    attr.mem.swap(mem);
+}
+
+/*
+ * the shapes must be final (see Node::IsStaticShape): run it after the shape
+ * inference and the fusions, just before saving
+ */
+bool GraphPlanMemory(Graph* graph, GraphOptimizer* opt)
+{
+    std::vector<PlanTensor> tensors;
+
+    /* a plan from an earlier run is stale */
+    for (auto node : graph->seq_nodes)
+        DropMemPlan(node);
+
+    if (!CollectPlanTensors(graph, tensors))
+    {
+        LOG_ERROR() << "graph: " << graph->GetName() << " has a tensor too big to plan\n";
+        return false;
+    }
+
+    if (tensors.empty())
+        return true;
+
+    uint64_t arena_size = PlaceTensors(tensors);
+
+    if (arena_size > INT32_MAX)
+    {
+        LOG_ERROR() << "graph: " << graph->GetName() << " needs an arena of " << arena_size << " bytes\n";
+        return false;
+    }
+
+    /* the most bytes alive at once: no placement does better */
+    uint64_t peak_size = 0;
+    uint64_t total_size = 0;
+
+    for (auto& t : tensors)
+    {
+        uint64_t live_size = 0;
+
+        for (auto& p : tensors)
+        {
+            if (p.first <= t.first && t.first <= p.last)
+                live_size += p.size;
+        }
+
+        peak_size = std::max(peak_size, live_size);
+        total_size += t.size;
+    }
+
+    std::unordered_map<Node*, std::vector<PlanTensor*>> node_outputs;
+
+    for (auto& t : tensors)
+        node_outputs[t.node].push_back(&t);
+
+    for (auto& ir : node_outputs)
+        SetMemPlanAttr(ir.first, ir.second, arena_size);
+
+    LOG_INFO() << "activation arena: " << arena_size << " bytes for " << tensors.size()
+               << " tensors, peak alive: " << peak_size << " bytes, all: " << total_size << " bytes\n";
+
+    return true;
+}
+
+const MemPlanHeader* GetMemPlan(Node* node)
+{
+    if (!node->ExistAttr(ATTR_CUSTOM_ATTR))
+        return nullptr;
+
+    node_custom_attr_map_t* attr_map = any_cast<node_custom_attr_map_t>(&node->GetAttr(ATTR_CUSTOM_ATTR));
+    auto ir = attr_map->find(MEM_PLAN_ATTR);
+
+    if (ir == attr_map->end() || ir->second.mem.size() < sizeof(MemPlanHeader))
+        return nullptr;
+
+    const MemPlanHeader* header = ( const MemPlanHeader* )ir->second.mem.data();
+
+    if (header->version != MEM_PLAN_VERSION || header->output_num != ( int )node->GetOutputNum() ||
+        ir->second.mem.size() != sizeof(MemPlanHeader) + header->output_num * sizeof(MemPlanEntry))
+        return nullptr;
+
+    return header;
+}
+
+void DropMemPlan(Node* node)
+{
+    if (node->ExistAttr(ATTR_CUSTOM_ATTR))
+        any_cast<node_custom_attr_map_t>(&node->GetAttr(ATTR_CUSTOM_ATTR))->erase(MEM_PLAN_ATTR);
+}
+
+}    // namespace TEngine
@@ -23,310 +23,298 @@
  *         bzhang@openailab.com
  */
 #include <cmath>
+#include <cfloat>
 #include <cstring>
+#include <algorithm>
+#include <unordered_map>
 
 #include "node.hpp"
 #include "graph.hpp"
 #include "graph_optimizer.hpp"
+#include "graph_rewriter.hpp"
 #include "operator/fused_operator.hpp"
 #include "operator/batch_norm.hpp"
 #include "operator/convolution.hpp"
+#include "operator/deconvolution.hpp"
 #include "operator/fully_connected.hpp"
 #include "operator/relu.hpp"
 #include "operator/scale.hpp"
 #include "operator/eltwise.hpp"
+#include "operator/pad.hpp"
+#include "operator/pooling.hpp"
+#include "operator/clip.hpp"
+#include "operator/elu.hpp"
+#include "operator/reduction.hpp"
+#include "operator/unary.hpp"
+#include "operator/softmax.hpp"
+#include "operator/transpose.hpp"
+#include "operator/layernorm.hpp"
+#include "operator/gelu.hpp"
+#include "operator/attention.hpp"
 #include "tensor_mem.hpp"
+#include "parallel_task.hpp"
 
 namespace TEngine {
 
-static bool GraphFuseBNScale(Graph* graph, GraphOptimizer* opt);
-static bool GraphFuseConvBN(Graph* graph, GraphOptimizer* opt);
-static bool GraphFuseConvReLu(Graph* graph, GraphOptimizer* opt);
-static bool GraphFuseConvReLu6(Graph* graph, GraphOptimizer* opt);
-static bool GraphFuseRelu6(Graph* graph, GraphOptimizer* opt);
 static void AddConstNodeToSubGraph(Subgraph* graph, Tensor* tensor, Node* fused_node, int fused_port_index);
-static bool GraphFusedFcBn(Graph* graph, GraphOptimizer* opt);
-static bool GraphFusedConvUnsqueeze(Graph* graph, GraphOptimizer* opt);
-static bool GraphFusedSigmoidMul(Graph* graph, GraphOptimizer* opt);
+static void AddFloatConst(Subgraph* graph, Node* fused_node, const std::string& name, const float* data, int num,
+                          int port);
+static bool GraphRunFusion(Graph* graph, GraphOptimizer* opt);
 
-static bool Weight_Bn(Subgraph* graph, Node* ConvNode, float* mean, float* var, float* gamma, float* beta, float eps,
-                      float rescale_factor, Tensor* bias_tensor)
+/* the weights one task rescales: enough to pay for a thread */
+#define BN_FOLD_TASK_SIZE (1 << 18)
+
+/*
+ * the BN folded into the layer: weight * scale[c] and new_bias[c], with
+ * scale[c] = gamma[c] / sqrt(var[c] / rescale_factor + eps)
+ */
+static void GetBnScale(int channel_num, const float* mean, const float* var, const float* gamma, const float* beta,
+                       float eps, float rescale_factor, float* scale, float* new_bias)
 {
-    Tensor* kernel_tensor = ConvNode->GetInputTensor(1);
-    Convolution* conv_op = dynamic_cast<Convolution*>(ConvNode->GetOp());
-    ConvParam* param = conv_op->GetParam();
-    const TShape& kernel_shape = kernel_tensor->GetShape();
+    float rescale = rescale_factor ? 1 / rescale_factor : 0;
 
-    int group = param->group;
-    // int input_chan = kernel_shape.Shape(1);
-    int input_chan = kernel_shape.GetC();
-    int output_chan = kernel_shape.Shape(0) / group;
-    int kernel_x = param->kernel_w;
-    int kernel_y = param->kernel_h;
-    int kernel_size = input_chan * kernel_x * kernel_y;
-    float* kernel_org = ( float* )get_tensor_mem(kernel_tensor);
-    int channel_num = kernel_shape.Shape(0);
-    float* kernel_new = ( float* )(malloc(kernel_size * channel_num * sizeof(float) + 128));
+    for (int c = 0; c < channel_num; c++)
+    {
+        float var_inv = 1.f / sqrt(var[c] * rescale + eps);
+        float shift = -mean[c] * rescale * var_inv;
 
-    memcpy(kernel_new, kernel_org, sizeof(float) * kernel_size * channel_num);
+        if (gamma)
+        {
+            var_inv *= gamma[c];
+            shift *= gamma[c];
+        }
+
+        if (beta)
+            shift += beta[c];
+
+        scale[c] = var_inv;
+        new_bias[c] = shift;
+    }
+}
+
+/* weight[c * row_size + i] = orig[c * row_size + i] * scale[c]: the rows are split among the threads */
+static void ScaleRows(const float* orig, float* weight, const float* scale, int row_num, int row_size)
+{
+    int row_block = std::max(1, BN_FOLD_TASK_SIZE / std::max(row_size, 1));
+    int task_num = (row_num + row_block - 1) / row_block;
 
-    kernel_tensor->SetMemAddr(kernel_new);
-    kernel_tensor->SetAttr("free_mem", 1);
+    ParallelRun(task_num, [&](int task) {
+        int end = std::min(row_num, (task + 1) * row_block);
 
-    float* scale_mean = ( float* )malloc(channel_num * sizeof(float));
-    float* scale_var_inv = ( float* )malloc(channel_num * sizeof(float));
+        for (int c = task * row_block; c < end; c++)
+        {
+            const float* src = orig + ( size_t )c * row_size;
+            float* dst = weight + ( size_t )c * row_size;
+            float w_scale = scale[c];
 
-    float rescale_factor_tmp = rescale_factor;
+            for (int i = 0; i < row_size; i++)
+                dst[i] = src[i] * w_scale;
+        }
+    });
+}
 
-    // fuse the bias;
-    float* bias = NULL;
+/* a new bias input at port 2 of node, the old one is left to its other consumers */
+static float* AddBnBias(Subgraph* graph, Node* node, Tensor* bias_tensor, int channel_num)
+{
     std::string bias_name;
+
     if (bias_tensor)
-    {
-        bias = ( float* )get_tensor_mem(bias_tensor);
         bias_name = bias_tensor->GetName() + ".bn";
-    }
     else
-    {
-        bias_name = ConvNode->GetName() + ".bias.bn";
-    }
+        bias_name = node->GetName() + ".bias.bn";
 
-    /*
-     *  create the bias node,,, ugly code..
-     *
-     */
+    Tensor* new_bias_tensor = new Tensor(bias_name);
+    std::vector<int> dims{channel_num};
 
-    {
-        Tensor* new_bias_tensor = new Tensor(bias_name);
-        std::vector<int> dims{channel_num};
+    TShape bias_shape;
+    bias_shape.SetDim(dims);
 
-        TShape bias_shape;
-        bias_shape.SetDim(dims);
+    new_bias_tensor->Reshape(bias_shape);
+    new_bias_tensor->SetType(kConstTensor);
 
-        new_bias_tensor->Reshape(bias_shape);
-        new_bias_tensor->SetType(kConstTensor);
+    void* bias_new = ( void* )malloc(channel_num * sizeof(float) + 128);
 
-        void* bias_new = ( void* )malloc(channel_num * sizeof(float) + 128);
+    new_bias_tensor->SetMemAddr(bias_new);
 
-        new_bias_tensor->SetMemAddr(bias_new);
+    AddConstNodeToSubGraph(graph, new_bias_tensor, node, 2);
 
-        AddConstNodeToSubGraph(graph, new_bias_tensor, ConvNode, 2);
+    delete new_bias_tensor;
 
-        delete new_bias_tensor;
+    // set the free flag
+    new_bias_tensor = node->GetInputTensor(2);
+    new_bias_tensor->SetFreeMem(true);
 
-        // set the free flag
-        new_bias_tensor = ConvNode->GetInputTensor(2);
-        new_bias_tensor->SetAttr("free_mem", 1);
-    }
+    return ( float* )get_tensor_mem(new_bias_tensor);
+}
 
-    rescale_factor_tmp = rescale_factor_tmp ? 1 / rescale_factor_tmp : 0;
+/* bias_new[c] = bias[c] * scale[c] + shift[c] */
+static void SetBnBias(float* bias_new, const float* bias, const std::vector<float>& scale,
+                      const std::vector<float>& shift)
+{
+    for (size_t c = 0; c < scale.size(); c++)
+        bias_new[c] = (bias ? bias[c] : 0.f) * scale[c] + shift[c];
+}
 
-    if (NULL == bias)
-    {
-        for (int c = 0; c < channel_num; c++)
-        {
-            scale_var_inv[c] = 1.f / sqrt(var[c] * rescale_factor_tmp + eps);
-            scale_mean[c] = -mean[c] * rescale_factor_tmp * scale_var_inv[c];
-        }
-    }
-    else
-    {
-        for (int c = 0; c < channel_num; c++)
-        {
-            scale_var_inv[c] = 1.f / sqrt(var[c] * rescale_factor_tmp + eps);
-            scale_mean[c] = (bias[c] - mean[c] * rescale_factor_tmp) * scale_var_inv[c];
-        }
-    }
+static bool Weight_Bn(Subgraph* graph, Node* ConvNode, const std::vector<float>& scale,
+                      const std::vector<float>& shift, Tensor* bias_tensor)
+{
+    Tensor* kernel_tensor = ConvNode->GetInputTensor(1);
+    Convolution* conv_op = dynamic_cast<Convolution*>(ConvNode->GetOp());
+    ConvParam* param = conv_op->GetParam();
+    const TShape& kernel_shape = kernel_tensor->GetShape();
+
+    int group = param->group;
+    // int input_chan = kernel_shape.Shape(1);
+    int input_chan = kernel_shape.GetC();
+    int output_chan = kernel_shape.Shape(0) / group;
+    int kernel_x = param->kernel_w;
+    int kernel_y = param->kernel_h;
+    int kernel_size = input_chan * kernel_x * kernel_y;
+    int channel_num = kernel_shape.Shape(0);
+
+    /* the scaled copy is written in one pass, when the kernel is shared */
+    const float* kernel_orig = ( const float* )kernel_tensor->GetMemAddr();
+    float* kernel_new = ( float* )kernel_tensor->GetWritableMemAddr(false);
+
+    float* bias = bias_tensor ? ( float* )get_tensor_mem(bias_tensor) : nullptr;
+    float* bias_new = AddBnBias(graph, ConvNode, bias_tensor, channel_num);
+
+    SetBnBias(bias_new, bias, scale, shift);
 
-    if (NULL != gamma)
-    {
-        for (int c = 0; c < channel_num; c++)
-        {
-            scale_var_inv[c] = gamma[c] * scale_var_inv[c];
-            scale_mean[c] = gamma[c] * scale_mean[c];
-        }
-    }
-    if (NULL != beta)
-    {
-        for (int c = 0; c < channel_num; c++)
-        {
-            scale_mean[c] = scale_mean[c] + beta[c];
-        }
-    }
     if (kernel_shape.GetDataLayout() == TENGINE_LAYOUT_NCHW)
     {
-        for (int g = 0; g < group; g++)
-        {
-            float* kernel = kernel_new + g * output_chan * kernel_size;
-            for (int o_c = 0; o_c < output_chan; o_c++)
-            {
-                float w_scale = scale_var_inv[g * output_chan + o_c];
-                for (int i = 0; i < kernel_size; i++)
-                {
-                    kernel[o_c * kernel_size + i] = kernel[o_c * kernel_size + i] * w_scale;
-                }
-            }
-        }
+        /* the kernel of group g, output o_c is row g * output_chan + o_c */
+        ScaleRows(kernel_orig, kernel_new, scale.data(), channel_num, kernel_size);
     }
     else
     {
-        for (int o_c = 0; o_c < output_chan; o_c++)
-        {
-            for (int k_h = 0; k_h < kernel_y; ++k_h)
+        /* [output_chan][kernel_y][kernel_x][group][input_chan] */
+        ParallelRun(output_chan, [&](int o_c) {
+            size_t offset = ( size_t )o_c * group * kernel_size;
+            const float* src = kernel_orig + offset;
+            float* dst = kernel_new + offset;
+
+            for (int k = 0; k < kernel_y * kernel_x; k++)
             {
-                for (int k_w = 0; k_w < kernel_x; ++k_w)
+                for (int g = 0; g < group; g++)
                 {
-                    for (int g = 0; g < group; ++g)
-                    {
-                        float w_scale = scale_var_inv[g * output_chan + o_c];
-                        for (int i_c = 0; i_c < input_chan; ++i_c)
-                        {
-                            int weight_idx = o_c * group * kernel_size + k_h * kernel_x * input_chan * group +
-                                             k_w * input_chan * group + g * input_chan + i_c;
-                            kernel_new[weight_idx] = kernel_new[weight_idx] * w_scale;
-                        }
-                    }
+                    float w_scale = scale[g * output_chan + o_c];
+
+                    for (int i_c = 0; i_c < input_chan; i_c++)
+                        dst[i_c] = src[i_c] * w_scale;
+
+                    src += input_chan;
+                    dst += input_chan;
                 }
             }
-        }
+        });
     }
-    float* bias_tmp = ( float* )get_tensor_mem(ConvNode->GetInputTensor(2));
-
-    for (int i = 0; i < channel_num; i++)
-    {
-        bias_tmp[i] = scale_mean[i];
-    }
-
-    free(scale_var_inv);
-    free(scale_mean);
 
     return true;
 }
 
-static bool Fc_Weight_Bn(Subgraph* graph, Node* FcNode, float* mean, float* var, float* gamma, float* beta, float eps,
-                         float rescale_factor, Tensor* bias_tensor)
+static bool Fc_Weight_Bn(Subgraph* graph, Node* FcNode, const std::vector<float>& scale,
+                         const std::vector<float>& shift, Tensor* bias_tensor)
 {
     Tensor* kernel_tensor = FcNode->GetInputTensor(1);
-    FullyConnected* fc_op = dynamic_cast<FullyConnected*>(FcNode->GetOp());
-    FCParam* param = fc_op->GetParam();
     const TShape& kernel_shape = kernel_tensor->GetShape();
 
-    int output_chan = param->num_output;
-    float* kernel_org = ( float* )get_tensor_mem(kernel_tensor);
-
     int channel_num = kernel_shape.Shape(0);
-    int totalSize = kernel_shape.Shape(1);
-    int kernel_size = totalSize;
-    float* kernel_new = ( float* )(malloc(channel_num * kernel_size * sizeof(float) + 128));
-    memcpy(kernel_new, kernel_org, sizeof(float) * channel_num * kernel_size + 128);
-    
-    kernel_tensor->SetMemAddr(kernel_new);
-    kernel_tensor->SetAttr("free_mem", 1);
+    int kernel_size = kernel_shape.Shape(1);
+    bool nchw = kernel_shape.GetDataLayout() == TENGINE_LAYOUT_NCHW;
 
-    float* scale_mean = ( float* )malloc(channel_num * sizeof(float));
-    float* scale_var_inv = ( float* )malloc(channel_num * sizeof(float));
+    /* every row is rewritten in the NCHW case */
+    const float* kernel_orig = ( const float* )kernel_tensor->GetMemAddr();
+    float* kernel_new = ( float* )kernel_tensor->GetWritableMemAddr(!nchw);
 
-    float rescale_factor_tmp = rescale_factor;
+    float* bias = bias_tensor ? ( float* )get_tensor_mem(bias_tensor) : nullptr;
+    float* bias_new = AddBnBias(graph, FcNode, bias_tensor, channel_num);
 
-    // fuse the bias;
-    float* bias = NULL;
-    std::string bias_name;
-    if (bias_tensor)
-    {
-        bias = ( float* )get_tensor_mem(bias_tensor);
-        bias_name = bias_tensor->GetName() + ".bn";
-    }
-    else
-    {
-        bias_name = FcNode->GetName() + ".bias.bn";
-    }
+    SetBnBias(bias_new, bias, scale, shift);
 
-    /*
-     *  create the bias node,,, ugly code..
-     *
-     */
+    if (nchw)
+        ScaleRows(kernel_orig, kernel_new, scale.data(), channel_num, kernel_size);
 
-    {
-        Tensor* new_bias_tensor = new Tensor(bias_name);
-        std::vector<int> dims{channel_num};
+    return true;
+}
 
-        TShape bias_shape;
-        bias_shape.SetDim(dims);
+/* a Scale node over the channels: gamma[c], and beta[c] when bias_term is set */
+static bool IsChannelScale(Node* node)
+{
+    ScaleParam* param = dynamic_cast<Scale*>(node->GetOp())->GetParam();
 
-        new_bias_tensor->Reshape(bias_shape);
-        new_bias_tensor->SetType(kConstTensor);
+    return param->axis == 1 && param->num_axes == 1 && node->GetInputNum() >= 2;
+}
 
-        void* bias_new = ( void* )malloc(channel_num * sizeof(float) + 128);
+/* the FP32 const at port of node, holding one value per channel */
+static const float* GetChannelData(Node* node, unsigned int port, int channel_num)
+{
+    if (port >= node->GetInputNum())
+        return nullptr;
 
-        new_bias_tensor->SetMemAddr(bias_new);
+    Tensor* tensor = node->GetInputTensor(port);
 
-        AddConstNodeToSubGraph(graph, new_bias_tensor, FcNode, 2);
+    if (tensor->GetType() != kConstTensor || tensor->GetDataType() != TENGINE_DT_FP32 ||
+        tensor->GetShape().GetSize() != channel_num)
+        return nullptr;
 
-        delete new_bias_tensor;
+    return ( const float* )tensor->GetMemAddr();
+}
 
-        // set the free flag
-        new_bias_tensor = FcNode->GetInputTensor(2);
-        new_bias_tensor->SetAttr("free_mem", 1);
-    }
-    rescale_factor_tmp = rescale_factor_tmp ? 1 / rescale_factor_tmp : 0;
+const std::vector<std::string>& GetElementwiseOps(void)
+{
+    static const std::vector<std::string> elementwise_ops = {
+        "ReLu", "ReLu6", "ReLU1", "Sigmoid", "Tanh", "Logistic", "Elu", "Selu", "Mish",
+        "Softplus", "HardSwish", "Hardsigmoid", "Clip", "Absval", "Floor", "Ceil", "Round",
+        "Reciprocal", "Threshold", "Power", "Cast", "Unary", "Dropout", "Noop", "Eltwise"};
 
-    if (NULL == bias)
-    {
-        for (int c = 0; c < channel_num; c++)
-        {
-            scale_var_inv[c] = 1.f / sqrt(var[c] * rescale_factor_tmp + eps);
-            scale_mean[c] = -mean[c] * rescale_factor_tmp * scale_var_inv[c];
-            
-        }
-    }
-    else
-    {
-        for (int c = 0; c < channel_num; c++)
-        {
-            
-            scale_var_inv[c] = 1.f / sqrt(var[c] * rescale_factor_tmp + eps);
-            scale_mean[c] = (bias[c] - mean[c] * rescale_factor_tmp) * scale_var_inv[c];
-        }
-    }
+    return elementwise_ops;
+}
 
-    if (NULL != gamma)
-    {
-        for (int c = 0; c < channel_num; c++)
-        {
-            scale_var_inv[c] = gamma[c] * scale_var_inv[c];
-            scale_mean[c] = gamma[c] * scale_mean[c];
-        }
-    }
-    if (NULL != beta)
+/* y[c] = x[c] * scale[c] + shift[c], for a BatchNormalization or a channel Scale node */
+bool GetChannelAffine(Node* node, int channel_num, std::vector<float>& scale, std::vector<float>& shift)
+{
+    scale.resize(channel_num);
+    shift.resize(channel_num);
+
+    if (node->GetOp()->GetName() == "Scale")
     {
+        ScaleParam* param = dynamic_cast<Scale*>(node->GetOp())->GetParam();
+        const float* gamma = GetChannelData(node, 1, channel_num);
+        const float* beta = param->bias_term ? GetChannelData(node, 2, channel_num) : nullptr;
+
+        if (!IsChannelScale(node) || gamma == nullptr || (param->bias_term && beta == nullptr))
+            return false;
+
         for (int c = 0; c < channel_num; c++)
         {
-            scale_mean[c] = scale_mean[c] + beta[c];
-        }
-    }
-    if (kernel_shape.GetDataLayout() == TENGINE_LAYOUT_NCHW)
-    {
-        for (int o_c = 0; o_c < output_chan; o_c++)
-        {
-            float w_scale = scale_var_inv[o_c];
-            for (int i = 0; i < kernel_size; i++)
-            {
-                kernel_new[o_c * kernel_size + i] = kernel_new[o_c * kernel_size + i] * w_scale ;
-        
-            }
+            scale[c] = gamma[c];
+            shift[c] = beta ? beta[c] : 0.f;
         }
+
+        return true;
     }
 
-    float* bias_tmp = ( float* )get_tensor_mem(FcNode->GetInputTensor(2));
+    BatchNormParam* param = dynamic_cast<BatchNorm*>(node->GetOp())->GetParam();
+    const float* mean = GetChannelData(node, 3, channel_num);
+    const float* var = GetChannelData(node, 4, channel_num);
+    const float* gamma = nullptr;
+    const float* beta = nullptr;
 
-    for (int i = 0; i < channel_num; i++)
+    if (mean == nullptr || var == nullptr)
+        return false;
+
+    if (!param->caffe_flavor)
     {
-        bias_tmp[i] = scale_mean[i];
-        // printf("%f \n",bias_tmp[i] );
+        gamma = GetChannelData(node, 1, channel_num);
+        beta = GetChannelData(node, 2, channel_num);
+
+        if (gamma == nullptr || beta == nullptr)
+            return false;
     }
 
-    free(scale_var_inv);
-    free(scale_mean);
+    GetBnScale(channel_num, mean, var, gamma, beta, param->eps, param->rescale_factor, scale.data(), shift.data());
+
     return true;
 }
 
@@ -339,6 +327,10 @@ static void AddConstNodeToSubGraph(Subgraph* graph, Tensor* tensor, Node* fused_
     //   if(new_tensor_name.rfind(".fused")==std::string::npos)
     new_tensor_name += ".fused";
 
+    /* a shared const is copied once per fused node */
+    if (tensor->consumer.size() > 1)
+        new_tensor_name += "." + fused_node->GetName();
+
     new_tensor->SetName(new_tensor_name);
 
     Node* new_node = new Node(new_tensor->GetName());
@@ -351,744 +343,680 @@ static void AddConstNodeToSubGraph(Subgraph* graph, Tensor* tensor, Node* fused_
     fused_node->AddInputTensor(new_tensor);
     new_tensor->consumer.clear();
     new_tensor->consumer.push_back(fused_node->GetInputPort(fused_port_index));
-    graph->seq_nodes.push_back(new_node);
-    graph->SetNodeOwner(new_node);
+    graph->AddNode(new_node);
     graph->SetTensorOwner(new_tensor);
 
-    if (tensor->ExistAttr("free_mem"))
-        tensor->RemoveAttr("free_mem");
-
     // return new_tensor;
 }
 
-static bool GraphFuseBNScale(Graph* graph, GraphOptimizer* opt)
+static bool HasConsumerOutside(Subgraph* orig, Tensor* tensor)
 {
-    int node_number = graph->seq_nodes.size();
-    std::vector<Subgraph*> orig_sub;
-    // printf("BNScale \n");
-    /*get all bn_scale chain*/
-    for (int i = 0; i < node_number; i++)
+    for (auto port : tensor->consumer)
     {
-        Node* Scale_node = graph->seq_nodes[i];
-        Operator* op = Scale_node->GetOp();
-
-        if (op->GetName() != "Scale")
-            continue;
+        if (std::find(orig->seq_nodes.begin(), orig->seq_nodes.end(), port->owner) == orig->seq_nodes.end())
+            return true;
+    }
 
-        /*Check if it is a bn-->Scale*/
-        Tensor* input_tensor;
-        Node* Bn_node;
+    return false;
+}
 
-        input_tensor = Scale_node->GetInputTensor(0);
-        Bn_node = input_tensor->producer->owner;
-        op = Bn_node->GetOp();
+/* the const inputs of node go away together with it, unless another node still reads them */
+static void AddConstProducers(Subgraph* orig, Node* node, unsigned int first_port = 1)
+{
+    for (unsigned int i = first_port; i < node->GetInputNum(); i++)
+    {
+        Tensor* tensor = node->GetInputTensor(i);
 
-        if (op->GetName() != "BatchNormalization")
+        if (tensor->GetType() != kConstTensor || tensor->producer == nullptr || HasConsumerOutside(orig, tensor))
             continue;
 
-        /*Create a subgrah represent the chain*/
-        Subgraph* sub = new Subgraph("BnScale_chain");
+        Node* const_node = tensor->producer->owner;
 
-        sub->seq_nodes.push_back(Bn_node);
-        sub->seq_nodes.push_back(Scale_node);
+        if (std::find(orig->seq_nodes.begin(), orig->seq_nodes.end(), const_node) == orig->seq_nodes.end())
+            orig->seq_nodes.push_back(const_node);
+    }
+}
 
-        sub->input_nodes.push_back(Bn_node);
-        sub->output_nodes.push_back(Scale_node);
+static bool FuseBNScale(Graph* graph, const std::vector<Node*>& match, Subgraph* orig, Subgraph* fused)
+{
+    Node* Scale_node = match[0];
+    Node* Bn_node = match[1];
 
-        /* add const node into seq nodes */
-        for (unsigned int i = 1; i < Bn_node->GetInputNum(); i++)
-        {
-            Tensor* tensor = Bn_node->GetInputTensor(i);
-            sub->seq_nodes.push_back(tensor->producer->owner);
-        }
+    orig->seq_nodes.push_back(Bn_node);
+    orig->seq_nodes.push_back(Scale_node);
 
-        for (unsigned int i = 1; i < Scale_node->GetInputNum(); i++)
-        {
-            Tensor* tensor = Scale_node->GetInputTensor(i);
-            sub->seq_nodes.push_back(tensor->producer->owner);
-        }
-        orig_sub.push_back(sub);
-    }
+    orig->input_nodes.push_back(Bn_node);
+    orig->output_nodes.push_back(Scale_node);
 
-    /*replace the nodes of the grah*/
-    for (unsigned int i = 0; i < orig_sub.size(); i++)
-    {
-        Subgraph fused("fused");
-        Subgraph* orig = orig_sub[i];
+    /* add const node into seq nodes */
+    AddConstProducers(orig, Bn_node);
+    AddConstProducers(orig, Scale_node);
 
-        Node* orig_output = orig->output_nodes[0];
-        Node* orig_input = orig->input_nodes[0];
+    Node* orig_output = orig->output_nodes[0];
+    Node* orig_input = orig->input_nodes[0];
 
-        //std::string node_name = orig_input->GetName() + "-" + orig_output->GetName();
-        std::string node_name = orig_input->GetName();
+    //std::string node_name = orig_input->GetName() + "-" + orig_output->GetName();
+    std::string node_name = orig_input->GetName();
 
-        /*create new Node node*/
-        Node* fused_node = new Node(node_name);
-        Operator* new_bn_op = OpManager::CreateOp("BatchNormalization");
+    /*create new Node node*/
+    Node* fused_node = new Node(node_name);
+    Operator* new_bn_op = OpManager::CreateOp("BatchNormalization");
 
-        fused_node->SetDynamicShape(orig_input->IsDynamicShape());
-        fused_node->MergeAttr(orig_output);
-        fused_node->MergeAttr(orig_input);
-        fused_node->SetOp(new_bn_op);
+    fused_node->SetDynamicShape(orig_input->IsDynamicShape());
+    fused_node->MergeAttr(orig_output);
+    fused_node->MergeAttr(orig_input);
+    fused_node->SetOp(new_bn_op);
 
-        // 1. Add the input tensor and ouput tensor to the fused node
+    // 1. Add the input tensor and ouput tensor to the fused node
 
-        Tensor* output_tensor = orig_output->GetOutputTensor(0);
-        fused_node->AddOutputTensor(output_tensor);
-        Tensor* input_tensor = orig_input->GetInputTensor(0);
-        fused_node->AddInputTensor(input_tensor);
+    Tensor* output_tensor = orig_output->GetOutputTensor(0);
+    fused_node->AddOutputTensor(output_tensor);
+    Tensor* input_tensor = orig_input->GetInputTensor(0);
+    fused_node->AddInputTensor(input_tensor);
 
-        fused.seq_nodes.push_back(fused_node);
-        fused.input_nodes.push_back(fused_node);
-        fused.output_nodes.push_back(fused_node);
-        fused.SetNodeOwner(fused_node);
+    fused->seq_nodes.push_back(fused_node);
+    fused->input_nodes.push_back(fused_node);
+    fused->output_nodes.push_back(fused_node);
+    fused->SetNodeOwner(fused_node);
 
-        // 2. Create the new const nodes
+    // 2. Create the new const nodes
 
-        Node* orig_bn = orig->seq_nodes[0];
-        Node* orig_scale = orig->seq_nodes[1];
+    Node* orig_bn = orig->seq_nodes[0];
+    Node* orig_scale = orig->seq_nodes[1];
 
-        Tensor* orig_gamma = orig_scale->GetInputTensor(1);
-        Tensor* orig_beta = orig_scale->GetInputTensor(2);
-        Tensor* orig_mean = orig_bn->GetInputTensor(3);
-        Tensor* orig_var = orig_bn->GetInputTensor(4);
+    Tensor* orig_gamma = orig_scale->GetInputTensor(1);
+    Tensor* orig_mean = orig_bn->GetInputTensor(3);
+    Tensor* orig_var = orig_bn->GetInputTensor(4);
 
-        /*create the const node and add to the sub graph*/
-        AddConstNodeToSubGraph(&fused, orig_gamma, fused_node, 1);
-        AddConstNodeToSubGraph(&fused, orig_beta, fused_node, 2);
-        AddConstNodeToSubGraph(&fused, orig_mean, fused_node, 3);
-        AddConstNodeToSubGraph(&fused, orig_var, fused_node, 4);
+    /*create the const node and add to the sub graph*/
+    AddConstNodeToSubGraph(fused, orig_gamma, fused_node, 1);
 
-        // 3. Set new Batch Norm
-        BatchNorm* bn_op = dynamic_cast<BatchNorm*>(orig_bn->GetOp());
-        BatchNormParam* param_org = bn_op->GetParam();
-        BatchNormParam* param_new = (( BatchNorm* )new_bn_op)->GetParam();
-        param_new->caffe_flavor = 0;
-        param_new->eps = param_org->eps;
-        param_new->rescale_factor = param_org->rescale_factor;
+    /* a Scale without bias_term has no beta */
+    if (orig_scale->GetInputNum() > 2)
+        AddConstNodeToSubGraph(fused, orig_scale->GetInputTensor(2), fused_node, 2);
+    else
+        AddFloatConst(fused, fused_node, "beta", nullptr, orig_gamma->GetShape().GetSize(), 2);
 
-        graph->Replace(orig, &fused);
-    }
+    AddConstNodeToSubGraph(fused, orig_mean, fused_node, 3);
+    AddConstNodeToSubGraph(fused, orig_var, fused_node, 4);
 
-    /* release orig_sub */
-    for (unsigned int i = 0; i < orig_sub.size(); i++)
-    {
-        Subgraph* orig = orig_sub[i];
-        delete orig;
-    }
+    // 3. Set new Batch Norm
+    BatchNorm* bn_op = dynamic_cast<BatchNorm*>(orig_bn->GetOp());
+    BatchNormParam* param_org = bn_op->GetParam();
+    BatchNormParam* param_new = (( BatchNorm* )new_bn_op)->GetParam();
+    param_new->caffe_flavor = 0;
+    param_new->eps = param_org->eps;
+    param_new->rescale_factor = param_org->rescale_factor;
 
     return true;
 }
 
-static bool GraphFuseRelu6(Graph* graph, GraphOptimizer* opt)
+static void AddBNScaleRules(GraphRewriter& rewriter)
 {
-    int node_number = graph->seq_nodes.size();
-    std::vector<Subgraph*> orig_sub;
+    RewriteRule rule;
 
-    /*get all relu_minimum chain*/
-    for (int i = 0; i < node_number; i++)
-    {
-        Node* min_node = graph->seq_nodes[i];
-        Operator* op = min_node->GetOp();
+    rule.name = "BnScale_chain";
+    rule.pattern = GraphPattern::Chain({"BatchNormalization", "Scale"});
+    rule.pattern.items[0].check = IsChannelScale;
+    rule.pattern.items[1].single_consumer = true;
+    rule.rewrite = FuseBNScale;
 
-        if (op->GetName() != "Eltwise")
-            continue;
+    rewriter.AddRule(rule);
+}
 
-        Eltwise* eltwise_op = dynamic_cast<Eltwise*>(op);
-        EltwiseParam* param = eltwise_op->GetParam();
-        if (param->type != ELT_MIN_SCALAR)
-            continue;    // todo:  verify 6
+static bool FuseRelu6(Graph* graph, const std::vector<Node*>& match, Subgraph* orig, Subgraph* fused)
+{
+    Node* min_node = match[0];
+    Node* relu_node = match[1];
 
-        /*Check if it is a  relu + minimum*/
-        Tensor* input_tensor;
-        Node* relu_node;
+    orig->seq_nodes.push_back(relu_node);
+    orig->seq_nodes.push_back(min_node);
 
-        input_tensor = min_node->GetInputTensor(0);
-        relu_node = input_tensor->producer->owner;
-        op = relu_node->GetOp();
+    orig->input_nodes.push_back(relu_node);
+    orig->output_nodes.push_back(min_node);
 
-        if (op->GetName() != "ReLu")
-            continue;
+    /* add const node into seq nodes */
+    AddConstProducers(orig, relu_node);
+    AddConstProducers(orig, min_node);
 
-        /*Create a subgrah represent the chain*/
-        Subgraph* sub = new Subgraph("relu6_chain");
+    Node* orig_output = orig->output_nodes[0];
+    Node* orig_input = orig->input_nodes[0];
 
-        sub->seq_nodes.push_back(relu_node);
-        sub->seq_nodes.push_back(min_node);
+    std::string node_name = orig_input->GetName();
 
-        sub->input_nodes.push_back(relu_node);
-        sub->output_nodes.push_back(min_node);
+    /*create new Node node*/
+    Node* fused_node = new Node(node_name);
+    Operator* new_bn_op = OpManager::CreateOp("ReLu6");
 
-        /* add const node into seq nodes */
-        for (unsigned int i = 1; i < relu_node->GetInputNum(); i++)
-        {
-            Tensor* tensor = relu_node->GetInputTensor(i);
-            sub->seq_nodes.push_back(tensor->producer->owner);
-        }
+    fused_node->SetDynamicShape(orig_input->IsDynamicShape());
+    fused_node->MergeAttr(orig_output);
+    fused_node->MergeAttr(orig_input);
+    fused_node->SetOp(new_bn_op);
 
-        for (unsigned int i = 1; i < min_node->GetInputNum(); i++)
-        {
-            Tensor* tensor = min_node->GetInputTensor(i);
-            sub->seq_nodes.push_back(tensor->producer->owner);
-        }
-        orig_sub.push_back(sub);
-    }
+    // 1. Add the input tensor and ouput tensor to the fused node
 
-    /*replace the nodes of the grah*/
-    for (unsigned int i = 0; i < orig_sub.size(); i++)
-    {
-        Subgraph fused("fused");
-        Subgraph* orig = orig_sub[i];
+    Tensor* output_tensor = orig_output->GetOutputTensor(0);
+    fused_node->AddOutputTensor(output_tensor);
+    Tensor* input_tensor = orig_input->GetInputTensor(0);
+    fused_node->AddInputTensor(input_tensor);
 
-        Node* orig_output = orig->output_nodes[0];
-        Node* orig_input = orig->input_nodes[0];
+    fused->seq_nodes.push_back(fused_node);
+    fused->input_nodes.push_back(fused_node);
+    fused->output_nodes.push_back(fused_node);
+    fused->SetNodeOwner(fused_node);
 
-        std::string node_name = orig_input->GetName();
+    return true;
+}
 
-        /*create new Node node*/
-        Node* fused_node = new Node(node_name);
-        Operator* new_bn_op = OpManager::CreateOp("ReLu6");
+static void AddRelu6Rules(GraphRewriter& rewriter)
+{
+    RewriteRule rule;
 
-        fused_node->SetDynamicShape(orig_input->IsDynamicShape());
-        fused_node->MergeAttr(orig_output);
-        fused_node->MergeAttr(orig_input);
-        fused_node->SetOp(new_bn_op);
+    /* relu + minimum */
+    rule.name = "relu6_chain";
+    rule.pattern = GraphPattern::Chain({"ReLu", "Eltwise"});
+    rule.pattern.items[0].check = [](Node* node) {
+        Eltwise* eltwise_op = dynamic_cast<Eltwise*>(node->GetOp());
+        EltwiseParam* param = eltwise_op->GetParam();
 
-        // 1. Add the input tensor and ouput tensor to the fused node
+        return param->type == ELT_MIN_SCALAR;    // todo:  verify 6
+    };
+    rule.rewrite = FuseRelu6;
 
-        Tensor* output_tensor = orig_output->GetOutputTensor(0);
-        fused_node->AddOutputTensor(output_tensor);
-        Tensor* input_tensor = orig_input->GetInputTensor(0);
-        fused_node->AddInputTensor(input_tensor);
+    rewriter.AddRule(rule);
+}
 
-        fused.seq_nodes.push_back(fused_node);
-        fused.input_nodes.push_back(fused_node);
-        fused.output_nodes.push_back(fused_node);
-        fused.SetNodeOwner(fused_node);
+/* a conv or fc with no fused activation: what follows it still sees its raw output */
+static bool HasNoActivation(Node* node)
+{
+    Operator* op = node->GetOp();
 
-        // 2. replace
-        graph->Replace(orig, &fused);
-    }
+    if (op->GetName() == "Convolution")
+        return dynamic_cast<Convolution*>(op)->GetParam()->activation == ActNONE;
 
-    /* release orig_sub */
-    for (unsigned int i = 0; i < orig_sub.size(); i++)
-    {
-        Subgraph* orig = orig_sub[i];
-        delete orig;
-    }
-    return true;
+    return dynamic_cast<FullyConnected*>(op)->GetParam()->activation == ActNONE;
 }
 
-static bool GraphFuseConvBN(Graph* graph, GraphOptimizer* opt)
+/* the BatchNormalization or the channel Scale after a conv/fc, as a new weight and bias */
+static bool FuseConvBN(Graph* graph, const std::vector<Node*>& match, Subgraph* orig, Subgraph* fused)
 {
-    int node_number = graph->seq_nodes.size();
-    std::vector<Subgraph*> orig_sub;
-
-    /*get all bn_scale chain*/
-    for (int i = 0; i < node_number; i++)
-    {
-        Node* Bn_node = graph->seq_nodes[i];
-        Operator* op = Bn_node->GetOp();
+    Node* bn_node = match[0];
+    Node* conv_node = match[1];
 
-        if (op->GetName() != "BatchNormalization")
-            continue;
+    bool is_conv = conv_node->GetOp()->GetName() == "Convolution";
+    Tensor* weight = conv_node->GetInputTensor(1);
+    int channel_num = weight->GetShape().Shape(0);
+    Tensor* bias_tensor = conv_node->GetInputNum() > 2 ? conv_node->GetInputTensor(2) : nullptr;
+    std::vector<float> scale;
+    std::vector<float> shift;
 
-        /*Check if it is a Conv-->Bn*/
-        Tensor* input_tensor;
-        Node* Conv_node;
+    if (weight->GetType() != kConstTensor || weight->GetDataType() != TENGINE_DT_FP32)
+        return false;
 
-        input_tensor = Bn_node->GetInputTensor(0);
-        Conv_node = input_tensor->producer->owner;
-        op = Conv_node->GetOp();
+    if (bias_tensor && GetChannelData(conv_node, 2, channel_num) == nullptr)
+        return false;
 
-        if (op->GetName() != "Convolution")
-            continue;
+    if (!GetChannelAffine(bn_node, channel_num, scale, shift))
+        return false;
 
-        /*Create a subgrah represent the chain*/
-        Subgraph* sub = new Subgraph("ConvBn_chain");
+    orig->seq_nodes.push_back(conv_node);
+    orig->seq_nodes.push_back(bn_node);
 
-        sub->seq_nodes.push_back(Conv_node);
-        sub->seq_nodes.push_back(Bn_node);
+    orig->input_nodes.push_back(conv_node);
+    orig->output_nodes.push_back(bn_node);
 
-        sub->input_nodes.push_back(Conv_node);
-        sub->output_nodes.push_back(Bn_node);
+    /* add const node into seq nodes */
+    AddConstProducers(orig, conv_node);
+    AddConstProducers(orig, bn_node);
 
-        /* add const node into seq nodes */
-        for (unsigned int i = 1; i < Conv_node->GetInputNum(); i++)
-        {
-            Tensor* tensor = Conv_node->GetInputTensor(i);
-            sub->seq_nodes.push_back(tensor->producer->owner);
-        }
+    /*create new Node node*/
+    Node* fused_node = new Node(conv_node->GetName());
+    Operator* new_conv_op = OpManager::CreateOp(conv_node->GetOp()->GetName());
 
-        for (unsigned int i = 1; i < Bn_node->GetInputNum(); i++)
-        {
-            Tensor* tensor = Bn_node->GetInputTensor(i);
-            sub->seq_nodes.push_back(tensor->producer->owner);
-        }
-        orig_sub.push_back(sub);
-    }
+    fused_node->SetDynamicShape(conv_node->IsDynamicShape());
+    fused_node->MergeAttr(bn_node);
+    fused_node->MergeAttr(conv_node);
+    fused_node->SetOp(new_conv_op);
 
-    /*replace the nodes of the graph*/
-    for (unsigned int i = 0; i < orig_sub.size(); i++)
-    {
-        Subgraph fused("fused");
-        Subgraph* orig = orig_sub[i];
+    /*copy conv param*/
+    fused_node->SetAttr("Fused.Batch", true);
 
-        Node* orig_output = orig->output_nodes[0];
-        Node* orig_input = orig->input_nodes[0];
+    if (is_conv)
+        *dynamic_cast<Convolution*>(new_conv_op)->GetParam() =
+            *dynamic_cast<Convolution*>(conv_node->GetOp())->GetParam();
+    else
+        *dynamic_cast<FullyConnected*>(new_conv_op)->GetParam() =
+            *dynamic_cast<FullyConnected*>(conv_node->GetOp())->GetParam();
 
-        //std::string node_name = orig_input->GetName() + "-" + orig_output->GetName();
-        std::string node_name = orig_input->GetName();
+    fused_node->AddOutputTensor(bn_node->GetOutputTensor(0));
+    fused_node->AddInputTensor(conv_node->GetInputTensor(0));
 
-        /*create new Node node*/
-        Node* fused_node = new Node(node_name);
-        Operator* new_conv_op = OpManager::CreateOp("Convolution");
+    fused->seq_nodes.push_back(fused_node);
+    fused->input_nodes.push_back(fused_node);
+    fused->output_nodes.push_back(fused_node);
+    fused->SetNodeOwner(fused_node);
 
-        fused_node->SetDynamicShape(orig_input->IsDynamicShape());
-        fused_node->MergeAttr(orig_output);
-        fused_node->MergeAttr(orig_input);
-        fused_node->SetOp(new_conv_op);
+    /* create new const node for convolution */
+    AddConstNodeToSubGraph(fused, weight, fused_node, 1);
 
-        /*copy conv param*/
-        fused_node->SetAttr("Fused.Batch", true);
+    if (is_conv)
+        Weight_Bn(fused, fused_node, scale, shift, bias_tensor);
+    else
+        Fc_Weight_Bn(fused, fused_node, scale, shift, bias_tensor);
 
-        Convolution* fused_op = dynamic_cast<Convolution*>(new_conv_op);
-        ConvParam* fused_param = fused_op->GetParam();
-        Convolution* orig_op = dynamic_cast<Convolution*>(orig_input->GetOp());
-        ConvParam* orig_param = orig_op->GetParam();
-        *fused_param = *orig_param;
+    return true;
+}
 
-        Tensor* output_tensor = orig_output->GetOutputTensor(0);
-        fused_node->AddOutputTensor(output_tensor);
+/* a BatchNormalization, or a channel Scale left by BNScale, after an unactivated conv or fc */
+static void AddLayerBNRule(GraphRewriter& rewriter, const std::string& name, const std::string& layer_op)
+{
+    RewriteRule rule;
 
-        Tensor* input_tensor = orig_input->GetInputTensor(0);
-        fused_node->AddInputTensor(input_tensor);
+    rule.name = name;
+    rule.pattern = GraphPattern::Chain({layer_op, "BatchNormalization"});
+    rule.pattern.items[0].ops.push_back("Scale");
+    rule.pattern.items[1].check = HasNoActivation;
+    rule.rewrite = FuseConvBN;
 
-        fused.seq_nodes.push_back(fused_node);
-        fused.input_nodes.push_back(fused_node);
-        fused.output_nodes.push_back(fused_node);
-        fused.SetNodeOwner(fused_node);
+    rewriter.AddRule(rule);
+}
 
-        /* create new const node for convolution */
-        Tensor* weight = orig_input->GetInputTensor(1);
-        AddConstNodeToSubGraph(&fused, weight, fused_node, 1);
+static void AddConvBNRules(GraphRewriter& rewriter)
+{
+    AddLayerBNRule(rewriter, "ConvBn_chain", "Convolution");
+}
 
-        BatchNorm* bn_op = dynamic_cast<BatchNorm*>(orig_output->GetOp());
-        BatchNormParam* param_org = bn_op->GetParam();
+static void AddFcBnRules(GraphRewriter& rewriter)
+{
+    AddLayerBNRule(rewriter, "FcBn_chain", "FullyConnected");
+}
 
-        Tensor* orig_mean = orig_output->GetInputTensor(3);
-        Tensor* orig_var = orig_output->GetInputTensor(4);
+/*
+ * the weight of Deconvolution is [input_chan][output_chan / group][kernel_h][kernel_w]:
+ * the BN scale goes along the second dim
+ */
+static bool FuseDeconvBN(Graph* graph, const std::vector<Node*>& match, Subgraph* orig, Subgraph* fused)
+{
+    Node* bn_node = match[0];
+    Node* deconv_node = match[1];
 
-        /* cal the scale mean and var */
+    DeconvParam* orig_param = dynamic_cast<Deconvolution*>(deconv_node->GetOp())->GetParam();
+    Tensor* weight = deconv_node->GetInputTensor(1);
+    const std::vector<int>& dims = weight->GetShape().GetDim();
+    int group = orig_param->group;
 
-        float* mean = ( float* )get_tensor_mem(orig_mean);
-        float* var = ( float* )get_tensor_mem(orig_var);
-        float* gamma = NULL;
-        float* beta = NULL;
+    if (graph->GetLayout() != TENGINE_LAYOUT_NCHW || weight->GetType() != kConstTensor ||
+        weight->GetDataType() != TENGINE_DT_FP32 || dims.size() != 4 || group <= 0 || dims[0] % group)
+        return false;
 
-        if (!param_org->caffe_flavor)
-        {
-            Tensor* orig_gamma = orig_output->GetInputTensor(1);
-            Tensor* orig_beta = orig_output->GetInputTensor(2);
-            gamma = ( float* )get_tensor_mem(orig_gamma);
-            beta = ( float* )get_tensor_mem(orig_beta);
-        }
+    int input_chan = dims[0] / group;
+    int output_chan = dims[1];
+    int kernel_size = dims[2] * dims[3];
+    int channel_num = output_chan * group;
+    Tensor* bias_tensor = deconv_node->GetInputNum() > 2 ? deconv_node->GetInputTensor(2) : nullptr;
+    std::vector<float> scale;
+    std::vector<float> shift;
 
-        Tensor* bias_tensor;
+    if (bias_tensor && GetChannelData(deconv_node, 2, channel_num) == nullptr)
+        return false;
 
-        if (orig_input->GetInputNum() > 2)
-            bias_tensor = orig_input->GetInputTensor(2);
-        else
-            bias_tensor = nullptr;
+    if (!GetChannelAffine(bn_node, channel_num, scale, shift))
+        return false;
 
-        Weight_Bn(&fused, fused_node, mean, var, gamma, beta, param_org->eps, param_org->rescale_factor, bias_tensor);
+    orig->seq_nodes.push_back(deconv_node);
+    orig->seq_nodes.push_back(bn_node);
 
-        graph->Replace(orig, &fused);
-    }
+    orig->input_nodes.push_back(deconv_node);
+    orig->output_nodes.push_back(bn_node);
 
-    /* release orig_sub */
-    for (unsigned int i = 0; i < orig_sub.size(); i++)
-    {
-        Subgraph* orig = orig_sub[i];
-        delete orig;
-    }
+    AddConstProducers(orig, deconv_node);
+    AddConstProducers(orig, bn_node);
 
-    return true;
-}
+    Node* fused_node = new Node(deconv_node->GetName());
+    Operator* new_deconv_op = OpManager::CreateOp("Deconvolution");
 
-static bool GraphFusedFcBn(Graph* graph, GraphOptimizer* opt)
-{
-    
-    int node_number = graph->seq_nodes.size();
-    std::vector<Subgraph*> orig_sub;
-    /*get all bn_scale chain*/
-    for (int i = 0; i < node_number; i++)
-    {
-        Node* Bn_node = graph->seq_nodes[i];
-        Operator* op = Bn_node->GetOp();
+    fused_node->SetDynamicShape(deconv_node->IsDynamicShape());
+    fused_node->MergeAttr(bn_node);
+    fused_node->MergeAttr(deconv_node);
+    fused_node->SetOp(new_deconv_op);
+    fused_node->SetAttr("Fused.Batch", true);
 
-        if (op->GetName() != "BatchNormalization")
-            continue;
+    *dynamic_cast<Deconvolution*>(new_deconv_op)->GetParam() = *orig_param;
 
-        /*Check if it is a Conv-->Bn*/
-        Tensor* input_tensor;
-        Node* Fc_node;
+    fused_node->AddOutputTensor(bn_node->GetOutputTensor(0));
+    fused_node->AddInputTensor(deconv_node->GetInputTensor(0));
 
-        input_tensor = Bn_node->GetInputTensor(0);
-        Fc_node = input_tensor->producer->owner;
-        op = Fc_node->GetOp();
+    fused->seq_nodes.push_back(fused_node);
+    fused->input_nodes.push_back(fused_node);
+    fused->output_nodes.push_back(fused_node);
+    fused->SetNodeOwner(fused_node);
 
-        if (op->GetName() != "FullyConnected")
-            continue;
+    AddConstNodeToSubGraph(fused, weight, fused_node, 1);
 
-        /*Create a subgrah represent the chain*/
-        Subgraph* sub = new Subgraph("FcBn_chain");
+    Tensor* kernel_tensor = fused_node->GetInputTensor(1);
+    const float* kernel_orig = ( const float* )kernel_tensor->GetMemAddr();
+    float* kernel_new = ( float* )kernel_tensor->GetWritableMemAddr(false);
+    const float* bias = bias_tensor ? ( const float* )get_tensor_mem(bias_tensor) : nullptr;
+    float* bias_new = AddBnBias(fused, fused_node, bias_tensor, channel_num);
 
-        sub->seq_nodes.push_back(Fc_node);
-        sub->seq_nodes.push_back(Bn_node);
+    SetBnBias(bias_new, bias, scale, shift);
 
-        sub->input_nodes.push_back(Fc_node);
-        sub->output_nodes.push_back(Bn_node);
+    /* input channel i_c of group g feeds the outputs g * output_chan ... (g + 1) * output_chan - 1 */
+    ParallelRun(dims[0], [&](int i_c) {
+        size_t offset = ( size_t )i_c * output_chan * kernel_size;
+        const float* src = kernel_orig + offset;
+        float* dst = kernel_new + offset;
+        const float* w_scale = scale.data() + (i_c / input_chan) * output_chan;
 
-        /* add const node into seq nodes */
-        for (unsigned int i = 1; i < Fc_node->GetInputNum(); i++)
+        for (int o_c = 0; o_c < output_chan; o_c++)
         {
-            Tensor* tensor = Fc_node->GetInputTensor(i);
-            sub->seq_nodes.push_back(tensor->producer->owner);
-        }
+            for (int k = 0; k < kernel_size; k++)
+                dst[k] = src[k] * w_scale[o_c];
 
-        for (unsigned int i = 1; i < Bn_node->GetInputNum(); i++)
-        {
-            Tensor* tensor = Bn_node->GetInputTensor(i);
-            sub->seq_nodes.push_back(tensor->producer->owner);
+            src += kernel_size;
+            dst += kernel_size;
         }
-        orig_sub.push_back(sub);
-    }
+    });
 
-    /*replace the nodes of the graph*/
-    for (unsigned int i = 0; i < orig_sub.size(); i++)
-    {
-        Subgraph fused("fused");
-        Subgraph* orig = orig_sub[i];
+    return true;
+}
 
-        Node* orig_output = orig->output_nodes[0];
-        Node* orig_input = orig->input_nodes[0];
+static void AddDeconvBNRules(GraphRewriter& rewriter)
+{
+    RewriteRule rule;
+
+    rule.name = "DeconvBn_chain";
+    rule.pattern.items.resize(2);
+    rule.pattern.items[0].ops = {"BatchNormalization", "Scale"};
+    rule.pattern.items[0].inputs = {{0, 1}};
+    rule.pattern.items[1].ops = {"Deconvolution"};
+    rule.pattern.items[1].single_consumer = true;
+    rule.pattern.items[1].check = [](Node* node) {
+        return dynamic_cast<Deconvolution*>(node->GetOp())->GetParam()->activation == ActNONE;
+    };
+    rule.rewrite = FuseDeconvBN;
+
+    rewriter.AddRule(rule);
+}
 
-        std::string node_name = orig_input->GetName();
+/*
+ * conv(x * scale + shift) = conv'(x): the weights of input channel c are
+ * multiplied by scale[c] and the bias takes the weight sum times shift[c].
+ * the padded border would see 0 instead of shift[c], so only an unpadded
+ * convolution qualifies.
+ */
+static bool FuseBNConv(Graph* graph, const std::vector<Node*>& match, Subgraph* orig, Subgraph* fused)
+{
+    Node* conv_node = match[0];
+    Node* bn_node = match[1];
 
-        /*create new Node node*/
-        Node* fused_node = new Node(node_name);
-        Operator* new_conv_op = OpManager::CreateOp("FullyConnected");
+    ConvParam* orig_param = dynamic_cast<Convolution*>(conv_node->GetOp())->GetParam();
+    Tensor* weight = conv_node->GetInputTensor(1);
+    const TShape& kernel_shape = weight->GetShape();
+    const std::vector<int>& dims = kernel_shape.GetDim();
+    int group = orig_param->group;
 
-        fused_node->SetDynamicShape(orig_input->IsDynamicShape());
-        fused_node->MergeAttr(orig_output);
-        fused_node->MergeAttr(orig_input);
-        fused_node->SetOp(new_conv_op);
+    if (orig_param->pad_h0 != 0 || orig_param->pad_h1 != 0 || orig_param->pad_w0 != 0 || orig_param->pad_w1 != 0)
+        return false;
 
-        /*copy conv param*/
-        fused_node->SetAttr("Fused.Batch", true);
+    if (graph->GetLayout() != TENGINE_LAYOUT_NCHW || kernel_shape.GetDataLayout() != TENGINE_LAYOUT_NCHW ||
+        weight->GetType() != kConstTensor || weight->GetDataType() != TENGINE_DT_FP32 || dims.size() != 4 ||
+        group <= 0 || dims[0] % group)
+        return false;
 
-        FullyConnected* fused_op = dynamic_cast<FullyConnected*>(new_conv_op);
-        FCParam* fused_param = fused_op->GetParam();
-        FullyConnected* orig_op = dynamic_cast<FullyConnected*>(orig_input->GetOp());
-        FCParam* orig_param = orig_op->GetParam();
-        *fused_param = *orig_param;
+    int output_num = dims[0];
+    int output_chan = output_num / group;
+    int input_chan = dims[1];
+    int kernel_size = dims[2] * dims[3];
+    int channel_num = input_chan * group;
+    Tensor* bias_tensor = conv_node->GetInputNum() > 2 ? conv_node->GetInputTensor(2) : nullptr;
+    std::vector<float> scale;
+    std::vector<float> shift;
 
-        Tensor* output_tensor = orig_output->GetOutputTensor(0);
-        fused_node->AddOutputTensor(output_tensor);
+    if (bias_tensor && GetChannelData(conv_node, 2, output_num) == nullptr)
+        return false;
 
-        Tensor* input_tensor = orig_input->GetInputTensor(0);
-        fused_node->AddInputTensor(input_tensor);
+    if (!GetChannelAffine(bn_node, channel_num, scale, shift))
+        return false;
 
-        fused.seq_nodes.push_back(fused_node);
-        fused.input_nodes.push_back(fused_node);
-        fused.output_nodes.push_back(fused_node);
-        fused.SetNodeOwner(fused_node);
+    orig->seq_nodes.push_back(bn_node);
+    orig->seq_nodes.push_back(conv_node);
 
-        /* create new const node for convolution */
-        Tensor* weight = orig_input->GetInputTensor(1);
-        AddConstNodeToSubGraph(&fused, weight, fused_node, 1);
+    orig->input_nodes.push_back(bn_node);
+    orig->output_nodes.push_back(conv_node);
 
-        BatchNorm* bn_op = dynamic_cast<BatchNorm*>(orig_output->GetOp());
-        BatchNormParam* param_org = bn_op->GetParam();
+    AddConstProducers(orig, bn_node);
+    AddConstProducers(orig, conv_node);
 
-        Tensor* orig_mean = orig_output->GetInputTensor(3);
-        Tensor* orig_var = orig_output->GetInputTensor(4);
+    Node* fused_node = new Node(conv_node->GetName());
+    Operator* new_conv_op = OpManager::CreateOp("Convolution");
 
-        /* cal the scale mean and var */
+    fused_node->SetDynamicShape(conv_node->IsDynamicShape());
+    fused_node->MergeAttr(bn_node);
+    fused_node->MergeAttr(conv_node);
+    fused_node->SetOp(new_conv_op);
+    fused_node->SetAttr("Fused.Batch", true);
 
-        float* mean = ( float* )get_tensor_mem(orig_mean);
-        float* var = ( float* )get_tensor_mem(orig_var);
-        float* gamma = NULL;
-        float* beta = NULL;
-        Tensor* orig_gamma = orig_output->GetInputTensor(1);
-        Tensor* orig_beta = orig_output->GetInputTensor(2);
-        gamma = ( float* )get_tensor_mem(orig_gamma);
-        beta = ( float* )get_tensor_mem(orig_beta);
+    *dynamic_cast<Convolution*>(new_conv_op)->GetParam() = *orig_param;
 
-        Tensor* bias_tensor;
+    fused_node->AddOutputTensor(conv_node->GetOutputTensor(0));
+    fused_node->AddInputTensor(bn_node->GetInputTensor(0));
 
-        if (orig_input->GetInputNum() > 2)
-            bias_tensor = orig_input->GetInputTensor(2);
-        else
-            bias_tensor = nullptr;
+    fused->seq_nodes.push_back(fused_node);
+    fused->input_nodes.push_back(fused_node);
+    fused->output_nodes.push_back(fused_node);
+    fused->SetNodeOwner(fused_node);
 
-        Fc_Weight_Bn(&fused, fused_node, mean, var, gamma, beta, param_org->eps, param_org->rescale_factor,
-                     bias_tensor);
-        graph->Replace(orig, &fused);
-    }
-       
-    /* release orig_sub */
-    for (unsigned int i = 0; i < orig_sub.size(); i++)
-    {
-        Subgraph* orig = orig_sub[i];
-        delete orig;
-    }
+    AddConstNodeToSubGraph(fused, weight, fused_node, 1);
+
+    Tensor* kernel_tensor = fused_node->GetInputTensor(1);
+    const float* kernel_orig = ( const float* )kernel_tensor->GetMemAddr();
+    float* kernel_new = ( float* )kernel_tensor->GetWritableMemAddr(false);
+    const float* bias = bias_tensor ? ( const float* )get_tensor_mem(bias_tensor) : nullptr;
+    float* bias_new = AddBnBias(fused, fused_node, bias_tensor, output_num);
+
+    ParallelRun(output_num, [&](int o_c) {
+        size_t offset = ( size_t )o_c * input_chan * kernel_size;
+        const float* src = kernel_orig + offset;
+        float* dst = kernel_new + offset;
+        int first_chan = (o_c / output_chan) * input_chan;
+        double sum = bias ? bias[o_c] : 0.0;
+
+        for (int i_c = 0; i_c < input_chan; i_c++)
+        {
+            float w_scale = scale[first_chan + i_c];
+            float w_shift = shift[first_chan + i_c];
+
+            for (int k = 0; k < kernel_size; k++)
+            {
+                sum += ( double )src[k] * w_shift;
+                dst[k] = src[k] * w_scale;
+            }
+
+            src += kernel_size;
+            dst += kernel_size;
+        }
+
+        bias_new[o_c] = sum;
+    });
 
     return true;
 }
 
-
-static bool GraphFusedConvUnsqueeze(Graph* graph, GraphOptimizer* opt)
+static void AddBNConvRules(GraphRewriter& rewriter)
 {
-    int node_number = graph->seq_nodes.size();
-    std::vector<Subgraph*> orig_sub;
-    std::vector<int> op_flag;
-    for (int i = 0; i < node_number; i++)
-    {
-        Node* Elt_node = graph->seq_nodes[i];
-        Operator* op = Elt_node->GetOp();
-        if (op->GetName() != "Eltwise")
-            continue;
-        
-        Tensor* input_tensor_0;
-        Tensor* input_tensor_1;
-        Node* Us_node;
-        Node* Conv_node;
-
-        input_tensor_1 = Elt_node->GetInputTensor(0);
-        input_tensor_0 = Elt_node->GetInputTensor(1);
-        if(input_tensor_0 == NULL || input_tensor_1 == NULL)
-            continue;
-        Us_node = input_tensor_0->producer->owner;
-        Conv_node = input_tensor_1->producer->owner;
-        Operator* Us_op = Us_node->GetOp();
-        
-        Operator* Conv_op = Conv_node->GetOp();
-        
-        if ((Us_op->GetName() != "Unsqueeze" && Conv_op->GetName() != "Convolution") || (Us_op->GetName() != "Unsqueeze" && Conv_op->GetName() != "FullyConnected"))
-            continue;
+    RewriteRule rule;
 
-        if(Us_op->GetName() == "Unsqueeze" && Conv_op->GetName() == "Convolution"){
-            op_flag.push_back(1);
-        }
-        if(Us_op->GetName() == "Unsqueeze" && Conv_op->GetName() == "FullyConnected"){
-            op_flag.push_back(2);
-        }
-        /*Create a subgrah represent the chain*/
-        Subgraph* sub = new Subgraph("uns_elt_conv_chain");
+    rule.name = "BnConv_chain";
+    rule.pattern.items.resize(2);
+    rule.pattern.items[0].ops = {"Convolution"};
+    rule.pattern.items[0].inputs = {{0, 1}};
+    rule.pattern.items[1].ops = {"BatchNormalization", "Scale"};
+    rule.pattern.items[1].single_consumer = true;
+    rule.rewrite = FuseBNConv;
 
-        sub->seq_nodes.push_back(Conv_node);
-        sub->seq_nodes.push_back(Us_node);
-        sub->seq_nodes.push_back(Elt_node);
+    rewriter.AddRule(rule);
+}
 
-        sub->input_nodes.push_back(Conv_node);
-        sub->input_nodes.push_back(Us_node);
-        sub->output_nodes.push_back(Elt_node);
+static bool FuseConvUnsqueeze(Graph* graph, const std::vector<Node*>& match, Subgraph* orig, Subgraph* fused)
+{
+    Node* Elt_node = match[0];
+    Node* Conv_node = match[1];
+    Node* Us_node = match[2];
 
-        /* add const node into seq nodes */
-        for (unsigned int i = 1; i < Conv_node->GetInputNum(); i++)
-        {
-            Tensor* tensor = Conv_node->GetInputTensor(i);
-            sub->seq_nodes.push_back(tensor->producer->owner);
-        }
-        for (unsigned int i = 1; i < Elt_node->GetInputNum(); i++)
-        {
-            Tensor* tensor = Elt_node->GetInputTensor(i);
-            sub->seq_nodes.push_back(tensor->producer->owner);
-        }
-        orig_sub.push_back(sub);
-    }
+    int op_flag = Conv_node->GetOp()->GetName() == "Convolution" ? 1 : 2;
 
-    /*replace the nodes of the graph*/
-    for (unsigned int i = 0; i < orig_sub.size(); i++)
-    {
-        Subgraph fused("fused");
-        Subgraph* orig = orig_sub[i];
+    orig->seq_nodes.push_back(Conv_node);
+    orig->seq_nodes.push_back(Us_node);
+    orig->seq_nodes.push_back(Elt_node);
 
-        Node* orig_output = orig->output_nodes[0];
-        Node* orig_input = orig->input_nodes[0];
-        Node* orig_input_1 = orig->input_nodes[1];
+    orig->input_nodes.push_back(Conv_node);
+    orig->input_nodes.push_back(Us_node);
+    orig->output_nodes.push_back(Elt_node);
 
-        std::string node_name = orig_input->GetName();
+    /* add const node into seq nodes */
+    AddConstProducers(orig, Conv_node);
+    AddConstProducers(orig, Elt_node);
 
-        /*create new Node node*/
-        Node* fused_node = new Node(node_name);
-        Operator* new_conv_op = NULL;
-        if(op_flag[i] == 1){
-            new_conv_op = OpManager::CreateOp("Convolution");
-        }
-        if(op_flag[i] == 2){
-            new_conv_op = OpManager::CreateOp("FullyConnected");
-        }
-        fused_node->SetDynamicShape(orig_input->IsDynamicShape());
-        fused_node->MergeAttr(orig_output);
-        fused_node->MergeAttr(orig_input);
-        fused_node->SetOp(new_conv_op);
-        /*copy conv param*/
-        fused_node->SetAttr("Fused.Batch", true);
-        if(op_flag[i] == 1){
-            Convolution* fused_op = dynamic_cast<Convolution*>(new_conv_op);
-            ConvParam* fused_param = fused_op->GetParam();
-            Convolution* orig_op = dynamic_cast<Convolution*>(orig_input->GetOp());
-            ConvParam* orig_param = orig_op->GetParam();
-            *fused_param = *orig_param;
-        }
-        if(op_flag[i] == 2){
-            FullyConnected* fused_op = dynamic_cast<FullyConnected*>(new_conv_op);
-            FCParam* fused_param = fused_op->GetParam();
-            FullyConnected* orig_op = dynamic_cast<FullyConnected*>(orig_input->GetOp());
-            FCParam* orig_param = orig_op->GetParam();
-            *fused_param = *orig_param;
-        }
-        Tensor* output_tensor = orig_output->GetOutputTensor(0);
-        fused_node->AddOutputTensor(output_tensor);
-
-        Tensor* input_tensor = orig_input->GetInputTensor(0);
-        Tensor* input_tensor_1 = orig_input_1->GetInputTensor(0);
-        fused_node->AddInputTensor(input_tensor);
-        fused.seq_nodes.push_back(fused_node);
-        fused.input_nodes.push_back(fused_node);
-        fused.output_nodes.push_back(fused_node);
-        fused.SetNodeOwner(fused_node);
-
-        /* create new const node for convolution */
-        Tensor* weight = orig_input->GetInputTensor(1);
-        AddConstNodeToSubGraph(&fused, weight, fused_node, 1);
-        AddConstNodeToSubGraph(&fused, input_tensor_1, fused_node, 2);
-        graph->Replace(orig, &fused);
+    Node* orig_output = orig->output_nodes[0];
+    Node* orig_input = orig->input_nodes[0];
+    Node* orig_input_1 = orig->input_nodes[1];
+
+    std::string node_name = orig_input->GetName();
+
+    /*create new Node node*/
+    Node* fused_node = new Node(node_name);
+    Operator* new_conv_op = NULL;
+    if(op_flag == 1){
+        new_conv_op = OpManager::CreateOp("Convolution");
     }
-    /* release orig_sub */
-    for (unsigned int i = 0; i < orig_sub.size(); i++)
-    {
-        Subgraph* orig = orig_sub[i];
-        delete orig;
+    if(op_flag == 2){
+        new_conv_op = OpManager::CreateOp("FullyConnected");
+    }
+    fused_node->SetDynamicShape(orig_input->IsDynamicShape());
+    fused_node->MergeAttr(orig_output);
+    fused_node->MergeAttr(orig_input);
+    fused_node->SetOp(new_conv_op);
+    /*copy conv param*/
+    fused_node->SetAttr("Fused.Batch", true);
+    if(op_flag == 1){
+        Convolution* fused_op = dynamic_cast<Convolution*>(new_conv_op);
+        ConvParam* fused_param = fused_op->GetParam();
+        Convolution* orig_op = dynamic_cast<Convolution*>(orig_input->GetOp());
+        ConvParam* orig_param = orig_op->GetParam();
+        *fused_param = *orig_param;
+    }
+    if(op_flag == 2){
+        FullyConnected* fused_op = dynamic_cast<FullyConnected*>(new_conv_op);
+        FCParam* fused_param = fused_op->GetParam();
+        FullyConnected* orig_op = dynamic_cast<FullyConnected*>(orig_input->GetOp());
+        FCParam* orig_param = orig_op->GetParam();
+        *fused_param = *orig_param;
     }
+    Tensor* output_tensor = orig_output->GetOutputTensor(0);
+    fused_node->AddOutputTensor(output_tensor);
+
+    Tensor* input_tensor = orig_input->GetInputTensor(0);
+    Tensor* input_tensor_1 = orig_input_1->GetInputTensor(0);
+    fused_node->AddInputTensor(input_tensor);
+    fused->seq_nodes.push_back(fused_node);
+    fused->input_nodes.push_back(fused_node);
+    fused->output_nodes.push_back(fused_node);
+    fused->SetNodeOwner(fused_node);
+
+    /* create new const node for convolution */
+    Tensor* weight = orig_input->GetInputTensor(1);
+    AddConstNodeToSubGraph(fused, weight, fused_node, 1);
+    AddConstNodeToSubGraph(fused, input_tensor_1, fused_node, 2);
+
     return true;
 }
 
-static bool GraphFusedSigmoidMul(Graph* graph, GraphOptimizer* opt)
+static void AddUnsEltConvRules(GraphRewriter& rewriter)
 {
-    int node_number = graph->seq_nodes.size();
-    std::vector<Subgraph*> orig_sub;
-    std::vector<int> op_flag;
-    for (int i = 0; i < node_number; i++)
-    {
-        Node* Elt_node = graph->seq_nodes[i];
-        Operator* op = Elt_node->GetOp();
-        if (op->GetName() != "Eltwise")
-            continue;
-        
-        Eltwise* elt_op = dynamic_cast<Eltwise*>(op);
-        EltwiseParam* elt_param = elt_op->GetParam();
-        if (elt_param ->type != 0)
-            continue;
-        Node* Sig_node;
-        Tensor* input_tensor_0;
-        Tensor* input_tensor_1;
-        if(Elt_node->GetInputNum() < 2){
-            continue;
-        }
-        input_tensor_0 = Elt_node->GetInputTensor(0);
-        input_tensor_1 = Elt_node->GetInputTensor(1);
-        printf("3\n");
-        if(input_tensor_0 == NULL || input_tensor_1 == NULL){
-            continue;
-        }
-        Node* tmp_node0;
-        Node* tmp_node1;
-
-        tmp_node0 = input_tensor_0->producer->owner;
-        tmp_node1 = input_tensor_1->producer->owner;
+    RewriteRule rule;
+
+    /* Convolution/FullyConnected --> Eltwise <-- Unsqueeze */
+    rule.name = "uns_elt_conv_chain";
+    rule.pattern.items.resize(3);
+    rule.pattern.items[0].ops = {"Eltwise"};
+    rule.pattern.items[0].inputs = {{0, 1}, {1, 2}};
+    rule.pattern.items[1].ops = {"Convolution", "FullyConnected"};
+    rule.pattern.items[1].check = HasNoActivation;
+    rule.pattern.items[2].ops = {"Unsqueeze"};
+    rule.rewrite = FuseConvUnsqueeze;
+
+    rewriter.AddRule(rule);
+}
 
-        Operator* tmp_op0 = tmp_node0->GetOp();
-        Operator* tmp_op1 = tmp_node1->GetOp();
+static bool FuseSigmoidMul(Graph* graph, const std::vector<Node*>& match, Subgraph* orig, Subgraph* fused)
+{
+    Node* Elt_node = match[0];
+    Node* Sig_node = match[1];
 
-        if(tmp_op0 ->GetName() == "Sigmoid"){
-            Sig_node = tmp_node0;
-        }
-        if(tmp_op1 ->GetName() == "Sigmoid"){
-            Sig_node = tmp_node1;
-        }
-        Operator* Sig_op = Sig_node->GetOp();
-        if ((Sig_op->GetName() != "Sigmoid"))
-            continue;
+    orig->seq_nodes.push_back(Sig_node);
+    orig->seq_nodes.push_back(Elt_node);
 
-                
-        /*Create a subgrah represent the chain*/
-        Subgraph* sub = new Subgraph("sigmoid_mul_chain");
+    orig->input_nodes.push_back(Sig_node);
+    orig->output_nodes.push_back(Elt_node);
 
-        sub->seq_nodes.push_back(Sig_node);
-        sub->seq_nodes.push_back(Elt_node);
+    /* add const node into seq nodes */
+    AddConstProducers(orig, Sig_node);
+    AddConstProducers(orig, Elt_node);
 
-        sub->input_nodes.push_back(Sig_node);
-        sub->output_nodes.push_back(Elt_node);
+    Node* orig_output = orig->output_nodes[0];
+    Node* orig_input = orig->input_nodes[0];
 
-        /* add const node into seq nodes */
-        for (unsigned int i = 1; i < Sig_node->GetInputNum(); i++)
-        {
-            Tensor* tensor = Sig_node->GetInputTensor(i);
-            sub->seq_nodes.push_back(tensor->producer->owner);
-        }
-        for (unsigned int i = 1; i < Elt_node->GetInputNum(); i++)
-        {
-            Tensor* tensor = Elt_node->GetInputTensor(i);
-            sub->seq_nodes.push_back(tensor->producer->owner);
-        }
-        orig_sub.push_back(sub);
-    }
-    /*replace the nodes of the graph*/
-    for (unsigned int i = 0; i < orig_sub.size(); i++)
-    {
-        Subgraph fused("fused");
-        Subgraph* orig = orig_sub[i];
+    std::string node_name = orig_input->GetName();
 
-        Node* orig_output = orig->output_nodes[0];
-        Node* orig_input = orig->input_nodes[0];
+    /*create new Node node*/
+    Node* fused_node = new Node(node_name);
+    Operator* new_conv_op = NULL;
+    new_conv_op = OpManager::CreateOp("HardSwish");
 
-        std::string node_name = orig_input->GetName();
+    fused_node->SetDynamicShape(orig_input->IsDynamicShape());
+    fused_node->MergeAttr(orig_output);
+    fused_node->MergeAttr(orig_input);
+    fused_node->SetOp(new_conv_op);
 
-        /*create new Node node*/
-        Node* fused_node = new Node(node_name);
-        Operator* new_conv_op = NULL;
-        new_conv_op = OpManager::CreateOp("HardSwish");
+    Tensor* output_tensor = orig_output->GetOutputTensor(0);
+    fused_node->AddOutputTensor(output_tensor);
 
-        fused_node->SetDynamicShape(orig_input->IsDynamicShape());
-        fused_node->MergeAttr(orig_output);
-        fused_node->MergeAttr(orig_input);
-        fused_node->SetOp(new_conv_op);
+    Tensor* input_tensor = orig_input->GetInputTensor(0);
+    fused_node->AddInputTensor(input_tensor);
+    fused->seq_nodes.push_back(fused_node);
+    fused->input_nodes.push_back(fused_node);
+    fused->output_nodes.push_back(fused_node);
+    fused->SetNodeOwner(fused_node);
 
-        Tensor* output_tensor = orig_output->GetOutputTensor(0);
-        fused_node->AddOutputTensor(output_tensor);
+    return true;
+}
 
-        Tensor* input_tensor = orig_input->GetInputTensor(0);
-        fused_node->AddInputTensor(input_tensor);
-        fused.seq_nodes.push_back(fused_node);
-        fused.input_nodes.push_back(fused_node);
-        fused.output_nodes.push_back(fused_node);
-        fused.SetNodeOwner(fused_node);
+static void AddSigMulRules(GraphRewriter& rewriter)
+{
 
-        /* create new const node for convolution */
-        graph->Replace(orig, &fused);
-    }
-    /* release orig_sub */
-    for (unsigned int i = 0; i < orig_sub.size(); i++)
+    /* the sigmoid may feed either input of the product */
+    for (int port = 0; port < 2; port++)
     {
-        Subgraph* orig = orig_sub[i];
-        delete orig;
+        RewriteRule rule;
+
+        rule.name = "sigmoid_mul_chain";
+        rule.pattern.items.resize(2);
+        rule.pattern.items[0].ops = {"Eltwise"};
+        rule.pattern.items[0].check = [](Node* node) {
+            Eltwise* elt_op = dynamic_cast<Eltwise*>(node->GetOp());
+            EltwiseParam* elt_param = elt_op->GetParam();
+
+            return elt_param->type == 0 && node->GetInputNum() >= 2;
+        };
+        rule.pattern.items[0].inputs = {{port, 1}};
+        rule.pattern.items[1].ops = {"Sigmoid"};
+        rule.rewrite = FuseSigmoidMul;
+
+        rewriter.AddRule(rule);
     }
-    return true;
 }
+
 bool GraphOptimizerManager::RunOpt(const std::string& name, Graph* graph)
 {
     if (!Find(name))
@@ -1104,197 +1032,1600 @@ void GraphOptimizerManager::Init(void)
     // register a few predefined optimizer
 
     GraphOptimizer* opt = new GraphOptimizer();
+    opt->name = "ConstFold";
+    opt->optimizer = graph_opt_t(GraphConstFold);
+    Add(opt->name, opt);
+
+    opt = new GraphOptimizer();
+    opt->name = "Transpose";
+    opt->optimizer = graph_opt_t(GraphOptimizeTranspose);
+    Add(opt->name, opt);
+
+    opt = new GraphOptimizer();
+    opt->name = "CSE";
+    opt->optimizer = graph_opt_t(GraphEliminateCommonSubexpr);
+    Add(opt->name, opt);
+
+    opt = new GraphOptimizer();
+    opt->name = "DCE";
+    opt->optimizer = graph_opt_t(GraphEliminateDeadCode);
+    Add(opt->name, opt);
+
+    opt = new GraphOptimizer();
+    opt->name = "ReshapeFold";
+    opt->optimizer = graph_opt_t(GraphFoldReshape);
+    Add(opt->name, opt);
+
+    opt = new GraphOptimizer();
+    opt->name = "LayoutNCHW";
+    opt->optimizer = graph_opt_t(GraphConvertToNCHW);
+    Add(opt->name, opt);
+
+    opt = new GraphOptimizer();
+    opt->name = "WeightPrepack";
+    opt->optimizer = graph_opt_t(GraphPrepackWeights);
+    opt->args = std::string("gemm4x16");
+    Add(opt->name, opt);
+
+    opt = new GraphOptimizer();
+    opt->name = "MemPlan";
+    opt->optimizer = graph_opt_t(GraphPlanMemory);
+    Add(opt->name, opt);
+
+    opt = new GraphOptimizer();
     opt->name = "BNScale";
-    opt->optimizer = graph_opt_t(GraphFuseBNScale);
+    opt->optimizer = graph_opt_t(GraphRunFusion);
     Add(opt->name, opt);
 
     opt = new GraphOptimizer();
     opt->name = "ConvBN";
-    opt->optimizer = graph_opt_t(GraphFuseConvBN);
+    opt->optimizer = graph_opt_t(GraphRunFusion);
     Add(opt->name, opt);
 
     opt = new GraphOptimizer();
     opt->name = "ConvReLu";
-    opt->optimizer = graph_opt_t(GraphFuseConvReLu);
+    opt->optimizer = graph_opt_t(GraphRunFusion);
     Add(opt->name, opt);
 
     opt = new GraphOptimizer();
     opt->name = "ConvReLu6";
-    opt->optimizer = graph_opt_t(GraphFuseConvReLu6);
+    opt->optimizer = graph_opt_t(GraphRunFusion);
     Add(opt->name, opt);
 
     opt = new GraphOptimizer();
     opt->name = "Relu6";
-    opt->optimizer = graph_opt_t(GraphFuseRelu6);
+    opt->optimizer = graph_opt_t(GraphRunFusion);
     Add(opt->name, opt);
 
     opt = new GraphOptimizer();
     opt->name = "FcBn";
-    opt->optimizer = graph_opt_t(GraphFusedFcBn);
+    opt->optimizer = graph_opt_t(GraphRunFusion);
+    Add(opt->name, opt);
+
+    opt = new GraphOptimizer();
+    opt->name = "DeconvBN";
+    opt->optimizer = graph_opt_t(GraphRunFusion);
+    Add(opt->name, opt);
+
+    opt = new GraphOptimizer();
+    opt->name = "BNConv";
+    opt->optimizer = graph_opt_t(GraphRunFusion);
     Add(opt->name, opt);
 
     opt = new GraphOptimizer();
     opt->name = "UnsEltConv";
-    opt->optimizer = graph_opt_t(GraphFusedConvUnsqueeze);
+    opt->optimizer = graph_opt_t(GraphRunFusion);
     Add(opt->name, opt);
 
     opt = new GraphOptimizer();
     opt->name = "SigMul";
-    opt->optimizer = graph_opt_t(GraphFusedSigmoidMul);
+    opt->optimizer = graph_opt_t(GraphRunFusion);
+    Add(opt->name, opt);
+
+    opt = new GraphOptimizer();
+    opt->name = "PadFuse";
+    opt->optimizer = graph_opt_t(GraphRunFusion);
+    Add(opt->name, opt);
+
+    opt = new GraphOptimizer();
+    opt->name = "ConvEltwise";
+    opt->optimizer = graph_opt_t(GraphRunFusion);
+    Add(opt->name, opt);
+
+    opt = new GraphOptimizer();
+    opt->name = "ConvActivation";
+    opt->optimizer = graph_opt_t(GraphRunFusion);
+    Add(opt->name, opt);
+
+    opt = new GraphOptimizer();
+    opt->name = "LayerNormFuse";
+    opt->optimizer = graph_opt_t(GraphRunFusion);
+    Add(opt->name, opt);
+
+    opt = new GraphOptimizer();
+    opt->name = "GeluFuse";
+    opt->optimizer = graph_opt_t(GraphRunFusion);
+    Add(opt->name, opt);
+
+    opt = new GraphOptimizer();
+    opt->name = "AttentionFuse";
+    opt->optimizer = graph_opt_t(GraphRunFusion);
     Add(opt->name, opt);
 }
 
-static bool NodeInGraph(Node* node, Graph* graph)
+/* the graph optimizer: conv_relu */
+static bool FuseConvReLuCommon(Graph* graph, const std::vector<Node*>& match, Subgraph* orig, Subgraph* fused, bool relu6)
 {
-    int number = graph->seq_nodes.size();
+    Node* node = match[0];
+    Node* conv_node = match[1];
+
+    orig->seq_nodes.push_back(conv_node);
+    orig->seq_nodes.push_back(node);
+
+    orig->input_nodes.push_back(conv_node);
+    orig->output_nodes.push_back(node);
+
+    /* add const node into seq nodes,
+    so that they will be removed from origin graph too */
+    AddConstProducers(orig, conv_node);
+
+    Node* orig_output = orig->output_nodes[0];
+    Node* orig_input = orig->input_nodes[0];
+
+    //std::string node_name = orig_input->GetName() + "-" + orig_output->GetName();
+    std::string node_name = orig_input->GetName();
 
-    for (int i = 0; i < number; i++)
+    Node* fused_node = new Node(node_name);
+    Operator* op = OpManager::CreateOp("Convolution");
+
+    fused_node->SetDynamicShape(orig_input->IsDynamicShape());
+
+    fused_node->SetOp(op);
+    fused_node->MergeAttr(orig_input);
+    fused_node->MergeAttr(orig_output);
+
+    Convolution* fused_op = dynamic_cast<Convolution*>(op);
+    ConvParam* fused_param = fused_op->GetParam();
+
+    Convolution* orig_op = dynamic_cast<Convolution*>(orig_input->GetOp());
+    ConvParam* orig_param = orig_op->GetParam();
+
+    *fused_param = *orig_param;
+
+    if (relu6)
+        fused_param->activation = ActRELU6;
+    else
+        fused_param->activation = ActRELU;
+
+    Tensor* output_tensor = orig_output->GetOutputTensor(0);
+    fused_node->AddOutputTensor(output_tensor);
+
+    Tensor* input_tensor = orig_input->GetInputTensor(0);
+    fused_node->AddInputTensor(input_tensor);
+
+    fused->seq_nodes.push_back(fused_node);
+    fused->input_nodes.push_back(fused_node);
+    fused->output_nodes.push_back(fused_node);
+    fused->SetNodeOwner(fused_node);
+
+    /* create new const node for convolution */
+    Tensor* weight = orig_input->GetInputTensor(1);
+    AddConstNodeToSubGraph(fused, weight, fused_node, 1);
+
+    bool has_bias = orig_input->GetInputNum() > 2 ? true : false;
+
+    if (has_bias)
     {
-        if (node == graph->seq_nodes[i])
-            return true;
+        Tensor* orig_bias = orig_input->GetInputTensor(2);
+        AddConstNodeToSubGraph(fused, orig_bias, fused_node, 2);
     }
 
-    return false;
+    return true;
 }
 
-/* the graph optimizer: conv_relu */
-static bool GraphFuseConvReLuCommon(Graph* graph, GraphOptimizer* opt, bool relu6)
+static void AddConvReLuCommonRules(GraphRewriter& rewriter, bool relu6)
 {
-    int node_number = graph->seq_nodes.size();
-    std::vector<Subgraph*> orig_sub;
+    RewriteRule rule;
+
+    rule.name = "conv_relu";
+    rule.pattern = GraphPattern::Chain({"Convolution", relu6 ? "ReLu6" : "ReLu"});
 
-    for (int i = 0; i < node_number; i++)
+    if (!relu6)
     {
-        Node* node = graph->seq_nodes[i];
-        Operator* op = node->GetOp();
+        rule.pattern.items[0].check = [](Node* node) {
+            return dynamic_cast<ReLu*>(node->GetOp())->GetParam()->negative_slope == 0.f;
+        };
+    }
 
-        if (relu6)
-        {
-            if (op->GetName() != "ReLu6")
-                continue;
-        }
-        else
-        {
-            if (op->GetName() != "ReLu")
-                continue;
-            if (op->GetName() == "ReLu" && dynamic_cast<ReLu*>(op)->GetParam()->negative_slope != 0.f)
-            {
-                continue;
-            }
-        }
-        Tensor* input_tensor = node->GetInputTensor(0);
+    // if parents has muti_consumer: not fuse
+    rule.pattern.items[1].single_consumer = true;
 
-        Node* conv_node = input_tensor->producer->owner;
+    /* the fused nodes are revisited: only fuse when the result stays the same */
+    rule.pattern.items[1].check = [relu6](Node* node) {
+        int activation = dynamic_cast<Convolution*>(node->GetOp())->GetParam()->activation;
 
-        op = conv_node->GetOp();
+        return activation == ActNONE || activation == ActRELU || (relu6 && activation == ActRELU6);
+    };
 
-        if (op->GetName() != "Convolution")
-            continue;
+    rule.rewrite = [relu6](Graph* graph, const std::vector<Node*>& match, Subgraph* orig, Subgraph* fused) {
+        return FuseConvReLuCommon(graph, match, orig, fused, relu6);
+    };
 
-        // check if node in seq_nodes
+    rewriter.AddRule(rule);
+}
 
-        if (!NodeInGraph(conv_node, graph))
-            continue;
-        // if parents has muti_consumer: not fuse
-        Tensor* conv_otensor = conv_node->GetOutputTensor(0);
-        if (conv_otensor->consumer.size() > 1)
-            continue;
-        Subgraph* sub = new Subgraph("conv_relu");
+static void AddConvReLuRules(GraphRewriter& rewriter)
+{
+    AddConvReLuCommonRules(rewriter, false);
+}
+static void AddConvReLu6Rules(GraphRewriter& rewriter)
+{
+    AddConvReLuCommonRules(rewriter, true);
+}
 
-        sub->seq_nodes.push_back(conv_node);
-        sub->seq_nodes.push_back(node);
+/* the graph optimizer: pad_conv and pad_pool */
 
-        sub->input_nodes.push_back(conv_node);
-        sub->output_nodes.push_back(node);
+/* the H and W pads of a constant Pad as h0, w0, h1, w1: N and C must be left alone */
+static bool GetSpatialPads(Graph* graph, Node* pad_node, int* pads)
+{
+    PadParam* param = dynamic_cast<Pad*>(pad_node->GetOp())->GetParam();
+    int before[4] = {param->pad_0_h, param->pad_1_h, param->pad_2_h, param->pad_3_h};
+    int after[4] = {param->pad_0_w, param->pad_1_w, param->pad_2_w, param->pad_3_w};
+    int h = 2, w = 3, c = 1;
 
-        /* add const node into seq nodes,
-        so that they will be removed from origin graph too */
+    if (graph->GetLayout() == TENGINE_LAYOUT_NHWC)
+    {
+        h = 1;
+        w = 2;
+        c = 3;
+    }
 
-        for (unsigned int i = 1; i < conv_node->GetInputNum(); i++)
-        {
-            Tensor* tensor = conv_node->GetInputTensor(i);
-            sub->seq_nodes.push_back(tensor->producer->owner);
-        }
+    if (param->mode != 0 || pad_node->GetInputNum() != 1 || pad_node->IsDynamicShape() ||
+        pad_node->GetInputTensor(0)->GetShape().GetDim().size() != 4)
+        return false;
 
-        orig_sub.push_back(sub);
+    for (int i = 0; i < 4; i++)
+    {
+        if (before[i] < 0 || after[i] < 0)
+            return false;
     }
 
-    /* construct new node */
-    for (unsigned int i = 0; i < orig_sub.size(); i++)
-    {
-        Subgraph fused("fused");
-        Subgraph* orig = orig_sub[i];
+    if (before[0] || after[0] || before[c] || after[c])
+        return false;
+
+    pads[0] = before[h];
+    pads[1] = before[w];
+    pads[2] = after[h];
+    pads[3] = after[w];
+
+    return true;
+}
 
-        Node* orig_output = orig->output_nodes[0];
-        Node* orig_input = orig->input_nodes[0];
+static bool AddConvPads(ConvParam* param, float value, const int* pads)
+{
+    /* negative pads are resolved at the shape inference */
+    if (value != 0.f || param->pad_h0 < 0 || param->pad_w0 < 0 || param->pad_h1 < 0 || param->pad_w1 < 0)
+        return false;
 
-        //std::string node_name = orig_input->GetName() + "-" + orig_output->GetName();
-        std::string node_name = orig_input->GetName();
+    param->pad_h0 += pads[0];
+    param->pad_w0 += pads[1];
+    param->pad_h1 += pads[2];
+    param->pad_w1 += pads[3];
 
-        Node* fused_node = new Node(node_name);
-        Operator* op = OpManager::CreateOp("Convolution");
+    return true;
+}
 
-        fused_node->SetDynamicShape(orig_input->IsDynamicShape());
+/* after a ReLu, a zero pad never wins a max */
+static bool IsNonNegative(Tensor* tensor)
+{
+    if (tensor->producer == nullptr)
+        return false;
 
-        fused_node->SetOp(op);
-        fused_node->MergeAttr(orig_input);
-        fused_node->MergeAttr(orig_output);
+    Operator* op = tensor->producer->owner->GetOp();
 
-        Convolution* fused_op = dynamic_cast<Convolution*>(op);
-        ConvParam* fused_param = fused_op->GetParam();
+    if (op->GetName() == "ReLu")
+        return dynamic_cast<ReLu*>(op)->GetParam()->negative_slope == 0.f;
 
-        Convolution* orig_op = dynamic_cast<Convolution*>(orig_input->GetOp());
-        ConvParam* orig_param = orig_op->GetParam();
+    if (op->GetName() == "ReLu6")
+        return true;
 
-        *fused_param = *orig_param;
+    if (op->GetName() == "Convolution")
+    {
+        int activation = dynamic_cast<Convolution*>(op)->GetParam()->activation;
+
+        return activation == ActRELU || activation == ActRELU6;
+    }
+
+    return false;
+}
 
-        if (relu6)
-            fused_param->activation = ActRELU6;
-        else
-            fused_param->activation = ActRELU;
+static bool AddPoolPads(PoolParam* param, Node* pad_node, float value, const int* pads)
+{
+    /* the pooling only keeps pad0, and derives pad1 from the output size */
+    if (param->global || (param->caffe_flavor & ~COUNT_INCLUDE_PAD_MSK) || pads[0] != pads[2] ||
+        pads[1] != pads[3] || pads[0] >= param->kernel_h || pads[1] >= param->kernel_w)
+        return false;
 
-        Tensor* output_tensor = orig_output->GetOutputTensor(0);
-        fused_node->AddOutputTensor(output_tensor);
+    if (param->pad_h0 || param->pad_w0 || param->pad_h1 || param->pad_w1)
+        return false;
 
-        Tensor* input_tensor = orig_input->GetInputTensor(0);
-        fused_node->AddInputTensor(input_tensor);
+    if (param->alg == kPoolAvg)
+    {
+        /* the explicit zeros count in the average */
+        if (value != 0.f)
+            return false;
 
-        fused.seq_nodes.push_back(fused_node);
-        fused.input_nodes.push_back(fused_node);
-        fused.output_nodes.push_back(fused_node);
-        fused.SetNodeOwner(fused_node);
+        param->caffe_flavor |= COUNT_INCLUDE_PAD_MSK;
+    }
+    else if (param->alg == kPoolMax)
+    {
+        if (value > -FLT_MAX && !(value == 0.f && IsNonNegative(pad_node->GetInputTensor(0))))
+            return false;
+    }
+    else
+    {
+        return false;
+    }
 
-        /* create new const node for convolution */
-        Tensor* weight = orig_input->GetInputTensor(1);
-        AddConstNodeToSubGraph(&fused, weight, fused_node, 1);
+    param->pad_h0 = param->pad_h1 = pads[0];
+    param->pad_w0 = param->pad_w1 = pads[1];
 
-        bool has_bias = orig_input->GetInputNum() > 2 ? true : false;
+    return true;
+}
 
-        if (has_bias)
-        {
-            Tensor* orig_bias = orig_input->GetInputTensor(2);
-            AddConstNodeToSubGraph(&fused, orig_bias, fused_node, 2);
-        }
+static bool FusePad(Graph* graph, const std::vector<Node*>& match, Subgraph* orig, Subgraph* fused)
+{
+    Node* node = match[0];
+    Node* pad_node = match[1];
+    float value = dynamic_cast<Pad*>(pad_node->GetOp())->GetParam()->value;
+    int pads[4];
+
+    if (!GetSpatialPads(graph, pad_node, pads))
+        return false;
 
-        graph->Replace(orig, &fused);
+    for (unsigned int i = 1; i < node->GetInputNum(); i++)
+    {
+        if (node->GetInputTensor(i)->GetType() != kConstTensor)
+            return false;
     }
 
-    for (unsigned int i = 0; i < orig_sub.size(); i++)
+    Operator* op = OpManager::CreateOp(node->GetOp()->GetName());
+    bool fusable;
+
+    if (op->GetName() == "Convolution")
+    {
+        ConvParam* param = dynamic_cast<Convolution*>(op)->GetParam();
+
+        *param = *dynamic_cast<Convolution*>(node->GetOp())->GetParam();
+        fusable = AddConvPads(param, value, pads);
+    }
+    else
     {
-        Subgraph* orig = orig_sub[i];
+        PoolParam* param = dynamic_cast<Pooling*>(op)->GetParam();
+
+        *param = *dynamic_cast<Pooling*>(node->GetOp())->GetParam();
+        fusable = AddPoolPads(param, pad_node, value, pads);
+    }
 
-        delete orig;
+    if (!fusable)
+    {
+        delete op;
+        return false;
     }
 
+    orig->seq_nodes.push_back(pad_node);
+    orig->seq_nodes.push_back(node);
+
+    orig->input_nodes.push_back(pad_node);
+    orig->output_nodes.push_back(node);
+
+    AddConstProducers(orig, node);
+
+    Node* fused_node = new Node(node->GetName());
+
+    fused_node->SetDynamicShape(node->IsDynamicShape());
+    fused_node->SetOp(op);
+    fused_node->MergeAttr(pad_node);
+    fused_node->MergeAttr(node);
+
+    fused_node->AddInputTensor(pad_node->GetInputTensor(0));
+    fused_node->AddOutputTensor(node->GetOutputTensor(0));
+
+    fused->seq_nodes.push_back(fused_node);
+    fused->input_nodes.push_back(fused_node);
+    fused->output_nodes.push_back(fused_node);
+    fused->SetNodeOwner(fused_node);
+
+    for (unsigned int i = 1; i < node->GetInputNum(); i++)
+        AddConstNodeToSubGraph(fused, node->GetInputTensor(i), fused_node, i);
+
     return true;
 }
-static bool GraphFuseConvReLu(Graph* graph, GraphOptimizer* opt)
+
+static void AddPadFuseRules(GraphRewriter& rewriter)
+{
+    RewriteRule rule;
+
+    rule.name = "pad_conv";
+    rule.pattern = GraphPattern::Chain({"Pad", "Convolution"});
+    rule.pattern.items[1].single_consumer = true;
+    rule.rewrite = FusePad;
+    rewriter.AddRule(rule);
+
+    rule.name = "pad_pool";
+    rule.pattern = GraphPattern::Chain({"Pad", "Pooling"});
+    rule.pattern.items[1].single_consumer = true;
+    rewriter.AddRule(rule);
+}
+
+/* the graph optimizer: conv_eltwise */
+
+/* a Convolution without activation, whose output only goes to the eltwise */
+static Node* GetResidualConv(Node* eltwise_node, int port)
+{
+    Tensor* tensor = eltwise_node->GetInputTensor(port);
+
+    if (tensor->producer == nullptr || tensor->consumer.size() != 1 || tensor->IsGraphOutput())
+        return nullptr;
+
+    Node* conv_node = tensor->producer->owner;
+
+    if (conv_node->GetOp()->GetName() != "Convolution" || conv_node->IsDynamicShape() ||
+        conv_node->GetOutputNum() != 1)
+        return nullptr;
+
+    if (dynamic_cast<Convolution*>(conv_node->GetOp())->GetParam()->activation != ActNONE)
+        return nullptr;
+
+    for (unsigned int i = 1; i < conv_node->GetInputNum(); i++)
+    {
+        if (conv_node->GetInputTensor(i)->GetType() != kConstTensor)
+            return nullptr;
+    }
+
+    return conv_node;
+}
+
+/* a new FP32 const input of fused_node, filled with data, or zeros without data */
+static void AddFloatConst(Subgraph* graph, Node* fused_node, const std::string& name, const float* data, int num,
+                          int port)
 {
-    return GraphFuseConvReLuCommon(graph, opt, false);
+    Tensor* const_tensor = new Tensor(fused_node->GetName() + "." + name);
+    std::vector<int> dims{num};
+
+    TShape const_shape;
+    const_shape.SetDim(dims);
+
+    const_tensor->Reshape(const_shape);
+    const_tensor->SetType(kConstTensor);
+
+    void* mem = ( void* )malloc(num * sizeof(float) + 128);
+
+    memset(mem, 0, num * sizeof(float) + 128);
+
+    if (data != nullptr)
+        memcpy(mem, data, num * sizeof(float));
+
+    const_tensor->SetMemAddr(mem);
+
+    AddConstNodeToSubGraph(graph, const_tensor, fused_node, port);
+
+    delete const_tensor;
+
+    // set the free flag
+    fused_node->GetInputTensor(port)->SetFreeMem(true);
 }
-static bool GraphFuseConvReLu6(Graph* graph, GraphOptimizer* opt)
+
+static bool FuseConvEltwise(Graph* graph, const std::vector<Node*>& match, Subgraph* orig, Subgraph* fused)
+{
+    Node* eltwise_node = match[0];
+    EltwiseParam* eltwise_param = dynamic_cast<Eltwise*>(eltwise_node->GetOp())->GetParam();
+
+    if (eltwise_param->type != ELT_SUM || eltwise_node->GetInputNum() != 2 || eltwise_node->IsDynamicShape())
+        return false;
+
+    /* no broadcast */
+    const std::vector<int>& dims = eltwise_node->GetInputTensor(0)->GetShape().GetDim();
+
+    if (dims.empty() || dims != eltwise_node->GetInputTensor(1)->GetShape().GetDim())
+        return false;
+
+    Node* conv_node = nullptr;
+    int port;
+
+    for (port = 0; port < 2 && conv_node == nullptr; port++)
+        conv_node = GetResidualConv(eltwise_node, port);
+
+    if (conv_node == nullptr)
+        return false;
+
+    Tensor* addend = eltwise_node->GetInputTensor(2 - port);
+    Tensor* output = conv_node->GetOutputTensor(0);
+
+    /* a const addend is a bias, not a residual */
+    if (addend->GetType() == kConstTensor || addend == output)
+        return false;
+
+    /* the bias input is always there */
+    if (conv_node->GetInputNum() < 3 && output->GetDataType() != TENGINE_DT_FP32)
+        return false;
+
+    orig->seq_nodes.push_back(conv_node);
+    orig->seq_nodes.push_back(eltwise_node);
+
+    orig->input_nodes.push_back(conv_node);
+    orig->output_nodes.push_back(eltwise_node);
+
+    AddConstProducers(orig, conv_node);
+
+    Node* fused_node = new Node(conv_node->GetName());
+    FusedConvEltwise* op = dynamic_cast<FusedConvEltwise*>(OpManager::CreateOp(FusedConvEltwise::class_name));
+    ConvParam* conv_param = dynamic_cast<Convolution*>(conv_node->GetOp())->GetParam();
+
+    *op->GetParam() = *conv_param;
+
+    fused_node->SetOp(op);
+    fused_node->MergeAttr(conv_node);
+    fused_node->MergeAttr(eltwise_node);
+
+    fused_node->AddInputTensor(conv_node->GetInputTensor(0));
+    fused_node->AddOutputTensor(eltwise_node->GetOutputTensor(0));
+
+    fused->seq_nodes.push_back(fused_node);
+    fused->input_nodes.push_back(fused_node);
+    fused->output_nodes.push_back(fused_node);
+    fused->SetNodeOwner(fused_node);
+
+    AddConstNodeToSubGraph(fused, conv_node->GetInputTensor(1), fused_node, 1);
+
+    if (conv_node->GetInputNum() > 2)
+        AddConstNodeToSubGraph(fused, conv_node->GetInputTensor(2), fused_node, 2);
+    else
+        AddFloatConst(fused, fused_node, "bias", nullptr, conv_param->output_channel, 2);
+
+    fused_node->AddInputTensor(addend);
+
+    return true;
+}
+
+/* act(Fused.ConvEltwise) --> Fused.ConvEltwise with the activation */
+static bool FuseConvEltwiseAct(Graph* graph, const std::vector<Node*>& match, Subgraph* orig, Subgraph* fused)
+{
+    Node* act_node = match[0];
+    Node* node = match[1];
+
+    orig->seq_nodes.push_back(node);
+    orig->seq_nodes.push_back(act_node);
+
+    orig->input_nodes.push_back(node);
+    orig->output_nodes.push_back(act_node);
+
+    AddConstProducers(orig, node);
+
+    Node* fused_node = new Node(node->GetName());
+    FusedConvEltwise* op = dynamic_cast<FusedConvEltwise*>(OpManager::CreateOp(FusedConvEltwise::class_name));
+    ConvParam* param = op->GetParam();
+
+    *param = *dynamic_cast<FusedConvEltwise*>(node->GetOp())->GetParam();
+
+    if (act_node->GetOp()->GetName() == "ReLu6")
+        param->activation = ActRELU6;
+    else
+        param->activation = ActRELU;
+
+    fused_node->SetOp(op);
+    fused_node->MergeAttr(node);
+    fused_node->MergeAttr(act_node);
+
+    fused_node->AddInputTensor(node->GetInputTensor(0));
+    fused_node->AddOutputTensor(act_node->GetOutputTensor(0));
+
+    fused->seq_nodes.push_back(fused_node);
+    fused->input_nodes.push_back(fused_node);
+    fused->output_nodes.push_back(fused_node);
+    fused->SetNodeOwner(fused_node);
+
+    AddConstNodeToSubGraph(fused, node->GetInputTensor(1), fused_node, 1);
+    AddConstNodeToSubGraph(fused, node->GetInputTensor(2), fused_node, 2);
+
+    fused_node->AddInputTensor(node->GetInputTensor(3));
+
+    return true;
+}
+
+static void AddConvEltwiseRules(GraphRewriter& rewriter)
+{
+    RewriteRule rule;
+
+    rule.name = "conv_eltwise";
+    rule.pattern.items.resize(1);
+    rule.pattern.items[0].ops = {"Eltwise"};
+    rule.rewrite = FuseConvEltwise;
+    rewriter.AddRule(rule);
+
+    rule.name = "conv_eltwise_relu";
+    rule.pattern = GraphPattern::Chain({FusedConvEltwise::class_name, "ReLu"});
+    rule.pattern.items[0].ops.push_back("ReLu6");
+    rule.pattern.items[0].check = [](Node* node) {
+        if (node->GetOp()->GetName() == "ReLu6")
+            return true;
+
+        return dynamic_cast<ReLu*>(node->GetOp())->GetParam()->negative_slope == 0.f;
+    };
+    rule.pattern.items[1].single_consumer = true;
+    rule.pattern.items[1].check = [](Node* node) {
+        return dynamic_cast<FusedConvEltwise*>(node->GetOp())->GetParam()->activation == ActNONE;
+    };
+    rule.rewrite = FuseConvEltwiseAct;
+    rewriter.AddRule(rule);
+}
+
+/* the graph optimizer: conv_act and fc_act */
+
+/* the ConvParam/FCParam encoding of an activation node */
+static bool GetFusedActivation(Node* node, int& activation, float& alpha, float& beta)
+{
+    Operator* op = node->GetOp();
+    const std::string& name = op->GetName();
+
+    alpha = 0.f;
+    beta = 0.f;
+
+    if (name == "ReLu")
+    {
+        alpha = dynamic_cast<ReLu*>(op)->GetParam()->negative_slope;
+        activation = alpha == 0.f ? ActRELU : ActLEAKY;
+    }
+    else if (name == "ReLu6")
+        activation = ActRELU6;
+    else if (name == "ReLU1")
+        activation = ActRELU1;
+    else if (name == "Clip")
+    {
+        ClipParam* param = dynamic_cast<Clip*>(op)->GetParam();
+
+        if (param->min > param->max)
+            return false;
+
+        alpha = param->min;
+        beta = param->max;
+        activation = ActCLIP;
+
+        /* the kernels know this one best */
+        if (alpha == 0.f && beta == 6.f)
+            activation = ActRELU6;
+    }
+    else if (name == "Elu")
+    {
+        alpha = dynamic_cast<Elu*>(op)->GetParam()->alpha;
+        activation = ActELU;
+    }
+    else if (name == "HardSwish")
+        activation = ActHSWISH;
+    else if (name == "Mish")
+        activation = ActMISH;
+    else if (name == "Sigmoid" || name == "Logistic")
+        activation = ActSIGMOD;
+    else if (name == "Tanh")
+        activation = ActTANH;
+    else if (name == "PReLU")
+        activation = ActPRELU;
+    else
+        return false;
+
+    if (activation == ActRELU || activation == ActRELU6 || activation == ActRELU1)
+        alpha = beta = 0.f;
+
+    return true;
+}
+
+/* the PReLU slopes, one per output channel */
+static bool GetPReLUSlopes(Node* prelu_node, int channel_num, std::vector<float>& slopes)
+{
+    if (prelu_node->GetInputNum() != 2)
+        return false;
+
+    Tensor* tensor = prelu_node->GetInputTensor(1);
+    const float* data = static_cast<const float*>(tensor->GetMemAddr());
+
+    if (tensor->GetType() != kConstTensor || tensor->GetDataType() != TENGINE_DT_FP32 || data == nullptr)
+        return false;
+
+    /* a scalar, or a vector along one axis */
+    const std::vector<int>& dims = tensor->GetShape().GetDim();
+    int slope_num = 1;
+    int axis_num = 0;
+
+    for (unsigned int i = 0; i < dims.size(); i++)
+    {
+        slope_num *= dims[i];
+        axis_num += dims[i] > 1;
+    }
+
+    if (axis_num > 1 || (slope_num != 1 && slope_num != channel_num))
+        return false;
+
+    slopes.resize(channel_num);
+
+    for (int i = 0; i < channel_num; i++)
+        slopes[i] = data[slope_num == 1 ? 0 : i];
+
+    return true;
+}
+
+static bool FuseActivation(Graph* graph, const std::vector<Node*>& match, Subgraph* orig, Subgraph* fused)
+{
+    Node* act_node = match[0];
+    Node* node = match[1];
+    int activation;
+    float alpha;
+    float beta;
+
+    if (!GetFusedActivation(act_node, activation, alpha, beta) || node->GetOutputTensor(0)->IsGraphOutput())
+        return false;
+
+    for (unsigned int i = 1; i < node->GetInputNum(); i++)
+    {
+        if (node->GetInputTensor(i)->GetType() != kConstTensor)
+            return false;
+    }
+
+    Operator* op = OpManager::CreateOp(node->GetOp()->GetName());
+    int channel_num;
+
+    if (op->GetName() == "Convolution")
+    {
+        ConvParam* param = dynamic_cast<Convolution*>(op)->GetParam();
+
+        *param = *dynamic_cast<Convolution*>(node->GetOp())->GetParam();
+        param->activation = activation;
+        param->act_alpha = alpha;
+        param->act_beta = beta;
+        channel_num = param->output_channel;
+    }
+    else
+    {
+        FCParam* param = dynamic_cast<FullyConnected*>(op)->GetParam();
+
+        *param = *dynamic_cast<FullyConnected*>(node->GetOp())->GetParam();
+        param->activation = activation;
+        param->act_alpha = alpha;
+        param->act_beta = beta;
+        channel_num = param->num_output;
+    }
+
+    /* the slopes are after the bias, which may have to be made up */
+    std::vector<float> slopes;
+
+    if (activation == ActPRELU)
+    {
+        if (node->GetOutputTensor(0)->GetDataType() != TENGINE_DT_FP32 ||
+            !GetPReLUSlopes(act_node, channel_num, slopes))
+        {
+            delete op;
+            return false;
+        }
+    }
+
+    orig->seq_nodes.push_back(node);
+    orig->seq_nodes.push_back(act_node);
+
+    orig->input_nodes.push_back(node);
+    orig->output_nodes.push_back(act_node);
+
+    AddConstProducers(orig, node);
+    AddConstProducers(orig, act_node);
+
+    Node* fused_node = new Node(node->GetName());
+
+    fused_node->SetDynamicShape(node->IsDynamicShape());
+    fused_node->SetOp(op);
+    fused_node->MergeAttr(node);
+    fused_node->MergeAttr(act_node);
+
+    fused_node->AddInputTensor(node->GetInputTensor(0));
+    fused_node->AddOutputTensor(act_node->GetOutputTensor(0));
+
+    fused->seq_nodes.push_back(fused_node);
+    fused->input_nodes.push_back(fused_node);
+    fused->output_nodes.push_back(fused_node);
+    fused->SetNodeOwner(fused_node);
+
+    for (unsigned int i = 1; i < node->GetInputNum(); i++)
+        AddConstNodeToSubGraph(fused, node->GetInputTensor(i), fused_node, i);
+
+    if (activation == ActPRELU)
+    {
+        if (node->GetInputNum() < 3)
+            AddFloatConst(fused, fused_node, "bias", nullptr, channel_num, 2);
+
+        AddFloatConst(fused, fused_node, "slope", slopes.data(), channel_num, 3);
+    }
+
+    return true;
+}
+
+static void AddActivationRules(GraphRewriter& rewriter)
+{
+    RewriteRule rule;
+    std::vector<std::string> act_ops = {"ReLu", "ReLu6",   "ReLU1",    "Clip", "Elu",  "HardSwish",
+                                        "Mish", "Sigmoid", "Logistic", "Tanh", "PReLU"};
+
+    rule.name = "conv_act";
+    rule.pattern = GraphPattern::Chain({"Convolution", "ReLu"});
+    rule.pattern.items[0].ops = act_ops;
+    rule.pattern.items[1].single_consumer = true;
+    rule.pattern.items[1].check = [](Node* node) {
+        return dynamic_cast<Convolution*>(node->GetOp())->GetParam()->activation == ActNONE;
+    };
+    rule.rewrite = FuseActivation;
+    rewriter.AddRule(rule);
+
+    rule.name = "fc_act";
+    rule.pattern.items[1].ops = {"FullyConnected"};
+    rule.pattern.items[1].check = [](Node* node) {
+        return dynamic_cast<FullyConnected*>(node->GetOp())->GetParam()->activation == ActNONE;
+    };
+    rewriter.AddRule(rule);
+}
+
+/* the graph optimizer: layer_norm, gelu and attention */
+
+/* a FP32 const holding a single value */
+static bool GetScalarConst(Tensor* tensor, float& value)
+{
+    if (tensor->GetType() != kConstTensor || tensor->GetDataType() != TENGINE_DT_FP32 ||
+        tensor->GetMemAddr() == nullptr || tensor->GetShape().GetSize() > 1)
+        return false;
+
+    value = *( const float* )tensor->GetMemAddr();
+
+    return true;
+}
+
+/* the constants in the exported models are rounded */
+static bool IsNear(float value, float expect)
+{
+    return std::fabs(value - expect) <= 1e-4f * std::fabs(expect);
+}
+
+static Node* GetProducer(Tensor* tensor)
+{
+    return tensor->producer ? tensor->producer->owner : nullptr;
+}
+
+static bool IsEltwise(Node* node, int type, unsigned int input_num)
+{
+    if (node == nullptr || node->GetOp()->GetName() != "Eltwise" || node->GetInputNum() != input_num)
+        return false;
+
+    return dynamic_cast<Eltwise*>(node->GetOp())->GetParam()->type == type;
+}
+
+static bool IsUnary(Node* node, int type)
+{
+    if (node == nullptr || node->GetOp()->GetName() != "Unary")
+        return false;
+
+    return dynamic_cast<Unary*>(node->GetOp())->GetParam()->type == type;
+}
+
+/* a + c or c + a, c being a scalar const: returns a */
+static Tensor* GetScalarAddend(Node* node, float& value)
+{
+    if (!IsEltwise(node, ELT_SUM, 2))
+        return nullptr;
+
+    for (int port = 0; port < 2; port++)
+    {
+        if (GetScalarConst(node->GetInputTensor(1 - port), value))
+            return node->GetInputTensor(port);
+    }
+
+    return nullptr;
+}
+
+static int GetLastDim(Tensor* tensor)
+{
+    const std::vector<int>& dims = tensor->GetShape().GetDim();
+
+    return dims.empty() ? 0 : dims.back();
+}
+
+/* a FP32 const with one value per channel of the last axis: [C] or [1, ..., C] */
+static bool IsChannelConst(Tensor* tensor, int channel_num)
+{
+    if (tensor->GetType() != kConstTensor || tensor->GetDataType() != TENGINE_DT_FP32 ||
+        tensor->GetMemAddr() == nullptr || channel_num <= 0)
+        return false;
+
+    return GetLastDim(tensor) == channel_num && tensor->GetShape().GetSize() == channel_num;
+}
+
+/*
+ * nodes are the matched ones: only root's output may be read by anyone else.
+ * the input nodes, as Replace() wants them, read nothing from inside the match.
+ */
+static bool SetMatch(Subgraph* orig, const std::vector<Node*>& nodes, Node* root)
+{
+    for (auto node : nodes)
+    {
+        if (std::find(orig->seq_nodes.begin(), orig->seq_nodes.end(), node) == orig->seq_nodes.end())
+            orig->seq_nodes.push_back(node);
+    }
+
+    for (auto node : orig->seq_nodes)
+    {
+        if (node == root)
+            continue;
+
+        for (unsigned int i = 0; i < node->GetOutputNum(); i++)
+        {
+            Tensor* tensor = node->GetOutputTensor(i);
+
+            if (tensor->IsGraphOutput() || HasConsumerOutside(orig, tensor))
+                return false;
+        }
+    }
+
+    for (auto node : orig->seq_nodes)
+    {
+        bool outside = true;
+
+        for (unsigned int i = 0; i < node->GetInputNum(); i++)
+        {
+            Tensor* tensor = node->GetInputTensor(i);
+            Node* producer = GetProducer(tensor);
+
+            if (tensor->GetType() != kConstTensor && producer != nullptr &&
+                std::find(orig->seq_nodes.begin(), orig->seq_nodes.end(), producer) != orig->seq_nodes.end())
+                outside = false;
+        }
+
+        if (outside)
+            orig->input_nodes.push_back(node);
+    }
+
+    orig->output_nodes.push_back(root);
+
+    /* the scalars may be read at any port */
+    for (auto node : nodes)
+        AddConstProducers(orig, node, 0);
+
+    return true;
+}
+
+/* the node taking the place of a match, under the root's name */
+static Node* AddFusedNode(Subgraph* fused, Node* root, Operator* op)
+{
+    Node* fused_node = new Node(root->GetName());
+
+    fused_node->SetDynamicShape(root->IsDynamicShape());
+    fused_node->SetOp(op);
+    fused_node->MergeAttr(root);
+    fused_node->AddOutputTensor(root->GetOutputTensor(0));
+
+    fused->seq_nodes.push_back(fused_node);
+    fused->input_nodes.push_back(fused_node);
+    fused->output_nodes.push_back(fused_node);
+    fused->SetNodeOwner(fused_node);
+
+    return fused_node;
+}
+
+static void AddFusedInput(Subgraph* fused, Node* fused_node, Tensor* tensor)
+{
+    if (tensor->GetType() == kConstTensor)
+        AddConstNodeToSubGraph(fused, tensor, fused_node, fused_node->GetInputNum());
+    else
+        fused_node->AddInputTensor(tensor);
+}
+
+/* ReduceMean over the last axis, keeping the dims */
+static bool IsLastAxisMean(Node* node)
+{
+    if (node == nullptr || node->GetOp()->GetName() != "Reduction")
+        return false;
+
+    ReductionParam* param = dynamic_cast<Reduction*>(node->GetOp())->GetParam();
+    int dim_num = node->GetInputTensor(0)->GetShape().GetDim().size();
+
+    if (param->type != 1 || param->keepdim != 1 || param->dim_1 != -2 || param->dim_2 != -2 || param->dim_3 != -2)
+        return false;
+
+    return param->dim_0 == -1 || (dim_num > 0 && param->dim_0 == dim_num - 1);
+}
+
+/* diff^2, as Pow, Mul or Square */
+static bool IsSquareOf(Node* node, Tensor* diff)
+{
+    float value;
+
+    if (node == nullptr || node->GetInputTensor(0) != diff)
+        return false;
+
+    if (IsEltwise(node, ELT_POW, 2))
+        return GetScalarConst(node->GetInputTensor(1), value) && value == 2.0f;
+
+    if (IsEltwise(node, ELT_PROD, 2))
+        return node->GetInputTensor(1) == diff;
+
+    return IsEltwise(node, ELT_SQUARE, 1) || IsUnary(node, UNARY_SQUARE);
+}
+
+/* d / sqrt(mean(d^2) + eps), d = x - mean(x): torch.nn.LayerNorm exported to ONNX */
+static bool FuseLayerNorm(Graph* graph, const std::vector<Node*>& match, Subgraph* orig, Subgraph* fused)
+{
+    Node* div_node = match[0];
+    Node* sub_node = GetProducer(div_node->GetInputTensor(0));
+    Node* sqrt_node = GetProducer(div_node->GetInputTensor(1));
+
+    if (!IsEltwise(sub_node, ELT_SUB, 2) || !(IsEltwise(sqrt_node, ELT_SQRT, 1) || IsUnary(sqrt_node, UNARY_SQRT)))
+        return false;
+
+    Tensor* input = sub_node->GetInputTensor(0);
+    Node* mean_node = GetProducer(sub_node->GetInputTensor(1));
+
+    if (!IsLastAxisMean(mean_node) || mean_node->GetInputTensor(0) != input)
+        return false;
+
+    Node* eps_node = GetProducer(sqrt_node->GetInputTensor(0));
+    float eps;
+    Tensor* var = eps_node ? GetScalarAddend(eps_node, eps) : nullptr;
+    Node* var_node = var ? GetProducer(var) : nullptr;
+
+    if (!IsLastAxisMean(var_node))
+        return false;
+
+    Node* square_node = GetProducer(var_node->GetInputTensor(0));
+
+    if (!IsSquareOf(square_node, sub_node->GetOutputTensor(0)))
+        return false;
+
+    if (!SetMatch(orig, {mean_node, sub_node, square_node, var_node, eps_node, sqrt_node, div_node}, div_node))
+        return false;
+
+    Operator* op = OpManager::CreateOp("LayerNorm");
+    LayerNormParam* param = dynamic_cast<LayerNorm*>(op)->GetParam();
+
+    param->eps = eps;
+    param->axis = -1;
+
+    Node* fused_node = AddFusedNode(fused, div_node, op);
+
+    AddFusedInput(fused, fused_node, input);
+
+    return true;
+}
+
+/*
+ * x * inv + (beta - mean * inv), inv = rsqrt(mean((x - mean)^2) + eps) * gamma:
+ * tf.nn.batch_normalization on tf.nn.moments, as the TF layer norms do it
+ */
+static bool FuseLayerNormMoments(Graph* graph, const std::vector<Node*>& match, Subgraph* orig, Subgraph* fused)
+{
+    Node* add_node = match[0];
+    Node* scale_node = GetProducer(add_node->GetInputTensor(0));
+    Node* shift_node = GetProducer(add_node->GetInputTensor(1));
+
+    if (!IsEltwise(scale_node, ELT_PROD, 2) || !IsEltwise(shift_node, ELT_SUB, 2))
+        return false;
+
+    Tensor* beta = shift_node->GetInputTensor(0);
+    Node* mean_scale_node = GetProducer(shift_node->GetInputTensor(1));
+
+    if (!IsEltwise(mean_scale_node, ELT_PROD, 2))
+        return false;
+
+    /* inv is the factor both products share */
+    Tensor* input = nullptr;
+    Tensor* mean = nullptr;
+    Tensor* inv = nullptr;
+
+    for (int i = 0; i < 4 && inv == nullptr; i++)
+    {
+        if (scale_node->GetInputTensor(i / 2) != mean_scale_node->GetInputTensor(i % 2))
+            continue;
+
+        inv = scale_node->GetInputTensor(i / 2);
+        input = scale_node->GetInputTensor(1 - i / 2);
+        mean = mean_scale_node->GetInputTensor(1 - i % 2);
+    }
+
+    if (inv == nullptr)
+        return false;
+
+    Node* mean_node = GetProducer(mean);
+    Node* gamma_node = GetProducer(inv);
+
+    if (!IsLastAxisMean(mean_node) || mean_node->GetInputTensor(0) != input || !IsEltwise(gamma_node, ELT_PROD, 2))
+        return false;
+
+    int gamma_port = gamma_node->GetInputTensor(0)->GetType() == kConstTensor ? 0 : 1;
+    Tensor* gamma = gamma_node->GetInputTensor(gamma_port);
+    Node* rsqrt_node = GetProducer(gamma_node->GetInputTensor(1 - gamma_port));
+
+    if (!(IsEltwise(rsqrt_node, ELT_RSQRT, 1) || IsUnary(rsqrt_node, UNARY_RSQRT)))
+        return false;
+
+    Node* eps_node = GetProducer(rsqrt_node->GetInputTensor(0));
+    float eps;
+    Tensor* var = eps_node ? GetScalarAddend(eps_node, eps) : nullptr;
+    Node* var_node = var ? GetProducer(var) : nullptr;
+
+    if (!IsLastAxisMean(var_node))
+        return false;
+
+    Node* diff_node = GetProducer(var_node->GetInputTensor(0));
+
+    if (diff_node == nullptr || diff_node->GetOp()->GetName() != "SquaredDifference" || diff_node->GetInputNum() != 2)
+        return false;
+
+    Tensor* diff_a = diff_node->GetInputTensor(0);
+    Tensor* diff_b = diff_node->GetInputTensor(1);
+
+    if (!(diff_a == input && diff_b == mean) && !(diff_a == mean && diff_b == input))
+        return false;
+
+    int channel_num = GetLastDim(input);
+
+    if (!IsChannelConst(gamma, channel_num) || !IsChannelConst(beta, channel_num))
+        return false;
+
+    if (!SetMatch(orig,
+                  {mean_node, diff_node, var_node, eps_node, rsqrt_node, gamma_node, scale_node, mean_scale_node,
+                   shift_node, add_node},
+                  add_node))
+        return false;
+
+    Operator* op = OpManager::CreateOp("LayerNorm");
+    LayerNormParam* param = dynamic_cast<LayerNorm*>(op)->GetParam();
+
+    param->eps = eps;
+    param->axis = -1;
+
+    Node* fused_node = AddFusedNode(fused, add_node, op);
+
+    AddFusedInput(fused, fused_node, input);
+    AddFusedInput(fused, fused_node, gamma);
+    AddFusedInput(fused, fused_node, beta);
+
+    return true;
+}
+
+/* LayerNorm * gamma, then + beta */
+static bool FuseLayerNormAffine(Graph* graph, const std::vector<Node*>& match, Subgraph* orig, Subgraph* fused)
+{
+    Node* eltwise_node = match[0];
+    Node* norm_node = match[1];
+    Tensor* output = norm_node->GetOutputTensor(0);
+    Tensor* other = eltwise_node->GetInputTensor(eltwise_node->GetInputTensor(0) == output ? 1 : 0);
+    int elt_type = norm_node->GetInputNum() == 1 ? ELT_PROD : ELT_SUM;
+
+    if (!IsEltwise(eltwise_node, elt_type, 2) || !IsChannelConst(other, GetLastDim(output)))
+        return false;
+
+    if (!SetMatch(orig, {norm_node, eltwise_node}, eltwise_node))
+        return false;
+
+    Operator* op = OpManager::CreateOp("LayerNorm");
+
+    *dynamic_cast<LayerNorm*>(op)->GetParam() = *dynamic_cast<LayerNorm*>(norm_node->GetOp())->GetParam();
+
+    Node* fused_node = AddFusedNode(fused, eltwise_node, op);
+
+    fused_node->MergeAttr(norm_node);
+
+    for (unsigned int i = 0; i < norm_node->GetInputNum(); i++)
+        AddFusedInput(fused, fused_node, norm_node->GetInputTensor(i));
+
+    AddFusedInput(fused, fused_node, other);
+
+    return true;
+}
+
+static void AddLayerNormRules(GraphRewriter& rewriter)
+{
+    RewriteRule rule;
+
+    rule.name = "layer_norm";
+    rule.pattern.items.resize(1);
+    rule.pattern.items[0].ops = {"Eltwise"};
+    rule.pattern.items[0].check = [](Node* node) { return IsEltwise(node, ELT_DIV, 2); };
+    rule.rewrite = FuseLayerNorm;
+    rewriter.AddRule(rule);
+
+    rule.name = "layer_norm_moments";
+    rule.pattern.items[0].check = [](Node* node) { return IsEltwise(node, ELT_SUM, 2); };
+    rule.rewrite = FuseLayerNormMoments;
+    rewriter.AddRule(rule);
+
+    /* the normalized output may be either input of the Mul/Add */
+    for (int port = 0; port < 2; port++)
+    {
+        rule.name = "layer_norm_affine";
+        rule.pattern.items.resize(2);
+        rule.pattern.items[0].check = nullptr;
+        rule.pattern.items[0].inputs = {{port, 1}};
+        rule.pattern.items[1].ops = {"LayerNorm"};
+        rule.pattern.items[1].single_consumer = true;
+        rule.pattern.items[1].check = [](Node* node) {
+            int axis = dynamic_cast<LayerNorm*>(node->GetOp())->GetParam()->axis;
+            int dim_num = node->GetInputTensor(0)->GetShape().GetDim().size();
+
+            /* gamma and beta come one after the other */
+            return node->GetInputNum() < 3 && (axis == -1 || axis == dim_num - 1);
+        };
+        rule.rewrite = FuseLayerNormAffine;
+        rewriter.AddRule(rule);
+    }
+}
+
+/* coeff * the product of the factors, as a tree of Mul, Div by a const and Pow nodes computes it */
+struct ScaledProduct
+{
+    float coeff = 1.0f;
+    std::vector<Tensor*> factors;
+    std::vector<Node*> nodes;
+};
+
+static void CollectProduct(Tensor* tensor, bool root, ScaledProduct& product)
+{
+    Node* node = GetProducer(tensor);
+    float value;
+
+    if (GetScalarConst(tensor, value))
+    {
+        product.coeff *= value;
+        return;
+    }
+
+    /* a product read by others too is a factor of its own */
+    if (node == nullptr || (!root && (tensor->consumer.size() != 1 || tensor->IsGraphOutput())))
+    {
+        product.factors.push_back(tensor);
+        return;
+    }
+
+    if (IsEltwise(node, ELT_PROD, 2))
+    {
+        product.nodes.push_back(node);
+        CollectProduct(node->GetInputTensor(0), false, product);
+        CollectProduct(node->GetInputTensor(1), false, product);
+    }
+    else if (IsEltwise(node, ELT_DIV, 2) && GetScalarConst(node->GetInputTensor(1), value) && value != 0.0f)
+    {
+        product.nodes.push_back(node);
+        product.coeff /= value;
+        CollectProduct(node->GetInputTensor(0), false, product);
+    }
+    else if (IsEltwise(node, ELT_POW, 2) && GetScalarConst(node->GetInputTensor(1), value) &&
+             (value == 2.0f || value == 3.0f))
+    {
+        product.nodes.push_back(node);
+        product.factors.insert(product.factors.end(), ( int )value, node->GetInputTensor(0));
+    }
+    else
+    {
+        product.factors.push_back(tensor);
+    }
+}
+
+/*
+ * 1 + erf(x / sqrt(2)), or 1 + tanh(sqrt(2 / pi) * (x + 0.044715 * x^3)):
+ * returns the approximate param of Gelu, -1 if tensor is neither
+ */
+static int MatchGeluCdf(Tensor* tensor, Tensor* input, std::vector<Node*>& nodes)
+{
+    Node* add_node = GetProducer(tensor);
+    float one;
+    Tensor* arg = add_node ? GetScalarAddend(add_node, one) : nullptr;
+    Node* func_node = arg ? GetProducer(arg) : nullptr;
+
+    if (func_node == nullptr || one != 1.0f || func_node->GetInputNum() != 1)
+        return -1;
+
+    ScaledProduct product;
+
+    CollectProduct(func_node->GetInputTensor(0), false, product);
+
+    nodes.push_back(add_node);
+    nodes.push_back(func_node);
+    nodes.insert(nodes.end(), product.nodes.begin(), product.nodes.end());
+
+    if (product.factors.size() != 1)
+        return -1;
+
+    if (IsUnary(func_node, UNARY_ERF))
+        return product.factors[0] == input && IsNear(product.coeff, 0.70710678f) ? 0 : -1;
+
+    if (func_node->GetOp()->GetName() != "Tanh" && !IsUnary(func_node, UNARY_TANH))
+        return -1;
+
+    Node* sum_node = GetProducer(product.factors[0]);
+
+    if (!IsNear(product.coeff, 0.79788456f) || !IsEltwise(sum_node, ELT_SUM, 2))
+        return -1;
+
+    nodes.push_back(sum_node);
+
+    for (int port = 0; port < 2; port++)
+    {
+        if (sum_node->GetInputTensor(port) != input)
+            continue;
+
+        ScaledProduct cube;
+
+        CollectProduct(sum_node->GetInputTensor(1 - port), false, cube);
+
+        if (!IsNear(cube.coeff, 0.044715f) || cube.factors != std::vector<Tensor*>(3, input))
+            continue;
+
+        nodes.insert(nodes.end(), cube.nodes.begin(), cube.nodes.end());
+
+        return 1;
+    }
+
+    return -1;
+}
+
+/* 0.5 * x * cdf(x), the factors in any order */
+static bool FuseGelu(Graph* graph, const std::vector<Node*>& match, Subgraph* orig, Subgraph* fused)
+{
+    Node* mul_node = match[0];
+    ScaledProduct product;
+
+    CollectProduct(mul_node->GetOutputTensor(0), true, product);
+
+    if (product.factors.size() != 2 || !IsNear(product.coeff, 0.5f))
+        return false;
+
+    for (int i = 0; i < 2; i++)
+    {
+        Tensor* input = product.factors[i];
+        std::vector<Node*> nodes = product.nodes;
+        int approximate = MatchGeluCdf(product.factors[1 - i], input, nodes);
+
+        if (approximate < 0)
+            continue;
+
+        if (!SetMatch(orig, nodes, mul_node))
+            return false;
+
+        Operator* op = OpManager::CreateOp("Gelu");
+
+        dynamic_cast<Gelu*>(op)->GetParam()->approximate = approximate;
+
+        Node* fused_node = AddFusedNode(fused, mul_node, op);
+
+        AddFusedInput(fused, fused_node, input);
+
+        return true;
+    }
+
+    return false;
+}
+
+static void AddGeluRules(GraphRewriter& rewriter)
+{
+    RewriteRule rule;
+
+    rule.name = "gelu";
+    rule.pattern.items.resize(1);
+    rule.pattern.items[0].ops = {"Eltwise"};
+    rule.pattern.items[0].check = [](Node* node) { return IsEltwise(node, ELT_PROD, 2); };
+    rule.rewrite = FuseGelu;
+
+    rewriter.AddRule(rule);
+}
+
+/* q * k, or the same scaled by a const: returns the MatMul */
+static Node* GetScaledScores(Tensor* tensor, float& scale, std::vector<Node*>& nodes)
+{
+    Node* scale_node = GetProducer(tensor);
+    Node* node = scale_node;
+    float value;
+
+    scale = 1.0f;
+
+    if (IsEltwise(scale_node, ELT_DIV, 2) && GetScalarConst(scale_node->GetInputTensor(1), value) && value != 0.0f)
+    {
+        scale = 1.0f / value;
+        node = GetProducer(scale_node->GetInputTensor(0));
+    }
+    else if (IsEltwise(scale_node, ELT_PROD, 2))
+    {
+        for (int port = 0; port < 2; port++)
+        {
+            if (!GetScalarConst(scale_node->GetInputTensor(1 - port), value))
+                continue;
+
+            scale = value;
+            node = GetProducer(scale_node->GetInputTensor(port));
+            break;
+        }
+    }
+
+    if (node == nullptr || node->GetOp()->GetName() != "MatMul" || node->GetInputNum() != 2)
+        return nullptr;
+
+    if (node != scale_node)
+        nodes.push_back(scale_node);
+
+    nodes.push_back(node);
+
+    return node;
+}
+
+/* a Transpose swapping the last two dims only */
+static bool IsLastDimsSwap(Node* node)
+{
+    if (node == nullptr || node->GetOp()->GetName() != "Transpose")
+        return false;
+
+    const std::vector<int>& perm = dynamic_cast<Transpose*>(node->GetOp())->GetParam()->tr_shape;
+    int dim_num = perm.size();
+
+    if (dim_num < 2 || perm[dim_num - 2] != dim_num - 1 || perm[dim_num - 1] != dim_num - 2)
+        return false;
+
+    for (int i = 0; i < dim_num - 2; i++)
+    {
+        if (perm[i] != i)
+            return false;
+    }
+
+    return true;
+}
+
+/* softmax(q * k * scale + mask) * v: the head split/merge around it is left alone */
+static bool FuseAttention(Graph* graph, const std::vector<Node*>& match, Subgraph* orig, Subgraph* fused)
+{
+    Node* root = match[0];
+    Node* softmax_node = match[1];
+    Tensor* scores = softmax_node->GetInputTensor(0);
+    int dim_num = scores->GetShape().GetDim().size();
+    int axis = dynamic_cast<Softmax*>(softmax_node->GetOp())->GetParam()->axis;
+
+    if (root->GetInputNum() != 2 || (axis != -1 && (dim_num == 0 || axis != dim_num - 1)))
+        return false;
+
+    std::vector<Node*> nodes = {softmax_node, root};
+    Tensor* mask = nullptr;
+    float scale;
+    Node* qk_node = GetScaledScores(scores, scale, nodes);
+    Node* add_node = GetProducer(scores);
+
+    /* the mask is added either way round */
+    if (qk_node == nullptr && IsEltwise(add_node, ELT_SUM, 2))
+    {
+        for (int port = 0; port < 2 && qk_node == nullptr; port++)
+        {
+            qk_node = GetScaledScores(add_node->GetInputTensor(port), scale, nodes);
+            mask = add_node->GetInputTensor(1 - port);
+        }
+
+        nodes.push_back(add_node);
+    }
+
+    if (qk_node == nullptr)
+        return false;
+
+    Tensor* query = qk_node->GetInputTensor(0);
+    Tensor* key = qk_node->GetInputTensor(1);
+    Node* trans_node = GetProducer(key);
+    int transpose_k = 0;
+
+    if (IsLastDimsSwap(trans_node) && key->consumer.size() == 1 && !key->IsGraphOutput())
+    {
+        nodes.push_back(trans_node);
+        key = trans_node->GetInputTensor(0);
+        transpose_k = 1;
+    }
+
+    Operator* op = OpManager::CreateOp("Attention");
+    AttentionParam* param = dynamic_cast<Attention*>(op)->GetParam();
+
+    param->scale = scale;
+    param->transpose_k = transpose_k;
+
+    /* taken only if the fused op agrees on the output shape */
+    Tensor* value = root->GetInputTensor(1);
+    std::vector<TShape> ishape = {query->GetShape(), key->GetShape(), value->GetShape()};
+    std::vector<TShape> oshape(1);
+
+    if (!op->InferShape(ishape, oshape, graph->GetLayout()) ||
+        oshape[0].GetDim() != root->GetOutputTensor(0)->GetShape().GetDim() || !SetMatch(orig, nodes, root))
+    {
+        delete op;
+        return false;
+    }
+
+    Node* fused_node = AddFusedNode(fused, root, op);
+
+    AddFusedInput(fused, fused_node, query);
+    AddFusedInput(fused, fused_node, key);
+    AddFusedInput(fused, fused_node, value);
+
+    if (mask != nullptr)
+        AddFusedInput(fused, fused_node, mask);
+
+    return true;
+}
+
+static void AddAttentionRules(GraphRewriter& rewriter)
+{
+    RewriteRule rule;
+
+    rule.name = "attention";
+    rule.pattern.items.resize(2);
+    rule.pattern.items[0].ops = {"MatMul"};
+    rule.pattern.items[0].inputs = {{0, 1}};
+    rule.pattern.items[1].ops = {"Softmax"};
+    rule.pattern.items[1].single_consumer = true;
+    rule.rewrite = FuseAttention;
+
+    rewriter.AddRule(rule);
+}
+
+/* the fusions, by the name of their optimizer */
+static const std::unordered_map<std::string, std::function<void(GraphRewriter&)>>& GetFusionRules(void)
+{
+    static const std::unordered_map<std::string, std::function<void(GraphRewriter&)>> fusion_rules = {
+        {"BNScale", AddBNScaleRules},
+        {"ConvBN", AddConvBNRules},
+        {"ConvReLu", AddConvReLuRules},
+        {"ConvReLu6", AddConvReLu6Rules},
+        {"Relu6", AddRelu6Rules},
+        {"FcBn", AddFcBnRules},
+        {"DeconvBN", AddDeconvBNRules},
+        {"BNConv", AddBNConvRules},
+        {"UnsEltConv", AddUnsEltConvRules},
+        {"SigMul", AddSigMulRules},
+        {"PadFuse", AddPadFuseRules},
+        {"ConvEltwise", AddConvEltwiseRules},
+        {"ConvActivation", AddActivationRules},
+        {"LayerNormFuse", AddLayerNormRules},
+        {"GeluFuse", AddGeluRules},
+        {"AttentionFuse", AddAttentionRules},
+    };
+
+    return fusion_rules;
+}
+
+int GraphFuse(Graph* graph, const std::vector<std::string>& fusions)
+{
+    const auto& fusion_rules = GetFusionRules();
+    GraphRewriter rewriter;
+
+    for (auto& name : fusions)
+    {
+        auto ir = fusion_rules.find(name);
+
+        if (ir == fusion_rules.end())
+        {
+            XLOG_ERROR() << "unknown fusion: " << name << "\n";
+            continue;
+        }
+
+        ir->second(rewriter);
+    }
+
+    return rewriter.Run(graph);
+}
+
+const std::vector<std::string>& GetFuseGraphAttrs(void)
+{
+    static const std::vector<std::string> fuse_attrs = {GRAPH_ATTR_FUSE_CONV_ELTWISE, GRAPH_ATTR_FUSE_ACTIVATION,
+                                                          GRAPH_ATTR_FUSE_TRANSFORMER};
+
+    return fuse_attrs;
+}
+
+/* a single fusion run on its own, as RunOpt does */
+static bool GraphRunFusion(Graph* graph, GraphOptimizer* opt)
 {
-    return GraphFuseConvReLuCommon(graph, opt, true);
+    return GraphFuse(graph, {opt->name}) >= 0;
 }
 
 }    // namespace TEngine
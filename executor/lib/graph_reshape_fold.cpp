@@ -0,0 +1,242 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2020, Open AI Lab
+ */
+#include <algorithm>
+#include <unordered_set>
+
+#include "node.hpp"
+#include "graph.hpp"
+#include "operator/reshape.hpp"
+#include "graph_optimizer.hpp"
+
+namespace TEngine {
+
+/* the data is kept, only the shape changes */
+static const std::vector<std::string> shape_ops = {"Reshape", "Flatten", "Squeeze", "Unsqueeze", "ExpandDims"};
+
+/* out = in at inference time */
+static const std::vector<std::string> identity_ops = {"Dropout", "Noop", "Copy"};
+
+static bool IsOneOf(Node* node, const std::vector<std::string>& op_list)
+{
+    const std::string& op_name = node->GetOp()->GetName();
+
+    return std::find(op_list.begin(), op_list.end(), op_name) != op_list.end();
+}
+
+static bool IsStaticShape(Tensor* tensor)
+{
+    const std::vector<int>& dims = tensor->GetShape().GetDim();
+
+    if (dims.empty())
+        return false;
+
+    for (auto d : dims)
+    {
+        if (d <= 0)
+            return false;
+    }
+
+    return true;
+}
+
+/* a shape op whose both ends are known, so that it may be skipped or replaced */
+static bool IsFoldableShapeOp(Node* node)
+{
+    if (!IsOneOf(node, shape_ops) || node->IsDynamicShape() || node->GetOutputNum() != 1 ||
+        node->GetInputNum() == 0)
+        return false;
+
+    Tensor* input = node->GetInputTensor(0);
+    Tensor* output = node->GetOutputTensor(0);
+
+    return IsStaticShape(input) && IsStaticShape(output) && input->GetDataType() == output->GetDataType() &&
+           input->GetShape().GetSize() == output->GetShape().GetSize();
+}
+
+/* a node which may go away: nobody outside sees its output */
+static bool CanRemoveNode(Node* node, const std::unordered_set<Node*>& boundary)
+{
+    if (boundary.count(node) || node->GetOutputNum() != 1 || node->GetInputNum() == 0)
+        return false;
+
+    Tensor* input = node->GetInputTensor(0);
+    Tensor* output = node->GetOutputTensor(0);
+
+    return !output->IsGraphOutput() && input->GetDataType() == output->GetDataType();
+}
+
+static void MovePort(NodePort* port, Tensor* tensor)
+{
+    port->tensor->RemoveConsumer(port);
+    port->tensor = tensor;
+    tensor->AddConsumer(port);
+}
+
+/* the consumers of node read src instead */
+static void BypassNode(Node* node, Tensor* src)
+{
+    Tensor* output = node->GetOutputTensor(0);
+
+    for (auto port : output->consumer)
+    {
+        port->tensor = src;
+        src->AddConsumer(port);
+    }
+
+    output->consumer.clear();
+}
+
+/* the shape ops and the identity ops left without consumers once their readers were rewired */
+static void RemoveDeadChain(Graph* graph, Tensor* tensor, const std::unordered_set<Node*>& boundary,
+                            std::unordered_set<Node*>& removed)
+{
+    while (tensor->producer && tensor->consumer.empty() && !tensor->IsGraphOutput())
+    {
+        Node* node = tensor->producer->owner;
+
+        if (!IsOneOf(node, shape_ops) && !IsOneOf(node, identity_ops))
+            return;
+
+        if (!CanRemoveNode(node, boundary))
+            return;
+
+        tensor = node->GetInputTensor(0);
+
+        graph->RemoveNode(node, false);
+        removed.insert(node);
+    }
+}
+
+/* Reshape with the resolved target shape, taken only if its own shape inference agrees */
+static bool ConvertToReshape(Graph* graph, Node* node, Tensor* src)
+{
+    const std::vector<int>& out_dims = node->GetOutputTensor(0)->GetShape().GetDim();
+
+    Operator* op = OpManager::CreateOp("Reshape");
+
+    if (op == nullptr)
+        return false;
+
+    ReshapeParam* param = dynamic_cast<Reshape*>(op)->GetParam();
+
+    param->re_shape = out_dims;
+    param->reverse = false;
+    param->is_mxnet = false;
+    param->is_onnx = false;
+    param->dim_size = out_dims.size();
+
+    std::vector<TShape> ishape = {src->GetShape()};
+    std::vector<TShape> oshape(1);
+
+    if (!op->InferShape(ishape, oshape, graph->GetLayout()) || oshape[0].GetDim() != out_dims)
+    {
+        delete op;
+        return false;
+    }
+
+    /* the shape tensor or the axes of the original op are no longer read */
+    for (int i = node->GetInputNum() - 1; i > 0; i--)
+    {
+        NodePort* port = node->GetInputPort(i);
+
+        port->tensor->RemoveConsumer(port);
+        node->RemoveInputPort(i);
+    }
+
+    MovePort(node->GetInputPort(0), src);
+    node->SetOp(op);
+
+    return true;
+}
+
+/*
+ * Dropout, Noop and Copy are skipped, and so is a shape op keeping the shape.
+ * a chain of shape ops is read from its head by the last op, which becomes a
+ * single Reshape; the ops in between go away once nothing else reads them.
+ */
+bool GraphFoldReshape(Graph* graph, GraphOptimizer* opt)
+{
+    std::unordered_set<Node*> boundary(graph->input_nodes.begin(), graph->input_nodes.end());
+    boundary.insert(graph->output_nodes.begin(), graph->output_nodes.end());
+
+    std::unordered_set<Node*> removed;
+
+    /* topological order: the producers of a chain are done before its tail */
+    std::vector<Node*> node_list = graph->seq_nodes;
+    int fold_number = 0;
+
+    for (auto node : node_list)
+    {
+        if (removed.count(node))
+            continue;
+
+        if (IsOneOf(node, identity_ops))
+        {
+            if (!CanRemoveNode(node, boundary))
+                continue;
+
+            Tensor* input = node->GetInputTensor(0);
+
+            BypassNode(node, input);
+            graph->RemoveNode(node, false);
+            removed.insert(node);
+
+            RemoveDeadChain(graph, input, boundary, removed);
+
+            fold_number++;
+            continue;
+        }
+
+        if (!IsFoldableShapeOp(node))
+            continue;
+
+        Tensor* input = node->GetInputTensor(0);
+        Tensor* src = input;
+
+        while (src->producer && IsFoldableShapeOp(src->producer->owner))
+            src = src->producer->owner->GetInputTensor(0);
+
+        if (src->GetShape().GetDim() == node->GetOutputTensor(0)->GetShape().GetDim() &&
+            CanRemoveNode(node, boundary))
+        {
+            BypassNode(node, src);
+            graph->RemoveNode(node, false);
+            removed.insert(node);
+        }
+        else if (src == input || !ConvertToReshape(graph, node, src))
+        {
+            continue;
+        }
+
+        RemoveDeadChain(graph, input, boundary, removed);
+
+        fold_number++;
+    }
+
+    if (fold_number > 0)
+        graph->SanitizeGraph();
+
+    return true;
+}
+
+}    // namespace TEngine
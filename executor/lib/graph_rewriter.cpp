@@ -0,0 +1,262 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2020, Open AI Lab
+ */
+#include <deque>
+#include <unordered_set>
+
+#include "graph.hpp"
+#include "graph_rewriter.hpp"
+#include "mem_plan.hpp"
+
+namespace TEngine {
+
+/* an op type no rule names */
+static const uint32_t kUnknownOpType = UINT32_MAX;
+
+/*
+ * a rewrite may already have added the new nodes to the consumers of the graph
+ * tensors they read (Replace() only connects the var ones): take them off again
+ * before fused deletes the nodes it owns
+ */
+static void UnlinkFused(Subgraph* fused)
+{
+    for (auto n : fused->seq_nodes)
+    {
+        for (unsigned int i = 0; i < n->GetInputNum(); i++)
+        {
+            Tensor* tensor = n->GetInputTensor(i);
+
+            if (tensor)
+                tensor->RemoveConsumer(n->GetInputPort(i));
+        }
+    }
+}
+
+GraphPattern GraphPattern::Chain(const std::vector<std::string>& ops)
+{
+    GraphPattern pattern;
+    int op_number = ops.size();
+
+    /* items are stored from the last op backwards */
+    for (int i = op_number - 1; i >= 0; i--)
+    {
+        PatternItem item;
+
+        item.ops.push_back(ops[i]);
+
+        if (i > 0)
+            item.inputs.push_back(std::make_pair(0, op_number - i));
+
+        pattern.items.push_back(item);
+    }
+
+    return pattern;
+}
+
+void GraphRewriter::AddRule(const RewriteRule& rule)
+{
+    int rule_idx = rules_.size();
+
+    rules_.push_back(rule);
+
+    std::vector<std::vector<uint32_t>> item_ops;
+
+    for (auto& item : rule.pattern.items)
+    {
+        std::vector<uint32_t> ops;
+
+        for (auto& op_name : item.ops)
+            ops.push_back(op_types_.emplace(op_name, ( uint32_t )op_types_.size()).first->second);
+
+        item_ops.push_back(ops);
+    }
+
+    if (item_ops.empty() || item_ops[0].empty())
+    {
+        any_root_rules_.push_back(rule_idx);
+    }
+    else
+    {
+        for (auto op_type : item_ops[0])
+            root_rules_[op_type].push_back(rule_idx);
+    }
+
+    rule_ops_.push_back(item_ops);
+}
+
+uint32_t GraphRewriter::GetOpType(Node* node)
+{
+    Operator* op = node->GetOp();
+
+    if (op == nullptr)
+        return kUnknownOpType;
+
+    auto ir = op_types_.find(op->GetName());
+
+    return ir == op_types_.end() ? kUnknownOpType : ir->second;
+}
+
+bool GraphRewriter::MatchItem(const RewriteRule& rule, int rule_idx, int item_idx, Node* node,
+                              std::vector<Node*>& match)
+{
+    const PatternItem& item = rule.pattern.items[item_idx];
+    const std::vector<uint32_t>& ops = rule_ops_[rule_idx][item_idx];
+
+    if (!ops.empty())
+    {
+        uint32_t op_type = GetOpType(node);
+        bool found = false;
+
+        for (auto t : ops)
+        {
+            if (t == op_type)
+            {
+                found = true;
+                break;
+            }
+        }
+
+        if (!found)
+            return false;
+    }
+
+    if (item.single_consumer)
+    {
+        if (node->GetOutputNum() != 1 || node->GetOutputTensor(0)->consumer.size() != 1)
+            return false;
+    }
+
+    if (item.check && !item.check(node))
+        return false;
+
+    match[item_idx] = node;
+
+    for (auto& input : item.inputs)
+    {
+        if (input.first >= ( int )node->GetInputNum())
+            return false;
+
+        Tensor* tensor = node->GetInputTensor(input.first);
+
+        if (tensor == nullptr || tensor->producer == nullptr)
+            return false;
+
+        if (!MatchItem(rule, rule_idx, input.second, tensor->producer->owner, match))
+            return false;
+    }
+
+    return true;
+}
+
+int GraphRewriter::Run(Graph* graph)
+{
+    std::deque<Node*> work_list(graph->seq_nodes.begin(), graph->seq_nodes.end());
+    std::unordered_set<Node*> queued(graph->seq_nodes.begin(), graph->seq_nodes.end());
+
+    auto push_node = [&](Node* node) {
+        if (queued.insert(node).second)
+            work_list.push_back(node);
+    };
+
+    int rewrite_number = 0;
+    bool failed = false;
+
+    while (!failed && !work_list.empty())
+    {
+        Node* node = work_list.front();
+
+        work_list.pop_front();
+
+        /* not queued any more: the node has been replaced meanwhile */
+        if (queued.erase(node) == 0)
+            continue;
+
+        std::vector<int> candidates = any_root_rules_;
+        auto ir = root_rules_.find(GetOpType(node));
+
+        if (ir != root_rules_.end())
+            candidates.insert(candidates.end(), ir->second.begin(), ir->second.end());
+
+        for (auto rule_idx : candidates)
+        {
+            const RewriteRule& rule = rules_[rule_idx];
+            std::vector<Node*> match(rule.pattern.items.size(), nullptr);
+
+            if (!MatchItem(rule, rule_idx, 0, node, match))
+                continue;
+
+            Subgraph orig(rule.name);
+            Subgraph fused("fused");
+
+            if (!rule.rewrite(graph, match, &orig, &fused))
+                continue;
+
+            for (auto n : orig.seq_nodes)
+                queued.erase(n);
+
+            if (!graph->Replace(&orig, &fused, false))
+            {
+                XLOG_ERROR() << "rule " << rule.name << " failed to replace node: " << node->GetName() << "\n";
+
+                /* the rewrite may have changed the graph already: stop here */
+                UnlinkFused(&fused);
+                failed = true;
+                break;
+            }
+
+            rewrite_number++;
+
+            /* revisit the new nodes and whatever is connected to them */
+            for (auto n : fused.seq_nodes)
+            {
+                /* MergeAttr() copied the plans of the nodes replaced */
+                DropMemPlan(n);
+                push_node(n);
+
+                for (unsigned int i = 0; i < n->GetInputNum(); i++)
+                {
+                    Tensor* tensor = n->GetInputTensor(i);
+
+                    if (tensor && tensor->producer)
+                        push_node(tensor->producer->owner);
+                }
+
+                for (unsigned int i = 0; i < n->GetOutputNum(); i++)
+                {
+                    Tensor* tensor = n->GetOutputTensor(i);
+
+                    for (auto port : tensor->consumer)
+                        push_node(port->owner);
+                }
+            }
+
+            break;
+        }
+    }
+
+    if (rewrite_number > 0)
+        graph->SanitizeGraph();
+
+    return failed ? -1 : rewrite_number;
+}
+
+}    // namespace TEngine
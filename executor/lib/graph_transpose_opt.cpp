@@ -0,0 +1,618 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2020, Open AI Lab
+ */
+#include <cstdlib>
+#include <algorithm>
+
+#include "node.hpp"
+#include "graph.hpp"
+#include "data_type.hpp"
+#include "graph_optimizer.hpp"
+#include "graph_rewriter.hpp"
+#include "tensor_permute.hpp"
+#include "operator/transpose.hpp"
+#include "operator/permute.hpp"
+
+namespace TEngine {
+
+/*
+ * output dim i is input dim perm[i], for Transpose as well as for Permute.
+ * Permute stores a 3-d order with order3 == -2
+ */
+static bool GetPermutation(Node* node, std::vector<int>& perm)
+{
+    Operator* op = node->GetOp();
+
+    perm.clear();
+
+    if (op->GetName() == "Transpose")
+    {
+        perm = dynamic_cast<Transpose*>(op)->GetParam()->tr_shape;
+    }
+    else if (op->GetName() == "Permute")
+    {
+        PermuteParam* param = dynamic_cast<Permute*>(op)->GetParam();
+
+        for (int order : {param->order0, param->order1, param->order2, param->order3})
+        {
+            if (order >= 0)
+                perm.push_back(order);
+        }
+    }
+
+    if (perm.empty())
+        return false;
+
+    std::vector<bool> seen(perm.size(), false);
+
+    for (auto p : perm)
+    {
+        if (p < 0 || p >= ( int )perm.size() || seen[p])
+            return false;
+
+        seen[p] = true;
+    }
+
+    return true;
+}
+
+static bool IsTransposeNode(Node* node)
+{
+    std::vector<int> perm;
+
+    if (node->GetInputNum() != 1 || node->GetOutputNum() != 1 || node->IsDynamicShape())
+        return false;
+
+    return GetPermutation(node, perm);
+}
+
+static bool IsIdentity(const std::vector<int>& perm)
+{
+    for (unsigned int i = 0; i < perm.size(); i++)
+    {
+        if (perm[i] != ( int )i)
+            return false;
+    }
+
+    return true;
+}
+
+/* all the consumers of the only output are the given node */
+static bool FeedsOnly(Node* node, Node* consumer)
+{
+    Tensor* tensor = node->GetOutputTensor(0);
+
+    if (tensor->IsGraphOutput())
+        return false;
+
+    for (auto port : tensor->consumer)
+    {
+        if (port->owner != consumer)
+            return false;
+    }
+
+    return true;
+}
+
+static Node* GetProducer(Node* node, int port)
+{
+    Tensor* tensor = node->GetInputTensor(port);
+
+    if (tensor == nullptr || tensor->producer == nullptr)
+        return nullptr;
+
+    return tensor->producer->owner;
+}
+
+static bool IsConstNode(Node* node)
+{
+    Tensor* tensor = node->GetOutputTensor(0);
+
+    return node->GetOp()->GetName() == "Const" && tensor->GetType() == kConstTensor &&
+           tensor->GetMemAddr() != nullptr;
+}
+
+/* dst[i] = src[perm[i]] with the rank and the shape both known */
+static bool GetPermutedDims(const std::vector<int>& dims, const std::vector<int>& perm, std::vector<int>& out_dims)
+{
+    if (dims.size() != perm.size())
+        return false;
+
+    out_dims.resize(perm.size());
+
+    for (unsigned int i = 0; i < perm.size(); i++)
+    {
+        if (dims[i] <= 0)
+            return false;
+
+        out_dims[i] = dims[perm[i]];
+    }
+
+    return true;
+}
+
+static std::vector<int> GetInversePerm(const std::vector<int>& perm)
+{
+    std::vector<int> inverse(perm.size());
+
+    for (unsigned int i = 0; i < perm.size(); i++)
+        inverse[perm[i]] = i;
+
+    return inverse;
+}
+
+/* the content of a const tensor transposed by perm, malloc()ed */
+static void* GetPermutedData(Tensor* tensor, const std::vector<int>& perm, std::vector<int>& out_dims)
+{
+    const std::vector<int>& dims = tensor->GetShape().GetDim();
+    int elem_size = DataType::GetTypeSize(tensor->GetDataType());
+
+    if (elem_size <= 0 || !GetPermutedDims(dims, perm, out_dims))
+        return nullptr;
+
+    void* data = std::malloc(tensor->GetTotalSize());
+
+    if (data != nullptr && !PermuteData(tensor->GetMemAddr(), data, dims, perm, elem_size))
+    {
+        std::free(data);
+        data = nullptr;
+    }
+
+    return data;
+}
+
+/* a Const node and tensor with the content of tensor, transposed by perm */
+static Node* CreatePermutedConst(Subgraph* fused, Tensor* tensor, const std::string& name,
+                                 const std::vector<int>& perm)
+{
+    std::vector<int> out_dims;
+    void* data = GetPermutedData(tensor, perm, out_dims);
+
+    if (data == nullptr)
+        return nullptr;
+
+    Tensor* new_tensor = new Tensor(name);
+
+    new_tensor->SetType(kConstTensor);
+    new_tensor->SetDataType(tensor->GetDataType());
+    new_tensor->GetShape().SetDim(out_dims);
+    new_tensor->GetShape().SetDataLayout(tensor->GetShape().GetDataLayout());
+    *new_tensor->GetQuantParam() = *tensor->GetQuantParam();
+    new_tensor->SetMemAddr(data);
+    new_tensor->SetFreeMem(true);
+
+    Node* const_node = new Node(name);
+
+    const_node->SetOp(OpManager::CreateOp("Const"));
+    const_node->AddOutputTensor(new_tensor);
+    new_tensor->producer = const_node->GetOutputPort(0);
+
+    fused->seq_nodes.push_back(const_node);
+    fused->SetNodeOwner(const_node);
+    fused->SetTensorOwner(new_tensor);
+
+    return const_node;
+}
+
+static Node* CreateTransposeNode(const std::string& name, const std::vector<int>& perm)
+{
+    Node* node = new Node(name);
+    Transpose* op = dynamic_cast<Transpose*>(OpManager::CreateOp("Transpose"));
+
+    op->GetParam()->tr_shape = perm;
+    node->SetOp(op);
+
+    return node;
+}
+
+/* the const goes away with the node, unless someone else reads it */
+static void AddUnsharedConst(Graph* graph, Subgraph* orig, Node* const_node, Node* node)
+{
+    if (graph->IsOutputNode(const_node) || !FeedsOnly(const_node, node))
+        return;
+
+    orig->seq_nodes.push_back(const_node);
+}
+
+/* Transpose(Transpose(x)) --> Transpose(x), with the permutations composed */
+static bool MergeTranspose(Graph* graph, const std::vector<Node*>& match, Subgraph* orig, Subgraph* fused)
+{
+    Node* second = match[0];
+    Node* first = match[1];
+    std::vector<int> perm0;
+    std::vector<int> perm1;
+
+    GetPermutation(first, perm0);
+    GetPermutation(second, perm1);
+
+    if (perm0.size() != perm1.size())
+        return false;
+
+    std::vector<int> perm(perm1.size());
+
+    for (unsigned int i = 0; i < perm.size(); i++)
+        perm[i] = perm0[perm1[i]];
+
+    orig->seq_nodes.push_back(first);
+    orig->seq_nodes.push_back(second);
+    orig->input_nodes.push_back(first);
+    orig->output_nodes.push_back(second);
+
+    Node* node = CreateTransposeNode(second->GetName(), perm);
+
+    node->MergeAttr(first);
+    node->MergeAttr(second);
+    node->AddInputTensor(first->GetInputTensor(0));
+    node->AddOutputTensor(second->GetOutputTensor(0));
+
+    fused->seq_nodes.push_back(node);
+    fused->input_nodes.push_back(node);
+    fused->output_nodes.push_back(node);
+    fused->SetNodeOwner(node);
+
+    return true;
+}
+
+/* Transpose(const) --> const, absorbing the transpose into the weights */
+static bool FoldConstTranspose(Graph* graph, const std::vector<Node*>& match, Subgraph* orig, Subgraph* fused)
+{
+    Node* node = match[0];
+    Node* const_node = match[1];
+    Tensor* output = node->GetOutputTensor(0);
+    std::vector<int> perm;
+
+    GetPermutation(node, perm);
+
+    Tensor* tensor = const_node->GetOutputTensor(0);
+    std::vector<int> out_dims;
+    void* data = GetPermutedData(tensor, perm, out_dims);
+
+    if (data == nullptr)
+        return false;
+
+    /* the output tensor stays, with a Const node as its new producer */
+    output->SetType(kConstTensor);
+    output->SetDataType(tensor->GetDataType());
+    output->SetMemAddr(data);
+    output->SetFreeMem(true);
+    output->GetShape().SetDim(out_dims);
+    *output->GetQuantParam() = *tensor->GetQuantParam();
+
+    Node* new_node = new Node(output->GetName());
+
+    new_node->SetOp(OpManager::CreateOp("Const"));
+    new_node->AddOutputTensor(output);
+
+    orig->seq_nodes.push_back(node);
+    orig->output_nodes.push_back(node);
+
+    AddUnsharedConst(graph, orig, const_node, node);
+
+    fused->seq_nodes.push_back(new_node);
+    fused->output_nodes.push_back(new_node);
+    fused->SetNodeOwner(new_node);
+
+    return true;
+}
+
+/*
+ * the output of node, computed before the transpose: the transpose moves
+ * below node and gets the chance to meet the next one
+ */
+static bool SinkTranspose(Node* node, const std::vector<Node*>& transposes, const std::vector<int>& perm,
+                          Subgraph* orig, Subgraph* fused)
+{
+    Tensor* output = node->GetOutputTensor(0);
+    Tensor* inner = new Tensor(output->GetName() + ".untransposed");
+    std::vector<int> inner_dims;
+
+    inner->SetType(kVarTensor);
+    inner->SetDataType(output->GetDataType());
+    *inner->GetQuantParam() = *output->GetQuantParam();
+
+    /* output dim i is inner dim perm[i] */
+    if (GetPermutedDims(output->GetShape().GetDim(), GetInversePerm(perm), inner_dims))
+        inner->GetShape().SetDim(inner_dims);
+
+    Node* new_node = new Node(node->GetName());
+
+    new_node->ShareOp(node);
+    new_node->MergeAttr(node);
+    new_node->SetDynamicShape(node->IsDynamicShape());
+
+    for (unsigned int i = 0; i < node->GetInputNum(); i++)
+    {
+        Tensor* tensor = node->GetInputTensor(i);
+        Node* producer = tensor->producer ? tensor->producer->owner : nullptr;
+
+        /* the transposed inputs are read directly */
+        if (std::find(transposes.begin(), transposes.end(), producer) != transposes.end())
+            tensor = producer->GetInputTensor(0);
+
+        new_node->AddInputTensor(tensor);
+
+        /* Replace() only connects the var tensors */
+        if (tensor->GetType() == kConstTensor)
+            tensor->AddConsumer(new_node->GetInputPort(i));
+    }
+
+    new_node->AddOutputTensor(inner);
+    inner->producer = new_node->GetOutputPort(0);
+
+    Node* transpose = CreateTransposeNode(transposes[0]->GetName(), perm);
+
+    transpose->AddInputTensor(inner);
+    transpose->AddOutputTensor(output);
+    inner->AddConsumer(transpose->GetInputPort(0));
+
+    orig->seq_nodes.push_back(node);
+    orig->output_nodes.push_back(node);
+
+    for (auto n : transposes)
+    {
+        if (std::find(orig->seq_nodes.begin(), orig->seq_nodes.end(), n) != orig->seq_nodes.end())
+            continue;
+
+        orig->seq_nodes.push_back(n);
+        orig->input_nodes.push_back(n);
+    }
+
+    fused->seq_nodes.push_back(new_node);
+    fused->seq_nodes.push_back(transpose);
+    fused->input_nodes.push_back(new_node);
+    fused->output_nodes.push_back(transpose);
+    fused->SetNodeOwner(new_node);
+    fused->SetNodeOwner(transpose);
+    fused->SetTensorOwner(inner);
+
+    return true;
+}
+
+/* act(Transpose(x)) --> Transpose(act(x)) */
+static bool SinkUnary(Graph* graph, const std::vector<Node*>& match, Subgraph* orig, Subgraph* fused)
+{
+    Node* node = match[0];
+    Node* transpose = match[1];
+    std::vector<int> perm;
+
+    if (node->GetInputNum() != 1 || node->GetOutputNum() != 1 || !FeedsOnly(transpose, node))
+        return false;
+
+    GetPermutation(transpose, perm);
+
+    return SinkTranspose(node, {transpose}, perm, orig, fused);
+}
+
+/*
+ * Transpose(a) op Transpose(b) --> Transpose(a op b), with both transposes the same;
+ * Transpose(a) op c --> Transpose(a op c'), c' being c transposed back
+ */
+static bool SinkBinary(Graph* graph, const std::vector<Node*>& match, Subgraph* orig, Subgraph* fused)
+{
+    Node* node = match[0];
+
+    if (node->GetInputNum() != 2 || node->GetOutputNum() != 1 || node->IsDynamicShape())
+        return false;
+
+    std::vector<Node*> transposes;
+    std::vector<int> perm;
+    int const_port = -1;
+
+    for (int i = 0; i < 2; i++)
+    {
+        Node* producer = GetProducer(node, i);
+        std::vector<int> input_perm;
+
+        if (producer == nullptr)
+            return false;
+
+        if (IsConstNode(producer))
+        {
+            const_port = i;
+            continue;
+        }
+
+        if (!IsTransposeNode(producer) || !FeedsOnly(producer, node))
+            return false;
+
+        GetPermutation(producer, input_perm);
+
+        if (!perm.empty() && perm != input_perm)
+            return false;
+
+        perm = input_perm;
+
+        if (std::find(transposes.begin(), transposes.end(), producer) == transposes.end())
+            transposes.push_back(producer);
+    }
+
+    if (transposes.empty())
+        return false;
+
+    Node* const_node = nullptr;
+    Node* new_const = nullptr;
+
+    if (const_port >= 0)
+    {
+        const_node = GetProducer(node, const_port);
+
+        Tensor* tensor = const_node->GetOutputTensor(0);
+
+        /* a scalar broadcasts the same either way, lower ranks do not */
+        if (tensor->GetShape().GetSize() != 1)
+        {
+            new_const = CreatePermutedConst(fused, tensor, tensor->GetName() + "." + node->GetName(),
+                                            GetInversePerm(perm));
+
+            if (new_const == nullptr)
+                return false;
+        }
+    }
+
+    SinkTranspose(node, transposes, perm, orig, fused);
+
+    if (new_const != nullptr)
+    {
+        Node* new_node = fused->input_nodes[0];
+        Tensor* new_tensor = new_const->GetOutputTensor(0);
+
+        new_node->GetInputTensor(const_port)->RemoveConsumer(new_node->GetInputPort(const_port));
+        new_node->SetInputPort(const_port, new_tensor);
+        new_tensor->AddConsumer(new_node->GetInputPort(const_port));
+
+        AddUnsharedConst(graph, orig, const_node, node);
+    }
+
+    return true;
+}
+
+/* bypass a transpose that does nothing: its consumers read its input */
+static bool BypassIdentity(Graph* graph, Node* node)
+{
+    Tensor* input = node->GetInputTensor(0);
+    Tensor* output = node->GetOutputTensor(0);
+
+    for (auto port : output->consumer)
+    {
+        port->tensor = input;
+        input->AddConsumer(port);
+    }
+
+    output->consumer.clear();
+
+    graph->RemoveNode(node, false);
+
+    return true;
+}
+
+/* a model output keeps its tensor: the node before the transpose produces it instead */
+static bool TakeOverOutput(Graph* graph, Node* node)
+{
+    Tensor* input = node->GetInputTensor(0);
+    Tensor* output = node->GetOutputTensor(0);
+
+    if (input->GetType() != kVarTensor || input->producer == nullptr || input->consumer.size() != 1 ||
+        input->IsGraphOutput())
+        return false;
+
+    Node* producer = input->producer->owner;
+    int port_index = input->producer->port_index;
+
+    if (graph->IsInputNode(producer) || graph->IsOutputNode(producer))
+        return false;
+
+    /* the same place in the output list */
+    std::replace(graph->output_nodes.begin(), graph->output_nodes.end(), node, producer);
+
+    node->RemoveOutputPort(0);
+    graph->RemoveNode(node, false);
+
+    producer->SetOutputPort(port_index, output);
+    output->producer = producer->GetOutputPort(port_index);
+
+    input->producer = nullptr;
+    graph->RemoveTensor(input);
+
+    return true;
+}
+
+static bool RemoveIdentity(Graph* graph, Node* node)
+{
+    Tensor* output = node->GetOutputTensor(0);
+
+    if (output->IsGraphOutput())
+        return TakeOverOutput(graph, node);
+
+    if (output->consumer.empty() || graph->IsOutputNode(node))
+        return false;
+
+    return BypassIdentity(graph, node);
+}
+
+bool GraphOptimizeTranspose(Graph* graph, GraphOptimizer* opt)
+{
+    std::vector<std::string> transpose_ops = {"Transpose", "Permute"};
+    GraphRewriter rewriter;
+    RewriteRule rule;
+
+    rule.name = "transpose_merge";
+    rule.pattern.items.resize(2);
+    rule.pattern.items[0].ops = transpose_ops;
+    rule.pattern.items[0].check = IsTransposeNode;
+    rule.pattern.items[0].inputs.push_back(std::make_pair(0, 1));
+    rule.pattern.items[1].ops = transpose_ops;
+    rule.pattern.items[1].check = IsTransposeNode;
+    rule.pattern.items[1].single_consumer = true;
+    rule.rewrite = MergeTranspose;
+    rewriter.AddRule(rule);
+
+    rule.name = "transpose_const";
+    rule.pattern.items[1].ops = {"Const"};
+    rule.pattern.items[1].check = IsConstNode;
+    rule.pattern.items[1].single_consumer = false;
+    rule.rewrite = FoldConstTranspose;
+    rewriter.AddRule(rule);
+
+    /* out = f(in) of an element-wise op commutes with any transpose */
+    rule.name = "transpose_sink_unary";
+    rule.pattern.items[0].ops = GetElementwiseOps();
+    rule.pattern.items[0].check = nullptr;
+    rule.pattern.items[1].ops = transpose_ops;
+    rule.pattern.items[1].check = IsTransposeNode;
+    rule.pattern.items[1].single_consumer = true;
+    rule.rewrite = SinkUnary;
+    rewriter.AddRule(rule);
+
+    rule.name = "transpose_sink_binary";
+    rule.pattern.items.resize(1);
+    rule.pattern.items[0].ops = {"Eltwise"};
+    rule.pattern.items[0].inputs.clear();
+    rule.rewrite = SinkBinary;
+    rewriter.AddRule(rule);
+
+    if (rewriter.Run(graph) < 0)
+        return false;
+
+    /* merging may leave permutations that do nothing */
+    std::vector<Node*> node_list = graph->seq_nodes;
+    int remove_number = 0;
+
+    for (auto node : node_list)
+    {
+        std::vector<int> perm;
+
+        if (!IsTransposeNode(node))
+            continue;
+
+        GetPermutation(node, perm);
+
+        if (IsIdentity(perm) && RemoveIdentity(graph, node))
+            remove_number++;
+    }
+
+    if (remove_number > 0)
+        graph->SanitizeGraph();
+
+    return true;
+}
+
+}    // namespace TEngine
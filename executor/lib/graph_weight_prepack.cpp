@@ -0,0 +1,333 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2020, Open AI Lab
+ */
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <algorithm>
+
+#include "tengine_c_api.h"
+#include "logger.hpp"
+#include "node.hpp"
+#include "graph.hpp"
+#include "graph_optimizer.hpp"
+#include "weight_prepack.hpp"
+#include "operator/convolution.hpp"
+#include "operator/fully_connected.hpp"
+#include "parallel_task.hpp"
+
+namespace TEngine {
+
+struct PrepackSchemeInfo
+{
+    const char* name;
+    int scheme;
+    int tile_m;
+    int tile_n;
+};
+
+static const PrepackSchemeInfo scheme_table[] = {
+    {"gemm4x16", PREPACK_GEMM, 4, 16},
+    {"gemm8x12", PREPACK_GEMM, 8, 12},
+    {"wino23", PREPACK_WINOGRAD, 2, 4},
+    {"wino63", PREPACK_WINOGRAD, 6, 8},
+};
+
+/* F(2, 3) */
+static const float wino23_g[4][3] = {{1.0f, 0.0f, 0.0f}, {0.5f, 0.5f, 0.5f}, {0.5f, -0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}};
+
+/* F(6, 3), interpolation points 0, 1, -1, 2, -2, 1/2, -1/2 */
+static const float wino63_g[8][3] = {
+    {1.0f, 0.0f, 0.0f},
+    {-2.0f / 9, -2.0f / 9, -2.0f / 9},
+    {-2.0f / 9, 2.0f / 9, -2.0f / 9},
+    {1.0f / 90, 1.0f / 45, 2.0f / 45},
+    {1.0f / 90, -1.0f / 45, 2.0f / 45},
+    {1.0f / 45, 1.0f / 90, 1.0f / 180},
+    {1.0f / 45, -1.0f / 90, 1.0f / 180},
+    {0.0f, 0.0f, 1.0f},
+};
+
+static const PrepackSchemeInfo* FindScheme(const std::string& name)
+{
+    for (auto& info : scheme_table)
+    {
+        if (name == info.name)
+            return &info;
+    }
+
+    return nullptr;
+}
+
+/* the weights a scheme applies to, as [group][out_dim][in_dim] */
+struct PrepackWeight
+{
+    const float* data;
+    int group;
+    int out_dim;
+    int in_dim;
+    bool winograd_ok;
+};
+
+static bool GetPrepackWeight(Graph* graph, Node* node, PrepackWeight& weight)
+{
+    Operator* op = node->GetOp();
+
+    if (node->GetInputNum() < 2)
+        return false;
+
+    Tensor* tensor = node->GetInputTensor(1);
+    const std::vector<int>& dims = tensor->GetShape().GetDim();
+
+    if (tensor->GetType() != kConstTensor || tensor->GetDataType() != TENGINE_DT_FP32 ||
+        tensor->GetMemAddr() == nullptr)
+        return false;
+
+    weight.data = ( const float* )tensor->GetMemAddr();
+    weight.winograd_ok = false;
+
+    if (op->GetName() == "Convolution")
+    {
+        ConvParam* param = dynamic_cast<Convolution*>(op)->GetParam();
+
+        /* OIHW: a NHWC graph holds OHWI weights, which no scheme here reads */
+        if (graph->GetLayout() != TENGINE_LAYOUT_NCHW || dims.size() != 4 || param->group <= 0 ||
+            dims[0] % param->group)
+            return false;
+
+        weight.group = param->group;
+        weight.out_dim = dims[0] / param->group;
+        weight.in_dim = dims[1] * dims[2] * dims[3];
+        weight.winograd_ok = param->group == 1 && dims[2] == 3 && dims[3] == 3 && param->stride_h == 1 &&
+                             param->stride_w == 1 && param->dilation_h == 1 && param->dilation_w == 1;
+
+        return true;
+    }
+
+    if (op->GetName() == "FullyConnected")
+    {
+        /* [num_output][K] */
+        if (dims.size() != 2)
+            return false;
+
+        weight.group = 1;
+        weight.out_dim = dims[0];
+        weight.in_dim = dims[1];
+
+        return true;
+    }
+
+    return false;
+}
+
+static void PackGemm(const PrepackWeight& weight, int tile_m, float* packed)
+{
+    int panel_num = (weight.out_dim + tile_m - 1) / tile_m;
+    int k = weight.in_dim;
+
+    ParallelRun(weight.group * panel_num, [&](int task) {
+        int g = task / panel_num;
+        int m0 = (task % panel_num) * tile_m;
+        int rows = std::min(tile_m, weight.out_dim - m0);
+        const float* src = weight.data + (( size_t )g * weight.out_dim + m0) * k;
+        float* dst = packed + ( size_t )task * tile_m * k;
+
+        for (int i = 0; i < k; i++)
+        {
+            for (int r = 0; r < rows; r++)
+                dst[r] = src[( size_t )r * k + i];
+
+            for (int r = rows; r < tile_m; r++)
+                dst[r] = 0.0f;
+
+            dst += tile_m;
+        }
+    });
+}
+
+/* U = G g G^T for each 3x3 kernel */
+static void PackWinograd(const PrepackWeight& weight, int tile_n, float* packed)
+{
+    const float* g_mat = (tile_n == 4) ? &wino23_g[0][0] : &wino63_g[0][0];
+    int in_channel = weight.in_dim / 9;
+
+    ParallelRun(weight.out_dim, [&](int o_c) {
+        for (int i_c = 0; i_c < in_channel; i_c++)
+        {
+            size_t idx = ( size_t )o_c * in_channel + i_c;
+            const float* kernel = weight.data + idx * 9;
+            float* u = packed + idx * tile_n * tile_n;
+            float tmp[8][3];
+
+            for (int i = 0; i < tile_n; i++)
+            {
+                for (int j = 0; j < 3; j++)
+                {
+                    const float* g = g_mat + i * 3;
+
+                    tmp[i][j] = g[0] * kernel[j] + g[1] * kernel[3 + j] + g[2] * kernel[6 + j];
+                }
+            }
+
+            for (int i = 0; i < tile_n; i++)
+            {
+                for (int j = 0; j < tile_n; j++)
+                {
+                    const float* g = g_mat + j * 3;
+
+                    u[i * tile_n + j] = tmp[i][0] * g[0] + tmp[i][1] * g[1] + tmp[i][2] * g[2];
+                }
+            }
+        }
+    });
+}
+
+static void SetPrepackAttr(Node* node, const std::string& attr_name, std::vector<uint8_t>& mem)
+{
+    if (!node->ExistAttr(ATTR_CUSTOM_ATTR))
+        node->SetAttr(ATTR_CUSTOM_ATTR, node_custom_attr_map_t());
+
+    node_custom_attr_map_t* attr_map = any_cast<node_custom_attr_map_t>(&node->GetAttr(ATTR_CUSTOM_ATTR));
+    CustomNodeAttr& attr = (*attr_map)[attr_name];
+
+    attr.type_name = nullptr;
+    attr.attr_size = mem.size();
+    attr.mem.swap(mem);
+}
+
+static bool PrepackNode(Node* node, const PrepackWeight& weight, const PrepackSchemeInfo& info)
+{
+    size_t elem_num;
+
+    if (info.scheme == PREPACK_GEMM)
+    {
+        int panel_num = (weight.out_dim + info.tile_m - 1) / info.tile_m;
+
+        elem_num = ( size_t )weight.group * panel_num * info.tile_m * weight.in_dim;
+    }
+    else
+    {
+        if (!weight.winograd_ok)
+            return false;
+
+        elem_num = ( size_t )weight.out_dim * (weight.in_dim / 9) * info.tile_n * info.tile_n;
+    }
+
+    /* the tmfile offsets are 32 bits */
+    if (elem_num * sizeof(float) > INT32_MAX - sizeof(PrepackHeader))
+        return false;
+
+    std::vector<uint8_t> mem(sizeof(PrepackHeader) + elem_num * sizeof(float));
+    PrepackHeader header;
+
+    memset(&header, 0, sizeof(header));
+    header.version = PREPACK_VERSION;
+    header.scheme = info.scheme;
+    header.tile_m = info.tile_m;
+    header.tile_n = info.tile_n;
+    header.isa = PREPACK_ISA_ANY;
+    header.group = weight.group;
+    header.out_dim = weight.out_dim;
+    header.in_dim = weight.in_dim;
+    header.data_size = elem_num * sizeof(float);
+
+    memcpy(mem.data(), &header, sizeof(header));
+
+    float* packed = ( float* )(mem.data() + sizeof(header));
+
+    if (info.scheme == PREPACK_GEMM)
+        PackGemm(weight, info.tile_m, packed);
+    else
+        PackWinograd(weight, info.tile_n, packed);
+
+    SetPrepackAttr(node, std::string(PREPACK_ATTR_PREFIX) + info.name, mem);
+
+    return true;
+}
+
+/*
+ * opt->args: the comma separated scheme names (see scheme_table).
+ * the weights must be final: run it after the fusions, just before saving
+ */
+bool GraphPrepackWeights(Graph* graph, GraphOptimizer* opt)
+{
+    std::vector<const PrepackSchemeInfo*> schemes;
+    std::stringstream list(any_cast<std::string>(opt->args));
+    std::string name;
+
+    while (std::getline(list, name, ','))
+    {
+        if (name.empty())
+            continue;
+
+        const PrepackSchemeInfo* info = FindScheme(name);
+
+        if (info == nullptr)
+        {
+            LOG_ERROR() << "unknown weight packing scheme: " << name << "\n";
+            return false;
+        }
+
+        schemes.push_back(info);
+    }
+
+    int pack_number = 0;
+
+    for (auto node : graph->seq_nodes)
+    {
+        PrepackWeight weight;
+
+        if (!GetPrepackWeight(graph, node, weight))
+            continue;
+
+        for (auto info : schemes)
+        {
+            if (PrepackNode(node, weight, *info))
+                pack_number++;
+        }
+    }
+
+    LOG_INFO() << "weight packings added: " << pack_number << "\n";
+
+    return true;
+}
+
+const PrepackHeader* GetPrepackedWeight(Node* node, const char* scheme_name)
+{
+    if (!node->ExistAttr(ATTR_CUSTOM_ATTR))
+        return nullptr;
+
+    node_custom_attr_map_t* attr_map = any_cast<node_custom_attr_map_t>(&node->GetAttr(ATTR_CUSTOM_ATTR));
+    auto ir = attr_map->find(std::string(PREPACK_ATTR_PREFIX) + scheme_name);
+
+    if (ir == attr_map->end() || ir->second.mem.size() < sizeof(PrepackHeader))
+        return nullptr;
+
+    const PrepackHeader* header = ( const PrepackHeader* )ir->second.mem.data();
+
+    if (header->version != PREPACK_VERSION || header->data_size != ir->second.mem.size() - sizeof(PrepackHeader))
+        return nullptr;
+
+    return header;
+}
+
+}    // namespace TEngine
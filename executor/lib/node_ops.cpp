@@ -318,6 +318,19 @@ NodeOpsRegistry* NodeOpsRegistryManager::FindRegistry(const std::string& name)
     return manager->registry_list[name];
 }
 
+bool NodeOpsRegistryManager::HasOpImplementor(const std::string& op_name)
+{
+    auto manager = GetInstance();
+
+    for (auto& e : manager->registry_list)
+    {
+        if (e.second->FindSelector(op_name) != nullptr)
+            return true;
+    }
+
+    return false;
+}
+
 void NodeOpsRegistryManager::RecordNodeOpsptr(NodeOps* ops)
 {
     auto manager = GetInstance();
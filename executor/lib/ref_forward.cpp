@@ -0,0 +1,760 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+/*
+ * Copyright (c) 2020, Open AI Lab
+ */
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+#include <algorithm>
+
+#include "logger.hpp"
+#include "node.hpp"
+#include "graph_optimizer.hpp"
+#include "ref_forward.hpp"
+#include "operator/convolution.hpp"
+#include "operator/deconvolution.hpp"
+#include "operator/fused_operator.hpp"
+#include "operator/fully_connected.hpp"
+#include "operator/pooling.hpp"
+#include "operator/batch_norm.hpp"
+#include "operator/relu.hpp"
+#include "operator/eltwise.hpp"
+#include "operator/concat.hpp"
+#include "operator/softmax.hpp"
+
+namespace TEngine {
+
+using ref_forward_t = bool (*)(Node* node, const std::vector<const float*>& inputs,
+                               const std::vector<float*>& outputs);
+
+static const std::vector<int>& GetDims(Node* node, bool input, int port)
+{
+    Tensor* tensor = input ? node->GetInputTensor(port) : node->GetOutputTensor(port);
+
+    return tensor->GetShape().GetDim();
+}
+
+static int GetElemNum(const std::vector<int>& dims)
+{
+    int elem_num = 1;
+
+    for (auto d : dims)
+        elem_num *= d;
+
+    return elem_num;
+}
+
+/* the dims past the third are folded into w */
+static void GetNCHW(const std::vector<int>& dims, int& n, int& c, int& h, int& w)
+{
+    int rank = dims.size();
+
+    n = rank > 0 ? dims[0] : 1;
+    c = rank > 1 ? dims[1] : 1;
+    h = rank > 2 ? dims[2] : 1;
+    w = 1;
+
+    for (int i = 3; i < rank; i++)
+        w *= dims[i];
+}
+
+/* see the activation codes in conv_param.hpp: for ActPRELU alpha is the slope of the channel */
+static float Activate(float x, int activation, float alpha, float beta)
+{
+    switch (activation)
+    {
+        case ActNONE:
+            return x;
+        case ActRELU:
+            return std::max(x, 0.f);
+        case ActLEAKY:
+        case ActPRELU:
+            return x > 0 ? x : x * alpha;
+        case ActCLIP:
+            return std::min(std::max(x, alpha), beta);
+        case ActELU:
+            return x > 0 ? x : alpha * (std::exp(x) - 1.f);
+        case ActSIGMOD:
+            return 1.f / (1.f + std::exp(-x));
+        case ActTANH:
+            return std::tanh(x);
+        case ActHSWISH:
+            return x * std::min(std::max(x + 3.f, 0.f), 6.f) / 6.f;
+        case ActMISH:
+            return x * std::tanh(std::log1p(std::exp(x)));
+        default:
+            /* RELU1, RELU6: clip at [0, activation] */
+            return std::min(std::max(x, 0.f), ( float )activation);
+    }
+}
+
+/* the PReLU slopes come after the bias */
+static bool IsRefActivation(Node* node, int activation)
+{
+    return activation != ActPRELU || node->GetInputNum() > 3;
+}
+
+/* Convolution, or Fused.ConvEltwise */
+static ConvParam* GetConvParam(Node* node)
+{
+    Operator* op = node->GetOp();
+
+    if (op->GetName() == FusedConvEltwise::class_name)
+        return dynamic_cast<FusedConvEltwise*>(op)->GetParam();
+
+    return dynamic_cast<Convolution*>(op)->GetParam();
+}
+
+/*
+ * weight: [output_channel][input_channel / group][kernel_h][kernel_w].
+ * Fused.ConvEltwise adds input 3 to the sum before the activation
+ */
+static bool RefConv(Node* node, const std::vector<const float*>& inputs, const std::vector<float*>& outputs)
+{
+    ConvParam* param = GetConvParam(node);
+    bool fused = node->GetOp()->GetName() == FusedConvEltwise::class_name;
+
+    int batch, in_c, in_h, in_w;
+    int out_n, out_c, out_h, out_w;
+
+    GetNCHW(GetDims(node, true, 0), batch, in_c, in_h, in_w);
+    GetNCHW(GetDims(node, false, 0), out_n, out_c, out_h, out_w);
+
+    int group = std::max(param->group, 1);
+    int in_c_g = in_c / group;
+    int out_c_g = out_c / group;
+    int kernel_h = param->kernel_h;
+    int kernel_w = param->kernel_w;
+
+    const float* input = inputs[0];
+    const float* weight = inputs[1];
+    const float* bias = inputs.size() > 2 ? inputs[2] : nullptr;
+    const float* addend = fused ? inputs[3] : nullptr;
+    const float* slope = !fused && param->activation == ActPRELU ? inputs[3] : nullptr;
+    float* output = outputs[0];
+
+    for (int n = 0; n < batch; n++)
+    {
+        for (int oc = 0; oc < out_c; oc++)
+        {
+            int g = oc / out_c_g;
+            const float* kernel = weight + ( size_t )oc * in_c_g * kernel_h * kernel_w;
+            size_t out_offset = (( size_t )n * out_c + oc) * out_h * out_w;
+            float* out = output + out_offset;
+            float alpha = slope ? slope[oc] : param->act_alpha;
+
+            for (int oy = 0; oy < out_h; oy++)
+            {
+                for (int ox = 0; ox < out_w; ox++)
+                {
+                    float sum = bias ? bias[oc] : 0.f;
+
+                    for (int ic = 0; ic < in_c_g; ic++)
+                    {
+                        const float* in = input + (( size_t )n * in_c + g * in_c_g + ic) * in_h * in_w;
+                        const float* k = kernel + ic * kernel_h * kernel_w;
+
+                        for (int ky = 0; ky < kernel_h; ky++)
+                        {
+                            int iy = oy * param->stride_h - param->pad_h0 + ky * param->dilation_h;
+
+                            if (iy < 0 || iy >= in_h)
+                                continue;
+
+                            for (int kx = 0; kx < kernel_w; kx++)
+                            {
+                                int ix = ox * param->stride_w - param->pad_w0 + kx * param->dilation_w;
+
+                                if (ix >= 0 && ix < in_w)
+                                    sum += in[iy * in_w + ix] * k[ky * kernel_w + kx];
+                            }
+                        }
+                    }
+
+                    if (addend)
+                        sum += addend[out_offset + oy * out_w + ox];
+
+                    out[oy * out_w + ox] = Activate(sum, param->activation, alpha, param->act_beta);
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+/*
+ * weight: [input_channel][output_channel / group][kernel_h][kernel_w]. every input
+ * pixel is spread over the outputs its kernel window covers
+ */
+static bool RefDeconv(Node* node, const std::vector<const float*>& inputs, const std::vector<float*>& outputs)
+{
+    Deconvolution* deconv_op = dynamic_cast<Deconvolution*>(node->GetOp());
+    DeconvParam* param = deconv_op->GetParam();
+
+    int batch, in_c, in_h, in_w;
+    int out_n, out_c, out_h, out_w;
+
+    GetNCHW(GetDims(node, true, 0), batch, in_c, in_h, in_w);
+    GetNCHW(GetDims(node, false, 0), out_n, out_c, out_h, out_w);
+
+    int group = std::max(param->group, 1);
+    int in_c_g = in_c / group;
+    int out_c_g = out_c / group;
+    int kernel_h = param->kernel_h;
+    int kernel_w = param->kernel_w;
+    int plane = out_h * out_w;
+
+    const float* bias = inputs.size() > 2 ? inputs[2] : nullptr;
+
+    for (int n = 0; n < batch; n++)
+    {
+        float* output = outputs[0] + ( size_t )n * out_c * plane;
+
+        for (int oc = 0; oc < out_c; oc++)
+        {
+            for (int i = 0; i < plane; i++)
+                output[( size_t )oc * plane + i] = bias ? bias[oc] : 0.f;
+        }
+
+        for (int ic = 0; ic < in_c; ic++)
+        {
+            int g = ic / in_c_g;
+            const float* in = inputs[0] + (( size_t )n * in_c + ic) * in_h * in_w;
+
+            for (int oc_g = 0; oc_g < out_c_g; oc_g++)
+            {
+                const float* k = inputs[1] + (( size_t )ic * out_c_g + oc_g) * kernel_h * kernel_w;
+                float* out = output + (( size_t )g * out_c_g + oc_g) * plane;
+
+                for (int iy = 0; iy < in_h; iy++)
+                {
+                    for (int ix = 0; ix < in_w; ix++)
+                    {
+                        float x = in[iy * in_w + ix];
+
+                        for (int ky = 0; ky < kernel_h; ky++)
+                        {
+                            int oy = iy * param->stride_h - param->pad_h0 + ky * param->dilation_h;
+
+                            if (oy < 0 || oy >= out_h)
+                                continue;
+
+                            for (int kx = 0; kx < kernel_w; kx++)
+                            {
+                                int ox = ix * param->stride_w - param->pad_w0 + kx * param->dilation_w;
+
+                                if (ox >= 0 && ox < out_w)
+                                    out[oy * out_w + ox] += x * k[ky * kernel_w + kx];
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        for (int i = 0; i < out_c * plane; i++)
+            output[i] = Activate(output[i], param->activation, 0.f, 0.f);
+    }
+
+    return true;
+}
+
+/* weight: [num_output][k], the input is m rows of k */
+static bool RefFC(Node* node, const std::vector<const float*>& inputs, const std::vector<float*>& outputs)
+{
+    FullyConnected* fc_op = dynamic_cast<FullyConnected*>(node->GetOp());
+    FCParam* param = fc_op->GetParam();
+
+    const std::vector<int>& weight_dims = GetDims(node, true, 1);
+    int n = weight_dims[0];
+    int k = GetElemNum(weight_dims) / n;
+    int m = GetElemNum(GetDims(node, true, 0)) / k;
+
+    const float* bias = inputs.size() > 2 ? inputs[2] : nullptr;
+
+    for (int i = 0; i < m; i++)
+    {
+        const float* in = inputs[0] + ( size_t )i * k;
+
+        for (int j = 0; j < n; j++)
+        {
+            const float* w = inputs[1] + ( size_t )j * k;
+            float sum = bias ? bias[j] : 0.f;
+
+            for (int l = 0; l < k; l++)
+                sum += in[l] * w[l];
+
+            float alpha = param->activation == ActPRELU ? inputs[3][j] : param->act_alpha;
+
+            outputs[0][( size_t )i * n + j] = Activate(sum, param->activation, alpha, param->act_beta);
+        }
+    }
+
+    return true;
+}
+
+static bool RefPooling(Node* node, const std::vector<const float*>& inputs, const std::vector<float*>& outputs)
+{
+    Pooling* pool_op = dynamic_cast<Pooling*>(node->GetOp());
+    PoolParam* param = pool_op->GetParam();
+
+    int batch, channel, in_h, in_w;
+    int out_n, out_c, out_h, out_w;
+
+    GetNCHW(GetDims(node, true, 0), batch, channel, in_h, in_w);
+    GetNCHW(GetDims(node, false, 0), out_n, out_c, out_h, out_w);
+
+    int kernel_h = param->global ? in_h : param->kernel_h;
+    int kernel_w = param->global ? in_w : param->kernel_w;
+    int stride_h = param->global ? 1 : param->stride_h;
+    int stride_w = param->global ? 1 : param->stride_w;
+    int pad_h = param->global ? 0 : param->pad_h0;
+    int pad_w = param->global ? 0 : param->pad_w0;
+    bool count_pad = !param->global && (param->caffe_flavor & COUNT_INCLUDE_PAD_MSK);
+
+    for (int nc = 0; nc < batch * channel; nc++)
+    {
+        const float* in = inputs[0] + ( size_t )nc * in_h * in_w;
+        float* out = outputs[0] + ( size_t )nc * out_h * out_w;
+
+        for (int oy = 0; oy < out_h; oy++)
+        {
+            for (int ox = 0; ox < out_w; ox++)
+            {
+                int y0 = oy * stride_h - pad_h;
+                int x0 = ox * stride_w - pad_w;
+                int y1 = std::min(y0 + kernel_h, in_h + (count_pad ? param->pad_h1 : 0));
+                int x1 = std::min(x0 + kernel_w, in_w + (count_pad ? param->pad_w1 : 0));
+                int pad_count = (y1 - y0) * (x1 - x0);
+
+                y0 = std::max(y0, 0);
+                x0 = std::max(x0, 0);
+                y1 = std::min(y1, in_h);
+                x1 = std::min(x1, in_w);
+
+                float max_val = -FLT_MAX;
+                float sum = 0.f;
+
+                for (int y = y0; y < y1; y++)
+                {
+                    for (int x = x0; x < x1; x++)
+                    {
+                        max_val = std::max(max_val, in[y * in_w + x]);
+                        sum += in[y * in_w + x];
+                    }
+                }
+
+                int count = count_pad ? pad_count : (y1 - y0) * (x1 - x0);
+
+                if (param->alg == kPoolMax)
+                    out[oy * out_w + ox] = count > 0 ? max_val : 0.f;
+                else
+                    out[oy * out_w + ox] = count > 0 ? sum / count : 0.f;
+            }
+        }
+    }
+
+    return true;
+}
+
+template <typename F> static bool RefUnary(Node* node, const float* input, float* output, F func)
+{
+    int elem_num = GetElemNum(GetDims(node, false, 0));
+
+    for (int i = 0; i < elem_num; i++)
+        output[i] = func(input[i]);
+
+    return true;
+}
+
+static bool RefReLu(Node* node, const std::vector<const float*>& inputs, const std::vector<float*>& outputs)
+{
+    ReLu* relu_op = dynamic_cast<ReLu*>(node->GetOp());
+    float slope = relu_op->GetParam()->negative_slope;
+
+    return RefUnary(node, inputs[0], outputs[0], [slope](float x) { return x > 0 ? x : x * slope; });
+}
+
+static bool RefReLu6(Node* node, const std::vector<const float*>& inputs, const std::vector<float*>& outputs)
+{
+    return RefUnary(node, inputs[0], outputs[0], [](float x) { return std::min(std::max(x, 0.f), 6.f); });
+}
+
+/* slope: one for all, or one per channel */
+static bool RefPReLU(Node* node, const std::vector<const float*>& inputs, const std::vector<float*>& outputs)
+{
+    int batch, channel, h, w;
+
+    GetNCHW(GetDims(node, true, 0), batch, channel, h, w);
+
+    bool shared = GetElemNum(GetDims(node, true, 1)) == 1;
+    int plane = h * w;
+
+    for (int n = 0; n < batch; n++)
+    {
+        for (int c = 0; c < channel; c++)
+        {
+            size_t offset = (( size_t )n * channel + c) * plane;
+            float slope = inputs[1][shared ? 0 : c];
+
+            for (int i = 0; i < plane; i++)
+            {
+                float x = inputs[0][offset + i];
+
+                outputs[0][offset + i] = x > 0 ? x : x * slope;
+            }
+        }
+    }
+
+    return true;
+}
+
+static bool IsRefPReLU(Node* node)
+{
+    if (node->GetInputNum() != 2)
+        return false;
+
+    int batch, channel, h, w;
+
+    GetNCHW(GetDims(node, true, 0), batch, channel, h, w);
+
+    int slope_num = GetElemNum(GetDims(node, true, 1));
+
+    return slope_num == 1 || slope_num == channel;
+}
+
+static bool RefSigmoid(Node* node, const std::vector<const float*>& inputs, const std::vector<float*>& outputs)
+{
+    return RefUnary(node, inputs[0], outputs[0], [](float x) { return 1.f / (1.f + std::exp(-x)); });
+}
+
+static bool RefTanh(Node* node, const std::vector<const float*>& inputs, const std::vector<float*>& outputs)
+{
+    return RefUnary(node, inputs[0], outputs[0], [](float x) { return std::tanh(x); });
+}
+
+/* the shape-only ops */
+static bool RefCopy(Node* node, const std::vector<const float*>& inputs, const std::vector<float*>& outputs)
+{
+    memcpy(outputs[0], inputs[0], sizeof(float) * GetElemNum(GetDims(node, false, 0)));
+
+    return true;
+}
+
+/* strides of dims laid over out_dims, 0 along the broadcast axes */
+static std::vector<int> GetBroadcastStrides(const std::vector<int>& dims, const std::vector<int>& out_dims)
+{
+    int rank = out_dims.size();
+    int offset = rank - dims.size();
+    int stride = 1;
+
+    std::vector<int> strides(rank, 0);
+
+    for (int i = rank - 1; i >= offset; i--)
+    {
+        if (dims[i - offset] != 1)
+            strides[i] = stride;
+
+        stride *= dims[i - offset];
+    }
+
+    return strides;
+}
+
+static bool RefEltwise(Node* node, const std::vector<const float*>& inputs, const std::vector<float*>& outputs)
+{
+    Eltwise* eltwise_op = dynamic_cast<Eltwise*>(node->GetOp());
+    int type = eltwise_op->GetParam()->type;
+
+    const std::vector<int>& out_dims = GetDims(node, false, 0);
+    std::vector<int> strides0 = GetBroadcastStrides(GetDims(node, true, 0), out_dims);
+    std::vector<int> strides1 = GetBroadcastStrides(GetDims(node, true, 1), out_dims);
+
+    int rank = out_dims.size();
+    int elem_num = GetElemNum(out_dims);
+
+    for (int i = 0; i < elem_num; i++)
+    {
+        int idx0 = 0;
+        int idx1 = 0;
+        int remain = i;
+
+        for (int j = rank - 1; j >= 0; j--)
+        {
+            int pos = remain % out_dims[j];
+
+            remain /= out_dims[j];
+            idx0 += pos * strides0[j];
+            idx1 += pos * strides1[j];
+        }
+
+        float x0 = inputs[0][idx0];
+        float x1 = inputs[1][idx1];
+        float y;
+
+        switch (type)
+        {
+            case ELT_SUM:
+            case ELT_SUM_SCALAR:
+                y = x0 + x1;
+                break;
+            case ELT_SUB:
+            case ELT_SUB_SCALAR:
+                y = x0 - x1;
+                break;
+            case ELT_PROD:
+            case ELT_PROD_SCALAR:
+                y = x0 * x1;
+                break;
+            case ELT_DIV:
+                y = x0 / x1;
+                break;
+            default:
+                y = std::max(x0, x1);
+                break;
+        }
+
+        outputs[0][i] = y;
+    }
+
+    return true;
+}
+
+static bool IsRefEltwise(Node* node)
+{
+    Eltwise* eltwise_op = dynamic_cast<Eltwise*>(node->GetOp());
+
+    switch (eltwise_op->GetParam()->type)
+    {
+        case ELT_SUM:
+        case ELT_SUM_SCALAR:
+        case ELT_SUB:
+        case ELT_SUB_SCALAR:
+        case ELT_PROD:
+        case ELT_PROD_SCALAR:
+        case ELT_DIV:
+        case ELT_MAX:
+            return node->GetInputNum() == 2;
+        default:
+            return false;
+    }
+}
+
+/* BatchNormalization and the channel Scale */
+static bool RefChannelAffine(Node* node, const std::vector<const float*>& inputs, const std::vector<float*>& outputs)
+{
+    int batch, channel, h, w;
+
+    GetNCHW(GetDims(node, true, 0), batch, channel, h, w);
+
+    std::vector<float> scale;
+    std::vector<float> shift;
+
+    if (!GetChannelAffine(node, channel, scale, shift))
+        return false;
+
+    int plane = h * w;
+
+    for (int n = 0; n < batch; n++)
+    {
+        for (int c = 0; c < channel; c++)
+        {
+            size_t offset = (( size_t )n * channel + c) * plane;
+
+            for (int i = 0; i < plane; i++)
+                outputs[0][offset + i] = inputs[0][offset + i] * scale[c] + shift[c];
+        }
+    }
+
+    return true;
+}
+
+static bool RefConcat(Node* node, const std::vector<const float*>& inputs, const std::vector<float*>& outputs)
+{
+    Concat* concat_op = dynamic_cast<Concat*>(node->GetOp());
+    const std::vector<int>& out_dims = GetDims(node, false, 0);
+    int axis = concat_op->GetParam()->axis;
+
+    if (axis < 0)
+        axis += out_dims.size();
+
+    int outer = 1;
+
+    for (int i = 0; i < axis; i++)
+        outer *= out_dims[i];
+
+    int out_inner = GetElemNum(out_dims) / outer;
+    int offset = 0;
+
+    for (unsigned int j = 0; j < inputs.size(); j++)
+    {
+        int inner = GetElemNum(GetDims(node, true, j)) / outer;
+
+        for (int i = 0; i < outer; i++)
+            memcpy(outputs[0] + ( size_t )i * out_inner + offset, inputs[j] + ( size_t )i * inner,
+                   sizeof(float) * inner);
+
+        offset += inner;
+    }
+
+    return true;
+}
+
+static bool RefSoftmax(Node* node, const std::vector<const float*>& inputs, const std::vector<float*>& outputs)
+{
+    Softmax* softmax_op = dynamic_cast<Softmax*>(node->GetOp());
+    const std::vector<int>& dims = GetDims(node, true, 0);
+    int axis = softmax_op->GetParam()->axis;
+
+    if (axis < 0)
+        axis += dims.size();
+
+    int outer = 1;
+    int inner = 1;
+
+    for (int i = 0; i < axis; i++)
+        outer *= dims[i];
+
+    for (unsigned int i = axis + 1; i < dims.size(); i++)
+        inner *= dims[i];
+
+    int axis_num = dims[axis];
+
+    for (int i = 0; i < outer; i++)
+    {
+        for (int k = 0; k < inner; k++)
+        {
+            const float* in = inputs[0] + ( size_t )i * axis_num * inner + k;
+            float* out = outputs[0] + ( size_t )i * axis_num * inner + k;
+            float max_val = -FLT_MAX;
+            float sum = 0.f;
+
+            for (int j = 0; j < axis_num; j++)
+                max_val = std::max(max_val, in[j * inner]);
+
+            for (int j = 0; j < axis_num; j++)
+            {
+                out[j * inner] = std::exp(in[j * inner] - max_val);
+                sum += out[j * inner];
+            }
+
+            for (int j = 0; j < axis_num; j++)
+                out[j * inner] /= sum;
+        }
+    }
+
+    return true;
+}
+
+static const struct
+{
+    const char* op_name;
+    ref_forward_t forward;
+} ref_table[] = {
+    {"Convolution", RefConv},
+    {"Fused.ConvEltwise", RefConv},
+    {"Deconvolution", RefDeconv},
+    {"FullyConnected", RefFC},
+    {"Pooling", RefPooling},
+    {"ReLu", RefReLu},
+    {"ReLu6", RefReLu6},
+    {"PReLU", RefPReLU},
+    {"Sigmoid", RefSigmoid},
+    {"Tanh", RefTanh},
+    {"Eltwise", RefEltwise},
+    {BatchNormName, RefChannelAffine},
+    {"Scale", RefChannelAffine},
+    {"Concat", RefConcat},
+    {"Softmax", RefSoftmax},
+    {"Reshape", RefCopy},
+    {"Flatten", RefCopy},
+    {"Squeeze", RefCopy},
+    {"Unsqueeze", RefCopy},
+    {"Dropout", RefCopy},
+};
+
+static ref_forward_t GetRefFunc(const std::string& op_name)
+{
+    for (auto& entry : ref_table)
+    {
+        if (op_name == entry.op_name)
+            return entry.forward;
+    }
+
+    return nullptr;
+}
+
+bool RefForwardSupported(Node* node)
+{
+    const std::string& op_name = node->GetOp()->GetName();
+
+    if (GetRefFunc(op_name) == nullptr || node->GetOutputNum() != 1)
+        return false;
+
+    for (unsigned int i = 0; i < node->GetInputNum(); i++)
+    {
+        if (node->GetInputTensor(i)->GetDataType() != TENGINE_DT_FP32)
+            return false;
+    }
+
+    if (node->GetOutputTensor(0)->GetDataType() != TENGINE_DT_FP32)
+        return false;
+
+    if (op_name == "Convolution")
+        return IsRefActivation(node, GetConvParam(node)->activation);
+
+    /* the addend takes the place of the slopes */
+    if (op_name == FusedConvEltwise::class_name)
+        return node->GetInputNum() == 4 && GetConvParam(node)->activation != ActPRELU;
+
+    /* no alpha to go with the other functions */
+    if (op_name == "Deconvolution")
+        return dynamic_cast<Deconvolution*>(node->GetOp())->GetParam()->activation >= ActNONE;
+
+    if (op_name == "FullyConnected")
+        return IsRefActivation(node, dynamic_cast<FullyConnected*>(node->GetOp())->GetParam()->activation);
+
+    if (op_name == "PReLU")
+        return IsRefPReLU(node);
+
+    if (op_name == "Eltwise")
+        return IsRefEltwise(node);
+
+    return true;
+}
+
+bool RefForward(Node* node, const std::vector<const float*>& inputs, const std::vector<float*>& outputs)
+{
+    ref_forward_t forward = GetRefFunc(node->GetOp()->GetName());
+
+    if (forward == nullptr || !forward(node, inputs, outputs))
+    {
+        LOG_ERROR() << "node: " << node->GetName() << " op: " << node->GetOp()->GetName()
+                    << " has no reference forward\n";
+        return false;
+    }
+
+    return true;
+}
+
+}    // namespace TEngine
@@ -77,7 +77,7 @@ bool set_tensor_mem(Tensor* tensor, void* addr, int size, mem_release_t releaser
 
         if (releaser)
         {
-            tensor->SetAttr("free_mem", 1);
+            tensor->SetFreeMem(true);
         }
 
         return true;
@@ -25,6 +25,7 @@
 #define __ATTRIBUTE_HPP__
 
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "any.hpp"
@@ -104,7 +105,7 @@ public:
 
     void SetAttr(const std::string& name, any&& val)
     {
-        dict_map_[name] = val;
+        dict_map_[name] = std::move(val);
     }
 
     void SetAttr(const std::string& name, const any& val)
@@ -30,8 +30,19 @@
 
 namespace TEngine {
 
+/*
+ * the codes >= 0 clip at [0, activation], the others name a function.
+ * act_alpha/act_beta: the LeakyReLU/Elu alpha, or the Clip min/max.
+ * the PReLU slopes, one per output channel, are the input after the bias
+ */
 enum ActivationType
 {
+    ActCLIP = -9,
+    ActELU = -8,
+    ActLEAKY = -7,
+    ActPRELU = -6,
+    ActMISH = -5,
+    ActHSWISH = -4,
     ActTANH = -3,
     ActSIGMOD = -2,
     ActNONE = -1,
@@ -56,6 +67,8 @@ struct ConvParam : public NamedParam
     int pad_w0;    // left padding columns
     int pad_h1;    // bottom padding rows
     int pad_w1;    // right padding columns
+    float act_alpha;
+    float act_beta;
 
     DECLARE_PARSER_STRUCTURE(ConvParam)
     {
@@ -73,6 +86,8 @@ struct ConvParam : public NamedParam
         DECLARE_PARSER_ENTRY(pad_w0);
         DECLARE_PARSER_ENTRY(pad_h1);
         DECLARE_PARSER_ENTRY(pad_w1);
+        DECLARE_PARSER_ENTRY(act_alpha);
+        DECLARE_PARSER_ENTRY(act_beta);
     };
 };
 
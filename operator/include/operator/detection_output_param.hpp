@@ -39,6 +39,10 @@ struct DetectionOutputParam : public NamedParam
     DECLARE_PARSER_STRUCTURE(DetectionOutputParam)
     {
         DECLARE_PARSER_ENTRY(num_classes);
+        DECLARE_PARSER_ENTRY(keep_top_k);
+        DECLARE_PARSER_ENTRY(nms_top_k);
+        DECLARE_PARSER_ENTRY(confidence_threshold);
+        DECLARE_PARSER_ENTRY(nms_threshold);
     };
 };
 
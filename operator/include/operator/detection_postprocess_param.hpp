@@ -44,6 +44,7 @@ struct DetectionPostProcessParam : public NamedParam
         DECLARE_PARSER_ENTRY(nms_score_threshold);
         DECLARE_PARSER_ENTRY(nms_iou_threshold);
         DECLARE_PARSER_ENTRY(num_classes);
+        DECLARE_PARSER_ENTRY(scales);
     };
 };
 
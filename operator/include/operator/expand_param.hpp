@@ -35,6 +35,7 @@ struct ExpandParam : public NamedParam
     DECLARE_PARSER_STRUCTURE(ExpandParam)
     {
         DECLARE_PARSER_ENTRY(shape);
+        DECLARE_PARSER_ENTRY(dim_num);
     }
 };
 
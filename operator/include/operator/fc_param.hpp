@@ -31,10 +31,16 @@ namespace TEngine {
 struct FCParam : public NamedParam
 {
     int num_output;
+    int activation;    // ActivationType, as ConvParam
+    float act_alpha;
+    float act_beta;
 
     DECLARE_PARSER_STRUCTURE(FCParam)
     {
         DECLARE_PARSER_ENTRY(num_output);
+        DECLARE_PARSER_ENTRY(activation);
+        DECLARE_PARSER_ENTRY(act_alpha);
+        DECLARE_PARSER_ENTRY(act_beta);
     };
 };
 
@@ -46,6 +46,28 @@ public:
     static const std::string class_name;
 };
 
+/*
+ * output = act(conv(input, weight, bias) + addend): the tail of a residual block.
+ * the inputs are always input, weight, bias and addend; the activation is in ConvParam
+ */
+class FusedConvEltwise : public OperatorWithParam<FusedConvEltwise, ConvParam>
+{
+public:
+    FusedConvEltwise()
+    {
+        name_ = class_name;
+    }
+    FusedConvEltwise(const FusedConvEltwise&) = default;
+    virtual ~FusedConvEltwise(){};
+
+    void SetSchema(void) override;
+
+    bool InferShape(const std::vector<TEngine::TShape>&, std::vector<TEngine::TShape>&, int layout) override;
+    float GetFops(const std::vector<TShape>& inputs, const std::vector<TShape>& outputs) override;
+
+    static const std::string class_name;
+};
+
 }    // namespace TEngine
 
 #endif
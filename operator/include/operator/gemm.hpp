@@ -41,6 +41,8 @@ public:
     void SetSchema(void) override;
 
     bool InferShape(const std::vector<TEngine::TShape>&, std::vector<TEngine::TShape>&, int layout) override;
+
+    float GetFops(const std::vector<TEngine::TShape>&, const std::vector<TEngine::TShape>&) override;
 };
 }    // namespace TEngine
 
@@ -0,0 +1,46 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2020, Open AI Lab
+ */
+#ifndef __LAYERNORM_HPP__
+#define __LAYERNORM_HPP__
+
+#include "operator.hpp"
+#include "layernorm_param.hpp"
+
+namespace TEngine {
+
+class LayerNorm : public OperatorWithParam<LayerNorm, LayerNormParam>
+{
+public:
+    LayerNorm(void)
+    {
+        name_ = "LayerNorm";
+    }
+    LayerNorm(const LayerNorm&) = default;
+
+    void SetSchema(void) override;
+    bool InferShape(const std::vector<TShape>&, std::vector<TShape>&, int layout) override;
+};
+
+}    // namespace TEngine
+
+#endif
@@ -53,6 +53,7 @@ struct LRNParam : public NamedParam
         DECLARE_PARSER_ENTRY(istf);
         DECLARE_PARSER_ENTRY(k);
         DECLARE_PARSER_ENTRY(is_onnx);
+        DECLARE_PARSER_ENTRY(bias);
     };
 };
 
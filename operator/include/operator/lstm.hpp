@@ -16,6 +16,7 @@ public:
     LSTM(const LSTM&) = default;
     void SetSchema(void) override;
     bool InferShape(const std::vector<TShape>&, std::vector<TShape>&, int layout) override;
+    float GetFops(const std::vector<TShape>& inputs, const std::vector<TShape>& outputs) override;
     const char* GetKernelName(void)
     {
         return "kernel";
@@ -38,6 +38,7 @@ public:
     MatMul(const MatMul& src) = default;
     virtual ~MatMul(){};
     bool InferShape(const std::vector<TEngine::TShape>&, std::vector<TEngine::TShape>&, int layout) override;
+    float GetFops(const std::vector<TEngine::TShape>&, const std::vector<TEngine::TShape>&) override;
     void SetSchema(void) override;
 };
 
@@ -49,6 +49,19 @@ struct PriorBoxParam : public NamedParam
     DECLARE_PARSER_STRUCTURE(PriorBoxParam)
     {
         DECLARE_PARSER_ENTRY(offset);
+        DECLARE_PARSER_ENTRY(min_size);
+        DECLARE_PARSER_ENTRY(max_size);
+        DECLARE_PARSER_ENTRY(variance);
+        DECLARE_PARSER_ENTRY(aspect_ratio);
+        DECLARE_PARSER_ENTRY(flip);
+        DECLARE_PARSER_ENTRY(clip);
+        DECLARE_PARSER_ENTRY(img_size);
+        DECLARE_PARSER_ENTRY(img_h);
+        DECLARE_PARSER_ENTRY(img_w);
+        DECLARE_PARSER_ENTRY(step_w);
+        DECLARE_PARSER_ENTRY(step_h);
+        DECLARE_PARSER_ENTRY(num_priors_);
+        DECLARE_PARSER_ENTRY(out_dim_);
     };
 };
 
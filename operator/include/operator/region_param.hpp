@@ -42,6 +42,10 @@ struct RegionParam : public NamedParam
         DECLARE_PARSER_ENTRY(num_box);
         DECLARE_PARSER_ENTRY(num_classes);
         DECLARE_PARSER_ENTRY(biases);
+        DECLARE_PARSER_ENTRY(side);
+        DECLARE_PARSER_ENTRY(coords);
+        DECLARE_PARSER_ENTRY(confidence_threshold);
+        DECLARE_PARSER_ENTRY(nms_threshold);
     }
 };
 
@@ -57,6 +57,8 @@ struct ReshapeParam : public NamedParam
         DECLARE_PARSER_ENTRY(reverse);
         DECLARE_PARSER_ENTRY(is_mxnet);
         DECLARE_PARSER_ENTRY(is_onnx);
+        DECLARE_PARSER_ENTRY(re_shape);
+        DECLARE_PARSER_ENTRY(dim_size);
     };
 };
 
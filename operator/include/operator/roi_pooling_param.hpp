@@ -37,6 +37,8 @@ struct ROIPoolingParam : public NamedParam
     DECLARE_PARSER_STRUCTURE(ROIPoolingParam)
     {
         DECLARE_PARSER_ENTRY(spatial_scale);
+        DECLARE_PARSER_ENTRY(pooled_h);
+        DECLARE_PARSER_ENTRY(pooled_w);
     };
 };
 
@@ -56,11 +56,19 @@ struct RPNParam : public NamedParam
     int post_nms_topn;
     float nms_thresh;
 
+    /* generated from ratios, anchor_scales and basesize */
     std::vector<Anchor> anchors_;
 
     DECLARE_PARSER_STRUCTURE(RPNParam)
     {
         DECLARE_PARSER_ENTRY(feat_stride);
+        DECLARE_PARSER_ENTRY(ratios);
+        DECLARE_PARSER_ENTRY(anchor_scales);
+        DECLARE_PARSER_ENTRY(basesize);
+        DECLARE_PARSER_ENTRY(min_size);
+        DECLARE_PARSER_ENTRY(per_nms_topn);
+        DECLARE_PARSER_ENTRY(post_nms_topn);
+        DECLARE_PARSER_ENTRY(nms_thresh);
     };
 };
 
@@ -51,6 +51,10 @@ struct SliceParam : public NamedParam
         DECLARE_PARSER_ENTRY(ismxnet);
         DECLARE_PARSER_ENTRY(isonnx);
         DECLARE_PARSER_ENTRY(isncnn);
+        DECLARE_PARSER_ENTRY(slice_point_);
+        DECLARE_PARSER_ENTRY(begin_);
+        DECLARE_PARSER_ENTRY(size_);
+        DECLARE_PARSER_ENTRY(iscaffe);
     }
 };
 
@@ -39,6 +39,7 @@ struct SpatialTransformerParam : public NamedParam
     {
         DECLARE_PARSER_ENTRY(sampler_type);
         DECLARE_PARSER_ENTRY(transform_type);
+        DECLARE_PARSER_ENTRY(target_shape);
     };
 };
 
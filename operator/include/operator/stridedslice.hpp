@@ -24,6 +24,8 @@
 #ifndef __STRIDEDSLICE_HPP__
 #define __STRIDEDSLICE_HPP__
 
+#include <cstring>
+
 #include "operator.hpp"
 #include "stridedslice_param.hpp"
 
@@ -39,6 +41,21 @@ public:
     StridedSlice(const StridedSlice& src) = default;
 
     virtual ~StridedSlice() {}
+
+    /* begin/end/stride are arrays, which are not parser entries */
+    bool IsSameParam(Operator* op) override
+    {
+        StridedSlice* other = dynamic_cast<StridedSlice*>(op);
+
+        if (other == nullptr || !OperatorWithParam::IsSameParam(op))
+            return false;
+
+        StridedSliceParam* param = other->GetParam();
+
+        return !memcmp(param_.begin, param->begin, sizeof(param_.begin)) &&
+               !memcmp(param_.end, param->end, sizeof(param_.end)) &&
+               !memcmp(param_.stride, param->stride, sizeof(param_.stride));
+    }
     bool InferShape(const std::vector<TEngine::TShape>& ishape, std::vector<TEngine::TShape>& oshape,
                     int layout) override;
     void SetSchema(void) override;
@@ -43,6 +43,7 @@ struct TransposeParam : public NamedParam
         DECLARE_PARSER_ENTRY(dim_1);
         DECLARE_PARSER_ENTRY(dim_2);
         DECLARE_PARSER_ENTRY(dim_3);
+        DECLARE_PARSER_ENTRY(tr_shape);
     };
 };
 
@@ -44,7 +44,8 @@ enum UnaryType
     UNARY_ACOS,
     UNARY_ATAN,
     UNARY_RECIPROCAL,
-    UNARY_TANH
+    UNARY_TANH,
+    UNARY_ERF
 };
 
 namespace TEngine {
@@ -0,0 +1,83 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2020, Open AI Lab
+ */
+#include "operator/attention.hpp"
+
+namespace TEngine {
+
+/* softmax(q * k^T * scale + mask) * v, with q [..., Lq, d], k [..., Lk, d] and v [..., Lk, dv] */
+bool Attention::InferShape(const std::vector<TEngine::TShape>& ishape, std::vector<TEngine::TShape>& oshape, int layout)
+{
+    const std::vector<int>& q_dims = ishape[0].GetDim();
+    const std::vector<int>& k_dims = ishape[1].GetDim();
+    const std::vector<int>& v_dims = ishape[2].GetDim();
+
+    int dim_num = q_dims.size();
+
+    if (dim_num < 2 || k_dims.size() != q_dims.size() || v_dims.size() != q_dims.size())
+        return false;
+
+    int k_len = param_.transpose_k ? k_dims[dim_num - 2] : k_dims[dim_num - 1];
+    int k_depth = param_.transpose_k ? k_dims[dim_num - 1] : k_dims[dim_num - 2];
+
+    if (k_depth != q_dims[dim_num - 1] || k_len != v_dims[dim_num - 2])
+        return false;
+
+    std::vector<int> dims = q_dims;
+
+    dims[dim_num - 1] = v_dims[dim_num - 1];
+
+    TShape shape;
+
+    shape.SetDim(dims);
+    shape.SetDataLayout(ishape[0].GetDataLayout());
+
+    oshape[0] = shape;
+
+    return true;
+}
+
+float Attention::GetFops(const std::vector<TEngine::TShape>& inputs, const std::vector<TEngine::TShape>& outputs)
+{
+    const std::vector<int>& q_dims = inputs[0].GetDim();
+    const std::vector<int>& v_dims = inputs[2].GetDim();
+
+    int dim_num = q_dims.size();
+    int depth = q_dims[dim_num - 1];
+    int k_len = v_dims[dim_num - 2];
+
+    /* q * k^T, then the scores * v: the output holds batch * Lq * dv elements */
+    float ops = 1.0f * outputs[0].GetSize() / v_dims[dim_num - 1] * k_len * (depth + v_dims[dim_num - 1]) * 2;
+
+    return ops;
+}
+
+void Attention::SetSchema(void)
+{
+    Input({"query:float32", "key:float32", "value:float32", "mask:float32"})
+        .Output({"output:float32"})
+        .SetAttr("scale", 1.0f)
+        .SetAttr("transpose_k", 1)
+        .SetDoc(R"DOC(scaled dot-product attention: softmax(q * k^T * scale + mask) * v)DOC");
+}
+
+}    // namespace TEngine
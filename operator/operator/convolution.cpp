@@ -159,6 +159,10 @@ float Convolution::GetFops(const std::vector<TShape>& inputs, const std::vector<
 
     float ops = 1.0f * per_input_c * param_.kernel_h * param_.kernel_w * outputs[0].GetSize() * 2;
 
+    /* the bias add */
+    if (inputs.size() > 2)
+        ops += outputs[0].GetSize();
+
     if (ops < 0)
     {
         std::cout << "input_c: " << per_input_c << " kernel_h: " << param_.kernel_h << " kernel_w: " << param_.kernel_w;
@@ -186,6 +190,8 @@ void Convolution::SetSchema(void)
         .SetAttr("pad_w0", 0)
         .SetAttr("pad_h1", 0)
         .SetAttr("pad_w1", 0)
+        .SetAttr("act_alpha", 0.f)
+        .SetAttr("act_beta", 0.f)
         .SetDoc(R"DOC(Convolution Layer)DOC");
 }
 
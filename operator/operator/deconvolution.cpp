@@ -102,7 +102,12 @@ bool Deconvolution::InferShape(const std::vector<TShape>& ishape, std::vector<TS
 
 float Deconvolution::GetFops(const std::vector<TShape>& inputs, const std::vector<TShape>& outputs)
 {
-    float ops = 1.0f * param_.num_output * param_.kernel_h * param_.kernel_w * inputs[0].GetSize() * 2;
+    /* each input element is scattered to the kernel window of the output channels of its group */
+    int group = param_.group > 0 ? param_.group : 1;
+    float ops = 1.0f * (param_.num_output / group) * param_.kernel_h * param_.kernel_w * inputs[0].GetSize() * 2;
+
+    if (inputs.size() > 2)
+        ops += outputs[0].GetSize();
 
     return ops;
 }
@@ -55,6 +55,17 @@ bool Eltwise::InferShape(const std::vector<TShape>& ishape, std::vector<TShape>&
     return true;
 }
 
+float Eltwise::GetFops(const std::vector<TShape>& inputs, const std::vector<TShape>& outputs)
+{
+    /* one operation per output element, a power with scale and shift takes three */
+    float fops = outputs[0].GetSize();
+
+    if (param_.type == ELT_POWER)
+        fops *= 3;
+
+    return fops;
+}
+
 void Eltwise::SetSchema(void)
 {
     Input({"input:float32"})
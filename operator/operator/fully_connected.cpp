@@ -78,16 +78,18 @@ bool FullyConnected::InferShape(const std::vector<TEngine::TShape>& ishape, std:
 
 float FullyConnected::GetFops(const std::vector<TShape>& inputs, const std::vector<TShape>& outputs)
 {
-    const TShape& input = inputs[0];
-    const TShape& weight = inputs[1];
+    const std::vector<int>& weight_dims = inputs[1].GetDim();
 
-    int m = input.GetN();
-
-    int n = weight.GetH();
-    int k = weight.GetW();
+    /* weight: [num_output][k], the input is m rows of k */
+    int n = weight_dims[0];
+    int k = weight_dims[weight_dims.size() - 1];
+    float m = 1.0f * inputs[0].GetSize() / k;
 
     float fops = m * n * k * 2;
 
+    if (inputs.size() > 2)
+        fops += m * n;
+
     return fops;
 }
 
@@ -96,6 +98,9 @@ void FullyConnected::SetSchema(void)
     Input({"input:float32", "weight:float32", "bias:float32"})
         .Output({"output:float32"})
         .SetAttr("num_output", 10)
+        .SetAttr("activation", -1)
+        .SetAttr("act_alpha", 0.f)
+        .SetAttr("act_beta", 0.f)
         .SetDoc(R"DOC(Fully Connected Operator)DOC");
 }
 
@@ -43,4 +43,63 @@ float FusedBNScaleReLu::GetFops(const std::vector<TShape>& inputs, const std::ve
     return outputs[0].GetSize() * 5;
 }
 
+const std::string FusedConvEltwise::class_name("Fused.ConvEltwise");
+
+bool FusedConvEltwise::InferShape(const std::vector<TEngine::TShape>& ishape, std::vector<TEngine::TShape>& oshape,
+                                  int layout)
+{
+    if (ishape.size() != 4)
+        return false;
+
+    Convolution conv;
+
+    *conv.GetParam() = param_;
+
+    if (!conv.InferShape(ishape, oshape, layout))
+        return false;
+
+    /* the pads may be resolved by the convolution */
+    param_ = *conv.GetParam();
+
+    if (ishape[3].GetDim() != oshape[0].GetDim())
+    {
+        LOG_ERROR() << "the addend does not match the convolution output\n";
+        return false;
+    }
+
+    return true;
+}
+
+float FusedConvEltwise::GetFops(const std::vector<TShape>& inputs, const std::vector<TShape>& outputs)
+{
+    Convolution conv;
+
+    *conv.GetParam() = param_;
+
+    return conv.GetFops(inputs, outputs) + outputs[0].GetSize();
+}
+
+void FusedConvEltwise::SetSchema(void)
+{
+    Input({"input:float32", "weight:float32", "bias:float32", "addend:float32"})
+        .Output({"output:float32"})
+        .SetAttr("kernel_h", 1)
+        .SetAttr("kernel_w", 1)
+        .SetAttr("stride_h", 1)
+        .SetAttr("stride_w", 1)
+        .SetAttr("dilation_h", 1)
+        .SetAttr("dilation_w", 1)
+        .SetAttr("input_channel", 1)
+        .SetAttr("output_channel", 1)
+        .SetAttr("group", 1)
+        .SetAttr("activation", -1)
+        .SetAttr("pad_h0", 0)
+        .SetAttr("pad_w0", 0)
+        .SetAttr("pad_h1", 0)
+        .SetAttr("pad_w1", 0)
+        .SetAttr("act_alpha", 0.f)
+        .SetAttr("act_beta", 0.f)
+        .SetDoc(R"DOC(Fused Convolution/Eltwise sum/activation)DOC");
+}
+
 }    // namespace TEngine
@@ -58,6 +58,21 @@ bool Gemm::InferShape(const std::vector<TEngine::TShape>& ishape, std::vector<TE
     return true;
 }
 
+float Gemm::GetFops(const std::vector<TEngine::TShape>& inputs, const std::vector<TEngine::TShape>& outputs)
+{
+    const TShape& input = inputs[0];
+    int k = param_.transA ? input.Shape(0) : input.Shape(1);
+    float mn = outputs[0].GetSize();
+
+    /* alpha * A * B, plus beta * C */
+    float fops = mn * k * 2 + mn;
+
+    if (inputs.size() > 2)
+        fops += mn * 2;
+
+    return fops;
+}
+
 void Gemm::SetSchema(void)
 {
     Input({"input:float32", "weight: float32", "bias: float32"})
@@ -37,6 +37,19 @@ bool GRU::InferShape(const std::vector<TShape>& ishape, std::vector<TShape>& osh
     return true;
 }
 
+float GRU::GetFops(const std::vector<TShape>& inputs, const std::vector<TShape>& outputs)
+{
+    const std::vector<int>& input_dims = inputs[0].GetDim();
+    int input_size = input_dims[input_dims.size() - 1];
+    int hidden_size = param_.hidden_size;
+
+    /* every step of every batch: [x, h] * kernel to the 2 gates and the candidate, the biases, then 3 activations and 5 ops */
+    float steps = 1.0f * inputs[0].GetSize() / input_size;
+    float step_fops = 2.0f * 3 * hidden_size * (input_size + hidden_size) + 3 * hidden_size + 8 * hidden_size;
+
+    return steps * step_fops;
+}
+
 void GRU::SetSchema(void)
 {
     Input({"input:float32", "kernel:float32", "bias:float32", "init_h:float32"})
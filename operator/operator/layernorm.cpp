@@ -0,0 +1,49 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2020, Open AI Lab
+ */
+#include "operator/layernorm.hpp"
+
+namespace TEngine {
+
+bool LayerNorm::InferShape(const std::vector<TEngine::TShape>& ishape, std::vector<TEngine::TShape>& oshape, int layout)
+{
+    int dim_num = ishape[0].GetDim().size();
+    int axis = param_.axis < 0 ? param_.axis + dim_num : param_.axis;
+
+    if (axis < 0 || axis >= dim_num)
+        return false;
+
+    oshape[0] = ishape[0];
+
+    return true;
+}
+
+void LayerNorm::SetSchema(void)
+{
+    Input({"input:float32", "gamma:float32", "beta:float32"})
+        .Output({"output:float32"})
+        .SetAttr("eps", 1e-5f)
+        .SetAttr("axis", -1)
+        .SetDoc(R"DOC(output is (x - mean) / sqrt(var + eps) * gamma + beta, over the dims from axis on)DOC");
+}
+
+}    // namespace TEngine
@@ -42,6 +42,22 @@ bool LSTM::InferShape(const std::vector<TShape>& ishape, std::vector<TShape>& os
     return true;
 }
 
+float LSTM::GetFops(const std::vector<TShape>& inputs, const std::vector<TShape>& outputs)
+{
+    const std::vector<int>& input_dims = inputs[0].GetDim();
+    int input_size = input_dims[input_dims.size() - 1];
+    int hidden_size = param_.hidden_size;
+
+    /* every step of every batch: [x, h] * kernel to the 4 gates, the biases, then 4 activations and 5 ops on the cell */
+    float steps = 1.0f * inputs[0].GetSize() / input_size;
+    float step_fops = 2.0f * 4 * hidden_size * (input_size + hidden_size) + 4 * hidden_size + 9 * hidden_size;
+
+    if (param_.has_peephole)
+        step_fops += 6 * hidden_size;
+
+    return steps * step_fops;
+}
+
 void LSTM::SetSchema(void)
 {
     Input({"input:float32", "kernel:float32", "bias:float32", "w_f_diag:float32", "w_o_diag:float32",
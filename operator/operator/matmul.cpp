@@ -71,6 +71,14 @@ bool MatMul::InferShape(const std::vector<TEngine::TShape>& ishape, std::vector<
     return true;
 }
 
+float MatMul::GetFops(const std::vector<TEngine::TShape>& inputs, const std::vector<TEngine::TShape>& outputs)
+{
+    const std::vector<int>& dim0 = inputs[0].GetDim();
+
+    /* each output element is a dot product of the last dim of input 0 */
+    return 2.0f * outputs[0].GetSize() * dim0[dim0.size() - 1];
+}
+
 void MatMul::SetSchema(void)
 {
     Input({"input:float32"}).Output({"output:float32"}).SetDoc(R"DOC(MatMul Operator)DOC");
@@ -160,6 +160,14 @@ float Pooling::GetFops(const std::vector<TShape>& inputs, const std::vector<TSha
 {
     float patch_fops = param_.kernel_h * param_.kernel_w;
 
+    /* the kernel is the whole input plane */
+    if (param_.global)
+    {
+        const TShape& input = inputs[0];
+
+        patch_fops = 1.0f * input.GetH() * input.GetW();
+    }
+
     return (patch_fops * outputs[0].GetSize());
 }
 
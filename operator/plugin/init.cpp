@@ -136,6 +136,9 @@
 #include "operator/reciprocal.hpp"
 #include "operator/spatialtransformer.hpp"
 #include "operator/nms.hpp"
+#include "operator/layernorm.hpp"
+#include "operator/gelu.hpp"
+#include "operator/attention.hpp"
 
 using namespace TEngine;
 
@@ -157,6 +160,7 @@ int operator_plugin_init(void)
     RegisterOp<Scale>("Scale");
     RegisterOp<LRN>("LRN");
     RegisterOp<FusedBNScaleReLu>(FusedBNScaleReLu::class_name);
+    RegisterOp<FusedConvEltwise>(FusedConvEltwise::class_name);
     RegisterOp<PReLU>("PReLU");
     RegisterOp<Eltwise>("Eltwise");
     RegisterOp<Slice>("Slice");
@@ -253,6 +257,9 @@ int operator_plugin_init(void)
     RegisterOp<Reciprocal>("Reciprocal");
     RegisterOp<SpatialTransformer>("SpatialTransformer");
     RegisterOp<NMS>("NMS");
+    RegisterOp<LayerNorm>("LayerNorm");
+    RegisterOp<Gelu>("Gelu");
+    RegisterOp<Attention>("Attention");
     // std::cout<<"OPERATOR PLUGIN INITED\n";
     return 0;
 }
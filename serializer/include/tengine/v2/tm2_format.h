@@ -152,6 +152,10 @@ typedef uint8_t tm_bool_t; /* bool is 1-byte unsigned integer */
 #define TM2_OPSTR_RECIPROCAL "Reciprocal"
 #define TM2_OPSTR_NMS "NMS"
 #define TM2_OPSTR_SPATIALTRANSFORMER "SpatialTransformer"
+#define TM2_OPSTR_LAYERNORM "LayerNorm"
+#define TM2_OPSTR_GELU "Gelu"
+#define TM2_OPSTR_ATTENTION "Attention"
+#define TM2_OPSTR_FUSEDCONVELTWISE "Fused.ConvEltwise"
 /* Operator types */
 #define TM2_OPTYPE_ACCURACY 0 /* No Param                 */
 #define TM2_OPTYPE_BATCHNORMALIZATION 1 /* TM2_BatchNormParam       */
@@ -259,7 +263,11 @@ typedef uint8_t tm_bool_t; /* bool is 1-byte unsigned integer */
 #define TM2_OPTYPE_RECIPROCAL 103
 #define TM2_OPTYPE_NMS 104
 #define TM2_OPTYPE_SPATIALTRANSFORMER 105
-#define TM2_OPTYPE_NUM 106
+#define TM2_OPTYPE_LAYERNORM 106 /* TM2_LayerNormParam */
+#define TM2_OPTYPE_GELU 107 /* TM2_GeluParam */
+#define TM2_OPTYPE_ATTENTION 108 /* TM2_AttentionParam */
+#define TM2_OPTYPE_FUSEDCONVELTWISE 109 /* TM2_ConvParam */
+#define TM2_OPTYPE_NUM 110
 
 /* --------------------- -------- TM objects -------------------------------- */
 
@@ -310,6 +318,7 @@ typedef struct
     tm_uoffset_t offset_s_nname; /* offset of string <node name> */
     tm_uoffset_t offset_vo_attrs; /* offset of TM2_Vector_offsets <attrs> */
     tm_bool_t dynamic_shape;
+    tm_bool_t static_shape; /* the dims of the output tensors are final, fits in the padding: 0 in older files */
 } TM2_Node;
 
 typedef struct
@@ -419,6 +428,8 @@ typedef struct
     int32_t pad_w0; /* left padding columns */
     int32_t pad_h1; /* bottom padding rows */
     int32_t pad_w1; /* right padding columns */
+    float act_alpha; /* op_ver 2 */
+    float act_beta; /* op_ver 2 */
 } TM2_ConvParam;
 
 typedef struct
@@ -458,6 +469,9 @@ typedef struct
 typedef struct
 {
     int32_t num_output;
+    int32_t activation; /* op_ver 2 */
+    float act_alpha; /* op_ver 2 */
+    float act_beta; /* op_ver 2 */
 } TM2_FCParam;
 
 typedef struct
@@ -998,6 +1012,23 @@ typedef struct
     int score_threshold;
 }TM2_NMSParam;
 
+typedef struct
+{
+    float eps;
+    int32_t axis;
+} TM2_LayerNormParam;
+
+typedef struct
+{
+    int32_t approximate; /* 0: erf, 1: tanh */
+} TM2_GeluParam;
+
+typedef struct
+{
+    float scale;
+    int32_t transpose_k;
+} TM2_AttentionParam;
+
 #ifdef __cplusplus
 }
 #endif
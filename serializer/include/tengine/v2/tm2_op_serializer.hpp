@@ -124,6 +124,9 @@
 #include "operator/reciprocal.hpp"
 #include "operator/nms.hpp"
 #include "operator/spatialtransformer.hpp"
+#include "operator/layernorm.hpp"
+#include "operator/gelu.hpp"
+#include "operator/attention.hpp"
 
 #include "operator/batch_norm_param.hpp"
 #include "operator/concat_param.hpp"
@@ -200,6 +203,9 @@
 #include "operator/log_softmax_param.hpp"
 #include "operator/nms_param.hpp"
 #include "operator/spatialtransformer_param.hpp"
+#include "operator/layernorm_param.hpp"
+#include "operator/gelu_param.hpp"
+#include "operator/attention_param.hpp"
 #include "tm2_format.h"
 
 namespace TEngine {
@@ -319,6 +325,10 @@ bool LoadTmSoftplusOp(StaticGraph* graph, StaticNode* node, void* const start_pt
 bool LoadTmReciprocalOp(StaticGraph* graph, StaticNode* node, void* const start_ptr, const TM2_Operator* tm_op);
 bool LoadTmNMSOp(StaticGraph* graph, StaticNode* node, void* const start_ptr, const TM2_Operator* tm_op);
 bool LoadTmSpatialTransformerOp(StaticGraph* graph, StaticNode* node, void* const start_ptr, const TM2_Operator* tm_op);
+bool LoadTmLayerNormOp(StaticGraph* graph, StaticNode* node, void* const start_ptr, const TM2_Operator* tm_op);
+bool LoadTmGeluOp(StaticGraph* graph, StaticNode* node, void* const start_ptr, const TM2_Operator* tm_op);
+bool LoadTmAttentionOp(StaticGraph* graph, StaticNode* node, void* const start_ptr, const TM2_Operator* tm_op);
+bool LoadTmFusedConvEltwiseOp(StaticGraph* graph, StaticNode* node, void* const start_ptr, const TM2_Operator* tm_op);
 
 
 op_save_t SaveTmOpFunc(uint32_t op_type);
@@ -426,6 +436,10 @@ tm_uoffset_t SaveTmSoftplusOp(void* const start_ptr, tm_uoffset_t* cur_pos, Oper
 tm_uoffset_t SaveTmReciprocalOp(void* const start_ptr, tm_uoffset_t* cur_pos, Operator* op);
 tm_uoffset_t SaveTmNMSop(void* const start_ptr, tm_uoffset_t* cur_pos, Operator* op);
 tm_uoffset_t SaveTmSpatialTransformerOp(void* const start_ptr, tm_uoffset_t* cur_pos, Operator* op);
+tm_uoffset_t SaveTmLayerNormOp(void* const start_ptr, tm_uoffset_t* cur_pos, Operator* op);
+tm_uoffset_t SaveTmGeluOp(void* const start_ptr, tm_uoffset_t* cur_pos, Operator* op);
+tm_uoffset_t SaveTmAttentionOp(void* const start_ptr, tm_uoffset_t* cur_pos, Operator* op);
+tm_uoffset_t SaveTmFusedConvEltwiseOp(void* const start_ptr, tm_uoffset_t* cur_pos, Operator* op);
 
 
 template <typename T> const T* GetTmPtr(void* const start_ptr, tm_uoffset_t tm_offset)
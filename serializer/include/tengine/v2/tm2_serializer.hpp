@@ -37,7 +37,7 @@ namespace TMSerializer2 {
 
 class TmSerializer2 : public TmSerializer
 {
-    using name_map_t = std::unordered_map<std::string, unsigned int>;
+    using tensor_map_t = std::unordered_map<const Tensor*, unsigned int>;
 
 public:
     TmSerializer2()
@@ -58,7 +58,7 @@ public:
     bool LoadGraph(StaticGraph* graph, const TM2_Model* tm_model, void* mmap_buf);
 
     tm_uoffset_t SaveTmSubgraph(void* const start_ptr, tm_uoffset_t* cur_pos, Graph* graph);
-    tm_uoffset_t SaveTmNode(void* const start_ptr, tm_uoffset_t* cur_pos, Node* node, name_map_t& tensor_name_map);
+    tm_uoffset_t SaveTmNode(void* const start_ptr, tm_uoffset_t* cur_pos, Node* node, tensor_map_t& tensor_map);
     tm_uoffset_t SaveTmTensor(void* const start_ptr, tm_uoffset_t* cur_pos, Tensor* tensor, unsigned int tensor_id,
                               unsigned int buffer_id);
 
@@ -93,10 +93,10 @@ bool LoadTmConstOp(StaticGraph* graph, StaticNode* node, void* const start_ptr,
     return true;
 }
 
-bool LoadTmConvOp(StaticGraph* graph, StaticNode* node, void* const start_ptr, const TM2_Operator* tm_op)
+/* Convolution and Fused.ConvEltwise share TM2_ConvParam */
+static bool LoadTmConvParamOp(StaticGraph* graph, StaticNode* node, void* const start_ptr, const TM2_Operator* tm_op,
+                              const std::string& op_str)
 {
-    const std::string& op_str = TM2_OPSTR_CONVOLUTION;
-
     ConvParam param = any_cast<ConvParam>(OpManager::GetOpDefParam(op_str));
     const TM2_ConvParam* tm_param = GetTmPtr<TM2_ConvParam>(start_ptr, tm_op->offset_t_param);
 
@@ -115,12 +115,24 @@ bool LoadTmConvOp(StaticGraph* graph, StaticNode* node, void* const start_ptr, c
     param.pad_w0 = tm_param->pad_w0;
     param.pad_w1 = tm_param->pad_w1;
 
+    /* the older params stop at pad_w1 */
+    if (tm_op->op_ver >= 2)
+    {
+        param.act_alpha = tm_param->act_alpha;
+        param.act_beta = tm_param->act_beta;
+    }
+
     StaticOp* op = CreateStaticOp(graph, op_str);
     SetOperatorParam(op, param);
     SetNodeOp(node, op);
     return true;
 }
 
+bool LoadTmConvOp(StaticGraph* graph, StaticNode* node, void* const start_ptr, const TM2_Operator* tm_op)
+{
+    return LoadTmConvParamOp(graph, node, start_ptr, tm_op, TM2_OPSTR_CONVOLUTION);
+}
+
 bool LoadTmDeconvOp(StaticGraph* graph, StaticNode* node, void* const start_ptr, const TM2_Operator* tm_op)
 {
     const std::string& op_str = TM2_OPSTR_DECONVOLUTION;
@@ -217,6 +229,13 @@ bool LoadTmFCOp(StaticGraph* graph, StaticNode* node, void* const start_ptr, con
 
     param.num_output = tm_param->num_output;
 
+    if (tm_op->op_ver >= 2)
+    {
+        param.activation = tm_param->activation;
+        param.act_alpha = tm_param->act_alpha;
+        param.act_beta = tm_param->act_beta;
+    }
+
     StaticOp* op = CreateStaticOp(graph, op_str);
     SetOperatorParam(op, param);
     SetNodeOp(node, op);
@@ -1698,6 +1717,58 @@ bool LoadTmSpatialTransformerOp(StaticGraph* graph, StaticNode* node, void* cons
     return true;
 
 }
+bool LoadTmLayerNormOp(StaticGraph* graph, StaticNode* node, void* const start_ptr, const TM2_Operator* tm_op)
+{
+    const std::string& op_str = TM2_OPSTR_LAYERNORM;
+
+    LayerNormParam param = any_cast<LayerNormParam>(OpManager::GetOpDefParam(op_str));
+    const TM2_LayerNormParam* tm_param = GetTmPtr<TM2_LayerNormParam>(start_ptr, tm_op->offset_t_param);
+
+    param.eps = tm_param->eps;
+    param.axis = tm_param->axis;
+
+    StaticOp* op = CreateStaticOp(graph, op_str);
+    SetOperatorParam(op, param);
+    SetNodeOp(node, op);
+    return true;
+}
+
+bool LoadTmGeluOp(StaticGraph* graph, StaticNode* node, void* const start_ptr, const TM2_Operator* tm_op)
+{
+    const std::string& op_str = TM2_OPSTR_GELU;
+
+    GeluParam param = any_cast<GeluParam>(OpManager::GetOpDefParam(op_str));
+    const TM2_GeluParam* tm_param = GetTmPtr<TM2_GeluParam>(start_ptr, tm_op->offset_t_param);
+
+    param.approximate = tm_param->approximate;
+
+    StaticOp* op = CreateStaticOp(graph, op_str);
+    SetOperatorParam(op, param);
+    SetNodeOp(node, op);
+    return true;
+}
+
+bool LoadTmAttentionOp(StaticGraph* graph, StaticNode* node, void* const start_ptr, const TM2_Operator* tm_op)
+{
+    const std::string& op_str = TM2_OPSTR_ATTENTION;
+
+    AttentionParam param = any_cast<AttentionParam>(OpManager::GetOpDefParam(op_str));
+    const TM2_AttentionParam* tm_param = GetTmPtr<TM2_AttentionParam>(start_ptr, tm_op->offset_t_param);
+
+    param.scale = tm_param->scale;
+    param.transpose_k = tm_param->transpose_k;
+
+    StaticOp* op = CreateStaticOp(graph, op_str);
+    SetOperatorParam(op, param);
+    SetNodeOp(node, op);
+    return true;
+}
+
+bool LoadTmFusedConvEltwiseOp(StaticGraph* graph, StaticNode* node, void* const start_ptr, const TM2_Operator* tm_op)
+{
+    return LoadTmConvParamOp(graph, node, start_ptr, tm_op, TM2_OPSTR_FUSEDCONVELTWISE);
+}
+
 op_load_t LoadTmOpFunc(uint32_t op_type)
 {
     switch(op_type)
@@ -1914,6 +1985,14 @@ op_load_t LoadTmOpFunc(uint32_t op_type)
             return LoadTmNMSOp;
         case TM2_OPTYPE_SPATIALTRANSFORMER:
             return LoadTmSpatialTransformerOp;
+        case TM2_OPTYPE_LAYERNORM:
+            return LoadTmLayerNormOp;
+        case TM2_OPTYPE_GELU:
+            return LoadTmGeluOp;
+        case TM2_OPTYPE_ATTENTION:
+            return LoadTmAttentionOp;
+        case TM2_OPTYPE_FUSEDCONVELTWISE:
+            return LoadTmFusedConvEltwiseOp;
         default:
             LOG_ERROR() << "Operator #" << op_type << " not supported in tengine model yet\n";
             return nullptr;
@@ -2150,6 +2229,14 @@ std::string GetOpStr(uint32_t op_type)
             return std::string(TM2_OPSTR_NMS);
         case TM2_OPTYPE_SPATIALTRANSFORMER:
             return std::string(TM2_OPSTR_SPATIALTRANSFORMER);
+        case TM2_OPTYPE_LAYERNORM:
+            return std::string(TM2_OPSTR_LAYERNORM);
+        case TM2_OPTYPE_GELU:
+            return std::string(TM2_OPSTR_GELU);
+        case TM2_OPTYPE_ATTENTION:
+            return std::string(TM2_OPSTR_ATTENTION);
+        case TM2_OPTYPE_FUSEDCONVELTWISE:
+            return std::string(TM2_OPSTR_FUSEDCONVELTWISE);
         default:
             LOG_ERROR() << "Get operator string failed\n";
             return std::string("");
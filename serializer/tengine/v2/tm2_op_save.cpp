@@ -86,9 +86,10 @@ tm_uoffset_t SaveTmConstOp(void* const start_ptr, tm_uoffset_t* cur_pos, Operato
     return WriteTmObject(start_ptr, cur_pos, &tm_op, sizeof(TM2_Operator));
 }
 
-tm_uoffset_t SaveTmConvOp(void* const start_ptr, tm_uoffset_t* cur_pos, Operator* op)
+/* Convolution and Fused.ConvEltwise share TM2_ConvParam */
+static tm_uoffset_t SaveTmConvParamOp(void* const start_ptr, tm_uoffset_t* cur_pos, const ConvParam* p,
+                                      uint32_t op_type)
 {
-    ConvParam* p = (dynamic_cast<Convolution*>(op))->GetParam();
     TM2_ConvParam tm_param;
     memset(&tm_param, 0, sizeof(TM2_ConvParam));
 
@@ -106,13 +107,21 @@ tm_uoffset_t SaveTmConvOp(void* const start_ptr, tm_uoffset_t* cur_pos, Operator
     tm_param.pad_h1 = p->pad_h1;
     tm_param.pad_w0 = p->pad_w0;
     tm_param.pad_w1 = p->pad_w1;
+    tm_param.act_alpha = p->act_alpha;
+    tm_param.act_beta = p->act_beta;
 
     TM2_Operator tm_op;
     memset(&tm_op, 0, sizeof(TM2_Operator));
-    SetTmOperator(&tm_op, TM2_OPTYPE_CONVOLUTION, WriteTmObject(start_ptr, cur_pos, &tm_param, sizeof(TM2_ConvParam)));
+    tm_op.op_ver = 2;
+    SetTmOperator(&tm_op, op_type, WriteTmObject(start_ptr, cur_pos, &tm_param, sizeof(TM2_ConvParam)));
     return WriteTmObject(start_ptr, cur_pos, &tm_op, sizeof(TM2_Operator));
 }
 
+tm_uoffset_t SaveTmConvOp(void* const start_ptr, tm_uoffset_t* cur_pos, Operator* op)
+{
+    return SaveTmConvParamOp(start_ptr, cur_pos, (dynamic_cast<Convolution*>(op))->GetParam(), TM2_OPTYPE_CONVOLUTION);
+}
+
 tm_uoffset_t SaveTmDeconvOp(void* const start_ptr, tm_uoffset_t* cur_pos, Operator* op)
 {
     DeconvParam* p = (dynamic_cast<Deconvolution*>(op))->GetParam();
@@ -188,9 +197,13 @@ tm_uoffset_t SaveTmFCOp(void* const start_ptr, tm_uoffset_t* cur_pos, Operator*
     TM2_FCParam tm_param;
     memset(&tm_param, 0, sizeof(TM2_FCParam));
     tm_param.num_output = p->num_output;
+    tm_param.activation = p->activation;
+    tm_param.act_alpha = p->act_alpha;
+    tm_param.act_beta = p->act_beta;
 
     TM2_Operator tm_op;
     memset(&tm_op, 0, sizeof(TM2_Operator));
+    tm_op.op_ver = 2;
     SetTmOperator(&tm_op, TM2_OPTYPE_FULLYCONNECTED, WriteTmObject(start_ptr, cur_pos, &tm_param, sizeof(TM2_FCParam)));
     return WriteTmObject(start_ptr, cur_pos, &tm_op, sizeof(TM2_Operator));
 }
@@ -1770,6 +1783,53 @@ tm_uoffset_t SaveTmSpatialTransformerOp(void* const start_ptr, tm_uoffset_t* cur
     return WriteTmObject(start_ptr, cur_pos, &tm_op, sizeof(TM2_Operator));
 
 }
+tm_uoffset_t SaveTmLayerNormOp(void* const start_ptr, tm_uoffset_t* cur_pos, Operator* op)
+{
+    LayerNormParam* p = (dynamic_cast<LayerNorm*>(op))->GetParam();
+    TM2_LayerNormParam tm_param;
+    memset(&tm_param, 0, sizeof(TM2_LayerNormParam));
+    tm_param.eps = p->eps;
+    tm_param.axis = p->axis;
+
+    TM2_Operator tm_op;
+    memset(&tm_op, 0, sizeof(TM2_Operator));
+    SetTmOperator(&tm_op, TM2_OPTYPE_LAYERNORM, WriteTmObject(start_ptr, cur_pos, &tm_param, sizeof(TM2_LayerNormParam)));
+    return WriteTmObject(start_ptr, cur_pos, &tm_op, sizeof(TM2_Operator));
+}
+
+tm_uoffset_t SaveTmGeluOp(void* const start_ptr, tm_uoffset_t* cur_pos, Operator* op)
+{
+    GeluParam* p = (dynamic_cast<Gelu*>(op))->GetParam();
+    TM2_GeluParam tm_param;
+    memset(&tm_param, 0, sizeof(TM2_GeluParam));
+    tm_param.approximate = p->approximate;
+
+    TM2_Operator tm_op;
+    memset(&tm_op, 0, sizeof(TM2_Operator));
+    SetTmOperator(&tm_op, TM2_OPTYPE_GELU, WriteTmObject(start_ptr, cur_pos, &tm_param, sizeof(TM2_GeluParam)));
+    return WriteTmObject(start_ptr, cur_pos, &tm_op, sizeof(TM2_Operator));
+}
+
+tm_uoffset_t SaveTmAttentionOp(void* const start_ptr, tm_uoffset_t* cur_pos, Operator* op)
+{
+    AttentionParam* p = (dynamic_cast<Attention*>(op))->GetParam();
+    TM2_AttentionParam tm_param;
+    memset(&tm_param, 0, sizeof(TM2_AttentionParam));
+    tm_param.scale = p->scale;
+    tm_param.transpose_k = p->transpose_k;
+
+    TM2_Operator tm_op;
+    memset(&tm_op, 0, sizeof(TM2_Operator));
+    SetTmOperator(&tm_op, TM2_OPTYPE_ATTENTION, WriteTmObject(start_ptr, cur_pos, &tm_param, sizeof(TM2_AttentionParam)));
+    return WriteTmObject(start_ptr, cur_pos, &tm_op, sizeof(TM2_Operator));
+}
+
+tm_uoffset_t SaveTmFusedConvEltwiseOp(void* const start_ptr, tm_uoffset_t* cur_pos, Operator* op)
+{
+    return SaveTmConvParamOp(start_ptr, cur_pos, (dynamic_cast<FusedConvEltwise*>(op))->GetParam(),
+                             TM2_OPTYPE_FUSEDCONVELTWISE);
+}
+
 op_save_t SaveTmOpFunc(uint32_t op_type)
 {
     switch(op_type)
@@ -1986,6 +2046,14 @@ op_save_t SaveTmOpFunc(uint32_t op_type)
             return SaveTmNMSOp;
         case TM2_OPTYPE_SPATIALTRANSFORMER:
             return SaveTmSpatialTransformerOp;
+        case TM2_OPTYPE_LAYERNORM:
+            return SaveTmLayerNormOp;
+        case TM2_OPTYPE_GELU:
+            return SaveTmGeluOp;
+        case TM2_OPTYPE_ATTENTION:
+            return SaveTmAttentionOp;
+        case TM2_OPTYPE_FUSEDCONVELTWISE:
+            return SaveTmFusedConvEltwiseOp;
         default:
             LOG_ERROR() << "Operator #" << op_type << " not supported in tengine model yet\n";
             return nullptr;
@@ -46,13 +46,6 @@
 #define TYPE_INFO_POINTER 4
 #define TYPE_INFO_GENERIC 5
 
-namespace TEngine {
-
-extern int NodeSetParamGeneric(void* node, const char* param_name, const char* type_name, const void* param_val,
-                               int size);
-extern int NodeAddParamGeneric(void* node, const char* param_name, const char* type_name, int param_size);
-}    // namespace TEngine
-
 using namespace TEngine;
 
 namespace TEngine {
@@ -128,7 +121,7 @@ tm_uoffset_t TmSerializer2::SaveTmTensor(void* const start_ptr, tm_uoffset_t* cu
 
     if(tm_with_string)
     {
-        std::string name = tensor->GetName();
+        const std::string& name = tensor->GetName();
         TM2_String tensor_name;
         memset(&tensor_name, 0, sizeof(TM2_String));
         tensor_name.size = name.size() + 1;    // including trailing \0
@@ -173,8 +166,8 @@ tm_uoffset_t TmSerializer2::SaveTmTensor(void* const start_ptr, tm_uoffset_t* cu
 
             qtparam.zero_point = p.zero_point;
             qtparam.scale = p.scale;
-            // qtparam.width = p.width; // width has not value 
-            qtparam.width = 0;
+            /* only the calibrated tensors have a real width, 32 is the unset default */
+            qtparam.width = p.width < 32 ? p.width : 0;
 
             v_qtparams->offsets[i] = WriteTmObject(start_ptr, cur_pos, &qtparam, sizeof(TM2_QuantParam));
         }
@@ -190,18 +183,19 @@ tm_uoffset_t TmSerializer2::SaveTmTensor(void* const start_ptr, tm_uoffset_t* cu
 }
 
 tm_uoffset_t TmSerializer2::SaveTmNode(void* const start_ptr, tm_uoffset_t* cur_pos, Node* node,
-                                       name_map_t& tensor_name_map)
+                                       tensor_map_t& tensor_map)
 {
     TM2_Node tm_node;
     memset(&tm_node, 0, sizeof(TM2_Node));
     tm_node.node_id = node->GetNodeIndex();
     tm_node.dynamic_shape = node->IsDynamicShape();
+    tm_node.static_shape = node->IsStaticShape();
 
     bool tm_with_string = IsSaveString();
 
     if(tm_with_string)
     {
-        std::string name = node->GetName();
+        const std::string& name = node->GetName();
         TM2_String node_name;
         node_name.size = name.size() + 1;    // including trailing \0
         node_name.offset_data = WriteTmFileAlign1(start_ptr, cur_pos, name.c_str(), node_name.size);
@@ -224,7 +218,7 @@ tm_uoffset_t TmSerializer2::SaveTmNode(void* const start_ptr, tm_uoffset_t* cur_
             // printf("start input %d  %d %d %d \n", i, input_num, node->GetInputNum(), output_num);
             Tensor* p_tensor = node->GetInputTensor(i);
             // printf("%s \n", p_tensor->GetName().c_str());
-            v_input_indices->indices[i] = tensor_name_map[p_tensor->GetName()];
+            v_input_indices->indices[i] = tensor_map[p_tensor];
         }
         tm_node.offset_vi_input_tensors = WriteTmObject(start_ptr, cur_pos, v_input_indices, vector_size);
         free(v_input_indices);
@@ -241,7 +235,7 @@ tm_uoffset_t TmSerializer2::SaveTmNode(void* const start_ptr, tm_uoffset_t* cur_
         for(unsigned int i = 0; i < output_num; i++)
         {
             Tensor* p_tensor = node->GetOutputTensor(i);
-            v_output_indices->indices[i] = tensor_name_map[p_tensor->GetName()];
+            v_output_indices->indices[i] = tensor_map[p_tensor];
         }
         tm_node.offset_vi_output_tensors = WriteTmObject(start_ptr, cur_pos, v_output_indices, vector_size);
         free(v_output_indices);
@@ -277,14 +271,14 @@ tm_uoffset_t TmSerializer2::SaveTmNode(void* const start_ptr, tm_uoffset_t* cur_
     {
         TM2_Attr tm_attr;
         std::string attr_name = it->first;
-        CustomNodeAttr attr = it->second;
+        const CustomNodeAttr& attr = it->second;
         TM2_String tm_attr_name, tm_attr_val;
         tm_attr_name.size = attr_name.size() + 1;    // including trailing \0
         tm_attr_name.offset_data = WriteTmFileAlign1(start_ptr, cur_pos, attr_name.c_str(), attr_name.size());
         tm_attr.offset_s_attrname = WriteTmObject(start_ptr, cur_pos, &tm_attr_name, sizeof(TM2_String));
 
         tm_attr_val.size = attr.attr_size;    // no trailing \0
-        tm_attr_val.offset_data = WriteTmFileAlign1(start_ptr, cur_pos, &(attr.mem), attr.attr_size);
+        tm_attr_val.offset_data = WriteTmFileAlign1(start_ptr, cur_pos, attr.mem.data(), attr.attr_size);
         tm_attr.offset_s_attrval = WriteTmObject(start_ptr, cur_pos, &tm_attr_val, sizeof(TM2_String));
 
         tm_attr.attr_type = typename_to_int(attr.type_name);
@@ -321,7 +315,7 @@ tm_uoffset_t TmSerializer2::SaveTmSubgraph(void* const start_ptr, tm_uoffset_t*
     std::vector<Tensor*> tensor_ptrs;
     std::vector<void*> buf_ptrs;
     std::vector<unsigned int> buf_sizes;
-    name_map_t tensor_name_map; /* map of tensor name and tensor index */
+    tensor_map_t tensor_map; /* map of tensor and tensor index */
     bool tm_no_data = !IsSaveData();
 
     /* Write the nodes */
@@ -336,10 +330,10 @@ tm_uoffset_t TmSerializer2::SaveTmSubgraph(void* const start_ptr, tm_uoffset_t*
         {
             Tensor* p_tensor = p_node->GetOutputTensor(k);
             tensor_ptrs.push_back(p_tensor);
-            tensor_name_map[p_tensor->GetName()] = tensor_num;
+            tensor_map[p_tensor] = tensor_num;
             tensor_num++;
         }
-        v_nodes->offsets[i] = SaveTmNode(start_ptr, cur_pos, p_node, tensor_name_map);
+        v_nodes->offsets[i] = SaveTmNode(start_ptr, cur_pos, p_node, tensor_map);
     }
     /* Write the vector of nodes */
     tm_subgraph.offset_vo_seq_nodes = WriteTmObject(start_ptr, cur_pos, v_nodes, vector_size);
@@ -484,7 +478,7 @@ bool TmSerializer2::LoadNode(StaticGraph* graph, StaticNode* node, const TM2_Nod
         /* Set the input tensors to the node */
         for(unsigned int i = 0; i < v_input_tensors->v_num; i++)
         {
-            StaticTensor* tensor = graph->tensor_list[v_input_tensors->indices[i]].get();
+            StaticTensor* tensor = graph->tensor_list[v_input_tensors->indices[i]];
             if(!tensor)
             {
                 LOG_ERROR() << "The input tensor not exist: " << v_input_tensors->indices[i] << "\n";
@@ -502,7 +496,7 @@ bool TmSerializer2::LoadNode(StaticGraph* graph, StaticNode* node, const TM2_Nod
         /* Set the output tensors to the node */
         for(unsigned int i = 0; i < v_output_tensors->v_num; i++)
         {
-            StaticTensor* tensor = graph->tensor_list[v_output_tensors->indices[i]].get();
+            StaticTensor* tensor = graph->tensor_list[v_output_tensors->indices[i]];
             if(!tensor)
             {
                 LOG_ERROR() << "The output tensor not exist: " << v_output_tensors->indices[i] << "\n";
@@ -512,10 +506,13 @@ bool TmSerializer2::LoadNode(StaticGraph* graph, StaticNode* node, const TM2_Nod
         }
     }
 
-    /* set the custom attributes into static node */
+    /* set the custom attributes into static node, the graph node gets them from there */
     if(tm_node->offset_vo_attrs == TM2_NOT_SET)
         return true;
 
+    node->attrs.SetAttr(ATTR_CUSTOM_ATTR, node_custom_attr_map_t());
+
+    node_custom_attr_map_t* attr_map = any_cast<node_custom_attr_map_t>(&node->attrs.GetAttr(ATTR_CUSTOM_ATTR));
     const TM2_Vector_offsets* v_attrs = GetTmPtr<TM2_Vector_offsets>(mmap_buf, tm_node->offset_vo_attrs);
     for(unsigned int i = 0; i < v_attrs->v_num; i++)
     {
@@ -524,15 +521,13 @@ bool TmSerializer2::LoadNode(StaticGraph* graph, StaticNode* node, const TM2_Nod
         const TM2_String* tm_attr_val = GetTmPtr<TM2_String>(mmap_buf, tm_attr->offset_s_attrval);
 
         const char* attr_name = GetTmPtr<char>(mmap_buf, tm_attr_name->offset_data);
-        const char* attr_val = GetTmPtr<char>(mmap_buf, tm_attr_val->offset_data);
-        const char* type_name = int_to_typename(tm_attr->attr_type);
+        const uint8_t* attr_val = GetTmPtr<uint8_t>(mmap_buf, tm_attr_val->offset_data);
 
-        if(NodeAddParamGeneric(node, attr_name, type_name, tm_attr_val->size) < 0 ||
-           NodeSetParamGeneric(node, attr_name, type_name, attr_val, tm_attr_val->size) < 0)
-        {
-            LOG_ERROR() << "Add and set node param failed\n";
-            return false;
-        }
+        CustomNodeAttr& attr = (*attr_map)[std::string(attr_name, tm_attr_name->size - 1)];
+
+        attr.type_name = int_to_typename(tm_attr->attr_type);
+        attr.attr_size = tm_attr_val->size;
+        attr.mem.assign(attr_val, attr_val + tm_attr_val->size);
     }
 
     return true;
@@ -678,6 +673,9 @@ bool TmSerializer2::LoadGraph(StaticGraph* graph, const TM2_Model* tm_model, voi
 
         /* Set the dynamic shape of the operator */
         node->op->dynamic_shape = tm_node->dynamic_shape;
+
+        if(tm_node->static_shape)
+            SetOperatorStaticShape(node->op);
     }
 
     if(i < v_nodes->v_num)
@@ -690,7 +688,7 @@ bool TmSerializer2::LoadGraph(StaticGraph* graph, const TM2_Model* tm_model, voi
     /* Set the input nodes */
     for(unsigned int i = 0; i < v_input_nodes->v_num; i++)
     {
-        StaticNode* node = graph->node_list[v_input_nodes->indices[i]].get();
+        StaticNode* node = graph->node_list[v_input_nodes->indices[i]];
         if(!node)
         {
             LOG_ERROR() << "Input node #" << v_input_nodes->indices[i] << " not exist\n";
@@ -702,7 +700,7 @@ bool TmSerializer2::LoadGraph(StaticGraph* graph, const TM2_Model* tm_model, voi
     /* Set the output nodes */
     for(unsigned int i = 0; i < v_output_nodes->v_num; i++)
     {
-        StaticNode* node = graph->node_list[v_output_nodes->indices[i]].get();
+        StaticNode* node = graph->node_list[v_output_nodes->indices[i]];
         if(!node)
         {
             LOG_ERROR() << "Output node #" << v_output_nodes->indices[i] << " not exist\n";
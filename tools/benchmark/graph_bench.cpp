@@ -0,0 +1,541 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2020, Open AI Lab
+ */
+
+/*
+ * Micro-benchmarks for the graph building and optimization paths, run on
+ * synthetic graphs so that no model file is needed:
+ *
+ *   graph_bench lookup [node_num]    build a StaticGraph, resolving every input by name
+ *   graph_bench create [node_num]    build the runtime Graph from a StaticGraph, copying it
+ *   graph_bench take [node_num]      the same, the Graph taking the StaticGraph over
+ *   graph_bench rewrite [node_num]   fuse the Conv, BatchNormalization and ReLu blocks of a chain in one rewrite
+ *   graph_bench bnfold [channel_num] fold a BatchNormalization into a large Convolution and a large FullyConnected
+ *
+ * run one mode per process: the peak RSS reported is the one of the process
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+
+#include "tengine_c_api.h"
+#include "static_graph.hpp"
+#include "static_graph_interface.hpp"
+#include "graph.hpp"
+#include "graph_optimizer.hpp"
+#include "operator/relu_param.hpp"
+#include "operator/conv_param.hpp"
+#include "operator/batch_norm_param.hpp"
+#include "operator/fc_param.hpp"
+
+using namespace TEngine;
+
+namespace {
+
+double ElapsedMs(const std::chrono::steady_clock::time_point& start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/* VmRSS or VmHWM of /proc/self/status, in KB */
+long GetProcMem(const char* key)
+{
+    FILE* fp = fopen("/proc/self/status", "r");
+
+    if (fp == nullptr)
+        return 0;
+
+    char line[128];
+    long val = 0;
+    size_t key_len = strlen(key);
+
+    while (fgets(line, sizeof(line), fp))
+    {
+        if (!strncmp(line, key, key_len) && line[key_len] == ':')
+        {
+            val = strtol(line + key_len + 1, nullptr, 10);
+            break;
+        }
+    }
+
+    fclose(fp);
+
+    return val;
+}
+
+/* a chain of ReLu nodes, with names and shapes like the ones of an exported model */
+StaticGraph* CreateChainGraph(int node_num)
+{
+    StaticGraph* graph = CreateStaticGraph("bench");
+    StaticTensor* prev = nullptr;
+
+    for (int i = 0; i < node_num; i++)
+    {
+        std::string name = "model/encoder/block_" + std::to_string(i / 8) + "/node_" + std::to_string(i);
+        StaticNode* node = CreateStaticNode(graph, name);
+        StaticTensor* tensor = CreateStaticTensor(graph, name + ":0");
+
+        SetTensorDataType(tensor, TENGINE_DT_FP32);
+        SetTensorDim(tensor, {1, 64, 56, 56});
+
+        if (prev)
+            AddNodeInputTensor(node, prev);
+
+        AddNodeOutputTensor(node, tensor);
+
+        StaticOp* op = CreateStaticOp(graph, i > 0 ? "ReLu" : "InputOp");
+
+        if (i > 0)
+        {
+            ReLuParam param;
+            param.negative_slope = 0.f;
+            SetOperatorParam(op, param);
+        }
+
+        SetNodeOp(node, op);
+
+        if (i == 0)
+            AddGraphInputNode(graph, node);
+
+        prev = tensor;
+    }
+
+    AddGraphOutputNode(graph, graph->node_list.back());
+
+    return graph;
+}
+
+int BenchCreate(int node_num, bool take_over)
+{
+    long base_rss = GetProcMem("VmRSS");
+
+    StaticGraphPtr static_graph(CreateChainGraph(node_num));
+
+    long static_rss = GetProcMem("VmRSS");
+
+    auto start = std::chrono::steady_clock::now();
+
+    Graph* graph = Graph::CreateFromStatic("bench", static_graph, take_over);
+
+    double create_ms = ElapsedMs(start);
+
+    if (graph == nullptr || graph->seq_nodes.size() != ( size_t )node_num)
+    {
+        printf("%s: failed to create the graph\n", take_over ? "take" : "create");
+        return -1;
+    }
+
+    long graph_rss = GetProcMem("VmRSS");
+
+    printf("%s: %d nodes, CreateFromStatic %.1f ms, RSS static graph %ld KB, after create %ld KB, peak %ld KB\n",
+           take_over ? "take" : "create", node_num, create_ms, static_rss - base_rss, graph_rss - base_rss,
+           GetProcMem("VmHWM"));
+
+    delete graph;
+
+    return 0;
+}
+
+/* a Const node holding a single FP32 value */
+StaticTensor* AddScalarConst(StaticGraph* graph, const std::string& name, float value)
+{
+    StaticNode* node = CreateStaticNode(graph, name);
+    StaticTensor* tensor = CreateStaticConstTensor(graph, name);
+    float* mem = ( float* )malloc(sizeof(float));
+
+    *mem = value;
+
+    SetTensorDim(tensor, {1});
+    SetTensorDataType(tensor, TENGINE_DT_FP32);
+    SetTensorSize(tensor, sizeof(float));
+    SetConstTensorBuffer(tensor, mem);
+
+    AddNodeOutputTensor(node, tensor);
+    SetNodeOp(node, CreateStaticOp(graph, "Const"));
+
+    return tensor;
+}
+
+/* a Const node of FP32 values around base, not all the same so that a wrong fold shows */
+StaticTensor* AddFilledConst(StaticGraph* graph, const std::string& name, const std::vector<int>& dims, float base)
+{
+    StaticNode* node = CreateStaticNode(graph, name);
+    StaticTensor* tensor = CreateStaticConstTensor(graph, name);
+    size_t num = 1;
+
+    for (int dim : dims)
+        num *= dim;
+
+    float* mem = ( float* )malloc(num * sizeof(float));
+
+    for (size_t i = 0; i < num; i++)
+        mem[i] = base + (i % 97) * 0.01f;
+
+    SetTensorDim(tensor, dims);
+    SetTensorDataType(tensor, TENGINE_DT_FP32);
+    SetTensorSize(tensor, num * sizeof(float));
+    SetConstTensorBuffer(tensor, mem);
+
+    AddNodeOutputTensor(node, tensor);
+    SetNodeOp(node, CreateStaticOp(graph, "Const"));
+
+    return tensor;
+}
+
+StaticTensor* AddOpNode(StaticGraph* graph, const std::string& name, StaticOp* op,
+                        const std::vector<StaticTensor*>& inputs, const std::vector<int>& dims)
+{
+    StaticNode* node = CreateStaticNode(graph, name);
+    StaticTensor* tensor = CreateStaticTensor(graph, name);
+
+    SetTensorDataType(tensor, TENGINE_DT_FP32);
+    SetTensorDim(tensor, dims);
+
+    for (auto input : inputs)
+        AddNodeInputTensor(node, input);
+
+    AddNodeOutputTensor(node, tensor);
+    SetNodeOp(node, op);
+
+    return tensor;
+}
+
+StaticTensor* AddChainNode(StaticGraph* graph, const std::string& name, StaticOp* op,
+                           const std::vector<StaticTensor*>& inputs)
+{
+    return AddOpNode(graph, name, op, inputs, {1, 1, 8, 8});
+}
+
+StaticTensor* AddInputNode(StaticGraph* graph, const std::string& name, const std::vector<int>& dims)
+{
+    StaticNode* node = CreateStaticNode(graph, name);
+    StaticTensor* tensor = CreateStaticTensor(graph, name);
+
+    SetTensorDataType(tensor, TENGINE_DT_FP32);
+    SetTensorDim(tensor, dims);
+    AddNodeOutputTensor(node, tensor);
+    SetNodeOp(node, CreateStaticOp(graph, "InputOp"));
+    AddGraphInputNode(graph, node);
+
+    return tensor;
+}
+
+/* a BatchNormalization of channel_num channels after layer_tensor, as a graph output */
+void AddBNNode(StaticGraph* graph, const std::string& name, StaticTensor* layer_tensor, int channel_num,
+               const std::vector<int>& dims)
+{
+    BatchNormParam param = any_cast<BatchNormParam>(OpManager::GetOpDefParam("BatchNormalization"));
+    StaticOp* op = CreateStaticOp(graph, "BatchNormalization");
+
+    param.caffe_flavor = 0;
+    SetOperatorParam(op, param);
+
+    StaticTensor* gamma = AddFilledConst(graph, name + "/gamma", {channel_num}, 1.f);
+    StaticTensor* beta = AddFilledConst(graph, name + "/beta", {channel_num}, 0.f);
+    StaticTensor* mean = AddFilledConst(graph, name + "/mean", {channel_num}, 0.5f);
+    StaticTensor* var = AddFilledConst(graph, name + "/var", {channel_num}, 2.f);
+
+    AddOpNode(graph, name, op, {layer_tensor, gamma, beta, mean, var}, dims);
+    AddGraphOutputNode(graph, graph->node_list.back());
+}
+
+/*
+ * blocks of 1x1 Convolution --> BatchNormalization --> ReLu, 9 nodes with the consts:
+ * ConvBN and ConvReLu both apply to every block, the second one to the node the first made
+ */
+int BenchRewrite(int node_num)
+{
+    int block_num = node_num / 9;
+    StaticGraphPtr static_graph(CreateStaticGraph("bench"));
+    StaticGraph* graph = static_graph.get();
+
+    StaticTensor* prev = AddInputNode(graph, "input", {1, 1, 8, 8});
+
+    ConvParam conv_param = any_cast<ConvParam>(OpManager::GetOpDefParam("Convolution"));
+    BatchNormParam bn_param = any_cast<BatchNormParam>(OpManager::GetOpDefParam("BatchNormalization"));
+    ReLuParam relu_param;
+
+    conv_param.input_channel = 1;
+    conv_param.output_channel = 1;
+    bn_param.caffe_flavor = 0;
+    relu_param.negative_slope = 0.f;
+
+    for (int i = 0; i < block_num; i++)
+    {
+        std::string name = "block_" + std::to_string(i);
+
+        StaticOp* conv_op = CreateStaticOp(graph, "Convolution");
+        StaticOp* bn_op = CreateStaticOp(graph, "BatchNormalization");
+        StaticOp* relu_op = CreateStaticOp(graph, "ReLu");
+
+        SetOperatorParam(conv_op, conv_param);
+        SetOperatorParam(bn_op, bn_param);
+        SetOperatorParam(relu_op, relu_param);
+
+        StaticTensor* weight = AddScalarConst(graph, name + "/weight", 0.5f);
+        StaticTensor* bias = AddScalarConst(graph, name + "/bias", 0.1f);
+
+        prev = AddChainNode(graph, name + "/conv", conv_op, {prev, weight, bias});
+
+        StaticTensor* gamma = AddScalarConst(graph, name + "/gamma", 1.f);
+        StaticTensor* beta = AddScalarConst(graph, name + "/beta", 0.f);
+        StaticTensor* mean = AddScalarConst(graph, name + "/mean", 0.2f);
+        StaticTensor* var = AddScalarConst(graph, name + "/var", 2.f);
+
+        prev = AddChainNode(graph, name + "/bn", bn_op, {prev, gamma, beta, mean, var});
+        prev = AddChainNode(graph, name + "/relu", relu_op, {prev});
+    }
+
+    AddGraphOutputNode(graph, graph->node_list.back());
+
+    Graph* rt_graph = Graph::CreateFromStatic("bench", static_graph, true);
+
+    if (rt_graph == nullptr)
+    {
+        printf("rewrite: failed to create the graph\n");
+        return -1;
+    }
+
+    size_t orig_num = rt_graph->seq_nodes.size();
+
+    /* the fusions CPURunner::OptimizeGraph applies to such a graph, in its order */
+    std::vector<std::string> fusions = {"PadFuse",  "BNScale", "FcBn",     "UnsEltConv", "ConvBN",
+                                        "DeconvBN", "BNConv",  "ConvReLu", "ConvReLu6"};
+
+    auto start = std::chrono::steady_clock::now();
+
+    int rewrite_num = GraphFuse(rt_graph, fusions);
+
+    double fuse_ms = ElapsedMs(start);
+
+    size_t fused_num = rt_graph->seq_nodes.size();
+
+    delete rt_graph;
+
+    if (rewrite_num != 2 * block_num)
+    {
+        printf("rewrite: %d rewrites, %d expected\n", rewrite_num, 2 * block_num);
+        return -1;
+    }
+
+    printf("rewrite: %zu nodes --> %zu, %d rewrites, GraphFuse %.1f ms\n", orig_num, fused_num, rewrite_num, fuse_ms);
+
+    return 0;
+}
+
+/*
+ * a 3x3 Convolution of channel_num x 1024 channels and a FullyConnected of 1000 x 50000, each followed
+ * by a BatchNormalization: the time to fold the BN into the weights, which is all in the weight loops
+ */
+int BenchBNFold(int channel_num)
+{
+    StaticGraphPtr static_graph(CreateStaticGraph("bench"));
+    StaticGraph* graph = static_graph.get();
+
+    /* the weight shapes are read by the layout */
+    SetGraphLayout(graph, TENGINE_LAYOUT_NCHW);
+    SetModelLayout(graph, TENGINE_LAYOUT_NCHW);
+
+    ConvParam conv_param = any_cast<ConvParam>(OpManager::GetOpDefParam("Convolution"));
+    FCParam fc_param = any_cast<FCParam>(OpManager::GetOpDefParam("FullyConnected"));
+
+    conv_param.kernel_h = 3;
+    conv_param.kernel_w = 3;
+    conv_param.pad_h0 = conv_param.pad_h1 = 1;
+    conv_param.pad_w0 = conv_param.pad_w1 = 1;
+    conv_param.input_channel = 1024;
+    conv_param.output_channel = channel_num;
+    fc_param.num_output = 1000;
+
+    StaticOp* conv_op = CreateStaticOp(graph, "Convolution");
+    StaticOp* fc_op = CreateStaticOp(graph, "FullyConnected");
+
+    SetOperatorParam(conv_op, conv_param);
+    SetOperatorParam(fc_op, fc_param);
+
+    std::vector<int> conv_dims = {1, channel_num, 8, 8};
+    StaticTensor* conv_input = AddInputNode(graph, "conv_input", {1, 1024, 8, 8});
+    StaticTensor* conv_weight = AddFilledConst(graph, "conv/weight", {channel_num, 1024, 3, 3}, 0.1f);
+    StaticTensor* conv_bias = AddFilledConst(graph, "conv/bias", {channel_num}, 0.f);
+    StaticTensor* conv = AddOpNode(graph, "conv", conv_op, {conv_input, conv_weight, conv_bias}, conv_dims);
+
+    AddBNNode(graph, "conv_bn", conv, channel_num, conv_dims);
+
+    StaticTensor* fc_input = AddInputNode(graph, "fc_input", {1, 50000});
+    StaticTensor* fc_weight = AddFilledConst(graph, "fc/weight", {1000, 50000}, 0.2f);
+    StaticTensor* fc_bias = AddFilledConst(graph, "fc/bias", {1000}, 0.f);
+    StaticTensor* fc = AddOpNode(graph, "fc", fc_op, {fc_input, fc_weight, fc_bias}, {1, 1000});
+
+    AddBNNode(graph, "fc_bn", fc, 1000, {1, 1000});
+
+    Graph* rt_graph = Graph::CreateFromStatic("bench", static_graph, true);
+
+    if (rt_graph == nullptr)
+    {
+        printf("bnfold: failed to create the graph\n");
+        return -1;
+    }
+
+    double weight_mb = (( double )channel_num * 1024 * 9 + 1000.0 * 50000) * sizeof(float) / (1 << 20);
+    double fold_ms[2];
+    const char* fusions[2] = {"ConvBN", "FcBn"};
+
+    for (int i = 0; i < 2; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        bool done = GraphOptimizerManager::RunOpt(fusions[i], rt_graph);
+
+        fold_ms[i] = ElapsedMs(start);
+
+        if (!done)
+        {
+            printf("bnfold: %s failed\n", fusions[i]);
+            delete rt_graph;
+            return -1;
+        }
+    }
+
+    int bn_num = 0;
+
+    for (auto node : rt_graph->seq_nodes)
+        bn_num += node->GetOp()->GetName() == "BatchNormalization";
+
+    delete rt_graph;
+
+    if (bn_num != 0)
+    {
+        printf("bnfold: %d BatchNormalization nodes left\n", bn_num);
+        return -1;
+    }
+
+    printf("bnfold: %.1f MB of weights, ConvBN %.1f ms, FcBn %.1f ms\n", weight_mb, fold_ms[0], fold_ms[1]);
+
+    return 0;
+}
+
+/* a chain of nodes, each resolving its input tensor by name, as the frontends do */
+int BenchLookup(int node_num)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    StaticGraph* graph = CreateStaticGraph("bench");
+
+    for (int i = 0; i < node_num; i++)
+    {
+        std::string name = "node_" + std::to_string(i);
+        StaticNode* node = CreateStaticNode(graph, name);
+
+        if (i > 0)
+        {
+            StaticTensor* input = FindTensor(graph, "node_" + std::to_string(i - 1));
+
+            if (input == nullptr)
+            {
+                printf("lookup: tensor node_%d not found\n", i - 1);
+                return -1;
+            }
+
+            AddNodeInputTensor(node, input);
+        }
+
+        StaticTensor* output = CreateStaticTensor(graph, name);
+        AddNodeOutputTensor(node, output);
+        SetNodeOp(node, CreateStaticOp(graph, i > 0 ? "ReLu" : "InputOp"));
+    }
+
+    double build_ms = ElapsedMs(start);
+
+    start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < node_num; i++)
+    {
+        std::string name = "node_" + std::to_string(i);
+
+        if (FindNode(graph, name) == nullptr || FindTensor(graph, name) == nullptr)
+        {
+            printf("lookup: node %s not found\n", name.c_str());
+            return -1;
+        }
+    }
+
+    double find_ms = ElapsedMs(start);
+
+    DestroyStaticGraph(graph);
+
+    printf("lookup: %d nodes, build+resolve %.1f ms, FindNode+FindTensor %.1f ms\n", node_num, build_ms, find_ms);
+
+    return 0;
+}
+
+void ShowUsage(const char* prog)
+{
+    fprintf(stderr, "usage: %s <mode> [node_num]\n", prog);
+    fprintf(stderr, "    lookup   build a chain StaticGraph resolving inputs by name (default 200000 nodes)\n");
+    fprintf(stderr, "    create   copy a chain StaticGraph into a Graph (default 200000 nodes)\n");
+    fprintf(stderr, "    take     let a Graph take a chain StaticGraph over (default 200000 nodes)\n");
+    fprintf(stderr, "    rewrite  fuse a chain of Conv/BN/ReLu blocks in one rewrite (default 50000 nodes)\n");
+    fprintf(stderr, "    bnfold   fold BNs into a channel_num x 1024 3x3 Conv and a 1000 x 50000 FC (default 2048 channels)\n");
+}
+
+}    // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        ShowUsage(argv[0]);
+        return 1;
+    }
+
+    const char* mode = argv[1];
+    int node_num = argc > 2 ? atoi(argv[2]) : 0;
+
+    if (init_tengine() < 0)
+    {
+        fprintf(stderr, "init tengine failed\n");
+        return 1;
+    }
+
+    int ret;
+
+    if (!strcmp(mode, "lookup"))
+        ret = BenchLookup(node_num > 0 ? node_num : 200000);
+    else if (!strcmp(mode, "create") || !strcmp(mode, "take"))
+        ret = BenchCreate(node_num > 0 ? node_num : 200000, !strcmp(mode, "take"));
+    else if (!strcmp(mode, "rewrite"))
+        ret = BenchRewrite(node_num > 0 ? node_num : 50000);
+    else if (!strcmp(mode, "bnfold"))
+        ret = BenchBNFold(node_num > 0 ? node_num : 2048);
+    else
+    {
+        ShowUsage(argv[0]);
+        ret = -1;
+    }
+
+    release_tengine();
+
+    return ret < 0 ? 1 : 0;
+}
@@ -25,21 +25,284 @@
 #include "config.hpp"
 
 #include <stdlib.h>
+#include <strings.h>
 #include <iostream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
 #include <unistd.h>
+#include <dirent.h>
+#include <getopt.h>
 
 #include "tengine_c_api.h"
+#include "tengine_operations.h"
 
 const char* help_params = "[Convert Tools Info]: optional arguments:\n"
                       "\t-h    help            show this help message and exit\n"
                       "\t-f    input type      path to input float32 tmfile\n"
                       "\t-p    input structure path to the network structure of input model(*.prototxt, *.symbol, *.cfg, *.pdmodel)\n"
                       "\t-m    input params    path to the network params of input model(*.caffemodel, *.params, *.weight, *.pb, *.onnx, *.tflite, *.pdiparams)\n"
-                      "\t-o    output model    path to output fp32 tmfile\n";
+                      "\t-o    output model    path to output fp32 tmfile\n"
+                      "\t-n    nchw layout     convert a NHWC model (tensorflow, tflite) to NCHW\n"
+                      "\t-k    prepack         also store the weights packed for the kernels: gemm4x16,gemm8x12,wino23,wino63\n"
+                      "\t-s    input shapes    resolve and store every tensor shape and the activation memory plan for these input shapes, e.g. 1,3,224,224;1,10\n"
+                      "\t-r    report          (or --report) print the flops and bytes of the heaviest nodes, and save all to this json file. -o is optional then\n"
+                      "\t-c    calib images    directory of sample images: calibrate the graph and store the int8 scales of the tensors\n"
+                      "\t-q    calib method    kl (default), minmax or percentile, the latter with an optional :<percent>, e.g. percentile:99.9\n"
+                      "\t-e    preprocess      of the calib images, pixels in [0, 255] and BGR by default, e.g. mean:104,117,123;scale:0.017;rgb;letterbox\n"
+                      "\t-u    fuse            (or --fuse) also fuse into the ops whose kernels only newer runtimes have, comma separated:\n"
+                      "\t                      conv_eltwise  a convolution and the residual sum after it, into Fused.ConvEltwise\n"
+                      "\t                      activation    the activation after a convolution or fc (sigmoid, tanh, elu, prelu, ...), into it\n"
+                      "\t                      transformer   the layer norm, gelu and attention subgraphs, into LayerNorm, Gelu and Attention\n";
 
 const char* example_params = "[Convert Tools Info]: example arguments:\n"
                              "\t./convert_tool -f caffe -p ./mobilenet.prototxt -m ./mobilenet.caffemodel -o ./mobilenet.tmfile\n";
 
+/* "1,3,224,224;1,10": the shapes of the graph inputs, in order */
+static bool set_input_shapes(graph_t graph, const std::string& shapes)
+{
+    std::stringstream shape_list(shapes);
+    std::string shape;
+    int input_idx = 0;
+
+    while (std::getline(shape_list, shape, ';'))
+    {
+        std::stringstream dim_list(shape);
+        std::string dim;
+        std::vector<int> dims;
+
+        while (std::getline(dim_list, dim, ','))
+        {
+            int d = atoi(dim.c_str());
+
+            if (d <= 0)
+            {
+                std::cout << "bad input shape: " << shape << "\n";
+                return false;
+            }
+
+            dims.push_back(d);
+        }
+
+        tensor_t tensor = get_graph_input_tensor(graph, input_idx, 0);
+
+        if (tensor == nullptr)
+        {
+            std::cout << "the graph has no input #" << input_idx << "\n";
+            return false;
+        }
+
+        if (set_tensor_shape(tensor, dims.data(), dims.size()) < 0)
+        {
+            std::cout << "set shape of input #" << input_idx << " failed\n";
+            return false;
+        }
+
+        input_idx++;
+    }
+
+    return true;
+}
+
+/* the images to calibrate with and how to turn them into the NCHW input */
+struct calib_config
+{
+    std::vector<std::string> images;
+    int channel;
+    int height;
+    int width;
+    float mean[3];
+    float scale[3];
+    bool rgb;
+    bool letterbox;
+};
+
+static bool parse_floats(const std::string& list, float* val, int max_num)
+{
+    std::stringstream val_list(list);
+    std::string item;
+    int num = 0;
+
+    while (std::getline(val_list, item, ',') && num < max_num)
+        val[num++] = atof(item.c_str());
+
+    if (num == 0)
+        return false;
+
+    /* one value for all the channels */
+    for (int i = num; i < max_num; i++)
+        val[i] = val[num - 1];
+
+    return true;
+}
+
+/* "mean:104,117,123;scale:0.017;rgb;letterbox" */
+static bool parse_preprocess(const std::string& preprocess, calib_config& config)
+{
+    std::stringstream item_list(preprocess);
+    std::string item;
+
+    while (std::getline(item_list, item, ';'))
+    {
+        if (item == "rgb")
+            config.rgb = true;
+        else if (item == "letterbox")
+            config.letterbox = true;
+        else if (item.compare(0, 5, "mean:") == 0 && parse_floats(item.substr(5), config.mean, 3))
+            continue;
+        else if (item.compare(0, 6, "scale:") == 0 && parse_floats(item.substr(6), config.scale, 3))
+            continue;
+        else
+        {
+            std::cout << "bad preprocess: " << item << "\n";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool is_image_file(const std::string& name)
+{
+    static const char* exts[] = {".jpg", ".jpeg", ".png", ".bmp", ".tga"};
+    std::string::size_type dot = name.rfind('.');
+
+    if (dot == std::string::npos)
+        return false;
+
+    for (auto ext : exts)
+    {
+        if (strcasecmp(name.c_str() + dot, ext) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+static bool list_images(const std::string& dir_name, std::vector<std::string>& images)
+{
+    DIR* dir = opendir(dir_name.c_str());
+
+    if (dir == nullptr)
+    {
+        std::cout << "Calibration image dir does not exist: " << dir_name << "\n";
+        return false;
+    }
+
+    struct dirent* entry;
+
+    while ((entry = readdir(dir)) != nullptr)
+    {
+        if (is_image_file(entry->d_name))
+            images.push_back(dir_name + "/" + entry->d_name);
+    }
+
+    closedir(dir);
+
+    std::sort(images.begin(), images.end());
+
+    if (images.empty())
+    {
+        std::cout << "no image in: " << dir_name << "\n";
+        return false;
+    }
+
+    return true;
+}
+
+/* called by calibrate_graph() from several threads: the helpers only allocate */
+static int get_calib_sample(int idx, float* data, int size, void* arg)
+{
+    const calib_config* config = ( const calib_config* )arg;
+    int plane = config->height * config->width;
+
+    if (size != config->channel * plane)
+        return -1;
+
+    /* not load_image_stb(): it exits on a bad image, from a worker thread */
+    image im = try_load_image_stb(config->images[idx].c_str(), config->channel);
+
+    if (im.data == nullptr)
+        return -1;
+
+    if (config->channel == 3 && !config->rgb)
+        im = rgb2bgr_premute(im);
+
+    image resized;
+
+    if (config->letterbox)
+    {
+        /* letterbox pads with 0.5: gray for the pixels in [0, 1] */
+        multi(im, 1.f / 255, im);
+        resized = letterbox(im, config->width, config->height);
+        multi(resized, 255.f, resized);
+    }
+    else
+        resized = resize_image(im, config->width, config->height);
+
+    free_image(im);
+
+    for (int c = 0; c < config->channel; c++)
+    {
+        for (int i = 0; i < plane; i++)
+            data[c * plane + i] = (resized.data[c * plane + i] - config->mean[c]) * config->scale[c];
+    }
+
+    free_image(resized);
+
+    return 0;
+}
+
+static bool calibrate(graph_t graph, calib_config& config, const std::string& method)
+{
+    tensor_t tensor = get_graph_input_tensor(graph, 0, 0);
+    int dims[MAX_SHAPE_DIM_NUM];
+
+    if (tensor == nullptr || get_tensor_shape(tensor, dims, MAX_SHAPE_DIM_NUM) != 4 || dims[0] != 1 ||
+        (dims[1] != 1 && dims[1] != 3))
+    {
+        std::cout << "calibration needs one input of shape 1,3,h,w or 1,1,h,w\n";
+        return false;
+    }
+
+    config.channel = dims[1];
+    config.height = dims[2];
+    config.width = dims[3];
+
+    std::cout << "Calibrate with " << config.images.size() << " images\n";
+
+    return calibrate_graph(graph, config.images.size(), get_calib_sample, &config, method.c_str()) == 0;
+}
+
+/* "conv_eltwise,...": the fusions the optimizer would skip for want of kernels */
+static bool set_fusions(graph_t graph, const std::string& fusions)
+{
+    static const char* known_fusions[] = {"conv_eltwise", "activation", "transformer"};
+
+    std::stringstream fusion_list(fusions);
+    std::string fusion;
+
+    while (std::getline(fusion_list, fusion, ','))
+    {
+        if (std::find(std::begin(known_fusions), std::end(known_fusions), fusion) == std::end(known_fusions))
+        {
+            std::cout << "unknown fusion: " << fusion << "\n";
+            return false;
+        }
+
+        std::string attr_name = "fuse_" + fusion;
+        int fuse = 1;
+
+        if (set_graph_attr(graph, attr_name.c_str(), &fuse, sizeof(int)) < 0)
+        {
+            std::cout << "set fusion " << fusion << " failed\n";
+            return false;
+        }
+    }
+
+    return true;
+}
+
 void show_usage()
 {
     fprintf(stderr, "%s\n", help_params);
@@ -55,9 +318,22 @@ int main(int argc, char* argv[])
     bool proto_file_needed = false;
     bool model_file_needed = false;
     int input_file_number = 0;
+    bool to_nchw = false;
+    std::string prepack_schemes;
+    std::string input_shapes;
+    std::string report_file;
+    std::string calib_dir;
+    std::string calib_method = "kl";
+    std::string preprocess;
+
+    std::string fusions;
+
+    static const struct option long_options[] = {{"report", required_argument, nullptr, 'r'},
+                                                 {"fuse", required_argument, nullptr, 'u'},
+                                                 {nullptr, 0, nullptr, 0}};
 
     int res;
-    while ((res = getopt(argc, argv, "f:p:m:o:h")) != -1)
+    while ((res = getopt_long(argc, argv, "f:p:m:o:nk:s:r:c:q:e:u:h", long_options, nullptr)) != -1)
     {
         switch (res)
         {
@@ -73,6 +349,30 @@ int main(int argc, char* argv[])
             case 'o':
                 output_tmfile = optarg;
                 break;
+            case 'n':
+                to_nchw = true;
+                break;
+            case 'k':
+                prepack_schemes = optarg;
+                break;
+            case 's':
+                input_shapes = optarg;
+                break;
+            case 'r':
+                report_file = optarg;
+                break;
+            case 'c':
+                calib_dir = optarg;
+                break;
+            case 'q':
+                calib_method = optarg;
+                break;
+            case 'e':
+                preprocess = optarg;
+                break;
+            case 'u':
+                fusions = optarg;
+                break;
             case 'h':
                 show_usage();
                 return 0;
@@ -152,7 +452,7 @@ int main(int argc, char* argv[])
         }
     }
 
-    if (output_tmfile.empty())
+    if (output_tmfile.empty() && report_file.empty())
     {
         std::cout << "Please specify the -o option to indicate the output tengine model file.\n";
         return -1;
@@ -167,15 +467,22 @@ int main(int argc, char* argv[])
         }
     }
 
+    calib_config config = {};
+
+    config.scale[0] = config.scale[1] = config.scale[2] = 1.f;
+
+    if (!calib_dir.empty() && (!parse_preprocess(preprocess, config) || !list_images(calib_dir, config.images)))
+        return -1;
+
     // init tengine
     init_tengine();
 
-    // create graph
+    // create graph, it is the only user of the model: no copy of it is kept
     graph_t graph = nullptr;
     if (input_file_number == 2)
-        graph = create_graph(nullptr, file_format.c_str(), proto_file.c_str(), model_file.c_str());
+        graph = create_graph_exclusive(nullptr, file_format.c_str(), proto_file.c_str(), model_file.c_str());
     else if (input_file_number == 1)
-        graph = create_graph(nullptr, file_format.c_str(), model_file.c_str());
+        graph = create_graph_exclusive(nullptr, file_format.c_str(), model_file.c_str());
 
     if (graph == nullptr)
     {
@@ -183,7 +490,38 @@ int main(int argc, char* argv[])
         return -1;
     }
 
+    if (to_nchw && set_graph_layout(graph, TENGINE_LAYOUT_NCHW) < 0)
+    {
+        std::cout << "convert to nchw layout failed\n";
+        return -1;
+    }
+
+    if (!fusions.empty() && !set_fusions(graph, fusions))
+        return -1;
+
     const char* env = std::getenv("TM_NO_OPTIMIZE");
+
+    if (!input_shapes.empty() || !report_file.empty() || !calib_dir.empty())
+    {
+        /* the shapes are resolved by prerun */
+        if (env != nullptr)
+        {
+            std::cout << "the -s, -r and -c options do not work with TM_NO_OPTIMIZE\n";
+            return -1;
+        }
+
+        /* only -s asks for the shapes and the memory plan in the tmfile: -r and -c just need them */
+        const char* shape_attr = input_shapes.empty() ? "infer_shape" : "static_shape";
+        int shape_flag = 1;
+
+        if ((!input_shapes.empty() && !set_input_shapes(graph, input_shapes)) ||
+            set_graph_attr(graph, shape_attr, &shape_flag, sizeof(int)) < 0)
+        {
+            std::cout << "set input shapes failed\n";
+            return -1;
+        }
+    }
+
     if (env == nullptr)
     {
         // optimize graph
@@ -201,15 +539,43 @@ int main(int argc, char* argv[])
         }
     }
 
-    // Save the tengine model file
-    if (save_graph(graph, "tengine", output_tmfile.c_str()) == -1)
+    /* on the optimized graph: the fusions change the tensors */
+    if (!calib_dir.empty() && !calibrate(graph, config, calib_method))
+    {
+        std::cout << "calibration failed\n";
+        return -1;
+    }
+
+    /* last: the optimizations above may still change the weights */
+    if (!prepack_schemes.empty() && prepack_graph_weights(graph, prepack_schemes.c_str()) < 0)
     {
-        std::cout << "Create tengine model file failed.\n";
+        std::cout << "prepack weights failed\n";
         return -1;
     }
+
+    if (!report_file.empty())
+    {
+        if (report_graph_cost(graph, 20, report_file.c_str()) < 0)
+        {
+            std::cout << "report graph cost failed\n";
+            return -1;
+        }
+
+        std::cout << "Graph cost report saved: " << report_file << "\n";
+    }
+
+    // Save the tengine model file
+    if (!output_tmfile.empty())
+    {
+        if (save_graph(graph, "tengine", output_tmfile.c_str()) == -1)
+        {
+            std::cout << "Create tengine model file failed.\n";
+            return -1;
+        }
 #ifndef __EMSCRIPTEN__
-    std::cout << "Create tengine model file done: " << output_tmfile << "\n";
+        std::cout << "Create tengine model file done: " << output_tmfile << "\n";
 #endif
+    }
 
     destroy_graph(graph);
 #ifndef __EMSCRIPTEN__
@@ -8,6 +8,16 @@
 #endif
 
 image load_image_stb(const char* filename, int channels)
+{
+    image im = try_load_image_stb(filename, channels);
+
+    if (!im.data)
+        exit(0);
+
+    return im;
+}
+
+image try_load_image_stb(const char* filename, int channels)
 {
     int w, h, c;
     unsigned char* data = stbi_load(filename, &w, &h, &c, channels);
@@ -15,7 +25,7 @@ image load_image_stb(const char* filename, int channels)
     if (!data)
     {
         fprintf(stderr, "Cannot load image \"%s\"\nSTB Reason: %s\n", filename, stbi_failure_reason());
-        exit(0);
+        return make_empty_image(0, 0, 0);
     }
     if (channels)
         c = channels;
@@ -37,6 +37,8 @@ typedef struct image
 } image;
 
 image load_image_stb(const char* filename, int channels);
+/* the same, but the data is NULL if the image cannot be loaded, instead of exiting */
+image try_load_image_stb(const char* filename, int channels);
 image make_image(int w, int h, int c);
 image make_empty_image(int w, int h, int c);
 void draw_label(image a, int r, int c, image label, const float* rgb);
@@ -87,6 +87,7 @@ protected:
     bool LoadModelFile(const char* fname, oneflow::SavedModel& model);
     void LoadConstNode(const oneflow::GraphDef& onnx_graph, StaticGraph* graph);
     bool LoadGraph(const oneflow::GraphDef& model, const std::string &checkpoint_dir, StaticGraph* graph);
+    bool LoadCheckpoint(const std::string& checkpoint_dir, const std::vector<StaticTensor*>& tensors);
     bool LoadConstTensor(StaticGraph* graph, const oneflow::GraphDef& onnx_graph);
     void CreateInputNode(StaticGraph* graph, const oneflow::GraphDef& onnx_graph);
     bool LoadNode(StaticGraph* graph, StaticNode**, const oneflow::OperatorConf&);
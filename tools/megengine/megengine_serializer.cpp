@@ -14,6 +14,7 @@
 
 #include "logger.hpp"
 #include "operator_manager.hpp"
+#include "tensor_permute.hpp"
 #include "operator/conv_param.hpp"
 #include "operator/pool_param.hpp"
 #include "operator/concat_param.hpp"
@@ -571,19 +572,10 @@ static bool LoadMGEMatrixMul(StaticGraph* graph, StaticNode* node, const mgb::cg
         weight_tensor->dims[0] = n;
         weight_tensor->dims[1] = k;
 
-        float* tmp = ( float* )malloc(k * n * sizeof(float));
         // if second input is not const, this would not work
         float* data = ( float* )GetConstTensorBuffer(weight_tensor);
 
-        for(int i = 0; i < n; i++)
-            for(int j = 0; j < k; j++)
-            {
-                tmp[i * k + j] = data[j * n + i];
-            }
-
-        memcpy(data, tmp, n * k * sizeof(float));
-
-        free(tmp);
+        TransposeDataInPlace(data, 1, k, n, sizeof(float));
     }
 
     StaticOp* op = CreateStaticOp(graph, "FullyConnected");
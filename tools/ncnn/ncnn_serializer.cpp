@@ -783,7 +783,7 @@ bool NcnnSerializer::LoadGraph(StaticGraph* graph, const std::vector<NcnnNode>&
 #endif
     for(int i = 0; i < graph->tensor_list.size(); i++)
     {
-        StaticTensor* stttensor = graph->tensor_list[i].get();
+        StaticTensor* stttensor = graph->tensor_list[i];
     }
     return true;
 }
@@ -26,6 +26,12 @@
 #include <google/protobuf/io/zero_copy_stream_impl.h>
 #include <google/protobuf/text_format.h>
 #include <google/protobuf/message.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
 #include <algorithm>
 #include <vector>
 
@@ -77,6 +83,7 @@
 
 #include "type_name.hpp"
 #include "compiler.hpp"
+#include "parallel_task.hpp"
 
 #include "oneflow_serializer.hpp"
 
@@ -289,6 +296,8 @@ bool OneFlowSerializer::LoadGraph(const oneflow::GraphDef& model, const std::str
 
     CreateInputNode(graph, model);
 
+    std::vector<StaticTensor*> var_tensors;
+
     for (const auto& op : model.op_list())
     {
         if (op.has_input_conf() || op.has_return_conf())
@@ -298,15 +307,137 @@ bool OneFlowSerializer::LoadGraph(const oneflow::GraphDef& model, const std::str
         StaticNode* node;
         if (!LoadNode(graph, &node, op))
         {
-            break;
+            return false;
         }
 
         auto* converter = GetConverterForOpConf(op);
         if (!converter->convert(graph, node, checkpoint_dir, op))
         {
-            break;
+            return false;
+        }
+
+        if (op.has_variable_conf())
+            var_tensors.push_back(FindConstTensor(graph, op.name() + "/out"));
+    }
+
+    return LoadCheckpoint(checkpoint_dir, var_tensors);
+}
+
+static bool ReadVariableFile(const std::string& file_path, char* buf, size_t mem_size, std::string& err)
+{
+    int fd = open(file_path.c_str(), O_RDONLY);
+
+    if (fd < 0)
+    {
+        err = "cannot open " + file_path + ": " + strerror(errno);
+        return false;
+    }
+
+    struct stat st;
+
+    if (fstat(fd, &st) < 0)
+    {
+        err = "cannot stat " + file_path + ": " + strerror(errno);
+        close(fd);
+        return false;
+    }
+
+    if (( size_t )st.st_size != mem_size)
+    {
+        err = file_path + ": file size " + std::to_string(st.st_size) + " does not match tensor size " +
+              std::to_string(mem_size);
+        close(fd);
+        return false;
+    }
+
+    size_t done = 0;
+
+    while (done < mem_size)
+    {
+        ssize_t ret = pread(fd, buf + done, mem_size - done, done);
+
+        if (ret < 0 && errno == EINTR)
+            continue;
+
+        if (ret <= 0)
+        {
+            err = "read " + file_path + " failed: " + (ret < 0 ? strerror(errno) : "unexpected end of file");
+            close(fd);
+            return false;
         }
+
+        done += ret;
     }
+
+    close(fd);
+
+    return true;
+}
+
+/*
+ * Each variable lives in its own file, checkpoint_dir/<var_name>/out.
+ * Large checkpoints have thousands of them, so read the files concurrently
+ * and only attach the buffers to the tensors when every read succeeded.
+ */
+bool OneFlowSerializer::LoadCheckpoint(const std::string& checkpoint_dir, const std::vector<StaticTensor*>& tensors)
+{
+    int var_num = tensors.size();
+
+    std::vector<char*> buffers(var_num, nullptr);
+    std::vector<std::string> errors(var_num);
+
+    auto load_var = [&](int i) {
+        StaticTensor* tensor = tensors[i];
+
+        size_t mem_size = sizeof(float);
+        for (int dim : GetTensorDim(tensor))
+            mem_size *= dim;
+
+        const std::string file_path = checkpoint_dir + "/" + GetTensorName(tensor);
+
+        char* buf = static_cast<char*>(std::malloc(mem_size));
+
+        if (buf == nullptr)
+        {
+            errors[i] = "cannot allocate " + std::to_string(mem_size) + " bytes for " + file_path;
+            return;
+        }
+
+        if (!ReadVariableFile(file_path, buf, mem_size, errors[i]))
+        {
+            std::free(buf);
+            return;
+        }
+
+        buffers[i] = buf;
+    };
+
+    /* the loads are I/O bound: allow more threads than cores, but keep the number of open files bounded */
+    ParallelRun(var_num, load_var, 16);
+
+    bool ret = true;
+
+    for (int i = 0; i < var_num; i++)
+    {
+        if (!errors[i].empty())
+        {
+            LOG_ERROR() << "oneflow serializer: " << errors[i] << "\n";
+            ret = false;
+        }
+    }
+
+    if (!ret)
+    {
+        for (char* buf : buffers)
+            std::free(buf);
+
+        set_tengine_errno(EIO);
+        return false;
+    }
+
+    for (int i = 0; i < var_num; i++)
+        SetConstTensorBuffer(tensors[i], buffers[i]);
+
     return true;
 }
 
@@ -396,17 +527,7 @@ DEFINE_ONEFLOW_CONVERTER(variable)
     const size_t mem_size = sizeof(float) * size;
     SetTensorSize(tensor, mem_size);
 
-    char* mem_buf = static_cast<char*>(std::malloc(mem_size));
-    {
-        const std::string file_path = checkpoint_dir + "/" + node_name + "/out";
-        std::ifstream file(file_path, std::ios::binary | std::ios::ate);
-        std::streamsize file_len = file.tellg();
-        assert(file_len == mem_size);
-        file.seekg(0, std::ios::beg);
-        file.read(mem_buf, file_len);
-    }
-
-    SetConstTensorBuffer(tensor, mem_buf);
+    /* the buffer is filled by LoadCheckpoint() once the whole graph is built */
     SetConstTensorFileLocation(tensor, -1, 0);
     StaticOp* op = CreateStaticOp(graph, "Const");
     SetNodeOp(node, op);
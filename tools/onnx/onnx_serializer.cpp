@@ -75,10 +75,13 @@
 #include "operator/depthtospace_param.hpp"
 #include "operator/lstm_param.hpp"
 #include "operator/instancenorm_param.hpp"
+#include "operator/layernorm_param.hpp"
+#include "operator/gelu_param.hpp"
 #include "operator/resize_param.hpp"
 
 
 #include "type_name.hpp"
+#include "tensor_permute.hpp"
 #include "compiler.hpp"
 
 #include "onnx_serializer.hpp"
@@ -977,15 +980,12 @@ static bool LoadOnnxGemm(StaticGraph* graph, StaticNode* node, const onnx::NodeP
         float* tmp = ( float* )malloc(k * n * sizeof(float));
         float* data = ( float* )GetConstTensorBuffer(weight_tensor);
 
-        for (int i = 0; i < n; i++)
-            for (int j = 0; j < k; j++)
-            {
-                tmp[i * k + j] = data[j * n + i];
-            }
+        TransposeData(data, tmp, 1, k, n, sizeof(float));
 
-        memcpy(data, tmp, n * k * sizeof(float));
+        /* the loader mallocs every const buffer, so hand over tmp instead of copying it back */
+        SetConstTensorBuffer(weight_tensor, tmp);
 
-        free(tmp);
+        free(data);
     }
 
     if (param.alpha != 1)
@@ -1655,16 +1655,12 @@ static bool LoadOnnxMatMul(StaticGraph* graph, StaticNode* node, const onnx::Nod
         float* tmp = ( float* )malloc(k * n * sizeof(float));
         float* data = ( float* )GetConstTensorBuffer(weight_tensor);
 
-        for (int i = 0; i < n; i++)
-        {
-            for (int j = 0; j < k; j++)
-            {
-                tmp[i * k + j] = data[j * n + i];
-            }
-        }
-        memcpy(data, tmp, n * k * sizeof(float));
+        TransposeData(data, tmp, 1, k, n, sizeof(float));
 
-        free(tmp);
+        /* the loader mallocs every const buffer, so hand over tmp instead of copying it back */
+        SetConstTensorBuffer(weight_tensor, tmp);
+
+        free(data);
 
         StaticOp* op = CreateStaticOp(graph, "FullyConnected");
 
@@ -2991,6 +2987,55 @@ static bool LoadOnnxInstanceNormalization(StaticGraph* graph, StaticNode* node,
 
     return true;
 }
+static bool LoadOnnxErf(StaticGraph* graph, StaticNode* node, const onnx::NodeProto& onnx_node)
+{
+    UnaryParam param = any_cast<UnaryParam>(OpManager::GetOpDefParam("Unary"));
+    param.type = UNARY_ERF;
+    StaticOp* op = CreateStaticOp(graph, "Unary");
+    SetOperatorParam(op, param);
+    SetNodeOp(node, op);
+
+    return true;
+}
+
+static bool LoadOnnxLayerNormalization(StaticGraph* graph, StaticNode* node, const onnx::NodeProto& onnx_node)
+{
+    LayerNormParam param = any_cast<LayerNormParam>(OpManager::GetOpDefParam("LayerNorm"));
+
+    for (int k = 0; k < onnx_node.attribute_size(); k++)
+    {
+        const onnx::AttributeProto& attr = onnx_node.attribute(k);
+        if (attr.name() == "epsilon")
+            param.eps = attr.f();
+        else if (attr.name() == "axis")
+            param.axis = attr.i();
+    }
+
+    StaticOp* op = CreateStaticOp(graph, "LayerNorm");
+    SetOperatorParam(op, param);
+    SetNodeOp(node, op);
+
+    return true;
+}
+
+static bool LoadOnnxGelu(StaticGraph* graph, StaticNode* node, const onnx::NodeProto& onnx_node)
+{
+    GeluParam param = any_cast<GeluParam>(OpManager::GetOpDefParam("Gelu"));
+
+    for (int k = 0; k < onnx_node.attribute_size(); k++)
+    {
+        const onnx::AttributeProto& attr = onnx_node.attribute(k);
+        if (attr.name() == "approximate")
+            param.approximate = attr.s() == "tanh" ? 1 : 0;
+    }
+
+    StaticOp* op = CreateStaticOp(graph, "Gelu");
+    SetOperatorParam(op, param);
+    SetNodeOp(node, op);
+
+    return true;
+}
+
 // To register all op loader...
 bool OnnxSerializerRegisterOpLoader(void)
 {
@@ -3085,6 +3130,9 @@ bool OnnxSerializerRegisterOpLoader(void)
     p_onnx->RegisterOpLoadMethod("Resize", op_load_t(LoadOnnxResize));
     p_onnx->RegisterOpLoadMethod("Reciprocal", op_load_t(LoadOnnxReciprocal));
     p_onnx->RegisterOpLoadMethod("InstanceNormalization", op_load_t(LoadOnnxInstanceNormalization));
+    p_onnx->RegisterOpLoadMethod("Erf", op_load_t(LoadOnnxErf));
+    p_onnx->RegisterOpLoadMethod("LayerNormalization", op_load_t(LoadOnnxLayerNormalization));
+    p_onnx->RegisterOpLoadMethod("Gelu", op_load_t(LoadOnnxGelu));
 
     return true;
 }
@@ -35,6 +35,7 @@
 #include "tengine_errno.hpp"
 #include "static_graph.hpp"
 #include "operator_manager.hpp"
+#include "tensor_permute.hpp"
 
 #include <google/protobuf/io/coded_stream.h>
 #include <google/protobuf/io/zero_copy_stream_impl.h>
@@ -664,13 +665,7 @@ static bool LoadPaddleFullyconnected(StaticGraph* graph, StaticNode* node, const
         int rows = weight->dims[0];
         int cols = weight->dims[1];
         float* new_data = (float*)std::malloc(rows * cols * sizeof(float));
-        for (int col = 0; col < cols; col++)
-        {
-            for (int row = 0; row < rows; row++)
-            {
-                new_data[col * rows + row] = data[row * cols + col];
-            }
-        }
+        TransposeData(data, new_data, 1, rows, cols, sizeof(float));
         free(data);
         SetConstTensorBuffer(weight, new_data);
         weight->dims[0] = cols;
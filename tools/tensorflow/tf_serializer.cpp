@@ -75,6 +75,7 @@
 #include "operator/sparsetodense_param.hpp"
 
 #include "operator_manager.hpp"
+#include "tensor_permute.hpp"
 #include "type_name.hpp"
 
 namespace TEngine {
@@ -1391,7 +1392,8 @@ bool TFSerializer::OptimizeGraph(TFGraph& tf_graph)
             }
         }
 
-        if (cur_node->op == "Identity")
+        /* StopGradient only matters for training, as in the moments of a layer norm */
+        if (cur_node->op == "Identity" || cur_node->op == "StopGradient")
         {
             TFNode* input_node = cur_node->inputs[0];
             MergeChildNode(input_node, cur_node);
@@ -2231,17 +2233,8 @@ static bool LoadConv2D(TFNode* tf_node, TFGraph& tf_graph, StaticGraph* graph)
     float* new_weight = ( float* )malloc(sizeof(float) * elem_size);
     float* src = ( float* )GetConstTensorBuffer(weight_tensor);
 
-    // in tensorflow, weight shape is [hwio]
-    float* dst = new_weight;
-
-    for (int o = 0; o < out_channel; o++)
-        for (int h = 0; h < kernel_h; h++)
-            for (int w = 0; w < kernel_w; w++)
-                for (int i = 0; i < in_channel; i++)
-                {
-                    *dst++ = src[h * (kernel_w * in_channel * out_channel) + w * (in_channel * out_channel) +
-                                 i * out_channel + o];
-                }
+    // in tensorflow, weight shape is [hwio]: [hwi][o] --> [o][hwi]
+    TransposeData(src, new_weight, 1, kernel_h * kernel_w * in_channel, out_channel, sizeof(float));
 
     // free src and set dst
     free(src);
@@ -3347,18 +3340,9 @@ static bool LoadGemm(TFNode* tf_node, TFGraph& tf_graph, StaticGraph* graph)
         weight_tensor->dims[0] = n;
         weight_tensor->dims[1] = k;
 
-        float* tmp = ( float* )malloc(k * n * sizeof(float));
         float* data = ( float* )GetConstTensorBuffer(weight_tensor);
 
-        for (int i = 0; i < n; i++)
-            for (int j = 0; j < k; j++)
-            {
-                tmp[i * k + j] = data[j * n + i];
-            }
-
-        memcpy(data, tmp, n * k * sizeof(float));
-
-        free(tmp);
+        TransposeDataInPlace(data, 1, k, n, sizeof(float));
     }
 
     StaticOp* op = CreateStaticOp(graph, "FullyConnected");
@@ -4271,6 +4255,10 @@ static bool LoadUnary(TFNode* tf_node, TFGraph& tf_graph, StaticGraph* graph)
     {
         param.type = 14;
     }
+    else if (tf_node->op == "Erf")
+    {
+        param.type = UNARY_ERF;
+    }
 
     StaticOp* op = CreateStaticOp(graph, "Unary");
     SetOperatorParam(op, param);
@@ -4483,6 +4471,7 @@ bool TFSerializerRegisterOpLoader(void)
     p_tf->RegisterOpLoadMethod("Acos", op_load_t(LoadUnary));
     p_tf->RegisterOpLoadMethod("Atan", op_load_t(LoadUnary));
     p_tf->RegisterOpLoadMethod("Reciprocal", op_load_t(LoadUnary));
+    p_tf->RegisterOpLoadMethod("Erf", op_load_t(LoadUnary));
     p_tf->RegisterOpLoadMethod("Rsqrt", op_load_t(LoadUnary));
     p_tf->RegisterOpLoadMethod("Rqrt", op_load_t(LoadUnary));
     p_tf->RegisterOpLoadMethod("Square", op_load_t(LoadUnary));